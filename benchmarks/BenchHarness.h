@@ -0,0 +1,304 @@
+/**
+ * @file BenchHarness.h
+ * @brief Минимальный каркас микробенчмарков в духе Google Benchmark.
+ *
+ * Бенчмарк — функция void(CBenchState&) с циклом
+ * `while (state.KeepRunning()) { ... }`. Число итераций подбирается
+ * удвоением, пока замер не займёт не меньше minTime секунд; затем
+ * результат (нс/итерация, элементов/с) печатается таблицей или
+ * выгружается в CSV/JSON для сравнения прогонов.
+ *
+ * Внешняя зависимость (google/benchmark) не подключается: ядро собирается
+ * только с OpenCV, и бенчмарки должны собираться там же.
+ *
+ * @par Пример
+ * @code
+ *   CBenchRunner runner;
+ *   runner.Add("Approximate/deg8", [&](CBenchState& st) {
+ *     while (st.KeepRunning()) DoNotOptimize(approx.Approximate(pts, 8));
+ *     st.SetItemsProcessed(st.Iterations() * (int64_t)pts.size());
+ *   });
+ *   return runner.Run(argc, argv);
+ * @endcode
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Interferometry {
+namespace Bench {
+
+/// Не дать компилятору выбросить вычисление value
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+  static volatile const void* sink;
+  sink = &value;
+  _ReadWriteBarrier();
+#else
+  asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+//=============================================================================
+// Состояние одного замера
+//=============================================================================
+class CBenchState {
+ public:
+  explicit CBenchState(int64_t maxIterations) : m_max(maxIterations) {}
+
+  /// true, пока нужны итерации; первый вызов запускает часы
+  bool KeepRunning() {
+    if (m_done == 0 && !m_running) Start();
+    if (m_done < m_max) {
+      m_done++;
+      return true;
+    }
+    Stop();
+    return false;
+  }
+
+  /// Исключить подготовку итерации из замера
+  void PauseTiming() { Stop(); }
+  void ResumeTiming() { Start(); }
+
+  int64_t Iterations() const { return m_done; }
+  double ElapsedSeconds() const { return m_elapsed; }
+
+  void SetItemsProcessed(int64_t items) { m_items = items; }
+  int64_t ItemsProcessed() const { return m_items; }
+
+  /// Пометка в отчёте (размер, число линий и т.п.)
+  void SetLabel(const std::string& label) { m_label = label; }
+  const std::string& Label() const { return m_label; }
+
+  /// Бенчмарк не может выполниться на этих данных
+  void SkipWithError(const std::string& error) {
+    m_error = error;
+    m_max = 0;
+  }
+  const std::string& Error() const { return m_error; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void Start() {
+    m_running = true;
+    m_start = Clock::now();
+  }
+  void Stop() {
+    if (!m_running) return;
+    m_elapsed += std::chrono::duration<double>(Clock::now() - m_start).count();
+    m_running = false;
+  }
+
+  int64_t m_max;
+  int64_t m_done = 0;
+  bool m_running = false;
+  double m_elapsed = 0.0;
+  Clock::time_point m_start;
+  int64_t m_items = 0;
+  std::string m_label;
+  std::string m_error;
+};
+
+struct CBenchResult {
+  std::string name;
+  std::string label;
+  std::string error;
+  int64_t iterations = 0;
+  double nsPerIter = 0.0;
+  double itemsPerSec = 0.0;
+};
+
+//=============================================================================
+// Регистрация и запуск
+//=============================================================================
+class CBenchRunner {
+ public:
+  using BenchFn = std::function<void(CBenchState&)>;
+
+  void Add(const std::string& name, BenchFn fn) {
+    m_benches.push_back({name, std::move(fn)});
+  }
+
+  /**
+   * @brief Разбор ключей и запуск.
+   *
+   * --filter=SUBSTR      только бенчмарки, в имени которых есть SUBSTR
+   * --min_time=SEC       минимальное время замера (0.2)
+   * --format=console|csv|json
+   * --out=FILE           отчёт в файл (по умолчанию — stdout)
+   *
+   * Неизвестные ключи оставляются вызывающему (см. Args()).
+   */
+  int Run(int argc, char* argv[]) {
+    ParseArgs(argc, argv);
+
+    std::vector<CBenchResult> results;
+    for (const auto& b : m_benches) {
+      if (!m_filter.empty() && b.name.find(m_filter) == std::string::npos)
+        continue;
+      CBenchResult r = RunOne(b);
+      if (m_format == "console") PrintConsoleRow(std::cout, r);
+      results.push_back(r);
+    }
+
+    if (m_format != "console") {
+      std::ostringstream report;
+      report.imbue(std::locale::classic());
+      if (m_format == "json")
+        WriteJson(report, results);
+      else
+        WriteCsv(report, results);
+
+      if (m_outFile.empty()) {
+        std::cout << report.str();
+      } else {
+        std::ofstream out(m_outFile, std::ios::binary);
+        out << report.str();
+        if (!out.good()) {
+          std::cerr << "Не удалось записать " << m_outFile << std::endl;
+          return 1;
+        }
+      }
+    }
+
+    for (const auto& r : results)
+      if (!r.error.empty()) return 1;
+    return 0;
+  }
+
+ private:
+  struct Entry {
+    std::string name;
+    BenchFn fn;
+  };
+
+  void ParseArgs(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+      std::string a = argv[i];
+      auto value = [&](const char* key) -> const char* {
+        size_t n = std::string(key).size();
+        return a.compare(0, n, key) == 0 ? argv[i] + n : nullptr;
+      };
+      if (const char* v = value("--filter="))
+        m_filter = v;
+      else if (const char* v = value("--min_time="))
+        m_minTime = std::max(0.001, std::atof(v));
+      else if (const char* v = value("--format="))
+        m_format = v;
+      else if (const char* v = value("--out="))
+        m_outFile = v;
+    }
+    if (m_format != "csv" && m_format != "json") m_format = "console";
+
+    if (m_format == "console")
+      std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+                << std::setw(14) << "Time, ns" << std::setw(12)
+                << "Iterations" << std::setw(14) << "Items/s"
+                << "  Label" << std::endl;
+  }
+
+  /// Удвоение числа итераций, пока замер не займёт m_minTime
+  CBenchResult RunOne(const Entry& b) const {
+    CBenchResult r;
+    r.name = b.name;
+    for (int64_t n = 1;; n = NextIterations(n, r)) {
+      CBenchState st(n);
+      b.fn(st);
+      r.label = st.Label();
+      r.error = st.Error();
+      r.iterations = st.Iterations();
+      if (!r.error.empty() || r.iterations == 0) return r;
+
+      double sec = st.ElapsedSeconds();
+      r.nsPerIter = 1e9 * sec / (double)r.iterations;
+      r.itemsPerSec = sec > 0 ? st.ItemsProcessed() / sec : 0.0;
+      if (sec >= m_minTime || n >= kMaxIterations) return r;
+    }
+  }
+
+  int64_t NextIterations(int64_t n, const CBenchResult& r) const {
+    // Оценка по текущему замеру с запасом, но не более чем в 10 раз
+    double perIter = r.nsPerIter > 0 ? r.nsPerIter * 1e-9 : 1e-9;
+    double want = 1.4 * m_minTime / perIter;
+    int64_t next = (int64_t)std::min(want, 10.0 * (double)n);
+    return std::min(kMaxIterations, std::max(next, n + 1));
+  }
+
+  static void PrintConsoleRow(std::ostream& out, const CBenchResult& r) {
+    out << std::left << std::setw(48) << r.name << std::right;
+    if (!r.error.empty()) {
+      out << "  ОШИБКА: " << r.error << std::endl;
+      return;
+    }
+    out << std::fixed << std::setprecision(0) << std::setw(14) << r.nsPerIter
+        << std::setw(12) << r.iterations << std::setw(14);
+    if (r.itemsPerSec > 0)
+      out << std::setprecision(0) << r.itemsPerSec;
+    else
+      out << "-";
+    out << "  " << r.label << std::endl;
+  }
+
+  static std::string Escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+      if (c == '"' || c == '\\') out += '\\';
+      out += c;
+    }
+    return out;
+  }
+
+  static void WriteCsv(std::ostream& out,
+                       const std::vector<CBenchResult>& results) {
+    out << "name,iterations,ns_per_iter,items_per_sec,label,error\n";
+    out << std::fixed << std::setprecision(1);
+    for (const auto& r : results)
+      out << r.name << "," << r.iterations << "," << r.nsPerIter << ","
+          << r.itemsPerSec << ",\"" << r.label << "\",\"" << r.error
+          << "\"\n";
+  }
+
+  static void WriteJson(std::ostream& out,
+                        const std::vector<CBenchResult>& results) {
+    out << "{\n  \"benchmarks\": [\n" << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < results.size(); i++) {
+      const CBenchResult& r = results[i];
+      out << "    {\"name\": \"" << Escape(r.name)
+          << "\", \"iterations\": " << r.iterations
+          << ", \"ns_per_iter\": " << r.nsPerIter
+          << ", \"items_per_sec\": " << r.itemsPerSec << ", \"label\": \""
+          << Escape(r.label) << "\", \"error\": \"" << Escape(r.error)
+          << "\"}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+  }
+
+  static constexpr int64_t kMaxIterations = 1000000000;
+
+  std::vector<Entry> m_benches;
+  std::string m_filter;
+  std::string m_format = "console";
+  std::string m_outFile;
+  double m_minTime = 0.2;
+};
+
+}  // namespace Bench
+}  // namespace Interferometry
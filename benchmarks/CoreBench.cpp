@@ -0,0 +1,1142 @@
+/**
+ * @file CoreBench.cpp
+ * @brief Микробенчмарки ядер трассировки на кадрах test_images/ и на
+ *        синтетических полосах нескольких размеров и плотностей.
+ *
+ * Ядра:
+ * - CFringeTracer: TraceLine, MeasureWidth, CenterPerpendicular,
+ *   TraceSubpixel (время Extract и RMS аппроксимации по режимам центра)
+ * - CFringeSkeletonizer: Skeletonize (Zhang-Suen), граф скелета —
+ *   GraphBuild, Prune, Link (бывшие PruneSkeleton / LinkBrokenLines)
+ * - CEllipseBoundary::SetEllipse (границы строк + маска; повёрнутый зрачок
+ *   с тремя заслонками)
+ * - CPolynomialApproximator::Approximate, ApproximateBatch
+ * - CFringeOrderer::Assign (нумерация полос по профилям)
+ * - CWavefrontFitter::Fit (Цернике по точкам полос)
+ * - CViewport::Render: полная перерисовка окна, сдвиг на 16 пикселей
+ *   (перерисовка открывшейся полосы) при масштабе «весь кадр» и 2:1
+ * - COverlay::Update: растеризация всего слоя разметки, добавление и
+ *   удаление одной линии
+ * - MaskedStats / MaskedThreshold (отрезки зрачка) против попиксельного
+ *   IsInside и байтовой маски на кадрах 2048x2048 и 4096x3072
+ * - CPupilDetector::Detect на всех кадрах и на синтетике 2048x2048 и
+ *   4096x3072 с экранированием и без (метка — отклонение от истинного
+ *   зрачка)
+ * - CFrnReader::Parse, CFrnWriter::Format (архивные .frn)
+ * - CMatrixReader: разбор .phs / .mtr из test_images/, чтение через кэш
+ * - CProjectReader: открытие .ifp целиком и только с секцией линий
+ * - ImageLoader::Load против cv::imread + cvtColor на кадрах test_images/
+ *
+ * Имя бенчмарка — "<ядро>/<кадр>", кадр — имя файла или
+ * synth_<w>x<h>_p<период>. Синтетика: 360x290 (SCAN360), 720x576,
+ * 1440x1152 с периодом полос 8, 16 и 32 пикселя.
+ *
+ * @par Использование
+ * @code
+ *   CoreBench                                    # всё, консольная таблица
+ *   CoreBench --filter=Skeletonize/synth
+ *   CoreBench --images=none --format=json --out=bench.json
+ *   CoreBench --images=D:/frames --min_time=0.5
+ * @endcode
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BenchHarness.h"
+#include "EllipseBoundary.h"
+#include "FringeOrderer.h"
+#include "FringeSkeletonizer.h"
+#include "FringeTracer.h"
+#include "FrnFile.h"
+#include "ImageLoader.h"
+#include "MatrixFile.h"
+#include "Overlay.h"
+#include "PolynomialApproximator.h"
+#include "ProjectFile.h"
+#include "PupilDetector.h"
+#include "PupilSpans.h"
+#include "SkeletonGraph.h"
+#include "SyntheticFringes.h"
+#include "Viewport.h"
+#include "WavefrontFitter.h"
+
+#ifndef INTERFEROMETRY_SOURCE_DIR
+#define INTERFEROMETRY_SOURCE_DIR "."
+#endif
+
+namespace Interferometry {
+
+// Доступ к закрытым ядрам (friend в CFringeTracer и CFringeSkeletonizer)
+struct CBenchAccess {
+  static bool MeasureWidth(const CFringeTracer& t, CTraceContext& ctx, int x,
+                           int y, float& width, int& direction) {
+    return t.MeasureWidth(ctx, x, y, width, direction);
+  }
+  static bool CenterPerpendicular(const CFringeTracer& t,
+                                  const CTraceContext& ctx, int& x, int& y,
+                                  int dx, int dy) {
+    return t.CenterPerpendicular(ctx, x, y, dx, dy);
+  }
+  static bool BuildBinary(CFringeSkeletonizer& s) { return s.BuildBinary(); }
+  static void Skeletonize(const CFringeSkeletonizer& s, const cv::Mat& binary,
+                          cv::Mat& skeleton) {
+    s.Skeletonize(binary, skeleton);
+  }
+};
+
+}  // namespace Interferometry
+
+using namespace Interferometry;
+using namespace Interferometry::Bench;
+namespace fs = std::filesystem;
+
+namespace {
+
+//=============================================================================
+// Подготовленный кадр
+//=============================================================================
+
+/// Точка трассированной линии: вход MeasureWidth (ширина-подсказка,
+/// как в начале TraceLine) и CenterPerpendicular (направление шага и
+/// состояние контекста после MeasureWidth)
+struct CLineSample {
+  int x, y, dx, dy;
+  float hintWidth;
+  float wideLine, average;
+};
+
+/**
+ * @brief Кадр со всем, что нужно бенчмаркам: граница, трассировщик,
+ *        бинаризация, скелет и граф. Строится один раз; трассировщик
+ *        и скелетизатор держат указатель на boundary, поэтому кадр
+ *        живёт в shared_ptr и не перемещается.
+ */
+struct CFrame {
+  std::string name;
+  cv::Mat image;
+  EllipseParams pupil;
+  CEllipseBoundary boundary;
+
+  CFringeTracer tracer;
+  std::vector<CSeedPoint> seeds;
+  std::vector<CLineSample> lineSamples;
+
+  CFringeSkeletonizer skeletonizer;
+  cv::Mat binary;
+  cv::Mat skeleton;
+  CSkeletonGraph graph;        // сразу после Build
+  CSkeletonGraph prunedGraph;  // после Prune — вход Link
+
+  std::string Label() const {
+    return std::to_string(image.cols) + "x" + std::to_string(image.rows);
+  }
+};
+
+/// Стартовые точки: локальные максимумы профиля центральной строки
+std::vector<CSeedPoint> FindSeeds(const cv::Mat& image,
+                                  const CEllipseBoundary& boundary) {
+  const int cy = image.rows / 2;
+  std::vector<float> profile(image.cols, 0.0f);
+  for (int x = 0; x < image.cols; x++) {
+    for (int dy = -2; dy <= 2; dy++)
+      profile[x] += image.at<uchar>(cv::borderInterpolate(cy + dy, image.rows,
+                                                          cv::BORDER_REFLECT),
+                                    x);
+    profile[x] /= 5.0f;
+  }
+  double sum = 0;
+  int cnt = 0;
+  boundary.ForEachSpan(cy, cy + 1, [&](int, int x0, int x1) {
+    for (int x = x0; x < (std::min)(x1, image.cols); x++) sum += profile[x];
+    cnt += (std::max)(0, (std::min)(x1, image.cols) - x0);
+  });
+  const float mean = cnt > 0 ? (float)(sum / cnt) : 0.0f;
+
+  std::vector<CSeedPoint> seeds;
+  const int R = 4;
+  for (int x = R; x < image.cols - R; x++) {
+    if (!boundary.IsInside(x, cy) || profile[x] <= mean) continue;
+    bool isMax = true;
+    for (int d = -R; d <= R && isMax; d++)
+      if (profile[x + d] > profile[x]) isMax = false;
+    if (!isMax) continue;
+    seeds.push_back(CSeedPoint(x, cy));
+    x += R;
+  }
+  return seeds;
+}
+
+std::shared_ptr<CFrame> PrepareFrame(const std::string& name,
+                                     const cv::Mat& image,
+                                     const EllipseParams& pupil) {
+  auto f = std::make_shared<CFrame>();
+  f->name = name;
+  f->image = image;
+  f->pupil = pupil;
+  f->boundary.Initialize(image.cols, image.rows);
+  f->boundary.SetEllipse(pupil, true);
+
+  // Трассировщик: один поток, интегральное изображение
+  CTracerParams tp;
+  tp.numThreads = 1;
+  tp.useIntegralImage = true;
+  f->tracer.SetParams(tp);
+  f->tracer.Initialize(image, f->boundary);
+  f->seeds = FindSeeds(image, f->boundary);
+
+  // Входы MeasureWidth / CenterPerpendicular — точки трассированных линий
+  CTraceContext ctx;
+  for (const CSeedPoint& s : f->seeds) {
+    std::vector<CTracerPoint> line;
+    if (!f->tracer.TraceLine(ctx, s.x, s.y, line)) continue;
+    for (size_t i = 1; i < line.size(); i++) {
+      int dx = line[i].x - line[i - 1].x;
+      int dy = line[i].y - line[i - 1].y;
+      float hint = (std::max)(line[i].width, 5.0f);
+      float width = 0.0f;
+      int dir = 0;
+      ctx.wideLine = hint;
+      ctx.average = 0.0f;
+      if ((dx == 0 && dy == 0) ||
+          !CBenchAccess::MeasureWidth(f->tracer, ctx, line[i].x, line[i].y,
+                                      width, dir))
+        continue;
+      f->lineSamples.push_back({line[i].x, line[i].y, (dx > 0) - (dx < 0),
+                                (dy > 0) - (dy < 0), hint, ctx.wideLine,
+                                ctx.average});
+    }
+  }
+
+  // Скелетизатор: бинаризация, скелет, граф — входы для ядер по отдельности
+  f->skeletonizer.Initialize(image, f->boundary);
+  if (CBenchAccess::BuildBinary(f->skeletonizer)) {
+    f->binary = f->skeletonizer.GetBinary().clone();
+    CBenchAccess::Skeletonize(f->skeletonizer, f->binary, f->skeleton);
+    f->graph.Build(f->skeleton);
+    f->prunedGraph = f->graph;
+    f->prunedGraph.Prune(f->skeletonizer.GetParams().pruneLength);
+  }
+  return f;
+}
+
+//=============================================================================
+// Наборы кадров
+//=============================================================================
+
+bool IsImageFile(const fs::path& path) {
+  std::string ext = path.extension().string();
+  for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+  if (ext == ".bmp" || ext == ".png" || ext == ".jpg" || ext == ".jpeg" ||
+      ext == ".tif" || ext == ".tiff")
+    return true;
+  // raw SCAN360 без расширения: 360 x 290 байт
+  std::error_code ec;
+  return ext.empty() && fs::file_size(path, ec) == 360u * 290u && !ec;
+}
+
+std::vector<std::shared_ptr<CFrame>> LoadFrames(const std::string& dir) {
+  std::vector<fs::path> files;
+  std::error_code ec;
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec))
+    if (it->is_regular_file(ec) && IsImageFile(it->path()))
+      files.push_back(it->path());
+  std::sort(files.begin(), files.end());
+
+  std::vector<std::shared_ptr<CFrame>> frames;
+  for (const fs::path& p : files) {
+    ImageLoader loader;
+    if (!loader.Load(p.string())) {
+      std::cerr << "Пропуск (не загружается): " << p.string() << std::endl;
+      continue;
+    }
+    const cv::Mat& img = loader.GetImage();
+    // Вписанный эллипс, как в TracerBench: ядра меряются на всём кадре
+    EllipseParams pupil(img.cols / 2, img.rows / 2, img.cols / 2 - 10,
+                        img.rows / 2 - 10);
+    frames.push_back(PrepareFrame(p.filename().string(), img, pupil));
+  }
+  return frames;
+}
+
+std::vector<std::shared_ptr<CFrame>> MakeSyntheticFrames() {
+  const cv::Size sizes[] = {{360, 290}, {720, 576}, {1440, 1152}};
+  const int periods[] = {8, 16, 32};
+
+  std::vector<std::shared_ptr<CFrame>> frames;
+  for (const cv::Size& sz : sizes)
+    for (int period : periods) {
+      CSyntheticFringes s = MakeSyntheticFringes(sz.width, sz.height, period);
+      std::string name = "synth_" + std::to_string(sz.width) + "x" +
+                         std::to_string(sz.height) + "_p" +
+                         std::to_string(period);
+      frames.push_back(PrepareFrame(name, s.image, s.pupil));
+    }
+  return frames;
+}
+
+/// Найденный зрачок; с truth — отклонение центра и полуосей от него
+std::string PupilLabel(const CPupilDetection& d, const EllipseParams* truth) {
+  if (!d.hasOuter) return "зрачок не найден";
+  std::ostringstream out;
+  const EllipseParams& e = d.outer;
+  if (truth) {
+    out << "ошибка центра " << e.centerX - truth->centerX << ","
+        << e.centerY - truth->centerY << ", полуосей "
+        << e.semiAxisA - truth->semiAxisA << ","
+        << e.semiAxisB - truth->semiAxisB;
+  } else {
+    out << "зрачок " << e.centerX << "," << e.centerY << " " << e.semiAxisA
+        << "x" << e.semiAxisB;
+  }
+  out << ", inliers " << d.outerInliers << "/" << d.outerPoints.size();
+  if (d.hasInner)
+    out << ", экранирование " << d.inner.semiAxisA << "x"
+        << d.inner.semiAxisB;
+  return out.str();
+}
+
+//=============================================================================
+// Бенчмарки кадра
+//=============================================================================
+
+void RegisterFrame(CBenchRunner& runner, std::shared_ptr<CFrame> f) {
+  runner.Add("TraceLine/" + f->name, [f](CBenchState& st) {
+    if (f->seeds.empty()) return st.SkipWithError("нет стартовых точек");
+    CTraceContext ctx;
+    std::vector<CTracerPoint> line;
+    int64_t points = 0;
+    size_t k = 0;
+    while (st.KeepRunning()) {
+      const CSeedPoint& s = f->seeds[k++ % f->seeds.size()];
+      f->tracer.TraceLine(ctx, s.x, s.y, line);
+      points += (int64_t)line.size();
+    }
+    st.SetItemsProcessed(points);  // точек линий в секунду
+    st.SetLabel(f->Label() + ", " + std::to_string(f->seeds.size()) +
+                " линий");
+  });
+
+  // Те же стартовые точки во всех режимах: метка — средний RMS полинома
+  // p = 5 по линиям, т. е. выигрыш точности при равном числе точек
+  const std::pair<ESubpixelMode, const char*> subpixelModes[] = {
+      {ESubpixelMode::None, "none"},
+      {ESubpixelMode::Parabolic, "parabolic"},
+      {ESubpixelMode::Centroid, "centroid"}};
+  for (const auto& mode : subpixelModes) {
+    const std::string name = "TraceSubpixel/" + f->name + "_" + mode.second;
+    runner.Add(name, [f, mode](CBenchState& st) {
+      if (f->seeds.empty()) return st.SkipWithError("нет стартовых точек");
+      CTracerParams tp;
+      tp.numThreads = 1;
+      tp.useIntegralImage = true;
+      tp.subpixel = mode.first;
+      CFringeTracer tracer;
+      tracer.SetParams(tp);
+      tracer.Initialize(f->image, f->boundary);
+
+      std::vector<std::vector<CTracerPoint>> lines;
+      while (st.KeepRunning()) {
+        lines = tracer.Extract(f->seeds);
+        DoNotOptimize(lines);
+      }
+
+      CPolynomialApproximator approximator;
+      DegreeSelection selection;
+      selection.criterion = EDegreeCriterion::Fixed;
+      selection.degree = 5;
+      std::vector<DegreeResidual> residuals;
+      double sumRms = 0.0;
+      int fitted = 0;
+      for (const auto& line : lines) {
+        if (!approximator.Approximate(line, selection, &residuals).valid)
+          continue;
+        for (const DegreeResidual& r : residuals)
+          if (r.degree == selection.degree) {
+            sumRms += r.rms;
+            fitted++;
+          }
+      }
+      std::ostringstream label;
+      label << f->Label() << ", RMS p=5 " << std::fixed
+            << std::setprecision(3) << (fitted ? sumRms / fitted : 0.0);
+      st.SetLabel(label.str());
+    });
+  }
+
+  runner.Add("MeasureWidth/" + f->name, [f](CBenchState& st) {
+    if (f->lineSamples.empty()) return st.SkipWithError("нет точек линий");
+    CTraceContext ctx;
+    size_t k = 0;
+    while (st.KeepRunning()) {
+      const CLineSample& s = f->lineSamples[k++ % f->lineSamples.size()];
+      float width = 0.0f;
+      int dir = 0;
+      ctx.wideLine = s.hintWidth;
+      ctx.average = 0.0f;
+      DoNotOptimize(
+          CBenchAccess::MeasureWidth(f->tracer, ctx, s.x, s.y, width, dir));
+      DoNotOptimize(width);
+    }
+    st.SetItemsProcessed(st.Iterations());
+    st.SetLabel(f->Label());
+  });
+
+  runner.Add("CenterPerpendicular/" + f->name, [f](CBenchState& st) {
+    if (f->lineSamples.empty()) return st.SkipWithError("нет точек линий");
+    CTraceContext ctx;
+    size_t k = 0;
+    while (st.KeepRunning()) {
+      const CLineSample& s = f->lineSamples[k++ % f->lineSamples.size()];
+      ctx.wideLine = s.wideLine;
+      ctx.average = s.average;
+      int x = s.x, y = s.y;
+      DoNotOptimize(CBenchAccess::CenterPerpendicular(f->tracer, ctx, x, y,
+                                                      s.dx, s.dy));
+      DoNotOptimize(x + y);
+    }
+    st.SetItemsProcessed(st.Iterations());
+    st.SetLabel(f->Label());
+  });
+
+  runner.Add("Skeletonize/" + f->name, [f](CBenchState& st) {
+    if (f->binary.empty()) return st.SkipWithError("бинаризация не удалась");
+    cv::Mat skeleton;
+    while (st.KeepRunning())
+      CBenchAccess::Skeletonize(f->skeletonizer, f->binary, skeleton);
+    st.SetItemsProcessed(st.Iterations() * (int64_t)f->binary.total());
+    st.SetLabel(f->Label());  // items — пикселей кадра
+  });
+
+  runner.Add("GraphBuild/" + f->name, [f](CBenchState& st) {
+    if (f->skeleton.empty()) return st.SkipWithError("нет скелета");
+    CSkeletonGraph graph;
+    while (st.KeepRunning()) graph.Build(f->skeleton);
+    st.SetItemsProcessed(st.Iterations() * (int64_t)f->skeleton.total());
+    st.SetLabel(f->Label() + ", " + std::to_string(f->graph.CountAliveEdges()) +
+                " рёбер");
+  });
+
+  // Prune и Link меняют граф: копия исходного — вне замера
+  runner.Add("Prune/" + f->name, [f](CBenchState& st) {
+    if (f->skeleton.empty()) return st.SkipWithError("нет скелета");
+    const int len = f->skeletonizer.GetParams().pruneLength;
+    CSkeletonGraph graph;
+    int removed = 0;
+    while (st.KeepRunning()) {
+      st.PauseTiming();
+      graph = f->graph;
+      st.ResumeTiming();
+      removed = graph.Prune(len);
+    }
+    st.SetLabel(f->Label() + ", удалено " + std::to_string(removed));
+  });
+
+  runner.Add("Link/" + f->name, [f](CBenchState& st) {
+    if (f->skeleton.empty()) return st.SkipWithError("нет скелета");
+    const int dist = f->skeletonizer.GetParams().linkDistance;
+    CSkeletonGraph graph;
+    int linked = 0;
+    while (st.KeepRunning()) {
+      st.PauseTiming();
+      graph = f->prunedGraph;
+      st.ResumeTiming();
+      linked = graph.LinkEndpoints(dist);
+    }
+    st.SetLabel(f->Label() + ", перемычек " + std::to_string(linked));
+  });
+
+  runner.Add("SetEllipse/" + f->name, [f](CBenchState& st) {
+    CEllipseBoundary boundary;
+    boundary.Initialize(f->image.cols, f->image.rows);
+    while (st.KeepRunning()) boundary.SetEllipse(f->pupil, true);
+    st.SetItemsProcessed(st.Iterations() * (int64_t)f->image.rows);
+    st.SetLabel(f->Label());  // items — строк границы
+  });
+
+  // Повёрнутый зрачок и три заслонки: квадратное уравнение на строку и
+  // объединение дырок
+  runner.Add("SetEllipse/Rotated+3screens/" + f->name, [f](CBenchState& st) {
+    const EllipseParams& p = f->pupil;
+    const EllipseParams outer(p.centerX, p.centerY, p.semiAxisA,
+                              p.semiAxisB * 9 / 10, 25.0f);
+    const int r = (std::max)(p.semiAxisB / 8, 1);
+    const EllipseParams screens[] = {
+        EllipseParams(p.centerX, p.centerY, r, r),
+        EllipseParams(p.centerX - p.semiAxisA / 2, p.centerY, r, r / 2, 30.0f),
+        EllipseParams(p.centerX + p.semiAxisA / 2, p.centerY, r, r / 2, -30.0f)};
+    CEllipseBoundary boundary;
+    boundary.Initialize(f->image.cols, f->image.rows);
+    while (st.KeepRunning()) {
+      boundary.SetDefaultBoundaries();
+      boundary.SetEllipse(outer, true);
+      for (const EllipseParams& e : screens) boundary.SetEllipse(e, false);
+    }
+    st.SetItemsProcessed(st.Iterations() * 4 * (int64_t)f->image.rows);
+    st.SetLabel(f->Label());  // items — строк границы
+  });
+
+  runner.Add("PupilDetect/" + f->name, [f](CBenchState& st) {
+    CPupilDetector detector;
+    CPupilDetection pupil;
+    while (st.KeepRunning()) detector.Detect(f->image, pupil);
+    st.SetItemsProcessed(st.Iterations());  // кадров в секунду
+    st.SetLabel(f->Label() + ", " + PupilLabel(pupil, nullptr));
+  });
+}
+
+//=============================================================================
+// Аппроксимация — синтетические линии
+//=============================================================================
+
+void RegisterApproximation(CBenchRunner& runner) {
+  const int numPoints[] = {100, 500, 2000};
+  const int degrees[] = {4, 8, 12};
+
+  for (int n : numPoints)
+    for (int degree : degrees) {
+      // Полоса поперёк кадра: y = f(x) плюс шум дискретизации
+      auto points = std::make_shared<std::vector<CTracerPoint>>();
+      cv::RNG rng(n * 31 + degree);
+      for (int i = 0; i < n; i++) {
+        double t = (double)i / (n - 1);
+        double y = 200.0 + 40.0 * std::sin(3.0 * t) + 15.0 * t * t;
+        points->push_back(
+            CTracerPoint(i, (int)std::lround(y + rng.gaussian(0.5))));
+      }
+
+      std::string name = "Approximate/n" + std::to_string(n) + "_deg" +
+                         std::to_string(degree);
+      runner.Add(name, [points, degree](CBenchState& st) {
+        CPolynomialApproximator approx;
+        while (st.KeepRunning())
+          DoNotOptimize(approx.Approximate(*points, degree));
+        st.SetItemsProcessed(st.Iterations() * (int64_t)points->size());
+      });
+
+      // Перебор степеней 1..20 для выбора модели — один раз на n
+      if (degree != degrees[0]) continue;
+      runner.Add("ApproximateSweep/n" + std::to_string(n) + "_deg1-20",
+                 [points](CBenchState& st) {
+                   CPolynomialApproximator approx;
+                   while (st.KeepRunning())
+                     for (int d = 1; d <= CPolynomialApproximator::MAX_DEGREE;
+                          d++)
+                       DoNotOptimize(approx.Approximate(*points, d));
+                   st.SetItemsProcessed(st.Iterations() *
+                                        (int64_t)points->size());
+                 });
+    }
+
+  // Пакет из 64 линий по 500 точек в CSR: один поток против всех ядер
+  auto batchPoints = std::make_shared<std::vector<CTracerPoint>>();
+  auto batchOffsets = std::make_shared<std::vector<int>>(1, 0);
+  cv::RNG rng(7);
+  for (int line = 0; line < 64; line++) {
+    for (int i = 0; i < 500; i++) {
+      double y = 20.0 * line + 8.0 * std::sin(0.01 * i + 0.3 * line);
+      batchPoints->push_back(
+          CTracerPoint(i, (int)std::lround(y + rng.gaussian(0.5))));
+    }
+    batchOffsets->push_back((int)batchPoints->size());
+  }
+
+  for (int threads : {1, 0}) {
+    std::string name = "ApproximateBatch/64x500_deg8_" +
+                       std::string(threads == 1 ? "1thread" : "allcores");
+    runner.Add(name, [batchPoints, batchOffsets, threads](CBenchState& st) {
+      CPolynomialApproximator approx;
+      BatchApproximationResult out;
+      const int numLines = (int)batchOffsets->size() - 1;
+      while (st.KeepRunning())
+        approx.ApproximateBatch(batchPoints->data(), batchOffsets->data(),
+                                numLines, 8, out, threads);
+      st.SetItemsProcessed(st.Iterations() * numLines);  // линий в секунду
+    });
+  }
+}
+
+//=============================================================================
+// Волновой фронт — точки на изолиниях синтетического фронта
+//=============================================================================
+
+void RegisterWavefront(CBenchRunner& runner) {
+  auto boundary = std::make_shared<CEllipseBoundary>();
+  boundary->Initialize(720, 576);
+  boundary->SetEllipse(EllipseParams(360, 288, 250, 250), true);
+  const CPupilGeometry pupil = CWavefrontFitter::PupilFromBoundary(*boundary);
+
+  // Фронт — наклон, дефокус и сферическая; точки — по сетке с шагом step,
+  // каждая точка — «линия» со своим порядком
+  for (int step : {4, 2}) {
+    auto lines = std::make_shared<std::vector<std::vector<CTracerPoint>>>();
+    auto orders = std::make_shared<std::vector<double>>();
+    for (int y = 0; y < 576; y += step)
+      for (int x = 0; x < 720; x += step) {
+        if (!boundary->IsInside(x, y)) continue;
+        double u = (x - pupil.centerX) / pupil.radiusX;
+        double v = (y - pupil.centerY) / pupil.radiusY;
+        double r2 = u * u + v * v;
+        lines->push_back({CTracerPoint(x, y)});
+        orders->push_back(3.0 * u + 1.5 * (2 * r2 - 1) +
+                          0.4 * (6 * r2 * r2 - 6 * r2 + 1));
+      }
+
+    const std::string points = std::to_string(lines->size() / 1000) + "k";
+    for (int mode = 0; mode < 3; mode++) {
+      static const char* const kModes[] = {"normal_1thread",
+                                           "normal_allcores", "qr"};
+      runner.Add("ZernikeFit/" + points + "_36terms_" + kModes[mode],
+                 [boundary, lines, orders, mode](CBenchState& st) {
+                   CWavefrontParams params;
+                   params.solver = mode == 2 ? EZernikeSolver::QR
+                                             : EZernikeSolver::NormalEquations;
+                   params.numThreads = mode == 0 ? 1 : 0;
+                   CWavefrontFitter fitter;
+                   fitter.SetParams(params);
+                   CWavefrontResult result;
+                   while (st.KeepRunning()) {
+                     if (!fitter.Fit(*lines, *orders, *boundary, result)) {
+                       st.SkipWithError(fitter.GetLastError());
+                       break;
+                     }
+                     DoNotOptimize(result.zernike);
+                   }
+                   st.SetItemsProcessed(st.Iterations() *
+                                        (int64_t)lines->size());
+                 });
+    }
+  }
+}
+
+// Полосы — изолинии наклона с кривизной: x = (k·period - c·y²) + x0,
+// в зрачке, точки через 2 пикселя; 20 и 80 полос
+void RegisterOrder(CBenchRunner& runner) {
+  for (int numFringes : {20, 80}) {
+    const int w = 720, h = 576, cx = w / 2, cy = h / 2, r = 270;
+    auto boundary = std::make_shared<CEllipseBoundary>();
+    boundary->Initialize(w, h);
+    boundary->SetEllipse(EllipseParams(cx, cy, r, r), true);
+    const double period = 2.0 * r / numFringes, c = 0.6 / r;
+
+    auto lines = std::make_shared<std::vector<std::vector<CTracerPoint>>>();
+    for (int k = -numFringes; k <= numFringes; k++) {
+      std::vector<CTracerPoint> line;
+      for (int y = 0; y < h; y += 2) {
+        double dy = y - cy;
+        CTracerPoint p;
+        p.SetPosition(cx + k * period - c * dy * dy, y);
+        if (boundary->IsInside(p.x, p.y)) line.push_back(p);
+      }
+      if (line.size() >= 2) lines->push_back(std::move(line));
+    }
+
+    runner.Add("FringeOrder/" + std::to_string(lines->size()) + "lines",
+               [boundary, lines](CBenchState& st) {
+                 CFringeOrderer orderer;
+                 CFringeOrderResult result;
+                 while (st.KeepRunning()) {
+                   if (!orderer.Assign(*lines, *boundary, result)) {
+                     st.SkipWithError(orderer.GetLastError());
+                     break;
+                   }
+                   DoNotOptimize(result.orders);
+                 }
+                 st.SetItemsProcessed(st.Iterations() * result.numCrossings);
+                 st.SetLabel(std::to_string(result.NumAssigned()) +
+                             " assigned, " +
+                             std::to_string(result.conflicts.size()) +
+                             " conflicts");
+               });
+  }
+}
+
+// Параболические линии через весь кадр w x h, точки через 2 пикселя
+std::shared_ptr<std::vector<std::vector<CTracerPoint>>> MakeCurvedLines(
+    int w, int h, int numLines) {
+  auto lines = std::make_shared<std::vector<std::vector<CTracerPoint>>>();
+  const double curv = 0.3 / h;
+  for (int k = 0; k < numLines; k++) {
+    std::vector<CTracerPoint> line;
+    for (int y = 0; y < h; y += 2) {
+      double dy = y - h / 2.0;
+      CTracerPoint p;
+      p.SetPosition((k + 0.5) * w / numLines - curv * dy * dy, y);
+      if (p.x >= 0 && p.x < w) line.push_back(p);
+    }
+    if (line.size() >= 2) lines->push_back(std::move(line));
+  }
+  return lines;
+}
+
+// Кадр 4096x3072 и 400 линий по ~1500 точек в окне 1280x960: полная
+// перерисовка и сдвиг на 16 пикселей туда-обратно (Render только полосы)
+void RegisterViewport(CBenchRunner& runner) {
+  const int w = 4096, h = 3072, numLines = 400;
+  auto frame = std::make_shared<cv::Mat>(
+      Bench::MakeSyntheticFringes(w, h, w / (double)numLines, 0.0, 1).image);
+  auto lines = MakeCurvedLines(w, h, numLines);
+
+  struct CCase {
+    const char* name;
+    double zoom;  // 0 — весь кадр в окне
+    bool pan;
+  };
+  for (const CCase& c : {CCase{"Redraw/fit", 0.0, false},
+                         CCase{"Pan16/fit", 0.0, true},
+                         CCase{"Pan16/zoom2", 2.0, true}}) {
+    runner.Add(std::string("Viewport/") + c.name,
+               [frame, lines, c](CBenchState& st) {
+                 CViewport view;
+                 view.SetImage(*frame);
+                 view.SetLines(*lines);
+                 view.Resize(1280, 960);
+                 view.FitToView();
+                 if (c.zoom > 0)
+                   view.ZoomAt(c.zoom / view.GetTransform().zoom, 640, 480);
+                 view.Render();
+                 view.ResetStats();
+
+                 int64_t tiles = 0;
+                 int step = 16;
+                 while (st.KeepRunning()) {
+                   if (c.pan) {
+                     view.Pan(step, 0);
+                     step = -step;
+                   } else {
+                     view.Invalidate();
+                   }
+                   tiles += view.Render();
+                   DoNotOptimize(view.GetBuffer().data);
+                 }
+                 st.SetItemsProcessed(tiles);
+                 std::ostringstream label;
+                 label << std::fixed << std::setprecision(1)
+                       << (double)tiles / (std::max)(st.Iterations(),
+                                                     (int64_t)1)
+                       << " tiles/frame, lod " << view.GetLodLevel();
+                 st.SetLabel(label.str());
+               });
+  }
+}
+
+// Слой 4096x3072 с границей и 400 линиями: растеризация целиком против
+// добавления и удаления одной линии (перерисовка только её охвата)
+void RegisterOverlay(CBenchRunner& runner) {
+  const int w = 4096, h = 3072, numLines = 400;
+  auto boundary = std::make_shared<CEllipseBoundary>();
+  boundary->Initialize(w, h);
+  boundary->SetEllipse(EllipseParams(w / 2, h / 2, 1500, 1450), true);
+  boundary->SetEllipse(EllipseParams(w / 2, h / 2, 300, 290), false);
+  auto lines = MakeCurvedLines(w, h, numLines);
+
+  auto build = [boundary, lines, w, h](COverlay& overlay) {
+    overlay.Reset(w, h);
+    overlay.SetBoundary(*boundary);
+    for (const auto& line : *lines) overlay.AddLine(line);
+    overlay.Update();
+  };
+
+  runner.Add("Overlay/Full/" + std::to_string(lines->size()) + "lines",
+             [build](CBenchState& st) {
+               COverlay overlay;
+               build(overlay);
+               while (st.KeepRunning()) {
+                 overlay.Invalidate();
+                 overlay.Update();
+                 DoNotOptimize(overlay.GetLayer().data);
+               }
+               st.SetItemsProcessed(st.Iterations());
+             });
+
+  runner.Add("Overlay/AddRemoveLine",
+             [build, lines](CBenchState& st) {
+               COverlay overlay;
+               build(overlay);
+               const auto& extra = (*lines)[lines->size() / 2];
+               int64_t area = 0;
+               std::vector<cv::Rect> changed;
+               while (st.KeepRunning()) {
+                 int id = overlay.AddLine(extra, MakeColor(255, 0, 0));
+                 overlay.Update(&changed);
+                 for (const cv::Rect& r : changed) area += r.area();
+                 overlay.RemoveLine(id);
+                 overlay.Update(&changed);
+                 for (const cv::Rect& r : changed) area += r.area();
+                 DoNotOptimize(overlay.GetLayer().data);
+               }
+               st.SetItemsProcessed(st.Iterations() * 2);
+               std::ostringstream label;
+               label << std::fixed << std::setprecision(1)
+                     << 100.0 * area /
+                            ((double)(std::max)(st.Iterations(),
+                                                (int64_t)1) *
+                             2.0 * overlay.Width() * overlay.Height())
+                     << "% of layer per update";
+               st.SetLabel(label.str());
+             });
+}
+
+//=============================================================================
+// Статистика по зрачку — отрезки строк против попиксельной проверки
+//=============================================================================
+
+void RegisterPupilSpans(CBenchRunner& runner) {
+  for (cv::Size size : {cv::Size(2048, 2048), cv::Size(4096, 3072)}) {
+    const int w = size.width, h = size.height;
+    auto boundary = std::make_shared<CEllipseBoundary>();
+    boundary->Initialize(w, h);
+    boundary->SetEllipse(EllipseParams(w / 2, h / 2, w * 2 / 5, h * 2 / 5,
+                                       20.0f),
+                         true);
+    boundary->SetEllipse(EllipseParams(w / 2, h / 2, w / 10, h / 10), false);
+    auto image = std::make_shared<cv::Mat>(h, w, CV_8UC1);
+    for (int y = 0; y < h; y++)
+      for (int x = 0; x < w; x++)
+        image->at<uchar>(y, x) = (uchar)(128 + 100 * std::sin(0.05 * x) *
+                                                   std::cos(0.03 * y));
+    const int64_t inside = boundary->CountInside();
+    const std::string name = std::to_string(w) + "x" + std::to_string(h);
+
+    runner.Add("PupilStats/IsInside/" + name,
+               [boundary, image, inside](CBenchState& st) {
+                 while (st.KeepRunning()) {
+                   uint64_t sum = 0, sum2 = 0;
+                   for (int y = 0; y < image->rows; y++) {
+                     const uchar* p = image->ptr<uchar>(y);
+                     for (int x = 0; x < image->cols; x++) {
+                       if (!boundary->IsInside(x, y)) continue;
+                       sum += p[x];
+                       sum2 += p[x] * p[x];
+                     }
+                   }
+                   DoNotOptimize(sum);
+                   DoNotOptimize(sum2);
+                 }
+                 st.SetItemsProcessed(st.Iterations() * inside);
+               });
+
+    runner.Add("PupilStats/InsideMask/" + name,
+               [boundary, image, inside](CBenchState& st) {
+                 const uint8_t* mask = boundary->GetInsideMask();
+                 const int stride = boundary->GetInsideMaskStride();
+                 while (st.KeepRunning()) {
+                   uint64_t sum = 0, sum2 = 0;
+                   for (int y = 0; y < image->rows; y++) {
+                     const uchar* p = image->ptr<uchar>(y);
+                     const uint8_t* m = mask + (size_t)y * stride;
+                     for (int x = 0; x < image->cols; x++) {
+                       const uint32_t v = p[x] & m[x];
+                       sum += v;
+                       sum2 += v * v;
+                     }
+                   }
+                   DoNotOptimize(sum);
+                   DoNotOptimize(sum2);
+                 }
+                 st.SetItemsProcessed(st.Iterations() * inside);
+               });
+
+    runner.Add("PupilStats/Spans/" + name,
+               [boundary, image, inside](CBenchState& st) {
+                 CMaskedStats stats;
+                 while (st.KeepRunning()) {
+                   stats = MaskedStats(*image, *boundary);
+                   DoNotOptimize(stats);
+                 }
+                 st.SetItemsProcessed(st.Iterations() * inside);
+                 st.SetLabel("среднее " + std::to_string(stats.mean));
+               });
+
+    runner.Add("PupilThreshold/MaskAnd/" + name,
+               [boundary, image, inside](CBenchState& st) {
+                 const cv::Mat mask(image->rows, image->cols, CV_8UC1,
+                                    const_cast<uint8_t*>(
+                                        boundary->GetInsideMask()),
+                                    boundary->GetInsideMaskStride());
+                 cv::Mat binary;
+                 while (st.KeepRunning()) {
+                   cv::threshold(*image, binary, 128, 255, cv::THRESH_BINARY);
+                   cv::bitwise_and(binary, mask, binary);
+                   DoNotOptimize(binary.data);
+                 }
+                 st.SetItemsProcessed(st.Iterations() * inside);
+               });
+
+    runner.Add("PupilThreshold/Spans/" + name,
+               [boundary, image, inside](CBenchState& st) {
+                 cv::Mat binary;
+                 while (st.KeepRunning()) {
+                   DoNotOptimize(MaskedThreshold(*image, binary, 128,
+                                                 *boundary));
+                 }
+                 st.SetItemsProcessed(st.Iterations() * inside);
+               });
+  }
+}
+
+//=============================================================================
+// Автоопределение зрачка — синтетика с известным зрачком
+//=============================================================================
+
+void RegisterPupilDetect(CBenchRunner& runner) {
+  for (cv::Size size : {cv::Size(2048, 2048), cv::Size(4096, 3072)}) {
+    for (bool screen : {false, true}) {
+      CSyntheticFringes s =
+          MakeSyntheticFringes(size.width, size.height, size.width / 40.0);
+      // Центральное экранирование — тёмный круг в треть апертуры
+      if (screen)
+        cv::circle(s.image, cv::Point(s.pupil.centerX, s.pupil.centerY),
+                   s.pupil.semiAxisA / 3, cv::Scalar(12), cv::FILLED);
+      auto image = std::make_shared<cv::Mat>(s.image);
+      const EllipseParams truth = s.pupil;
+      const std::string name = std::string("PupilDetect/") +
+                               (screen ? "screen_" : "") +
+                               std::to_string(size.width) + "x" +
+                               std::to_string(size.height);
+      runner.Add(name, [image, truth](CBenchState& st) {
+        CPupilDetector detector;
+        CPupilDetection pupil;
+        while (st.KeepRunning()) detector.Detect(*image, pupil);
+        st.SetItemsProcessed(st.Iterations());  // кадров в секунду
+        st.SetLabel(PupilLabel(pupil, &truth));
+      });
+    }
+  }
+}
+
+// Синтетический архив: 200 и 2000 линий по 500 точек (~1.8 и ~18 МБ .frn)
+void RegisterFrn(CBenchRunner& runner) {
+  for (int numLines : {200, 2000}) {
+    auto frn = std::make_shared<CFrnData>();
+    for (int i = 0; i < numLines; i++) {
+      frn->orders.push_back(i);
+      frn->lines.emplace_back();
+      for (int k = 0; k < 500; k++)
+        frn->lines.back().emplace_back((i * 37 + k * 11) % 4000,
+                                       (i * 13 + k * 7) % 4000);
+    }
+    auto text = std::make_shared<std::string>(CFrnWriter::Format(*frn));
+    const std::string name = std::to_string(numLines) + "lines_" +
+                             std::to_string(text->size() >> 20) + "MB";
+
+    runner.Add("FrnParse/" + name, [frn, text](CBenchState& st) {
+      CFrnReader reader;
+      CFrnData data;
+      while (st.KeepRunning()) {
+        if (!reader.Parse(text->data(), text->size(), data)) {
+          st.SkipWithError(reader.GetLastError());
+          break;
+        }
+        DoNotOptimize(data.lines);
+      }
+      st.SetItemsProcessed(st.Iterations() * (int64_t)text->size());
+    });
+    runner.Add("FrnFormat/" + name, [frn, text](CBenchState& st) {
+      while (st.KeepRunning()) {
+        std::string out = CFrnWriter::Format(*frn);
+        DoNotOptimize(out);
+      }
+      st.SetItemsProcessed(st.Iterations() * (int64_t)text->size());
+    });
+  }
+}
+
+// Сетки .phs / .mtr каталога: разбор текста в памяти (1 поток и все ядра)
+// и повторное открытие через двоичный кэш (копия во временном каталоге)
+void RegisterMatrix(CBenchRunner& runner, const std::string& dir) {
+  std::vector<fs::path> files;
+  std::error_code ec;
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    std::string ext = it->path().extension().string();
+    for (char& c : ext) c = (char)std::tolower((unsigned char)c);
+    if (it->is_regular_file(ec) && (ext == ".phs" || ext == ".mtr"))
+      files.push_back(it->path());
+  }
+  std::sort(files.begin(), files.end());
+
+  for (const fs::path& p : files) {
+    std::ifstream in(p, std::ios::binary);
+    auto text = std::make_shared<std::string>(
+        (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::string name = p.filename().string();
+
+    for (int threads : {1, 0}) {
+      runner.Add("MatrixParse/" + name + (threads ? "_1thread" : "_allcores"),
+                 [text, threads](CBenchState& st) {
+                   CMatrixFileParams params;
+                   params.numThreads = threads;
+                   CMatrixReader reader;
+                   reader.SetParams(params);
+                   CMatrixData data;
+                   while (st.KeepRunning()) {
+                     if (!reader.Parse(text->data(), text->size(), data)) {
+                       st.SkipWithError(reader.GetLastError());
+                       break;
+                     }
+                     DoNotOptimize(data.values);
+                   }
+                   st.SetItemsProcessed(st.Iterations() *
+                                        (int64_t)text->size());
+                 });
+    }
+
+    runner.Add("MatrixCache/" + name, [p](CBenchState& st) {
+      fs::path copy = fs::temp_directory_path() / ("CoreBench_" +
+                                                   p.filename().string());
+      std::error_code ec;
+      fs::copy_file(p, copy, fs::copy_options::overwrite_existing, ec);
+      CMatrixFileParams params;
+      params.useCache = true;
+      CMatrixReader reader;
+      reader.SetParams(params);
+      CMatrixData data;
+      if (ec || !reader.ReadFile(copy, data)) {  // первый проход пишет кэш
+        st.SkipWithError("не удалось подготовить " + copy.string());
+        return;
+      }
+      while (st.KeepRunning()) {
+        reader.ReadFile(copy, data);
+        DoNotOptimize(data.values);
+      }
+      if (!reader.FromCache()) st.SkipWithError("кэш не использован");
+      fs::remove(copy, ec);
+      fs::remove(CMatrixReader::CachePath(copy), ec);
+    });
+  }
+}
+
+// Кадры каталога: ImageLoader::Load (отображение файла, BMP/raw напрямую)
+// против прежнего пути cv::imread + cvtColor
+void RegisterImageLoad(CBenchRunner& runner, const std::string& dir) {
+  std::vector<fs::path> files;
+  std::error_code ec;
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec))
+    if (it->is_regular_file(ec) && IsImageFile(it->path()))
+      files.push_back(it->path());
+  std::sort(files.begin(), files.end());
+
+  for (const fs::path& p : files) {
+    const std::string name = p.filename().string();
+    runner.Add("ImageLoad/" + name, [p](CBenchState& st) {
+      ImageLoader loader;
+      while (st.KeepRunning()) {
+        if (!loader.Load(p.string())) {
+          st.SkipWithError("не загружается");
+          break;
+        }
+        DoNotOptimize(loader.GetImage().data);
+      }
+      st.SetItemsProcessed(st.Iterations() *
+                         (int64_t)loader.GetImage().total());
+    });
+
+    if (p.extension().empty()) continue;  // raw OpenCV не читает
+    runner.Add("ImageLoad/" + name + "_imread", [p](CBenchState& st) {
+      cv::Mat image, gray;
+      while (st.KeepRunning()) {
+        image = cv::imread(p.string(), cv::IMREAD_UNCHANGED);
+        if (image.channels() > 1) {
+          cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+          image = gray;
+        }
+        DoNotOptimize(image.data);
+      }
+      st.SetItemsProcessed(st.Iterations() * (int64_t)image.total());
+    });
+  }
+}
+
+// Проект 1440x1152 со встроенным кадром, 500 линий по 400 точек:
+// Open() + только линии против LoadAll()
+void RegisterProject(CBenchRunner& runner) {
+  const int w = 1440, h = 1152;
+  CProjectData project;
+  CEllipseBoundary boundary;
+  boundary.Initialize(w, h);
+  boundary.SetEllipse(EllipseParams(w / 2, h / 2, 600, 500), true);
+  project.SetBoundary(boundary);
+  project.hasOuter = true;
+  project.outerEllipse = EllipseParams(w / 2, h / 2, 600, 500);
+  project.pixels = cv::Mat(h, w, CV_8UC1, cv::Scalar(128));
+  for (int i = 0; i < 500; i++) {
+    project.orders.push_back(i);
+    project.lines.emplace_back();
+    for (int k = 0; k < 400; k++)
+      project.lines.back().emplace_back((i * 3 + k) % w, (k * 3) % h);
+  }
+
+  auto path = std::make_shared<fs::path>(fs::temp_directory_path() /
+                                         "CoreBench_project.ifp");
+  CProjectWriter writer;
+  if (!writer.WriteFile(*path, project)) return;
+
+  for (bool all : {false, true}) {
+    runner.Add(std::string("ProjectOpen/500lines_") +
+                   (all ? "all_sections" : "lines_only"),
+               [path, all](CBenchState& st) {
+                 CProjectReader reader;
+                 CProjectData data;
+                 while (st.KeepRunning()) {
+                   bool ok = reader.Open(*path) &&
+                             (all ? reader.LoadAll(data)
+                                  : reader.Load(EProjectSection::Lines, data));
+                   if (!ok) {
+                     st.SkipWithError(reader.GetLastError());
+                     break;
+                   }
+                   DoNotOptimize(data.lines);
+                 }
+               });
+  }
+}
+
+}  // namespace
+
+//=============================================================================
+// Main
+//=============================================================================
+
+int main(int argc, char* argv[]) {
+  std::string imagesDir =
+      std::string(INTERFEROMETRY_SOURCE_DIR) + "/test_images";
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a.compare(0, 9, "--images=") == 0) imagesDir = a.substr(9);
+  }
+
+  CBenchRunner runner;
+
+  std::vector<std::shared_ptr<CFrame>> frames;
+  if (imagesDir != "none") frames = LoadFrames(imagesDir);
+  for (auto& f : MakeSyntheticFrames()) frames.push_back(f);
+
+  for (auto& f : frames) RegisterFrame(runner, f);
+  RegisterApproximation(runner);
+  RegisterOrder(runner);
+  RegisterWavefront(runner);
+  RegisterViewport(runner);
+  RegisterOverlay(runner);
+  RegisterPupilSpans(runner);
+  RegisterPupilDetect(runner);
+  RegisterFrn(runner);
+  if (imagesDir != "none") {
+    RegisterImageLoad(runner, imagesDir);
+    RegisterMatrix(runner, imagesDir);
+  }
+  RegisterProject(runner);
+
+  return runner.Run(argc, argv);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file SyntheticFringes.h
+ * @brief Синтетические интерферограммы для бенчмарков: заданные размер
+ *        кадра и период полос, воспроизводимый шум.
+ *
+ * Полосы — наклон волнового фронта плюс небольшая дефокусировка, поэтому
+ * они слегка изогнуты, как на реальных кадрах. Вне круглой апертуры —
+ * тёмный фон (как у интерферограмм SCAN360).
+ */
+#pragma once
+
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+#include "EllipseBoundary.h"
+
+namespace Interferometry {
+namespace Bench {
+
+struct CSyntheticFringes {
+  cv::Mat image;          ///< CV_8UC1
+  EllipseParams pupil;    ///< апертура с запасом 2 пикселя
+};
+
+/**
+ * @param width, height  размер кадра
+ * @param period         период полос в центре апертуры, пикселей
+ * @param noiseSigma     СКО гауссова шума, уровней яркости
+ * @param seed           зерно шума (одинаковые параметры — одинаковый кадр)
+ */
+inline CSyntheticFringes MakeSyntheticFringes(int width, int height,
+                                              double period,
+                                              double noiseSigma = 6.0,
+                                              uint64_t seed = 12345) {
+  CSyntheticFringes out;
+  const double cx = 0.5 * width;
+  const double cy = 0.5 * height;
+  const double radius = 0.45 * (std::min)(width, height);
+
+  // Наклон под 10° и дефокус: на краю апертуры +1 полоса
+  const double tilt = 2.0 * CV_PI / period;
+  const double ct = std::cos(10.0 * CV_PI / 180.0);
+  const double st = std::sin(10.0 * CV_PI / 180.0);
+  const double defocus = 2.0 * CV_PI / (radius * radius);
+
+  cv::Mat1f intensity(height, width);
+  for (int y = 0; y < height; y++) {
+    float* row = intensity.ptr<float>(y);
+    double dy = y - cy;
+    for (int x = 0; x < width; x++) {
+      double dx = x - cx;
+      double r2 = dx * dx + dy * dy;
+      if (r2 > radius * radius) {
+        row[x] = 12.0f;
+        continue;
+      }
+      double phase = tilt * (dx * ct + dy * st) + defocus * r2;
+      row[x] = (float)(128.0 + 100.0 * std::cos(phase));
+    }
+  }
+
+  if (noiseSigma > 0) {
+    cv::Mat1f noise(height, width);
+    cv::RNG rng(seed);
+    rng.fill(noise, cv::RNG::NORMAL, 0.0, noiseSigma);
+    intensity += noise;
+  }
+  intensity.convertTo(out.image, CV_8UC1);  // с насыщением в [0, 255]
+
+  int r = (int)radius - 2;
+  out.pupil = EllipseParams((int)cx, (int)cy, r, r);
+  return out;
+}
+
+}  // namespace Bench
+}  // namespace Interferometry
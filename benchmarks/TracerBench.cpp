@@ -0,0 +1,154 @@
+/**
+ * @file TracerBench.cpp
+ * @brief Замер времени трассировки одной линии CFringeTracer:
+ *        поэлементный AverageIntensity (до) против интегрального
+ *        изображения (после).
+ *
+ * Трассировка идёт в один поток (numThreads = 1), чтобы время на линию
+ * не смешивалось с параллельностью Extract(). Обе конфигурации обязаны
+ * дать одинаковые точки — это проверяется и печатается.
+ *
+ * @par Использование
+ * @code
+ *   TracerBench                                  # tests/PipelineTest/bat2v31.bmp
+ *   TracerBench image.bmp
+ *   TracerBench image.bmp 185 181 170 165        # эллипс cx cy a b
+ *   TracerBench image.bmp 185 181 170 165 50     # + число повторов
+ * @endcode
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "EllipseBoundary.h"
+#include "FringeTracer.h"
+#include "ImageLoader.h"
+
+using namespace Interferometry;
+
+#ifndef INTERFEROMETRY_SOURCE_DIR
+#define INTERFEROMETRY_SOURCE_DIR "."
+#endif
+
+namespace {
+
+struct BenchResult {
+  double totalMs = 0.0;
+  int numLines = 0;
+  int numPoints = 0;
+  std::vector<std::vector<CTracerPoint>> lines;
+};
+
+/**
+ * @brief Трассировка всех стартовых точек repeats раз подряд.
+ *        Initialize() (и построение интегрального изображения)
+ *        в замер не входит — он делается один раз на кадр.
+ */
+BenchResult RunTrace(const cv::Mat& image, const CEllipseBoundary& boundary,
+                     const std::vector<CSeedPoint>& seeds, bool useIntegral,
+                     int repeats) {
+  CTracerParams params;
+  params.numThreads = 1;
+  params.useIntegralImage = useIntegral;
+
+  CFringeTracer tracer;
+  tracer.SetParams(params);
+  tracer.Initialize(image, boundary);
+
+  BenchResult res;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; r++) res.lines = tracer.Extract(seeds);
+  auto t1 = std::chrono::steady_clock::now();
+
+  res.totalMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  res.numLines = (int)res.lines.size();
+  for (const auto& l : res.lines) res.numPoints += (int)l.size();
+  return res;
+}
+
+bool SameLines(const std::vector<std::vector<CTracerPoint>>& a,
+               const std::vector<std::vector<CTracerPoint>>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].size() != b[i].size()) return false;
+    for (size_t j = 0; j < a[i].size(); j++) {
+      const CTracerPoint& p = a[i][j];
+      const CTracerPoint& q = b[i][j];
+      if (p.x != q.x || p.y != q.y || p.width != q.width ||
+          p.intensity != q.intensity)
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string imagePath =
+      std::string(INTERFEROMETRY_SOURCE_DIR) + "/tests/PipelineTest/bat2v31.bmp";
+  if (argc >= 2) imagePath = argv[1];
+
+  ImageLoader loader;
+  if (!loader.Load(imagePath)) {
+    std::cerr << "Не удалось загрузить " << imagePath << std::endl;
+    return 1;
+  }
+
+  int w = loader.GetWidth();
+  int h = loader.GetHeight();
+
+  // Эллипс по умолчанию — вписанный в кадр с запасом 10 пикселей
+  EllipseParams ellipse(w / 2, h / 2, w / 2 - 10, h / 2 - 10);
+  if (argc >= 6)
+    ellipse = EllipseParams(std::atoi(argv[2]), std::atoi(argv[3]),
+                            std::atoi(argv[4]), std::atoi(argv[5]));
+  int repeats = (argc >= 7) ? std::atoi(argv[6]) : 20;
+  if (repeats < 1) repeats = 1;
+
+  CEllipseBoundary boundary;
+  boundary.Initialize(w, h);
+  boundary.SetEllipse(ellipse, true);
+
+  // Стартовые точки — через 8 пикселей по центральной строке
+  std::vector<CSeedPoint> seeds;
+  for (int x = 0; x < w; x += 8)
+    if (boundary.IsInside(x, h / 2)) seeds.push_back(CSeedPoint(x, h / 2));
+
+  std::cout << "Изображение: " << imagePath << " (" << w << " x " << h
+            << ")" << std::endl;
+  std::cout << "Стартовых точек: " << seeds.size() << ", повторов: " << repeats
+            << std::endl;
+
+  BenchResult before = RunTrace(loader.GetImage(), boundary, seeds, false,
+                                repeats);
+  BenchResult after = RunTrace(loader.GetImage(), boundary, seeds, true,
+                               repeats);
+
+  auto report = [&](const char* name, const BenchResult& r) {
+    double perLineUs =
+        r.numLines > 0 ? 1000.0 * r.totalMs / (repeats * r.numLines) : 0.0;
+    std::cout << "  " << std::left << std::setw(22) << name << std::right
+              << " линий " << std::setw(4) << r.numLines << "  точек "
+              << std::setw(6) << r.numPoints << "  " << std::fixed
+              << std::setprecision(1) << std::setw(9) << perLineUs
+              << " мкс/линия" << std::endl;
+  };
+
+  report("3x3 поэлементно", before);
+  report("интегральное", after);
+
+  if (after.totalMs > 0.0)
+    std::cout << "  Ускорение: " << std::setprecision(2)
+              << before.totalMs / after.totalMs << "x" << std::endl;
+
+  bool same = SameLines(before.lines, after.lines);
+  std::cout << "  Результаты совпадают: " << (same ? "да" : "НЕТ")
+            << std::endl;
+
+  return same ? 0 : 2;
+}
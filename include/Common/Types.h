@@ -1,4 +1,5 @@
 #pragma once
+#include <cmath>
 #include <string>
 #include <vector>
 
@@ -34,13 +35,27 @@ struct FringePoint {
 
 // Точка линии
 struct CTracerPoint {
-  int x;
+  int x;  // Ближайший пиксель центра полосы
   int y;
   float width = 0.0f;      // Ширина полосы в этой точке
   float intensity = 0.0f;  // Средняя интенсивность
+  float offsetX = 0.0f;    // Субпиксельный центр относительно (x, y),
+  float offsetY = 0.0f;    // |offset| <= 0.5
 
   CTracerPoint() : x(0), y(0), width(0), intensity(0) {}
   CTracerPoint(int _x, int _y) : x(_x), y(_y), width(0), intensity(0) {}
+
+  // Центр полосы с субпиксельной точностью
+  double PosX() const { return x + (double)offsetX; }
+  double PosY() const { return y + (double)offsetY; }
+
+  // Дробная позиция: (x, y) — ближайший пиксель, остаток — в offset
+  void SetPosition(double px, double py) {
+    x = (int)std::floor(px + 0.5);
+    y = (int)std::floor(py + 0.5);
+    offsetX = (float)(px - x);
+    offsetY = (float)(py - y);
+  }
 };
 
 // // Линия полосы
@@ -0,0 +1,41 @@
+/**
+ * @file ImagePyramid.h
+ * @brief Пирамида уменьшенных копий кадра для вывода с любым масштабом.
+ *
+ * Уровень 0 — сам кадр (общие данные с исходным cv::Mat, без копии),
+ * уровень i — уменьшение в 2^i раз усреднением (INTER_AREA). Уровни
+ * строятся, пока большая сторона больше tileSize. Вывод с масштабом zoom
+ * берёт уровень, на котором пиксель окна покрывает от 1 до 2 пикселей
+ * уровня — объём чтения на кадр ограничен размером окна, а не кадра.
+ */
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace Interferometry {
+
+class CImagePyramid {
+ public:
+  CImagePyramid() = default;
+
+  /// image — CV_8UC1; цветной кадр переводится в оттенки серого
+  void Build(const cv::Mat& image, int tileSize = 256);
+  void Clear() { m_levels.clear(); }
+
+  bool IsEmpty() const { return m_levels.empty(); }
+  int NumLevels() const { return (int)m_levels.size(); }
+  const cv::Mat& Level(int level) const { return m_levels[level]; }
+  double Scale(int level) const { return (double)(1 << level); }
+
+  int Width() const { return m_levels.empty() ? 0 : m_levels[0].cols; }
+  int Height() const { return m_levels.empty() ? 0 : m_levels[0].rows; }
+
+  /// Уровень для масштаба zoom (пикселей окна на пиксель кадра)
+  int LevelForZoom(double zoom) const;
+
+ private:
+  std::vector<cv::Mat> m_levels;
+};
+
+}  // namespace Interferometry
@@ -0,0 +1,172 @@
+/**
+ * @file Overlay.h
+ * @brief Слой разметки поверх кадра: границы, маркеры и линии полос,
+ *        растеризованные один раз в RGBA и обновляемые по частям.
+ *
+ * COverlay держит слой размера кадра (CV_8UC4, BGRA с предумноженной
+ * альфой: 0 — прозрачно) и список элементов. Элемент — ломаная в точках
+ * кадра, разбитая на фрагменты с охватывающими прямоугольниками. Изменение
+ * (новая или удалённая линия, другие границы) помечает грязным только охват
+ * элемента; Update() очищает грязные прямоугольники и заново рисует в них
+ * пересекающиеся фрагменты в порядке слоёв:
+ *   границы → линии полос (с маркером начала) → маркеры.
+ * Поэтому перерисовка окна только выводит готовый слой, а добавление линии
+ * стоит её охвата, а не всего кадра.
+ *
+ * Вместе со слоем поддерживаются уменьшенные копии (усреднение 2×2, как в
+ * CImagePyramid): CViewport берёт копию под текущий масштаб, тонкая линия
+ * при уменьшении бледнеет, но не рвётся. Предумноженная альфа делает
+ * усреднение корректным: прозрачные пиксели не затемняют цвет.
+ *
+ * Один слой используют окно (CViewport::SetOverlay), пакетный экспорт и
+ * отладочные картинки (Compose).
+ *
+ * @par Пример
+ * @code
+ *   COverlay overlay;
+ *   overlay.Reset(image.cols, image.rows);
+ *   overlay.SetBoundary(boundary);
+ *   int id = overlay.AddLine(points, MakeColor(255, 0, 0));
+ *   std::vector<cv::Rect> changed;
+ *   overlay.Update(&changed);          // пиксели кадра, изменённые в слое
+ *   cv::Mat bgr = overlay.Compose(image);
+ *   overlay.RemoveLine(id);            // грязным становится только охват
+ * @endcode
+ */
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "EllipseBoundary.h"
+#include "Instrumentation.h"
+#include "Types.h"
+#include "Viewport.h"
+
+namespace Interferometry {
+
+enum class EMarkerShape {
+  Dot,    // закрашенный круг
+  Cross,  // крест
+};
+
+struct COverlayParams {
+  int lineWidth = 2;       // толщина линий полос, пикселей кадра
+  int markerRadius = 3;    // маркер начала линии; 0 — без маркера
+  int boundaryWidth = 1;
+  int pointRadius = 4;     // размер маркеров SetMarkers()
+  CColor outerColor = MakeColor(255, 255, 255);
+  CColor innerColor = MakeColor(0, 255, 255);
+  int maxDirtyRects = 16;  // больше — объединяются в один
+};
+
+class COverlay {
+ public:
+  COverlay() = default;
+
+  /// Новые параметры — слой перерисовывается целиком
+  void SetParams(const COverlayParams& p);
+  const COverlayParams& GetParams() const { return m_params; }
+
+  /// Размер кадра; все элементы удаляются
+  void Reset(int width, int height);
+  int Width() const { return m_width; }
+  int Height() const { return m_height; }
+  bool IsEmpty() const { return m_width == 0 || m_height == 0; }
+
+  /// Контур внешней границы и по контуру на каждую заслонку — по строкам
+  /// boundary. Если контур не изменился, слой не трогается
+  void SetBoundary(const CEllipseBoundary& boundary);
+  void ClearBoundary();
+
+  /// Маркеры поверх всего (точки ввода границы, центр эллипса);
+  /// connect — соединить точки по порядку тонкой линией
+  void SetMarkers(const std::vector<cv::Point2f>& points, CColor color,
+                  EMarkerShape shape = EMarkerShape::Dot,
+                  bool connect = false);
+  void ClearMarkers();
+
+  /// Линия полосы; возвращает её номер для RemoveLine()
+  int AddLine(const std::vector<CTracerPoint>& line,
+              CColor color = MakeColor(255, 255, 0));
+  bool RemoveLine(int id);
+  void ClearLines();
+  int NumLines() const { return (int)m_lines.size(); }
+
+  /// Весь слой грязный
+  void Invalidate();
+  bool IsDirty() const { return !m_dirty.empty(); }
+
+  /**
+   * @brief Перерисовать грязные области слоя и уменьшенных копий.
+   * @param updated  если задан — изменённые прямоугольники, пиксели кадра
+   * @return число перерисованных прямоугольников
+   */
+  int Update(std::vector<cv::Rect>* updated = nullptr);
+
+  /// Слой кадра: CV_8UC4, BGRA, предумноженная альфа. Актуален после Update()
+  const cv::Mat& GetLayer() const { return m_layer; }
+
+  /// Уменьшенные копии: уровень l — в 2^l раз; размер кратен 2^l с запасом
+  int NumLevels() const { return (int)m_levels.size(); }
+  const cv::Mat& Level(int level) const { return m_levels[level]; }
+
+  /// Кадр (CV_8UC1 / CV_8UC3 / CV_8UC4) с разметкой → CV_8UC3 BGR;
+  /// вызывает Update()
+  cv::Mat Compose(const cv::Mat& image);
+
+  /// target (CV_8UC3 или CV_8UC4) = layer + target · (1 − α); размеры равны
+  static void Blend(const cv::Mat& layer, cv::Mat& target);
+
+  /// Замеры Update(); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
+ private:
+  // Фрагмент ломаной: точки [begin, end] и охват с запасом на толщину
+  struct CChunk {
+    int begin;
+    int end;
+    cv::Rect bounds;
+  };
+  struct CItem {
+    int id = 0;
+    CColor color = 0;
+    int thickness = 1;
+    bool dots = false;           // маркеры: фигура в каждой точке
+    bool connect = true;         // соединять точки ломаной
+    EMarkerShape shape = EMarkerShape::Dot;
+    int radius = 0;              // маркер начала линии / размер фигуры
+    std::vector<cv::Point> points;  // с kPointShift дробными битами
+    std::vector<CChunk> chunks;
+    cv::Rect bounds;
+  };
+
+  void BuildChunks(CItem& item) const;
+  void SetContour(CItem& item, std::vector<cv::Point>&& points, CColor color);
+  void InvalidateRect(const cv::Rect& rect);
+  void InvalidateItem(const CItem& item);
+  void RasterizeRect(const cv::Rect& rect);
+  void DrawItem(cv::Mat& target, const cv::Rect& area, const CItem& item);
+  void UpdateLevels(const cv::Rect& rect);
+
+  COverlayParams m_params;
+  int m_width = 0;
+  int m_height = 0;
+
+  CItem m_outer;
+  std::vector<CItem> m_inner;  // по заслонке
+  std::vector<CItem> m_lines;
+  CItem m_markers;
+  int m_nextId = 1;
+
+  std::vector<cv::Mat> m_levels;  // уровень 0 — слой с запасом
+  cv::Mat m_layer;                // m_levels[0] без запаса
+  std::vector<cv::Rect> m_dirty;  // пиксели кадра
+  cv::Mat m_scratch;              // грязный прямоугольник с полями
+  std::vector<cv::Point> m_polyline;
+
+  CInstrumentation m_stats;
+};
+
+}  // namespace Interferometry
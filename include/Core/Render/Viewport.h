@@ -0,0 +1,205 @@
+/**
+ * @file Viewport.h
+ * @brief Окно просмотра кадра и линий полос без MFC: масштаб, сдвиг,
+ *        уровни детализации и перерисовка только изменившихся областей.
+ *
+ * CViewport держит внеэкранный буфер размера окна (BGRA, раскладка
+ * 32-битного DIB сверху вниз) и список грязных прямоугольников. Render()
+ * перерисовывает только их, разбивая на плитки tileSize × tileSize:
+ * - фон — из CImagePyramid, с уровня под текущий масштаб;
+ * - линии — упрощённые (Дуглас-Пекер) под масштаб, с допуском lodTolerance
+ *   пикселей окна; линия хранится фрагментами по chunkPoints точек с
+ *   охватывающими прямоугольниками, фрагменты вне плитки не рисуются.
+ * - разметка (границы, маркеры) — слой COverlay, если задан SetOverlay(),
+ *   с его уменьшенной копии под масштаб; линии рисуются поверх.
+ * Pan() прокручивает содержимое буфера и помечает грязной только открывшуюся
+ * полосу. Время кадра поэтому ограничено размером окна и числом видимых
+ * вершин после упрощения, а не размером кадра и числом линий.
+ *
+ * Вывод в окно — забота платформы: в MFC это SetDIBitsToDevice из GetBuffer()
+ * для прямоугольников, которые вернул Render().
+ *
+ * @par Пример
+ * @code
+ *   CViewport view;
+ *   view.SetImage(loader.GetImage());
+ *   view.SetLines(lines, colors);
+ *   view.Resize(clientWidth, clientHeight);
+ *   view.FitToView();
+ *   ...
+ *   view.Pan(dx, dy);            // перетаскивание мышью
+ *   view.ZoomAt(1.25, mx, my);   // колесо: точка под курсором неподвижна
+ *   std::vector<cv::Rect> updated;
+ *   view.Render(&updated);       // вывести updated из view.GetBuffer()
+ * @endcode
+ */
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+#include "ImagePyramid.h"
+#include "Instrumentation.h"
+#include "Types.h"
+
+namespace Interferometry {
+
+class COverlay;
+
+/// Цвет 0x00BBGGRR — раскладка COLORREF, без зависимости от windows.h
+using CColor = uint32_t;
+
+constexpr CColor MakeColor(int r, int g, int b) {
+  return (CColor)(r & 0xFF) | ((CColor)(g & 0xFF) << 8) |
+         ((CColor)(b & 0xFF) << 16);
+}
+
+/// Цвет для cv:: рисования в CV_8UC4 (B, G, R, A), непрозрачный
+inline cv::Scalar ToScalar(CColor c) {
+  return cv::Scalar((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF, 255);
+}
+
+/// Дробные биты координат вершин для cv::polylines / cv::circle —
+/// общие для COverlay и CViewport
+constexpr int kPointShift = 4;
+constexpr double kPointShiftScale = 1 << kPointShift;
+
+/// Окно ↔ кадр: пиксель окна (vx, vy) — точка кадра origin + (v + 0.5) / zoom
+struct CViewTransform {
+  double zoom = 1.0;     // пикселей окна на пиксель кадра
+  double originX = 0.0;  // точка кадра в левом верхнем углу окна
+  double originY = 0.0;
+
+  cv::Point2d ImageToView(double x, double y) const {
+    return {(x - originX) * zoom, (y - originY) * zoom};
+  }
+  cv::Point2d ViewToImage(double vx, double vy) const {
+    return {originX + vx / zoom, originY + vy / zoom};
+  }
+};
+
+struct CViewportParams {
+  int tileSize = 256;           // плитка перерисовки, пикселей окна
+  double minZoom = 1.0 / 64.0;
+  double maxZoom = 32.0;
+  double lodTolerance = 0.5;    // допуск упрощения линий, пикселей окна
+  int chunkPoints = 64;         // точек во фрагменте линии для отсечения
+  int lineWidth = 2;
+  int markerRadius = 3;         // маркер начала линии; 0 — без маркера
+  CColor background = MakeColor(32, 32, 32);
+  int maxDirtyRects = 16;       // больше — объединяются в один
+};
+
+class CViewport {
+ public:
+  CViewport() = default;
+
+  void SetParams(const CViewportParams& p);
+  const CViewportParams& GetParams() const { return m_params; }
+
+  /// Кадр CV_8UC1 (цветной переводится в серый); данные уровня 0 общие с
+  /// image — после изменения кадра SetImage() вызывается снова
+  void SetImage(const cv::Mat& image);
+  void ClearImage();
+  int ImageWidth() const { return m_pyramid.Width(); }
+  int ImageHeight() const { return m_pyramid.Height(); }
+
+  /// colors.size() == lines.size() или пусто (все линии — жёлтые)
+  void SetLines(const std::vector<std::vector<CTracerPoint>>& lines,
+                const std::vector<CColor>& colors = {});
+  /// Новая линия: грязной становится только её область
+  void AddLine(const std::vector<CTracerPoint>& line,
+               CColor color = MakeColor(255, 255, 0));
+  void ClearLines();
+  int NumLines() const { return (int)m_lines.size(); }
+
+  /// Слой разметки под линиями; nullptr — без слоя. Слой не копируется:
+  /// после overlay->Update(&rects) изменённые rects передаются в
+  /// InvalidatePixels()
+  void SetOverlay(const COverlay* overlay);
+
+  /// Размер окна; содержимое буфера сохраняется, новые области — грязные
+  void Resize(int width, int height);
+  int Width() const { return m_buffer.cols; }
+  int Height() const { return m_buffer.rows; }
+
+  void SetTransform(const CViewTransform& transform);
+  const CViewTransform& GetTransform() const { return m_transform; }
+
+  /// Сдвиг содержимого на (dx, dy) пикселей окна
+  void Pan(int dx, int dy);
+  /// Масштаб × factor, точка окна (vx, vy) остаётся на месте
+  void ZoomAt(double factor, double vx, double vy);
+  /// Весь кадр в окне, по центру
+  void FitToView();
+
+  void Invalidate();
+  void InvalidateView(const cv::Rect& rect);
+  /// Область кадра (например, охват новой линии) — с запасом на толщину
+  void InvalidateImage(const cv::Rect2d& rect);
+  /// Пиксели кадра [x, x + width) × [y, y + height)
+  void InvalidatePixels(const cv::Rect& pixels);
+  bool IsDirty() const { return !m_dirty.empty(); }
+
+  /**
+   * @brief Перерисовать грязные области.
+   * @param updated  если задан — прямоугольники окна, изменённые в буфере
+   * @return число перерисованных плиток
+   */
+  int Render(std::vector<cv::Rect>* updated = nullptr);
+
+  /// Буфер окна: CV_8UC4, BGRA, строки сверху вниз
+  const cv::Mat& GetBuffer() const { return m_buffer; }
+
+  /// Уровень пирамиды (и упрощения линий) для текущего масштаба
+  int GetLodLevel() const;
+
+  /// Замеры Render(); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
+ private:
+  // Фрагмент упрощённой линии: точки [begin, end] и их охват
+  struct CChunk {
+    int begin;
+    int end;
+    cv::Rect2f bounds;
+  };
+  struct CLod {
+    bool built = false;
+    std::vector<cv::Point2f> points;
+    std::vector<CChunk> chunks;
+  };
+  struct CLine {
+    std::vector<cv::Point2f> points;
+    CColor color;
+    cv::Rect2f bounds;
+    std::vector<CLod> lods;
+  };
+
+  void AppendLine(const std::vector<CTracerPoint>& line, CColor color);
+  const CLod& GetLod(CLine& line, int level);
+  void RenderTile(const cv::Rect& tile, int level);
+  void DrawOverlay(const cv::Rect& area, int level);
+  cv::Matx23d LevelMap(const cv::Rect& area, double scale) const;
+  void DrawLines(cv::Mat& target, const cv::Rect& area, int level);
+  cv::Rect2d ViewRectToImage(const cv::Rect& rect) const;
+
+  CViewportParams m_params;
+  CViewTransform m_transform;
+  CImagePyramid m_pyramid;
+  std::vector<CLine> m_lines;
+  const COverlay* m_overlay = nullptr;
+
+  cv::Mat m_buffer;                // CV_8UC4, размер окна
+  std::vector<cv::Rect> m_dirty;   // в координатах окна
+  cv::Mat m_scratchGray;           // плитка с полями, до перевода в BGRA
+  cv::Mat m_scratch;
+  cv::Mat m_scratchOverlay;
+  std::vector<cv::Point> m_polyline;
+
+  CInstrumentation m_stats;
+};
+
+}  // namespace Interferometry
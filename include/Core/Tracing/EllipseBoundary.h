@@ -2,7 +2,11 @@
 // Установка и управление эллиптическими границами рабочей области
 // Портировано из SCAN360/MARKER.C
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <vector>
+
+#include "Instrumentation.h"
 namespace Interferometry {
 // Структура для хранения границ одной строки
 struct RowBoundary {
@@ -22,15 +26,27 @@ struct RowBoundary {
     if (!HasInnerBoundary()) return false;  // нет внутренней границы — нет дыры
     return (x >= leftInner && x <= rightInner);
   }
+  // Только первая дырка строки; дополнительные — у CEllipseBoundary
   bool IsInside(int x) const { return IsInsideOuter(x) && !IsInsideInner(x); }
 };
+// Отрезок строки [x0, x1], концы включительно, как в RowBoundary
+struct CRowSpan {
+  int x0;
+  int x1;
+};
+// Дополнительная дырка строки row — для сохранения в проект
+struct CRowHole {
+  int row;
+  int x0;
+  int x1;
+};
 // Параметры эллипса
 struct EllipseParams {
   int centerX;    // Центр по X
   int centerY;    // Центр по Y
-  int semiAxisA;  // Большая полуось (по X)
-  int semiAxisB;  // Малая полуось (по Y)
-  float angle;    // Угол наклона в градусах (из cv::fitEllipse)
+  int semiAxisA;  // Полуось вдоль направления angle (при angle = 0 — по X)
+  int semiAxisB;  // Вторая полуось (при angle = 0 — по Y)
+  float angle;    // Поворот оси A от оси X к оси Y, градусы (cv::fitEllipse)
 
   EllipseParams()
       : centerX(0), centerY(0), semiAxisA(0), semiAxisB(0), angle(0.0f) {}
@@ -57,6 +73,49 @@ class CEllipseBoundary {
   const std::vector<RowBoundary>& GetAllBoundaries() const {
     return m_boundaries;
   }
+
+  // Несколько заслонок на зрачке: первая дырка строки — leftInner..rightInner,
+  // вторая и следующие (по возрастанию x, не пересекаются) хранятся отдельно,
+  // одним массивом на все строки со смещениями по строкам
+  int GetExtraHoleCount(int row) const;
+  const CRowSpan* GetExtraHoles(int row) const;
+  // Все дырки строки по возрастанию x
+  void GetRowHoles(int row, std::vector<CRowSpan>& holes) const;
+  // Дополнительные дырки всех строк — для сохранения / восстановления
+  std::vector<CRowHole> GetAllExtraHoles() const;
+  void SetAllExtraHoles(const std::vector<CRowHole>& holes);
+
+  // Обход рабочей области отрезками: fn(y, x0, x1) для каждого непрерывного
+  // отрезка [x0, x1) строки y внутри внешней границы и вне всех дырок, строки
+  // по возрастанию, отрезки строки — по возрастанию x. Пиксель попадает в
+  // отрезок тогда и только тогда, когда IsInside(x, y). Внутренний цикл по
+  // отрезку — без проверок принадлежности:
+  //   boundary.ForEachSpan([&](int y, int x0, int x1) {
+  //     const uint8_t* p = image.ptr<uint8_t>(y);
+  //     for (int x = x0; x < x1; x++) sum += p[x];
+  //   });
+  template <typename Fn>
+  void ForEachSpan(Fn&& fn) const {
+    ForEachSpan(0, m_imageHeight, fn);
+  }
+  // То же для строк [y0, y1)
+  template <typename Fn>
+  void ForEachSpan(int y0, int y1, Fn&& fn) const;
+  // Число пикселей рабочей области — по отрезкам, O(строк)
+  int64_t CountInside() const;
+
+  // Байтовая маска рабочей области: 0xFF внутри, 0 снаружи.
+  // Строки выровнены на MASK_ALIGN байт, вокруг кадра рамка MASK_PAD нулей,
+  // поэтому соседи (x±1, y±1) любого пикселя кадра читаются без проверок.
+  // Перестраивается при каждом изменении границ методами класса.
+  static constexpr int MASK_PAD = 1;
+  static constexpr int MASK_ALIGN = 16;
+  const uint8_t* GetInsideMask() const {
+    return m_insideMask.data() + MASK_PAD * m_maskStride + MASK_PAD;
+  }
+  int GetInsideMaskStride() const { return m_maskStride; }
+  // Вызывать после ручной правки строк через неконстантный GetRowBoundary()
+  void RebuildInsideMask();
   void ResetOuterBoundaries();
   void ResetInnerBoundaries();
   void ResetAllBoundaries();
@@ -64,15 +123,52 @@ class CEllipseBoundary {
   void CopyFrom(const CEllipseBoundary& other);
   bool Validate() const;
 
+  // Замеры SetEllipse(); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
  private:
-  void CalculateEllipsePoints(const EllipseParams& ellipse, int row, float& x1,
+  bool CalculateEllipsePoints(const EllipseParams& ellipse, int row, float& x1,
                               float& x2) const;
+  void GetEllipseRows(const EllipseParams& ellipse, int& top,
+                      int& bottom) const;
   void ApplyOuterEllipse(const EllipseParams& ellipse);
   void ApplyInnerEllipse(const EllipseParams& ellipse);
+  void ClearExtraHoles();
   int ClampX(int x) const;
   int ClampY(int y) const;
   int m_imageWidth;
   int m_imageHeight;
   std::vector<RowBoundary> m_boundaries;
+  std::vector<int> m_holeIndex;        // h + 1 смещений в m_holeSpans
+  std::vector<CRowSpan> m_holeSpans;   // дополнительные дырки по строкам
+  std::vector<uint8_t> m_insideMask;  // (h + 2*PAD) строк по m_maskStride
+  int m_maskStride = 0;
+  CInstrumentation m_stats;
 };
+
+template <typename Fn>
+void CEllipseBoundary::ForEachSpan(int y0, int y1, Fn&& fn) const {
+  y0 = (std::max)(y0, 0);
+  y1 = (std::min)(y1, m_imageHeight);
+  const bool extra = !m_holeSpans.empty();
+  for (int y = y0; y < y1; y++) {
+    const RowBoundary& b = m_boundaries[y];
+    if (!b.HasOuterBoundary()) continue;
+    const int end = (std::min)(b.rightOuter, m_imageWidth - 1) + 1;
+    int x = (std::max)(b.leftOuter, 0);
+
+    // Отрезок до дырки [h0, h1]; дальше — правее неё
+    auto hole = [&](int h0, int h1) {
+      if (h0 > x && x < end) fn(y, x, (std::min)(h0, end));
+      x = (std::max)(x, h1 + 1);
+    };
+    if (b.HasInnerBoundary()) hole(b.leftInner, b.rightInner);
+    if (extra) {
+      for (int k = m_holeIndex[y]; k < m_holeIndex[y + 1]; k++)
+        hole(m_holeSpans[k].x0, m_holeSpans[k].x1);
+    }
+    if (x < end) fn(y, x, end);
+  }
+}
 }  // namespace Interferometry
@@ -0,0 +1,115 @@
+/**
+ * @file FringeOrderer.h
+ * @brief Автоматическая нумерация полос: порядок интерференции каждой линии
+ *        по соседству линий вдоль профилей через зрачок.
+ *
+ * Линии из IFringeExtractor::Extract не упорядочены. Порядок восстанавливается
+ * так:
+ * 1. Направление профилей — поперёк средней полосы (среднее по удвоенному
+ *    углу отрезков всех линий) или заданное.
+ * 2. Параллельные профили через scanSpacing пикселей; пересечения отрезков
+ *    линий с профилями считаются за один проход по точкам.
+ * 3. Вдоль профиля соседние пересечения разных линий — голос «порядок
+ *    следующей на 1 больше». Одна линия дважды подряд — профиль прошёл через
+ *    экстремум (кольцо), знак приращения меняется. Пропуск через
+ *    экранирование или зазор больше gapFactor медианного — не голос (между
+ *    ними может быть нетрассированная полоса). Пересечения ближе
+ *    mergeDistance — одна полоса, пройденная двумя линиями: голос «равны».
+ * 4. Голоса всех профилей за пару линий складываются, ребро графа — решение
+ *    большинства; порядки назначаются по максимальному остовному лесу
+ *    (Крускал, вес — перевес голосов), остальные рёбра проверяются —
+ *    расхождения и ничьи попадают в conflicts.
+ * 5. Наибольшая (по точкам) компонента — порядки от 0. Прочие компоненты
+ *    привязываются сдвигом по линейной регрессии порядка от положения поперёк
+ *    полос (статус Extrapolated).
+ *
+ * Время — O(точек + пересечений · log(пересечений на профиль)).
+ * Знак нумерации по своей природе не определяется по одной интерферограмме:
+ * порядок растёт вдоль направления профиля (scanAngle в результате).
+ *
+ * @par Пример
+ * @code
+ *   CFringeOrderer orderer;
+ *   CFringeOrderResult order;
+ *   if (orderer.Assign(lines, boundary, order) && order.conflicts.empty())
+ *     fitter.Fit(lines, order.orders, boundary, wavefront);
+ * @endcode
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Instrumentation.h"
+#include "Types.h"
+
+namespace Interferometry {
+
+class CEllipseBoundary;
+
+struct CFringeOrderParams {
+  double scanSpacing = 4.0;  // пикселей между соседними профилями
+  double gapFactor = 1.8;    // зазор > gapFactor · медиана профиля — не ребро
+  double mergeDistance = 1.5;  // пересечения ближе — одна полоса (дубликаты)
+  bool flipAtRepeat = true;  // линия дважды подряд — смена знака приращения
+  bool autoAngle = true;     // профили поперёк средней полосы
+  double scanAngleDeg = 0.0; // направление профилей, если !autoAngle
+};
+
+enum class EOrderStatus {
+  Unassigned,   ///< нет порядка (orders[i] — NaN)
+  Assigned,     ///< по графу соседства основной компоненты
+  Extrapolated  ///< отдельная компонента, сдвиг по регрессии
+};
+
+/// Пара линий, у которой голоса профилей расходятся с назначенными порядками
+struct COrderConflict {
+  int lineA = -1;
+  int lineB = -1;
+  int expected = 0;  // orders[lineB] - orders[lineA] по большинству голосов
+  int actual = 0;    // то же по назначенным порядкам
+  int votes = 0;     // перевес голосов за expected; 0 — ничья
+};
+
+struct CFringeOrderResult {
+  std::vector<double> orders;  // по линиям; NaN — Unassigned
+  std::vector<EOrderStatus> status;
+  std::vector<COrderConflict> conflicts;
+  double scanAngle = 0.0;  // направление профилей, радианы
+  int numScans = 0;
+  int numCrossings = 0;
+  int numEdges = 0;       // пар соседних линий
+  int numComponents = 0;  // связных компонент среди линий с точками
+
+  int NumAssigned() const;
+  void Clear();
+};
+
+class CFringeOrderer {
+ public:
+  CFringeOrderer() = default;
+
+  void SetParams(const CFringeOrderParams& p) { m_params = p; }
+  const CFringeOrderParams& GetParams() const { return m_params; }
+
+  /**
+   * @param lines     линии полос, субпиксельные координаты учитываются
+   * @param boundary  рабочая область: профиль вне её — разрыв соседства
+   * @return false — нет линий с точками или профилей (GetLastError())
+   */
+  bool Assign(const std::vector<std::vector<CTracerPoint>>& lines,
+              const CEllipseBoundary& boundary, CFringeOrderResult& result);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+  /// Замеры Assign(); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
+ private:
+  CFringeOrderParams m_params;
+  std::string m_lastError;
+  CInstrumentation m_stats;
+};
+
+}  // namespace Interferometry
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "IFringeExtractor.h"
+#include "SkeletonGraph.h"
 #include "Types.h"
 
 namespace Interferometry {
@@ -41,22 +42,22 @@ class CFringeSkeletonizer : public IFringeExtractor {
 
   std::string GetName() const override { return "Skeletonizer"; }
   const std::string& GetLastError() const override { return m_lastError; }
+  const CInstrumentation& GetStats() const override { return m_stats; }
 
   // Промежуточные данные для отладки
-  const cv::Mat& GetMask() const { return m_mask; }
+  // Маска зрачка в рабочем цикле не нужна — строится при первом запросе
+  const cv::Mat& GetMask() const;
   const cv::Mat& GetBinary() const { return m_binary; }
   const cv::Mat& GetSkeleton() const { return m_skeleton; }
   const cv::Mat& GetDistMap() const { return m_distMap; }
+  const CSkeletonGraph& GetGraph() const { return m_graph; }
 
  private:
+  // Микробенчмарки внутренних ядер (benchmarks/CoreBench.cpp)
+  friend struct CBenchAccess;
+
   bool BuildBinary();
   void Skeletonize(const cv::Mat& binary, cv::Mat& skeleton) const;
-  int CountNeighbors(const cv::Mat& skel, int x, int y) const;
-  void PruneSkeleton(cv::Mat& skel, int maxBranchLength) const;
-  void LinkBrokenLines(std::vector<std::vector<CTracerPoint>>& lines) const;
-
-  std::vector<CTracerPoint> TraceBranch(const cv::Mat& skel, cv::Mat& visited,
-                                        int sx, int sy);
 
   std::vector<std::vector<CTracerPoint>> ExtractPolylines();
   void SmoothLine(std::vector<CTracerPoint>& line) const;
@@ -68,12 +69,14 @@ class CFringeSkeletonizer : public IFringeExtractor {
   const CEllipseBoundary* m_boundary = nullptr;
 
   // промежуточные результаты
-  cv::Mat m_mask;
+  mutable cv::Mat m_mask;  // кэш GetMask()
   cv::Mat m_binary;
   cv::Mat m_skeleton;
   cv::Mat m_distMap;
+  CSkeletonGraph m_graph;
 
   std::string m_lastError;
+  CInstrumentation m_stats;
 };
 
 }  // namespace Interferometry
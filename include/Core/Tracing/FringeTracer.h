@@ -20,6 +20,13 @@ namespace Interferometry {
 class CEllipseBoundary;
 
 
+// Уточнение центра полосы между пикселями
+enum class ESubpixelMode {
+  None,       // Целые пиксели, как в SCAN360
+  Parabolic,  // Вершина параболы по трём отсчётам поперёк полосы
+  Centroid    // Центр тяжести профиля поперёк полосы (в пределах ширины)
+};
+
 // Параметры трассировки
 struct CTracerParams {
   float initialWidth;        // Начальная ожидаемая ширина полосы
@@ -28,6 +35,9 @@ struct CTracerParams {
   int maxSteps;              // Максимальное количество шагов
   bool bidirectional;        // Двунаправленная трассировка
   float curvatureCoeff;      // Коэффициент учета кривизны
+  int numThreads;            // Потоки для Extract (0 = по числу ядер, 1 = последовательно)
+  bool useIntegralImage;     // Интегральное изображение для AverageIntensity (строится в Initialize)
+  ESubpixelMode subpixel;    // Субпиксельный центр точек (offsetX/offsetY)
 
   CTracerParams()
       : initialWidth(20.0f),
@@ -35,7 +45,30 @@ struct CTracerParams {
         intensityThreshold(0.5f),
         maxSteps(200),
         bidirectional(true),
-        curvatureCoeff(1.5f) {}
+        curvatureCoeff(1.5f),
+        numThreads(0),
+        useIntegralImage(false),
+        subpixel(ESubpixelMode::None) {}
+};
+
+// Состояние трассировки одной линии (аналог глобальных переменных STEP.C).
+// Вынесено из CFringeTracer, чтобы линии можно было трассировать параллельно.
+struct CTraceContext {
+  float curWidth = 0.0f;    // Текущая ширина полосы (cur_wide)
+  float curAverage = 0.0f;  // Текущая средняя интенсивность (cur_average)
+  int curDirection = 0;     // Текущее направление (direct)
+
+  float wideLine = 0.0f;  // аналог wide_line
+  float average = 0.0f;   // аналог average (порог для max_perp)
+
+  // Временная линия
+  std::vector<CTracerPoint> tempLine;
+
+  // Сообщение об ошибке трассировки этой линии
+  std::string lastError;
+
+  // Число вызовов Step() (накапливается по всем линиям контекста)
+  int64_t numSteps = 0;
 };
 
 // Напрвыление трассирвоки
@@ -65,6 +98,8 @@ class CFringeTracer : public IFringeExtractor {
 
   const std::string& GetLastError() const override { return m_lastError; }
 
+  const CInstrumentation& GetStats() const override { return m_stats; }
+
   std::vector<CTracerPoint> TraceLine(int startX, int startY);
 
   // Установка изображения
@@ -78,10 +113,20 @@ class CFringeTracer : public IFringeExtractor {
   // Главная функция трассировки одной линии (низкоуровневый метод)
   bool TraceLine(int startX, int startY, std::vector<CTracerPoint>& outPoints);
 
+  // Трассировка с внешним контекстом — потокобезопасна (не меняет трассировщик)
+  bool TraceLine(CTraceContext& ctx, int startX, int startY,
+                 std::vector<CTracerPoint>& outPoints) const;
+
   // Проверка, находится ли точка внутри изображения
   bool IsInside(int x, int y) const;
 
+  // Построено ли интегральное изображение (см. useIntegralImage)
+  bool HasIntegralImage() const { return !m_integral.empty(); }
+
  private:
+  // Микробенчмарки внутренних ядер (benchmarks/CoreBench.cpp)
+  friend struct CBenchAccess;
+
   // Изображение
   const uint8_t* m_image = nullptr;
   int m_width = 0;
@@ -91,50 +136,64 @@ class CFringeTracer : public IFringeExtractor {
   // Границы (для проверки IsInside)
   const CEllipseBoundary* m_boundary = nullptr;
 
-  // Парметры
-  CTracerParams m_params;
-
-  // Текущее состояние трассировки
-  float m_curWidth = 0.0f;    // Текщая ширна полосы
-  float m_curAverage = 0.0f;  // Текщая средняя интенсивность
-  int m_curDirection = 0;     // Текщее направление
+  // Маска рабочей области из CEllipseBoundary (0xFF — внутри)
+  const uint8_t* m_mask = nullptr;
+  int m_maskStride = 0;
 
-  float m_wideLine = 0.0f;  // аналог wide_line
-  float m_average = 0.0f;   // аналог average (порог для max_perp)
+  // Интегральное изображение по маскированному кадру: пары
+  // {Σ яркости, Σ пикселей маски} на (h+1) x (w+1) узлов.
+  // uint32 с переполнением — разности по окну всё равно точные.
+  std::vector<uint32_t> m_integral;
+  int m_integralStride = 0;  // в элементах uint32_t
 
-  // Временная линия
-  std::vector<CTracerPoint> m_tempLine;
+  // Парметры
+  CTracerParams m_params;
 
   // Сообщение об ошибке
   std::string m_lastError;
 
+  // Замеры последнего Extract()
+  CInstrumentation m_stats;
+
   // --- Основные функции алгоритма (портировано из STEP.c) ---
 
   void SetInsideMask(const uint8_t* mask, int width, int height,
                      int strideBytes);
 
+  // Построение m_integral по текущим изображению и маске
+  void BuildIntegralImage();
+
   // Определение первого шага
-  bool FirstStep(int x, int y, CTracerPoint& point1, CTracerPoint& point2);
+  bool FirstStep(CTraceContext& ctx, int x, int y, CTracerPoint& point1,
+                 CTracerPoint& point2) const;
 
   // Один шаг трассировки
   // Возвращает: 0=продолжить, 1=успешное завершение, -1=ошибка
-  int Step(std::vector<CTracerPoint>& line);
+  int Step(CTraceContext& ctx, std::vector<CTracerPoint>& line) const;
 
   // Один шаг трассировки версия 2
   int Step_ver2(std::vector<CTracerPoint>& line);
 
   // Определение ширины полосы в точке
-  bool MeasureWidth(int x, int y, float& outWidth, int& outDirection);
+  bool MeasureWidth(CTraceContext& ctx, int x, int y, float& outWidth,
+                    int& outDirection) const;
 
   // Поиск максимума вдоль направления
-  bool FindMaxAlong(int& x, int& y, int dx, int dy, float searchDist);
+  bool FindMaxAlong(int& x, int& y, int dx, int dy, float searchDist) const;
 
   // Центрирование перпендикулярно навправлению
-  bool CenterPerpendicular(int& x, int& y, int dx, int dy);
+  bool CenterPerpendicular(const CTraceContext& ctx, int& x, int& y, int dx,
+                           int dy) const;
 
   // Усреднение интсенсивности в окне 3х3
   float AverageIntensity(int x, int y) const;
 
+  // AverageIntensity в дробной точке (билинейно по соседним пикселям)
+  float AverageIntensityAt(float x, float y) const;
+
+  // Субпиксельный центр каждой точки линии поперёк полосы
+  void RefineSubpixel(std::vector<CTracerPoint>& line) const;
+
   // Получение значения пикселя
   inline uint8_t GetPixel(int x, int y) const {
     if (!m_image || x < 0 || x >= m_width || y < 0 || y >= m_height) return 0;
@@ -0,0 +1,137 @@
+/**
+ * @file FrnFile.h
+ * @brief Чтение и запись архивных файлов полос .frn.
+ *
+ * Текстовый формат (cp1251, строки LF или CRLF), секции:
+ * @code
+ *   [GENERAL]          Title=, Date=, Time=, ScaleFactor=, FiScan=
+ *   [ELLIPSES]         " cx cy a b angle type flags E" — по строке на контур
+ *   [BOUNDS]           " x0 y0 x1 y1 E" (в старых файлах — 6 чисел и END)
+ *   [FRINGES]          NFringe=<порядок>, пары " x y", E — по блоку на линию
+ *   [IMAGE]            Size=<w> <h>, FileName=<имя> (или просто имя)
+ *   [IMAGE_FILE]       старый вариант: Size=, Name=
+ * @endcode
+ * Пустая секция и конец секции в старых файлах отмечаются строкой END.
+ *
+ * Чтение потоковое: файл читается блоками по 1 МБ, целые строки разбираются
+ * прямо в буфере блока без копирования, числа — std::from_chars (не зависит
+ * от локали). Через блок переносится только незаконченная последняя строка.
+ * Запись — std::to_chars в буфер, сбрасываемый в файл по мере заполнения.
+ *
+ * @par Пример
+ * @code
+ *   CFrnData frn;
+ *   CFrnReader reader;
+ *   if (reader.ReadFile("BBR1V20.frn", frn))
+ *     approximator.ApproximateBatch(frn.lines, 8, results);
+ * @endcode
+ */
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EllipseBoundary.h"
+#include "Types.h"
+
+namespace Interferometry {
+
+/// Контур из [ELLIPSES] (координаты в пикселях изображения)
+struct CFrnEllipse {
+  double centerX = 0.0;
+  double centerY = 0.0;
+  double semiAxisA = 0.0;
+  double semiAxisB = 0.0;
+  double angle = 0.0;  // градусы
+  int type = 1;        // тип контура (1 — внешняя граница)
+  int flags = 0;
+
+  EllipseParams ToParams() const;
+  static CFrnEllipse FromParams(const EllipseParams& ellipse);
+};
+
+struct CFrnData {
+  /// [GENERAL] в порядке файла
+  std::vector<std::pair<std::string, std::string>> general;
+  std::vector<CFrnEllipse> ellipses;
+  /// [BOUNDS] — записи как есть (обычно x0 y0 x1 y1)
+  std::vector<std::vector<double>> bounds;
+
+  /// [FRINGES]: линии и их порядки, orders.size() == lines.size().
+  /// Дробные координаты сохраняются: CTracerPoint::PosX() / PosY().
+  std::vector<std::vector<CTracerPoint>> lines;
+  std::vector<double> orders;
+
+  int imageWidth = 0;
+  int imageHeight = 0;
+  std::string imageFile;
+
+  void Clear();
+
+  /// Значение ключа [GENERAL]; пустая строка, если ключа нет
+  std::string GetGeneral(const std::string& key) const;
+  void SetGeneral(const std::string& key, const std::string& value);
+
+  /// Внешний контур (первый с type == 1); false — контуров нет
+  bool GetOuterEllipse(EllipseParams& ellipse) const;
+};
+
+/**
+ * @brief Потоковый разбор .frn.
+ *
+ * ReadFile() / Parse() — весь файл или буфер целиком. Для данных, приходящих
+ * частями (сеть, архив), — Begin(), Feed() на каждый кусок, Finish().
+ */
+class CFrnReader {
+ public:
+  CFrnReader() = default;
+
+  bool ReadFile(const std::filesystem::path& path, CFrnData& data);
+  bool Parse(const char* text, size_t size, CFrnData& data);
+
+  void Begin(CFrnData& data);
+  bool Feed(const char* chunk, size_t size);
+  bool Finish();
+
+  /// Текст ошибки с номером строки файла
+  const std::string& GetLastError() const { return m_lastError; }
+
+ private:
+  enum class ESection { None, General, Ellipses, Bounds, Fringes, Image,
+                        Unknown };
+
+  bool ParseLine(const char* begin, const char* end);
+  bool ParseFringeLine(const char* begin, const char* end);
+  bool Fail(const std::string& message);
+
+  CFrnData* m_data = nullptr;
+  ESection m_section = ESection::None;
+  bool m_inFringe = false;   // внутри блока NFringe= ... E
+  std::string m_pending;     // незаконченная строка с конца куска
+  size_t m_lineNumber = 0;
+  std::vector<double> m_numbers;
+  std::string m_lastError;
+};
+
+/**
+ * @brief Запись .frn в современной раскладке ([IMAGE] с FileName=).
+ *
+ * Координаты — 3 знака после точки, угол — 2, порядок полосы — 1 знак
+ * для кратных 0.1, иначе 3.
+ */
+class CFrnWriter {
+ public:
+  CFrnWriter() = default;
+
+  bool WriteFile(const std::filesystem::path& path, const CFrnData& data);
+  static std::string Format(const CFrnData& data);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+ private:
+  std::string m_lastError;
+};
+
+}  // namespace Interferometry
@@ -13,6 +13,8 @@
 #include <string>
 #include <vector>
 
+#include "Instrumentation.h"
+
 namespace Interferometry {
 
 class CEllipseBoundary;
@@ -70,6 +72,12 @@ class IFringeExtractor {
    * @brief Текст последней ошибки.
    */
   virtual const std::string& GetLastError() const = 0;
+
+  /**
+   * @brief Замеры этапов и счётчики последнего Extract()
+   *        (сбрасываются в начале каждого вызова).
+   */
+  virtual const CInstrumentation& GetStats() const = 0;
 };
 
 }  // namespace Interferometry
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <filesystem>
+#include <memory>
 #include <string>
 #include <opencv2/opencv.hpp>
 
+#include "Instrumentation.h"
+
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -10,6 +14,25 @@
 namespace Interferometry
 {
 
+  class CMappedFile;
+
+  /**
+   * @brief Загрузчик кадра интерферограммы (градации серого, CV_8UC1).
+   *
+   * Файл открывается и отображается в память один раз, формат определяется
+   * по сигнатуре. 8-битный BMP и raw SCAN360 разбираются напрямую: если
+   * строки файла уже лежат как строки CV_8UC1 (raw; BMP сверху вниз с
+   * палитрой «индекс = яркость»), кадр — заголовок cv::Mat над отображением,
+   * без копирования; иначе один проход через палитру в серый. Прочие форматы
+   * декодирует cv::imdecode из того же отображения.
+   *
+   * Отображение копируется при записи: SetPixel() и Normailze() меняют
+   * кадр, но не файл. Отображение живёт, пока жива хоть одна копия Mat:
+   * всё это время файл открыт. В Windows его можно переименовать или
+   * удалить, но не перезаписать; в POSIX усечение файла извне даёт SIGBUS
+   * при чтении кадра. Долгоживущим владельцам кадра (документ GUI) —
+   * SetZeroCopy(false): кадр копируется, файл закрывается в Load().
+   */
   class ImageLoader
   {
   public:
@@ -20,6 +43,10 @@ namespace Interferometry
     bool Load(const std::string &filename);
     bool Load(const std::wstring &filename);
 
+    /// false — кадр всегда в своём буфере, файл не держится открытым
+    void SetZeroCopy(bool enable) { m_zeroCopy = enable; }
+    bool GetZeroCopy() const { return m_zeroCopy; }
+
     // --- Получение данных ---
     const cv::Mat &GetImage() const { return m_image; }
     cv::Mat &GetImage() { return m_image; }
@@ -49,21 +76,27 @@ namespace Interferometry
     // --- Сохранение ---
     bool Save(const std::string &filename) const;
 
+    // --- Замеры Load(); накапливаются до ResetStats() ---
+    const CInstrumentation &GetStats() const { return m_stats; }
+    void ResetStats() { m_stats.Reset(); }
+
 #ifdef _WIN32
     // --- Конвертация в HBITMAP ---
     HBITMAP CreateHBITMAP() const;
 #endif
 
   private:
-    // --- Raw-формат SCAN360 ---
-    bool LoadRaw(const std::string &filename,
-                 int width = 360,
-                 int height = 290);
-    bool IsRawFormat(const std::string &filename);
+    // --- Разбор отображённого файла ---
+    bool LoadFile(const std::filesystem::path &path);
+    bool LoadBmp(std::unique_ptr<CMappedFile> &file);
+    bool LoadRaw(std::unique_ptr<CMappedFile> &file);
+    bool LoadEncoded(const CMappedFile &file);
 
     bool ValidateCoordinates(int x, int y) const;
 
     cv::Mat m_image;
+    bool m_zeroCopy = true;
+    CInstrumentation m_stats;
   };
 
 } // namespace Interferometry
@@ -0,0 +1,189 @@
+/**
+ * @file Instrumentation.h
+ * @brief Замеры этапов конвейера: таймеры областей и счётчики.
+ *
+ * Каждый объект ядра, выполняющий работу (ImageLoader, CEllipseBoundary,
+ * CFringeSkeletonizer, CFringeTracer, CPolynomialApproximator,
+ * CFringeOrderer, CWavefrontFitter, CViewport, COverlay) держит свой
+ * CInstrumentation и отдаёт его через GetStats(). Экстракторы сбрасывают
+ * статистику в начале каждого Extract(), остальные накапливают до
+ * ResetStats().
+ *
+ * Замеры включаются макросом INTERFEROMETRY_INSTRUMENTATION (CMake-опция
+ * того же имени, по умолчанию 1). При 0 макросы INTERF_TIMED_SCOPE /
+ * INTERF_COUNT раскрываются в пустоту — в коде ядра не остаётся ни вызовов
+ * часов, ни сложений; GetStats() возвращает нули.
+ *
+ * @par Пример
+ * @code
+ *   skel.Extract({});
+ *   const CInstrumentation& st = skel.GetStats();
+ *   double thinMs = st.GetStage(EStage::Thin).totalMs;
+ *   st.SaveJson("run_stats.json");
+ * @endcode
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifndef INTERFEROMETRY_INSTRUMENTATION
+#define INTERFEROMETRY_INSTRUMENTATION 1
+#endif
+
+namespace Interferometry {
+
+/// Этапы конвейера, время которых замеряется
+enum class EStage {
+  Load = 0,     ///< ImageLoader::Load
+  Boundary,     ///< CEllipseBoundary::SetEllipse (границы + маска)
+  Binarize,     ///< сглаживание, маска, адаптивный порог, морфология
+  Thin,         ///< скелетизация Zhang-Suen
+  GraphBuild,   ///< построение графа скелета
+  Prune,        ///< обрезка веточек
+  Link,         ///< склейка разрывов
+  Polylines,    ///< сборка полилиний (+ ширина и яркость точек)
+  Trace,        ///< CFringeTracer::Extract — трассировка всех линий
+  Approximate,  ///< CPolynomialApproximator::Approximate
+  Order,        ///< CFringeOrderer::Assign — нумерация полос
+  Wavefront,    ///< CWavefrontFitter::Fit — Цернике и характеристики фронта
+  Render,       ///< CViewport::Render — перерисовка грязных плиток окна
+  Overlay,      ///< COverlay::Update — растеризация грязных областей разметки
+  Pupil,        ///< CPupilDetector::Detect — автоопределение границ зрачка
+  Count
+};
+
+/// Счётчики работы этапов
+enum class ECounter {
+  SkeletonPixels = 0,  ///< пикселей скелета после утончения
+  GraphNodes,          ///< узлов графа после построения
+  GraphEdges,          ///< рёбер графа после построения
+  PrunedEdges,         ///< удалено веточек
+  LinkedGaps,          ///< добавлено перемычек
+  Lines,               ///< выдано линий
+  LinePoints,          ///< выдано точек во всех линиях
+  TraceSeeds,          ///< стартовых точек трассировки
+  TraceSteps,          ///< шагов Step() трассировщика
+  ApproxFits,          ///< успешных аппроксимаций (неудачные = calls - fits)
+  WavefrontPoints,     ///< точек полос в МНК волнового фронта
+  OrderConflicts,      ///< пар линий с противоречивыми порядками
+  RenderTiles,         ///< перерисовано плиток окна
+  OverlayRects,        ///< перерисовано прямоугольников слоя разметки
+  Count
+};
+
+/// Накопленное время одного этапа
+struct CStageStats {
+  int64_t calls = 0;
+  double totalMs = 0.0;
+  double minMs = 0.0;
+  double maxMs = 0.0;
+
+  double MeanMs() const { return calls > 0 ? totalMs / calls : 0.0; }
+};
+
+class CInstrumentation {
+ public:
+  static constexpr int NUM_STAGES = (int)EStage::Count;
+  static constexpr int NUM_COUNTERS = (int)ECounter::Count;
+
+  /// Включены ли замеры в этой сборке
+  static constexpr bool Enabled() { return INTERFEROMETRY_INSTRUMENTATION != 0; }
+
+  void Reset() { *this = CInstrumentation(); }
+
+  void AddTime(EStage stage, double ms) {
+    CStageStats& s = m_stages[(int)stage];
+    if (s.calls == 0 || ms < s.minMs) s.minMs = ms;
+    if (s.calls == 0 || ms > s.maxMs) s.maxMs = ms;
+    s.calls++;
+    s.totalMs += ms;
+  }
+
+  void AddCount(ECounter counter, int64_t value) {
+    m_counters[(int)counter] += value;
+  }
+
+  /// Выданные линии: Lines += число линий, LinePoints += число точек
+  template <typename TLines>
+  void AddLines(const TLines& lines) {
+    int64_t points = 0;
+    for (const auto& line : lines) points += (int64_t)line.size();
+    AddCount(ECounter::Lines, (int64_t)lines.size());
+    AddCount(ECounter::LinePoints, points);
+  }
+
+  /// Сложить статистику другого объекта (например, всех кадров прогона)
+  void Merge(const CInstrumentation& other);
+
+  const CStageStats& GetStage(EStage stage) const {
+    return m_stages[(int)stage];
+  }
+  int64_t GetCounter(ECounter counter) const {
+    return m_counters[(int)counter];
+  }
+
+  /// Имена для экспорта: "thin", "trace_steps", ...
+  static const char* StageName(EStage stage);
+  static const char* CounterName(ECounter counter);
+
+  /**
+   * @brief JSON: {"stages": {"thin": {"calls", "total_ms", "min_ms",
+   *        "max_ms"}, ...}, "counters": {"trace_steps": N, ...}}.
+   *        Все этапы и счётчики присутствуют всегда — схема не меняется.
+   */
+  std::string ToJson() const;
+
+  /// CSV: kind,name,calls,total_ms,min_ms,max_ms,value — строка на этап
+  /// (kind = stage) и на счётчик (kind = counter)
+  std::string ToCsv() const;
+
+  bool SaveJson(const std::string& filename) const;
+  bool SaveCsv(const std::string& filename) const;
+
+ private:
+  CStageStats m_stages[NUM_STAGES];
+  int64_t m_counters[NUM_COUNTERS] = {};
+};
+
+/// Таймер области: время от конструктора до деструктора идёт в stats
+class CScopedStageTimer {
+ public:
+  CScopedStageTimer(CInstrumentation& stats, EStage stage)
+      : m_stats(stats), m_stage(stage), m_start(Clock::now()) {}
+
+  ~CScopedStageTimer() {
+    m_stats.AddTime(m_stage, std::chrono::duration<double, std::milli>(
+                                 Clock::now() - m_start)
+                                 .count());
+  }
+
+  CScopedStageTimer(const CScopedStageTimer&) = delete;
+  CScopedStageTimer& operator=(const CScopedStageTimer&) = delete;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  CInstrumentation& m_stats;
+  EStage m_stage;
+  Clock::time_point m_start;
+};
+
+}  // namespace Interferometry
+
+#define INTERF_CONCAT_IMPL(a, b) a##b
+#define INTERF_CONCAT(a, b) INTERF_CONCAT_IMPL(a, b)
+
+#if INTERFEROMETRY_INSTRUMENTATION
+/// Замерить время до конца текущей области видимости
+#define INTERF_TIMED_SCOPE(stats, stage) ::Interferometry::CScopedStageTimer INTERF_CONCAT(interfTimer_, __LINE__)((stats), ::Interferometry::EStage::stage)
+/// Прибавить value к счётчику
+#define INTERF_COUNT(stats, counter, value) (stats).AddCount(::Interferometry::ECounter::counter, (int64_t)(value))
+/// Прибавить линии и их точки (счётчики Lines, LinePoints)
+#define INTERF_COUNT_LINES(stats, lines) (stats).AddLines(lines)
+#else
+#define INTERF_TIMED_SCOPE(stats, stage) ((void)0)
+#define INTERF_COUNT(stats, counter, value) ((void)0)
+#define INTERF_COUNT_LINES(stats, lines) ((void)0)
+#endif
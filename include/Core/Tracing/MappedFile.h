@@ -0,0 +1,58 @@
+/**
+ * @file MappedFile.h
+ * @brief Файл, отображённый в память (mmap / CreateFileMapping).
+ *
+ * Файл открывается и измеряется один раз. В режиме CopyOnWrite страницы
+ * доступны на запись, но изменения остаются в памяти процесса и в файл не
+ * попадают — так cv::Mat поверх отображения можно править (SetPixel,
+ * normalize) без копирования кадра заранее.
+ *
+ * Файл открыт до Close(). В Windows открытие с FILE_SHARE_DELETE: файл
+ * можно переименовать и удалить, но не перезаписать. В POSIX усечение
+ * файла другим процессом даёт SIGBUS при обращении к пропавшим страницам —
+ * отображение годится для кадров, которые живут недолго.
+ */
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace Interferometry {
+
+enum class EMapMode {
+  ReadOnly,    ///< только чтение
+  CopyOnWrite  ///< запись в частные копии страниц
+};
+
+class CMappedFile {
+ public:
+  CMappedFile() = default;
+  ~CMappedFile() { Close(); }
+  CMappedFile(const CMappedFile&) = delete;
+  CMappedFile& operator=(const CMappedFile&) = delete;
+
+  /// Пустой файл открывается успешно: Size() == 0, Data() == nullptr
+  bool Open(const std::filesystem::path& path,
+            EMapMode mode = EMapMode::ReadOnly);
+  void Close();
+
+  bool IsOpen() const;
+  char* Data() const { return m_data; }
+  size_t Size() const { return m_size; }
+
+ private:
+  char* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef _WIN32
+  HANDLE m_file = INVALID_HANDLE_VALUE;
+  HANDLE m_mapping = nullptr;
+#else
+  int m_fd = -1;
+#endif
+};
+
+}  // namespace Interferometry
@@ -0,0 +1,128 @@
+/**
+ * @file MatrixFile.h
+ * @brief Чтение и запись сеток фазы и поверхности (.phs, .mtr).
+ *
+ * Текстовый формат: заголовок (ключ=значение, обычно в [GENERAL]; обязателен
+ * Size=N), затем [MATRIX] — по записи на строку сетки:
+ * @code
+ *   [MATRIX]
+ *    -0.9760 -0.0014 -0.0880 -0.0040 -0.0840 ... -0.0680
+ *           -0.0049 -0.0640 ... E
+ *   END
+ * @endcode
+ * Запись — координата строки y, затем пары «значение x», до E; перенос
+ * после каждых 6 пар. Координаты — нормированные, от -1 до 1 с шагом
+ * 2 / (N - 1): индекс = (c + 1) · (N - 1) / 2. Ячейки без значения (вне
+ * зрачка) в cv::Mat — NaN. Текст до [MATRIX] и после END (ELLIPSES,
+ * BOUNDS, IMAGE_FILE и т. п.) сохраняется как есть.
+ *
+ * Файл отображается в память; тело [MATRIX] делится по границам записей
+ * (E) на куски и разбирается потоками через std::from_chars прямо в
+ * строки cv::Mat. С useCache рядом с файлом ведётся двоичный кэш
+ * (<файл>.mcache: заголовок, текст до и после матрицы, float-ы сетки),
+ * действительный, пока у исходного файла те же размер и время изменения —
+ * повторное открытие сводится к чтению N² · 4 байт.
+ *
+ * @par Пример
+ * @code
+ *   CMatrixFileParams params;
+ *   params.useCache = true;
+ *   CMatrixReader reader;
+ *   reader.SetParams(params);
+ *   CMatrixData phase;
+ *   if (reader.ReadFile("morozoff-1c.phs", phase))
+ *     std::cout << phase.values.at<float>(phase.Size() / 2, phase.Size() / 2);
+ * @endcode
+ */
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "Instrumentation.h"
+
+namespace Interferometry {
+
+struct CMatrixFileParams {
+  int numThreads = 0;     // 0 — по числу ядер
+  bool useCache = false;  // двоичный кэш <файл>.mcache
+};
+
+struct CMatrixData {
+  /// Пары ключ=значение до [MATRIX] в порядке файла (Size, ScaleFactor,
+  /// Units, ...)
+  std::vector<std::pair<std::string, std::string>> header;
+
+  cv::Mat values;  // CV_32F, Size × Size; строка — y, столбец — x; NaN — нет
+
+  std::string preamble;  // текст до строки [MATRIX]
+  std::string trailer;   // текст после строки END матрицы
+
+  void Clear();
+  int Size() const { return values.rows; }
+
+  /// Значение ключа заголовка; пустая строка, если ключа нет
+  std::string GetHeader(const std::string& key) const;
+
+  /// Нормированная координата узла index сетки size и обратно
+  static double Coordinate(int index, int size);
+  static int Index(double coordinate, int size);
+};
+
+class CMatrixReader {
+ public:
+  CMatrixReader() = default;
+
+  void SetParams(const CMatrixFileParams& p) { m_params = p; }
+  const CMatrixFileParams& GetParams() const { return m_params; }
+
+  bool ReadFile(const std::filesystem::path& path, CMatrixData& data);
+  bool Parse(const char* text, size_t size, CMatrixData& data);
+
+  /// Путь двоичного кэша файла
+  static std::filesystem::path CachePath(const std::filesystem::path& path);
+
+  /// true — последний ReadFile() взял данные из кэша
+  bool FromCache() const { return m_fromCache; }
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+  /// Замеры ReadFile() / Parse() (этап Load); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
+ private:
+  bool ParseText(const char* text, size_t size, CMatrixData& data);
+  bool ParseBody(const char* begin, const char* end, cv::Mat& values,
+                 const char*& errorAt);
+  bool ReadCache(const std::filesystem::path& path, CMatrixData& data);
+  void WriteCache(const std::filesystem::path& path, const CMatrixData& data);
+
+  CMatrixFileParams m_params;
+  bool m_fromCache = false;
+  std::string m_lastError;
+  CInstrumentation m_stats;
+};
+
+/**
+ * @brief Запись сетки: значения и координаты — 4 знака после точки,
+ *        строки без значений пропускаются.
+ */
+class CMatrixWriter {
+ public:
+  CMatrixWriter() = default;
+
+  bool WriteFile(const std::filesystem::path& path, const CMatrixData& data);
+  static std::string Format(const CMatrixData& data);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+ private:
+  std::string m_lastError;
+};
+
+}  // namespace Interferometry
@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 
+#include "Instrumentation.h"
+
 namespace Interferometry
 {
 
@@ -31,6 +33,78 @@ namespace Interferometry
     double Evaluate(double x) const;
   };
 
+  // ============================================================================
+  // Выбор степени
+  // ============================================================================
+
+  /// Критерий выбора степени (p — число коэффициентов, N — число точек)
+  enum class EDegreeCriterion
+  {
+    Fixed,  ///< ровно DegreeSelection::degree, без перебора
+    AIC,    ///< минимум N·ln(RSS/N) + 2p
+    BIC,    ///< минимум N·ln(RSS/N) + p·ln N
+    Plateau ///< наименьшая p, у которой RMS ≤ (1 + plateauTolerance)·min RMS
+  };
+
+  struct DegreeSelection
+  {
+    EDegreeCriterion criterion = EDegreeCriterion::BIC;
+    int degree = 20;                // Fixed — степень, иначе верхняя граница
+    double plateauTolerance = 0.05; // только для Plateau
+  };
+
+  /**
+   * @brief Строка таблицы невязок — аналог таблицы *APPOLN* отчёта SCAN
+   *        (NP, RMSA, DISP) для одной линии.
+   */
+  struct DegreeResidual
+  {
+    int degree = 0;    // число коэффициентов; NP отчёта = degree - 1
+    double rss = 0.0;  // Σ невязок²
+    double rms = 0.0;  // RMSA = sqrt(rss / N)
+    double disp = 0.0; // DISP = sqrt(rss / (N - degree))
+    double aic = 0.0;
+    double bic = 0.0;
+  };
+
+  // ============================================================================
+  // Пакетная аппроксимация
+  // ============================================================================
+
+  /// Итог одной линии пакета; коэффициенты — в общем буфере пакета
+  struct LineFitInfo
+  {
+    bool valid = false;
+    int degree = 0; // число коэффициентов, как ApproximationResult::degree
+    double xMin = 0.0;
+    double xMax = 0.0;
+  };
+
+  /**
+   * @brief Результат ApproximateBatch(): коэффициенты всех линий подряд
+   *        в одном буфере, по stride на линию (хвост за degree — нули).
+   *
+   * Повторный вызов с тем же объектом переиспользует буферы.
+   */
+  struct BatchApproximationResult
+  {
+    int stride = 0;
+    std::vector<LineFitInfo> lines;
+    std::vector<double> coefficients; // lines.size() * stride
+
+    int NumLines() const { return (int)lines.size(); }
+    const double *Coefficients(int line) const
+    {
+      return coefficients.data() + (size_t)line * stride;
+    }
+
+    /// Значение полинома линии line в точке x (Горнер)
+    double Evaluate(int line, double x) const;
+
+    /// Копия линии в виде ApproximationResult (выделяет память)
+    ApproximationResult ToResult(int line) const;
+  };
+
   // ============================================================================
   // Аппроксиматор
   // ============================================================================
@@ -50,37 +124,98 @@ namespace Interferometry
     ApproximationResult Approximate(const std::vector<CTracerPoint> &points,
                                     int degree);
 
+    /**
+     * @brief Аппроксимация с выбором степени по критерию.
+     *
+     * Все степени до selection.degree строятся за один проход (базис
+     * ортогонален, младшие проекции от старших не зависят), невязка каждой
+     * степени — O(N). Итоговый полином — выбранной степени.
+     *
+     * @param residuals  если не nullptr — таблица невязок для степеней
+     *                   1..min(selection.degree, N - 2)
+     */
+    ApproximationResult Approximate(const std::vector<CTracerPoint> &points,
+                                    const DegreeSelection &selection,
+                                    std::vector<DegreeResidual> *residuals = nullptr);
+
     /// Аппроксимация по готовым массивам (x монотонен)
     ApproximationResult Approximate(const double *xx, const double *yy,
                                     int numPoints, int degree);
 
+    /**
+     * @brief Аппроксимация пакета линий в CSR-раскладке.
+     *
+     * Линия i — точки points[offsets[i] .. offsets[i+1]), offsets имеет
+     * numLines + 1 элементов. Линии делятся между numThreads потоками
+     * (0 — по числу ядер), у каждого потока свой рабочий буфер; на линию
+     * память не выделяется. Неудавшиеся линии — lines[i].valid == false.
+     *
+     * @return false — неверные аргументы (текст в GetLastError()).
+     */
+    bool ApproximateBatch(const CTracerPoint *points, const int *offsets,
+                          int numLines, int degree,
+                          BatchApproximationResult &out, int numThreads = 0);
+
+    /// То же для вектора линий (одна упаковка в CSR на весь пакет)
+    bool ApproximateBatch(const std::vector<std::vector<CTracerPoint>> &lines,
+                          int degree, BatchApproximationResult &out,
+                          int numThreads = 0);
+
+    /// Пакет с выбором степени каждой линии; stride = selection.degree
+    bool ApproximateBatch(const CTracerPoint *points, const int *offsets,
+                          int numLines, const DegreeSelection &selection,
+                          BatchApproximationResult &out, int numThreads = 0);
+
+    bool ApproximateBatch(const std::vector<std::vector<CTracerPoint>> &lines,
+                          const DegreeSelection &selection,
+                          BatchApproximationResult &out, int numThreads = 0);
+
     const std::string &GetLastError() const { return m_lastError; }
 
+    /// Замеры Approximate(); накапливаются до ResetStats()
+    const CInstrumentation &GetStats() const { return m_stats; }
+    void ResetStats() { m_stats.Reset(); }
+
   private:
+    // --- Одна линия: общий путь Approximate() и ApproximateBatch() ---
+    bool FitLine(const CTracerPoint *points, int numPoints,
+                 const DegreeSelection &selection, double *coeffsOut,
+                 LineFitInfo &info,
+                 std::vector<DegreeResidual> *residuals = nullptr);
+
     // --- Подготовка точек ---
-    bool PreparePoints(const std::vector<CTracerPoint> &points);
+    bool PreparePoints(const CTracerPoint *points, int n);
 
     // --- Ядро алгоритма Форсайта ---
     bool ComputeApproximation();
+    void ConvertToMonomial();
 
-    // --- Вспомогательные ---
-    double EvalPolynomial(double x, int degree, const double *coeffs) const;
-    double ComputeAlpha(int k) const;
-    double ComputeBeta(int k1, int k2) const;
-    double ComputeNorm(int k) const;
+    // --- Выбор степени (по m_rss после ComputeApproximation) ---
+    DegreeResidual MakeResidual(int degree) const;
+    int SelectDegree(const DegreeSelection &selection) const;
 
     // --- Данные ---
     std::vector<double> m_xx; // независимая ось (монотонная)
     std::vector<double> m_yy; // зависимая ось
 
+    // Значения Q_{k-1}(xx[i]) и Q_k(xx[i]) — столбцы рекуррентности
+    std::vector<double> m_qPrev;
+    std::vector<double> m_qCur;
+
+    // Невязка y - Σ b[j]·Qj, ведётся при m_trackResiduals
+    std::vector<double> m_resid;
+    bool m_trackResiduals;
+
     int m_numPoints;
     int m_degree;
 
     double m_orthoCoeffs[MAX_DEGREE][MAX_DEGREE]; // коэф-ты ортогональных полиномов
     double m_projections[MAX_DEGREE];             // проекции <y, Qk>
     double m_coefficients[MAX_DEGREE];            // итоговые коэф-ты полинома
+    double m_rss[MAX_DEGREE + 1];                 // m_rss[p] — Σ невязок² для p коэф-тов
 
     std::string m_lastError;
+    CInstrumentation m_stats;
   };
 
 } // namespace Interferometry
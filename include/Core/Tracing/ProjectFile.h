@@ -0,0 +1,145 @@
+/**
+ * @file ProjectFile.h
+ * @brief Двоичный файл проекта трассировки (.ifp): кадр, границы, линии
+ *        полос и аппроксимация.
+ *
+ * Файл — заголовок и последовательность секций, каждая со своей длиной:
+ * @code
+ *   "IFPROJ\0\0"  uint32 версия формата  uint32 0
+ *   секция: char[4] тег  uint32 версия  uint64 длина  uint32 CRC32  uint32 0
+ *           <длина байт данных>
+ *   ...
+ * @endcode
+ * Числа — little-endian. Секции:
+ *   INFO — ссылка на файл кадра, размеры, какие границы заданы
+ *   PIXL — встроенный кадр (по желанию; без него — только ссылка)
+ *   ELLP — параметры внешнего и внутреннего эллипсов
+ *   BNDS — таблица RowBoundary по строкам и дополнительные дырки строк
+ *   LINE — линии полос (пиксель, субпиксельный сдвиг, ширина, яркость)
+ *          и их порядки
+ *   APRX — BatchApproximationResult
+ *
+ * Open() читает только заголовки секций, переходя через данные; секция
+ * декодируется при Load() — проект на 500 линий открывается без чтения
+ * встроенного кадра. Незнакомые теги пропускаются, секция более новой
+ * версии, чем знает читатель, — ошибка Load() только этой секции.
+ *
+ * @par Пример
+ * @code
+ *   CProjectReader reader;
+ *   CProjectData project;
+ *   if (reader.Open("frame.ifp") &&
+ *       reader.Load(EProjectSection::Lines, project))
+ *     approximator.ApproximateBatch(project.lines, 8, results);
+ * @endcode
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "EllipseBoundary.h"
+#include "PolynomialApproximator.h"
+#include "Types.h"
+
+namespace Interferometry {
+
+enum class EProjectSection {
+  Info = 0,       ///< INFO
+  Image,          ///< PIXL
+  Ellipses,       ///< ELLP
+  Boundaries,     ///< BNDS
+  Lines,          ///< LINE
+  Approximation,  ///< APRX
+  Count
+};
+
+struct CProjectData {
+  // --- Кадр ---
+  std::string imagePath;  // исходный файл кадра (UTF-8)
+  int imageWidth = 0;
+  int imageHeight = 0;
+  cv::Mat pixels;  // встроенный кадр; пусто — грузить по imagePath
+
+  // --- Границы ---
+  bool hasOuter = false;
+  bool hasInner = false;
+  EllipseParams outerEllipse;
+  EllipseParams innerEllipse;
+  std::vector<RowBoundary> boundaries;  // по строке кадра
+  std::vector<CRowHole> extraHoles;     // вторая и следующие заслонки
+
+  // --- Полосы ---
+  std::vector<std::vector<CTracerPoint>> lines;
+  std::vector<double> orders;  // порядок линии; пусто — не назначены
+  BatchApproximationResult approximation;
+
+  void Clear();
+
+  /// Снимок границ: размеры, таблица строк (эллипсы задаются отдельно)
+  void SetBoundary(const CEllipseBoundary& boundary);
+
+  /// Восстановить CEllipseBoundary из таблицы строк (без пересчёта эллипсов)
+  bool RestoreBoundary(CEllipseBoundary& boundary) const;
+};
+
+class CProjectWriter {
+ public:
+  CProjectWriter() = default;
+
+  /// Секции PIXL нет, если data.pixels пуст; APRX — если аппроксимации нет
+  bool WriteFile(const std::filesystem::path& path, const CProjectData& data);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+ private:
+  std::string m_lastError;
+};
+
+class CProjectReader {
+ public:
+  static constexpr uint32_t FORMAT_VERSION = 1;
+
+  CProjectReader() = default;
+
+  /// Заголовок и оглавление секций; данные секций не читаются
+  bool Open(const std::filesystem::path& path);
+  void Close();
+  bool IsOpen() const { return m_file.is_open(); }
+
+  uint32_t GetVersion() const { return m_version; }
+  bool HasSection(EProjectSection section) const;
+  uint64_t GetSectionSize(EProjectSection section) const;
+
+  /// Декодировать одну секцию в соответствующие поля data
+  bool Load(EProjectSection section, CProjectData& data);
+
+  /// Все секции, кроме Image, если withImage == false
+  bool LoadAll(CProjectData& data, bool withImage = true);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+ private:
+  struct CSectionEntry {
+    bool present = false;
+    uint32_t version = 0;
+    uint64_t offset = 0;  // начало данных в файле
+    uint64_t size = 0;
+    uint32_t crc = 0;
+  };
+
+  bool ReadPayload(EProjectSection section, std::vector<char>& payload);
+
+  std::ifstream m_file;
+  std::filesystem::path m_path;
+  uint32_t m_version = 0;
+  CSectionEntry m_sections[(int)EProjectSection::Count];
+  std::string m_lastError;
+};
+
+}  // namespace Interferometry
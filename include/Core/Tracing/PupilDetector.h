@@ -0,0 +1,118 @@
+/**
+ * @file PupilDetector.h
+ * @brief Автоматическое определение зрачка: внешний эллипс и центральное
+ *        экранирование по кадру интерферограммы, без участия оператора.
+ *
+ * Порядок работы:
+ * 1. Кадр уменьшается (INTER_AREA) до maxWorkSize по длинной стороне и
+ *    сглаживается скользящим средним окна ±smoothRadius через интегральное
+ *    изображение — полосы усредняются, остаётся огибающая зрачка.
+ * 2. Порог: threshold > 0 — доля максимума сглаженного кадра (как прежнее
+ *    правило 10 %), иначе — 10 % пути от фона к зрачку (уровни — средние
+ *    классов Оцу). Низкий порог не срабатывает на тёмных полосах.
+ * 3. Начало лучей — центр масс пикселей выше порога. numRays лучей
+ *    сэмплируются билинейно с шагом полпикселя уменьшенного кадра.
+ *    Внешний край — последний спуск ниже порога (тёмные полосы внутри
+ *    зрачка не обрывают луч), внутренний — первый подъём, если начало
+ *    луча тёмное (экранирование).
+ * 4. Край уточняется до долей пикселя: сначала по сглаженному профилю
+ *    (середина между уровнями по обе стороны), затем по исходному кадру —
+ *    где яркость впервые отрывается от фона на 4 СКО шума. Положение по
+ *    сглаженному кадру зависит от фазы полос у края, по исходному — нет.
+ * 5. По точкам края — RANSAC с cv::fitEllipse по 5 точкам, невязка —
+ *    радиальное расстояние до эллипса; итог — fitEllipse по всем inlier'ам.
+ * 6. Экранирование принимается, если внутри него так же темно, как за
+ *    зрачком (тёмная центральная полоса колец светлее фона), оно почти
+ *    круглое и лежит в зрачке.
+ *
+ * Время определяется уменьшением кадра: единицы миллисекунд на кадр
+ * 4096×3072, остальное — сотни лучей по уменьшенному кадру.
+ *
+ * @par Пример
+ * @code
+ *   CPupilDetector detector;
+ *   CPupilDetection pupil;
+ *   if (detector.Detect(image, pupil)) {
+ *     boundary.SetEllipse(pupil.outer, true);
+ *     if (pupil.hasInner) boundary.SetEllipse(pupil.inner, false);
+ *   }
+ * @endcode
+ */
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+#include "EllipseBoundary.h"
+#include "Instrumentation.h"
+
+namespace Interferometry {
+
+struct CPupilDetectorParams {
+  int numRays = 72;
+  int maxWorkSize = 512;      // длинная сторона уменьшенного кадра
+  double smoothRadius = 12.0;  // полуширина окна среднего, пикселей кадра
+  double threshold = 0.0;     // доля максимума; <= 0 — автопорог
+  double margin = 2.0;        // внешний эллипс уже, внутренний шире, пикселей
+  bool detectInner = true;    // искать центральное экранирование
+  int ransacIterations = 200;
+  double ransacTolerance = 2.0;   // невязка inlier'а, пикселей кадра
+  double minInlierFraction = 0.5;  // от числа лучей с краем
+  uint32_t seed = 1;          // RANSAC детерминирован при одном seed
+};
+
+struct CPupilDetection {
+  bool hasOuter = false;
+  bool hasInner = false;
+  EllipseParams outer;  // с учётом margin — готово для SetEllipse
+  EllipseParams inner;
+  double threshold = 0.0;  // порог в единицах яркости кадра
+  cv::Point2f origin;      // начало лучей, пиксели кадра
+
+  // Точки края (пиксели кадра), по лучам; inlier'ов — outerInliers
+  std::vector<cv::Point2f> outerPoints;
+  std::vector<cv::Point2f> innerPoints;
+  int outerInliers = 0;
+  int innerInliers = 0;
+  double outerRms = 0.0;  // СКО невязки inlier'ов, пикселей
+  double innerRms = 0.0;
+
+  void Clear();
+};
+
+class CPupilDetector {
+ public:
+  CPupilDetector() = default;
+  explicit CPupilDetector(const CPupilDetectorParams& p) : m_params(p) {}
+
+  void SetParams(const CPupilDetectorParams& p) { m_params = p; }
+  const CPupilDetectorParams& GetParams() const { return m_params; }
+
+  /**
+   * @param image  одноканальный кадр: 8U, 8S, 16U, 16S, 32S, 32F или 64F
+   * @return false — кадр не подходит или внешний край не найден
+   *         (GetLastError()); экранирование не обязательно:
+   *         hasInner == false не считается ошибкой
+   */
+  bool Detect(const cv::Mat& image, CPupilDetection& result);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+  /// Замеры Detect(); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
+ private:
+  CPupilDetectorParams m_params;
+  std::string m_lastError;
+  CInstrumentation m_stats;
+
+  // Рабочие буферы — повторные вызовы на кадрах одного размера без выделений
+  cv::Mat m_small;
+  cv::Mat m_sum;
+  cv::Mat m_mean;
+};
+
+}  // namespace Interferometry
@@ -0,0 +1,65 @@
+/**
+ * @file PupilSpans.h
+ * @brief Операции над кадром только в рабочей области зрачка — по отрезкам
+ *        строк CEllipseBoundary::ForEachSpan, без проверки каждого пикселя.
+ *
+ * Рабочая область хранится построчно (RowBoundary и дополнительные дырки),
+ * поэтому перебор «пиксель → IsInside» заменяется перебором отрезков
+ * [x0, x1): внутренний цикл — плотный проход по строке, который компилятор
+ * векторизует; пиксели вне зрачка не читаются вовсе.
+ *
+ * Кадр может быть больше или меньше границ: берётся общая часть, всё вне
+ * границ считается вне зрачка.
+ *
+ * @par Пример
+ * @code
+ *   CMaskedStats s = MaskedStats(image, boundary);
+ *   cv::Mat binary;
+ *   MaskedThreshold(image, binary, (int)s.mean, boundary);
+ *   ClearOutside(skeleton, boundary);   // вместо bitwise_and с маской
+ * @endcode
+ */
+#pragma once
+
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+#include "EllipseBoundary.h"
+
+namespace Interferometry {
+
+struct CMaskedStats {
+  int64_t count = 0;  // пикселей в зрачке; 0 — статистики нет
+  double mean = 0.0;
+  double stdDev = 0.0;
+  double minValue = 0.0;
+  double maxValue = 0.0;
+};
+
+/// Среднее, СКО, минимум и максимум по зрачку; одноканальный кадр
+/// CV_8U / CV_16U / CV_32F / CV_64F, иначе count == 0
+CMaskedStats MaskedStats(const cv::Mat& image,
+                         const CEllipseBoundary& boundary);
+
+/// Гистограмма CV_8UC1 по зрачку (256 корзин) — для порогов по зрачку
+void MaskedHistogram(const cv::Mat& image, const CEllipseBoundary& boundary,
+                     int64_t hist[256]);
+
+/// dst = src в зрачке, вне зрачка dst не меняется. dst создаётся нулевым,
+/// если его размер или тип не совпадает с src
+void MaskedCopy(const cv::Mat& src, cv::Mat& dst,
+                const CEllipseBoundary& boundary);
+
+/// Обнулить всё вне зрачка; любой тип кадра
+void ClearOutside(cv::Mat& image, const CEllipseBoundary& boundary);
+
+/**
+ * @brief Порог по зрачку: dst (CV_8UC1) = 255, если src > thresh, иначе 0;
+ *        вне зрачка — 0.
+ * @param src  CV_8UC1
+ * @return число пикселей 255
+ */
+int64_t MaskedThreshold(const cv::Mat& src, cv::Mat& dst, int thresh,
+                        const CEllipseBoundary& boundary);
+
+}  // namespace Interferometry
@@ -0,0 +1,161 @@
+/**
+ * @file SkeletonGraph.h
+ * @brief Граф скелета полос: узлы (концы, развилки) и рёбра-цепочки
+ *        пикселей между ними.
+ *
+ * Строится за один растровый проход по скелету CFringeSkeletonizer.
+ * Обрезка веточек, склейка разрывов и сборка полилиний — операции над
+ * графом, а не повторные проходы по изображению.
+ */
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+#include "Types.h"
+
+namespace Interferometry {
+
+/**
+ * @brief Узел графа: конец линии (степень 1), развилка (степень >= 3)
+ *        или одиночный пиксель (степень 0).
+ *
+ * Развилка — связная группа пикселей скелета с 3+ соседями (и углов
+ * треугольников между ними); её пиксели лежат в хранилище графа подряд.
+ */
+struct CSkeletonNode {
+  int x = 0;  ///< опорный пиксель (первый в растровом порядке)
+  int y = 0;
+  int firstPixel = 0;      ///< начало пикселей узла в хранилище точек
+  int numPixels = 0;       ///< число пикселей узла
+  std::vector<int> edges;  ///< инцидентные рёбра; петля входит дважды
+  bool alive = true;
+
+  int Degree() const { return (int)edges.size(); }
+};
+
+/**
+ * @brief Ребро графа — цепочка пикселей степени 2 между узлами from и to.
+ *
+ * Точки ребра (без пикселей узлов) лежат подряд в хранилище графа,
+ * упорядочены от from к to. У замкнутого контура без узлов from = to = -1.
+ * Ребро-перемычка (gap) добавляется склейкой и точек не содержит.
+ */
+struct CSkeletonEdge {
+  int from = -1;
+  int to = -1;
+  int firstPoint = 0;
+  int numPoints = 0;
+  bool gap = false;
+  bool alive = true;
+
+  int Other(int node) const { return node == from ? to : from; }
+};
+
+class CSkeletonGraph {
+ public:
+  CSkeletonGraph() = default;
+
+  /**
+   * @brief Построить граф по скелету (CV_8UC1, ненулевые пиксели — скелет).
+   *
+   * Один растровый проход считает степени пикселей и размечает концы
+   * и развилки (развилки сливаются в узлы по связности); затем рёбра
+   * обходятся от узлов, оставшиеся пиксели степени 2 — замкнутые контуры.
+   * Развилки, у которых оказалось ровно два ребра (ступеньки диагоналей),
+   * сразу растворяются в одно ребро.
+   */
+  void Build(const cv::Mat& skeleton);
+
+  void Clear();
+
+  // === Структура ===
+  int NumNodes() const { return (int)m_nodes.size(); }
+  int NumEdges() const { return (int)m_edges.size(); }
+  const CSkeletonNode& GetNode(int i) const { return m_nodes[i]; }
+  const CSkeletonEdge& GetEdge(int i) const { return m_edges[i]; }
+  int Degree(int node) const { return m_nodes[node].Degree(); }
+
+  /// Пиксели узла / точки ребра — непрерывный участок хранилища
+  const cv::Point* NodePixels(int node) const {
+    return m_points.data() + m_nodes[node].firstPixel;
+  }
+  const cv::Point* EdgePoints(int edge) const {
+    return m_points.data() + m_edges[edge].firstPoint;
+  }
+
+  int CountAliveNodes() const;
+  int CountAliveEdges() const;
+
+  // === Операции ===
+
+  /**
+   * @brief Обрезка веточек: ребро «конец — развилка» короче
+   *        maxBranchLength пикселей (считая пиксель конца) удаляется.
+   *        Отдельный отрезок «конец — конец» удаляется целиком.
+   *
+   * Очередь концов обрабатывается до сходимости: развилка, ставшая
+   * концом, сама попадает в очередь, развилка степени 2 растворяется.
+   *
+   * @return Число удалённых рёбер.
+   */
+  int Prune(int maxBranchLength);
+
+  /**
+   * @brief Склейка разрывов: концы разных компонент ближе maxDistance
+   *        соединяются ребром-перемычкой, от ближайшей пары к дальней.
+   *
+   * Пара склеивается, если у обоих концов есть по два пикселя вглубь
+   * линии, а направление линии у первого конца и от второго конца
+   * совпадают с точностью до 60° (cos >= 0.5).
+   *
+   * @return Число добавленных перемычек.
+   */
+  int LinkEndpoints(int maxDistance);
+
+  /**
+   * @brief Сборка полилиний обходом графа.
+   *
+   * Обход идёт от концов (в растровом порядке), затем по оставшимся
+   * рёбрам и контурам. На развилке выбирается непройденное ребро,
+   * ближайшее по направлению к последнему шагу. Полилинии короче
+   * minLength точек отбрасываются. Заполняются только x, y.
+   */
+  std::vector<std::vector<CTracerPoint>> ExtractPolylines(int minLength) const;
+
+  /// Нарисовать текущий граф (без перемычек) в skeleton: 255 / 0
+  void Render(cv::Mat& skeleton) const;
+
+ private:
+  int AddEdge(int from, int to, const std::vector<cv::Point>& points,
+              bool gap = false);
+  void KillEdge(int edge);
+  void DetachEdge(int node, int edge);
+
+  /// Развилка степени 2 растворяется: два ребра и путь через неё — одно
+  /// ребро (лишние пиксели утолщения в граф не попадают)
+  void Dissolve(int node);
+
+  /// Точки ребра в порядке «от узла node»
+  void AppendEdgeFrom(int edge, int node, std::vector<cv::Point>& out) const;
+
+  /// Пиксели узла на пути from -> to: кратчайший 8-связный путь от
+  /// ближайшего к from до ближайшего к to. Без одной из точек — один
+  /// ближайший пиксель, без обеих — все пиксели узла.
+  void AppendNodePixels(int node, const cv::Point* from, const cv::Point* to,
+                        std::vector<cv::Point>& out) const;
+
+  /// Точка на steps шагов вглубь линии от конца node; false — нет такой
+  bool InwardPoint(int node, int steps, cv::Point& pt) const;
+
+  int m_width = 0;
+  int m_height = 0;
+
+  std::vector<CSkeletonNode> m_nodes;
+  std::vector<CSkeletonEdge> m_edges;
+
+  /// Хранилище точек: пиксели узлов и точки рёбер участками подряд
+  std::vector<cv::Point> m_points;
+};
+
+}  // namespace Interferometry
@@ -0,0 +1,126 @@
+/**
+ * @file WavefrontFitter.h
+ * @brief Волновой фронт по трассированным полосам: разложение по
+ *        полиномам Цернике и его характеристики (PV, RMS, Strehl).
+ *
+ * Вход — линии полос с известным порядком интерференции. Точка линии
+ * порядка k лежит на изолинии W = k · wavesPerFringe (в длинах волн).
+ * Координаты нормируются на зрачок, найденный по внешним границам
+ * CEllipseBoundary (аналог «Координаты центра» и «Диаметр» отчёта SCAN),
+ * точки вне рабочей области и в центральном экранировании отбрасываются.
+ *
+ * Коэффициенты ищутся МНК. Основной путь — нормальные уравнения AᵀA·z = Aᵀw:
+ * строки базиса считаются блоками, AᵀA накапливается по потокам, затем
+ * Холецкий (T×T, T — число членов). Память — O(T²) на поток, независимо от
+ * числа точек. Путь QR (Хаусхолдер) строит всю матрицу N×T и устойчивее при
+ * плохой обусловленности (мало точек, точки на одной стороне зрачка); на него
+ * же переходит основной путь, если Холецкий не проходит.
+ *
+ * @par Пример
+ * @code
+ *   CWavefrontFitter fitter;
+ *   CWavefrontResult wf;
+ *   if (fitter.Fit(lines, orders, boundary, wf))
+ *     std::cout << wf.stats.PV << " " << wf.stats.RMS << " " << wf.strehl;
+ * @endcode
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Instrumentation.h"
+#include "Types.h"
+
+namespace Interferometry {
+
+class CEllipseBoundary;
+
+/// Способ решения задачи МНК
+enum class EZernikeSolver {
+  NormalEquations,  ///< AᵀA + Холецкий (не положительно определена — QR)
+  QR                ///< QR-разложение полной матрицы N×T
+};
+
+struct CWavefrontParams {
+  int numTerms = 36;            // членов Цернике, порядок Fringe (Z1 — поршень)
+  double wavesPerFringe = 1.0;  // волн на порядок полосы (1 / кратность)
+  EZernikeSolver solver = EZernikeSolver::NormalEquations;
+  bool removeTilt = true;       // статистика без Z2, Z3
+  bool removeDefocus = false;   // статистика без Z4 (опорная — сфера)
+  int statsGrid = 128;          // отсчётов по диаметру для PV / RMS
+  int numThreads = 0;           // 0 — по числу ядер
+};
+
+/// Зрачок: u = (x - centerX) / radiusX, v = (y - centerY) / radiusY
+struct CPupilGeometry {
+  double centerX = 0.0;
+  double centerY = 0.0;
+  double radiusX = 0.0;
+  double radiusY = 0.0;
+
+  bool IsValid() const { return radiusX > 0.0 && radiusY > 0.0; }
+};
+
+struct CWavefrontResult {
+  bool valid = false;
+  std::vector<double> zernike;  // Z1..Zn, длины волн
+  CPupilGeometry pupil;
+  int numPoints = 0;            // точек полос в МНК
+  double fitRms = 0.0;          // СКО невязки в точках полос, волн
+
+  /// По сетке внутри зрачка, без Z1 и отключённых параметрами членов:
+  /// RMS — относительно нуля, stddev — относительно среднего
+  WavefrontStats stats = {};
+  double strehl = 0.0;          // по Марешалю: exp(-(2π·stddev)²)
+
+  bool MeetsStrehl() const;     // strehl ≥ Quality::MIN_STREHL
+
+  /// W(u, v) по всем членам, (u, v) — нормированные координаты зрачка
+  double Evaluate(double u, double v) const;
+};
+
+class CWavefrontFitter {
+ public:
+  CWavefrontFitter() = default;
+
+  void SetParams(const CWavefrontParams& p) { m_params = p; }
+  const CWavefrontParams& GetParams() const { return m_params; }
+
+  /**
+   * @param lines    линии полос (выход IFringeExtractor)
+   * @param orders   порядок полосы каждой линии, orders.size() == lines.size();
+   *                 линии с NaN (не пронумерованные CFringeOrderer) пропускаются
+   * @param boundary рабочая область; зрачок — по её внешним границам
+   * @return false — мало точек, нет зрачка или система вырождена
+   *         (текст в GetLastError())
+   */
+  bool Fit(const std::vector<std::vector<CTracerPoint>>& lines,
+           const std::vector<double>& orders,
+           const CEllipseBoundary& boundary, CWavefrontResult& result);
+
+  const std::string& GetLastError() const { return m_lastError; }
+
+  /// Замеры Fit(); накапливаются до ResetStats()
+  const CInstrumentation& GetStats() const { return m_stats; }
+  void ResetStats() { m_stats.Reset(); }
+
+  // === Базис ===
+
+  /// Радиальная степень n и азимутальный порядок m члена j (1..) в порядке
+  /// Fringe; sinTerm — член с sin(mθ)
+  static void FringeIndex(int j, int& n, int& m, bool& sinTerm);
+
+  /// Значение члена j в точке единичного круга
+  static double Zernike(int j, double u, double v);
+
+  /// Зрачок по внешним границам строк (центр и полуоси по моментам области)
+  static CPupilGeometry PupilFromBoundary(const CEllipseBoundary& boundary);
+
+ private:
+  CWavefrontParams m_params;
+  std::string m_lastError;
+  CInstrumentation m_stats;
+};
+
+}  // namespace Interferometry
@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include "Overlay.h"
+#include "Viewport.h"
+
 class CInterferometryAppView : public CView {
  protected:  // create from serialization only
   CInterferometryAppView() noexcept;
@@ -21,6 +24,7 @@ class CInterferometryAppView : public CView {
   virtual BOOL PreCreateWindow(CREATESTRUCT& cs);
 
  protected:
+  virtual void OnUpdate(CView* pSender, LPARAM lHint, CObject* pHint);
   virtual BOOL OnPreparePrinting(CPrintInfo* pInfo);
   virtual void OnBeginPrinting(CDC* pDC, CPrintInfo* pInfo);
   virtual void OnEndPrinting(CDC* pDC, CPrintInfo* pInfo);
@@ -53,6 +57,15 @@ class CInterferometryAppView : public CView {
 
   // Мышь
   afx_msg void OnLButtonDown(UINT nFlags, CPoint point);
+  afx_msg void OnMouseMove(UINT nFlags, CPoint point);
+  // Колесо — масштаб под курсором, средняя кнопка — перетаскивание кадра
+  afx_msg BOOL OnMouseWheel(UINT nFlags, short zDelta, CPoint pt);
+  afx_msg void OnMButtonDown(UINT nFlags, CPoint point);
+  afx_msg void OnMButtonUp(UINT nFlags, CPoint point);
+
+  // Окно
+  afx_msg void OnSize(UINT nType, int cx, int cy);
+  afx_msg BOOL OnEraseBkgnd(CDC* pDC);
 
   // Клавиатура
   afx_msg void OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags);
@@ -62,18 +75,39 @@ class CInterferometryAppView : public CView {
   // Текщий режим редактирования
   Interferometry::EditMode m_currentMode;
 
+  // Отступ области кадра от края окна (сверху — строка информации)
+  int m_imageOffsetX;
+  int m_imageOffsetY;
+
+  // Границы и точки ввода: слой, растеризуемый только при изменениях
+  Interferometry::COverlay m_overlay;
+
+  // Кадр, слой разметки и линии в окне: масштаб, сдвиг, перерисовка по
+  // плиткам
+  Interferometry::CViewport m_viewport;
+  const uchar* m_viewportImage;  // данные кадра, переданного в m_viewport
+  size_t m_viewportLines;        // линий документа, переданных в m_viewport
+
+  // Перетаскивание средней кнопкой
+  bool m_panning;
+  CPoint m_panLast;
+
   // ============================================================================
 // ВСПОМОГАТЕЛЬНЫЕ МЕТОДЫ отрисовки
 // ============================================================================
 private:
-// Нарисовать точки границ (пока элипс не построен)
-void DrawBoundaryPoints(CDC* pDC, const std::vector<CPoint>& points, COLORREF color);
+// Окно -> кадр с учётом масштаба и сдвига
+CPoint WindowToImage(CPoint windowPt) const;
+
+// Область окна под кадром
+CRect GetViewportRect() const;
 
-// Нарисовать элипс границ
-void DrawEllipseBoundary(CDC* pDC, bool isOuter);
+// Передать в m_viewport и m_overlay новый кадр, линии, границы и точки
+// ввода документа
+void SyncViewport();
 
-// Нарисовать одну трассированную линию
-void DrawFringeLine(CDC* pDC, const Interferometry::FringeLine& line);
+// Вывести буфер m_viewport в прямоугольник окна
+void BlitViewport(CDC* pDC, const CRect& rect);
 
 // Обновить текст в статусбаре
 void UpdateStatusBar();
@@ -0,0 +1,38 @@
+#include "ImagePyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+namespace Interferometry {
+
+void CImagePyramid::Build(const cv::Mat& image, int tileSize) {
+  m_levels.clear();
+  if (image.empty()) return;
+
+  cv::Mat gray;
+  if (image.channels() == 1)
+    gray = image;
+  else
+    cv::cvtColor(image, gray,
+                 image.channels() == 4 ? cv::COLOR_BGRA2GRAY
+                                       : cv::COLOR_BGR2GRAY);
+  m_levels.push_back(gray);
+
+  tileSize = (std::max)(tileSize, 16);
+  while ((std::max)(m_levels.back().cols, m_levels.back().rows) > tileSize) {
+    const cv::Mat& prev = m_levels.back();
+    cv::Mat next;
+    cv::resize(prev, next, cv::Size((prev.cols + 1) / 2, (prev.rows + 1) / 2),
+               0, 0, cv::INTER_AREA);
+    m_levels.push_back(next);
+  }
+}
+
+int CImagePyramid::LevelForZoom(double zoom) const {
+  if (m_levels.empty() || zoom >= 1.0) return 0;
+  int level = (int)std::floor(std::log2(1.0 / zoom));
+  return (std::min)(level, NumLevels() - 1);
+}
+
+}  // namespace Interferometry
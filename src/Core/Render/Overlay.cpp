@@ -0,0 +1,423 @@
+#include "Overlay.h"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+namespace Interferometry {
+
+namespace {
+
+// Уменьшенные копии строятся, пока большая сторона больше kMinLevelSize
+constexpr int kMinLevelSize = 256;
+// Точек во фрагменте ломаной: отсечение по грязному прямоугольнику
+constexpr int kChunkPoints = 64;
+// Поля вокруг грязного прямоугольника: отрезок, обрезанный краем, ложится
+// так же, как при перерисовке всего слоя
+constexpr int kRasterMargin = 4;
+
+cv::Point ToFixed(double x, double y) {
+  return cv::Point((int)std::lround(x * kPointShiftScale),
+                   (int)std::lround(y * kPointShiftScale));
+}
+
+// Контур границы: левые концы строк сверху вниз, правые — снизу вверх
+template <typename Has, typename Left, typename Right>
+std::vector<cv::Point> Contour(const std::vector<RowBoundary>& rows, Has has,
+                               Left left, Right right) {
+  std::vector<cv::Point> contour;
+  for (int y = 0; y < (int)rows.size(); y++)
+    if (has(rows[y])) contour.push_back(ToFixed(left(rows[y]), y));
+  for (int y = (int)rows.size() - 1; y >= 0; y--)
+    if (has(rows[y])) contour.push_back(ToFixed(right(rows[y]), y));
+  if (!contour.empty()) contour.push_back(contour.front());
+  return contour;
+}
+
+// Контуры дырок: отрезки соседних строк, которые перекрываются по x, —
+// одна дырка. Заслонки выпуклые, поэтому слияний и ветвлений не бывает;
+// если всё же встретятся, лишний отрезок начинает новый контур
+std::vector<std::vector<cv::Point>> HoleContours(
+    const CEllipseBoundary& boundary) {
+  struct CChain {
+    std::vector<cv::Point> left, right;
+    CRowSpan last;
+  };
+  std::vector<CChain> open, next, closed;
+  std::vector<CRowSpan> holes;
+  for (int y = 0; y < boundary.GetImageHeight(); y++) {
+    boundary.GetRowHoles(y, holes);
+    next.clear();
+    for (const CRowSpan& h : holes) {
+      auto it = std::find_if(open.begin(), open.end(), [&](const CChain& c) {
+        return !c.left.empty() && c.last.x0 <= h.x1 && h.x0 <= c.last.x1;
+      });
+      next.emplace_back();
+      if (it != open.end()) std::swap(next.back(), *it);
+      next.back().left.push_back(ToFixed(h.x0, y));
+      next.back().right.push_back(ToFixed(h.x1, y));
+      next.back().last = h;
+    }
+    for (CChain& c : open)
+      if (!c.left.empty()) closed.push_back(std::move(c));
+    open.swap(next);
+  }
+  for (CChain& c : open) closed.push_back(std::move(c));
+
+  std::vector<std::vector<cv::Point>> contours;
+  for (CChain& c : closed) {
+    std::vector<cv::Point>& contour = c.left;
+    contour.insert(contour.end(), c.right.rbegin(), c.right.rend());
+    contour.push_back(contour.front());
+    contours.push_back(std::move(contour));
+  }
+  return contours;
+}
+
+}  // namespace
+
+//=============================================================================
+// Параметры и размер
+//=============================================================================
+void COverlay::SetParams(const COverlayParams& p) {
+  m_params = p;
+  m_params.maxDirtyRects = (std::max)(m_params.maxDirtyRects, 1);
+  // Толщина и радиусы входят в охваты фрагментов
+  m_outer.thickness = m_params.boundaryWidth;
+  m_outer.color = m_params.outerColor;
+  m_markers.radius = m_params.pointRadius;
+  BuildChunks(m_outer);
+  for (CItem& hole : m_inner) {
+    hole.thickness = m_params.boundaryWidth;
+    hole.color = m_params.innerColor;
+    BuildChunks(hole);
+  }
+  BuildChunks(m_markers);
+  for (CItem& line : m_lines) {
+    line.thickness = m_params.lineWidth;
+    line.radius = m_params.markerRadius;
+    BuildChunks(line);
+  }
+  Invalidate();
+}
+
+void COverlay::Reset(int width, int height) {
+  m_width = (std::max)(width, 0);
+  m_height = (std::max)(height, 0);
+  m_outer = CItem();
+  m_inner.clear();
+  m_markers = CItem();
+  m_lines.clear();
+  m_dirty.clear();
+  m_levels.clear();
+  m_layer = cv::Mat();
+  if (IsEmpty()) return;
+
+  // Размер уровня 0 кратен 2^(уровней − 1): каждое уменьшение — ровно
+  // 2×2 → 1, и кусок уровня пересчитывается так же, как уровень целиком
+  int numLevels = 1;
+  while ((std::max)(m_width, m_height) > (kMinLevelSize << (numLevels - 1)))
+    numLevels++;
+  const int align = 1 << (numLevels - 1);
+  int w = (m_width + align - 1) / align * align;
+  int h = (m_height + align - 1) / align * align;
+  for (int l = 0; l < numLevels; l++)
+    m_levels.push_back(cv::Mat::zeros(h >> l, w >> l, CV_8UC4));
+  m_layer = m_levels[0](cv::Rect(0, 0, m_width, m_height));
+}
+
+//=============================================================================
+// Элементы
+//=============================================================================
+void COverlay::BuildChunks(CItem& item) const {
+  item.chunks.clear();
+  item.bounds = cv::Rect();
+  const int n = (int)item.points.size();
+  if (n == 0) return;
+
+  // Запас на толщину линии, фигуру маркера и округление координат
+  const int pad = (item.thickness + 1) / 2 + item.radius + 2;
+  const int step = item.dots ? kChunkPoints : kChunkPoints - 1;
+  for (int begin = 0; begin < n; begin += step) {
+    int end = (std::min)(begin + (item.dots ? step - 1 : step), n - 1);
+    // Соединяющая линия маркеров доходит до первой точки следующего фрагмента
+    int last = item.dots && item.connect ? (std::min)(end + 1, n - 1) : end;
+    int x0 = item.points[begin].x, x1 = x0;
+    int y0 = item.points[begin].y, y1 = y0;
+    for (int i = begin + 1; i <= last; i++) {
+      x0 = (std::min)(x0, item.points[i].x);
+      x1 = (std::max)(x1, item.points[i].x);
+      y0 = (std::min)(y0, item.points[i].y);
+      y1 = (std::max)(y1, item.points[i].y);
+    }
+    cv::Rect bounds((x0 >> kPointShift) - pad, (y0 >> kPointShift) - pad,
+                    ((x1 - x0) >> kPointShift) + 2 * pad + 2,
+                    ((y1 - y0) >> kPointShift) + 2 * pad + 2);
+    item.chunks.push_back({begin, end, bounds});
+    item.bounds = item.bounds.empty() ? bounds : (item.bounds | bounds);
+    if (end == n - 1) break;
+  }
+}
+
+void COverlay::SetContour(CItem& item, std::vector<cv::Point>&& points,
+                          CColor color) {
+  if (points == item.points && color == item.color) return;
+  InvalidateItem(item);
+  item.points = std::move(points);
+  item.color = color;
+  item.thickness = m_params.boundaryWidth;
+  BuildChunks(item);
+  InvalidateItem(item);
+}
+
+void COverlay::SetBoundary(const CEllipseBoundary& boundary) {
+  const std::vector<RowBoundary>& rows = boundary.GetAllBoundaries();
+  SetContour(m_outer,
+             Contour(rows, [](const RowBoundary& r) {
+                       return r.HasOuterBoundary();
+                     },
+                     [](const RowBoundary& r) { return r.leftOuter; },
+                     [](const RowBoundary& r) { return r.rightOuter; }),
+             m_params.outerColor);
+  // Контур на заслонку; лишние старые контуры стираются
+  std::vector<std::vector<cv::Point>> holes = HoleContours(boundary);
+  if (m_inner.size() < holes.size()) m_inner.resize(holes.size());
+  for (size_t i = 0; i < m_inner.size(); i++)
+    SetContour(m_inner[i],
+               i < holes.size() ? std::move(holes[i])
+                                : std::vector<cv::Point>(),
+               m_params.innerColor);
+  m_inner.resize(holes.size());
+}
+
+void COverlay::ClearBoundary() {
+  SetContour(m_outer, {}, m_params.outerColor);
+  for (CItem& hole : m_inner) SetContour(hole, {}, m_params.innerColor);
+  m_inner.clear();
+}
+
+void COverlay::SetMarkers(const std::vector<cv::Point2f>& points,
+                          CColor color, EMarkerShape shape, bool connect) {
+  std::vector<cv::Point> fixed;
+  fixed.reserve(points.size());
+  for (const cv::Point2f& p : points) fixed.push_back(ToFixed(p.x, p.y));
+  if (fixed == m_markers.points && color == m_markers.color &&
+      shape == m_markers.shape && connect == m_markers.connect)
+    return;
+
+  InvalidateItem(m_markers);
+  m_markers.points = std::move(fixed);
+  m_markers.color = color;
+  m_markers.shape = shape;
+  m_markers.connect = connect;
+  m_markers.dots = true;
+  m_markers.thickness = 1;
+  m_markers.radius = m_params.pointRadius;
+  BuildChunks(m_markers);
+  InvalidateItem(m_markers);
+}
+
+void COverlay::ClearMarkers() {
+  InvalidateItem(m_markers);
+  m_markers.points.clear();
+  BuildChunks(m_markers);
+}
+
+int COverlay::AddLine(const std::vector<CTracerPoint>& line, CColor color) {
+  CItem item;
+  item.id = m_nextId++;
+  item.color = color;
+  item.thickness = m_params.lineWidth;
+  item.radius = m_params.markerRadius;
+  item.points.reserve(line.size());
+  for (const CTracerPoint& p : line)
+    item.points.push_back(ToFixed(p.PosX(), p.PosY()));
+  BuildChunks(item);
+  InvalidateItem(item);
+  m_lines.push_back(std::move(item));
+  return m_lines.back().id;
+}
+
+bool COverlay::RemoveLine(int id) {
+  auto it = std::find_if(m_lines.begin(), m_lines.end(),
+                         [id](const CItem& item) { return item.id == id; });
+  if (it == m_lines.end()) return false;
+  InvalidateItem(*it);
+  m_lines.erase(it);
+  return true;
+}
+
+void COverlay::ClearLines() {
+  for (const CItem& line : m_lines) InvalidateItem(line);
+  m_lines.clear();
+}
+
+//=============================================================================
+// Грязные области
+//=============================================================================
+void COverlay::Invalidate() {
+  m_dirty.clear();
+  if (!IsEmpty()) m_dirty.push_back(cv::Rect(0, 0, m_width, m_height));
+}
+
+void COverlay::InvalidateRect(const cv::Rect& rect) {
+  cv::Rect r = rect & cv::Rect(0, 0, m_width, m_height);
+  if (r.empty()) return;
+  m_dirty.push_back(r);
+  if ((int)m_dirty.size() > m_params.maxDirtyRects) {
+    cv::Rect all = m_dirty[0];
+    for (const cv::Rect& d : m_dirty) all |= d;
+    m_dirty.assign(1, all);
+  }
+}
+
+void COverlay::InvalidateItem(const CItem& item) {
+  // Охват по фрагментам: длинная изогнутая линия — несколько полос, а не
+  // весь её прямоугольник
+  if (item.chunks.size() <= 4) {
+    if (!item.bounds.empty()) InvalidateRect(item.bounds);
+    return;
+  }
+  const size_t group = (item.chunks.size() + 3) / 4;
+  for (size_t i = 0; i < item.chunks.size(); i += group) {
+    cv::Rect r = item.chunks[i].bounds;
+    for (size_t j = i + 1; j < (std::min)(i + group, item.chunks.size()); j++)
+      r |= item.chunks[j].bounds;
+    InvalidateRect(r);
+  }
+}
+
+//=============================================================================
+// Растеризация
+//=============================================================================
+int COverlay::Update(std::vector<cv::Rect>* updated) {
+  INTERF_TIMED_SCOPE(m_stats, Overlay);
+  if (updated) updated->clear();
+  if (IsEmpty() || m_dirty.empty()) {
+    m_dirty.clear();
+    return 0;
+  }
+
+  std::vector<cv::Rect> dirty;
+  dirty.swap(m_dirty);
+  for (const cv::Rect& rect : dirty) {
+    RasterizeRect(rect);
+    UpdateLevels(rect);
+    if (updated) updated->push_back(rect);
+  }
+  INTERF_COUNT(m_stats, OverlayRects, (int64_t)dirty.size());
+  return (int)dirty.size();
+}
+
+void COverlay::RasterizeRect(const cv::Rect& rect) {
+  const cv::Rect area(rect.x - kRasterMargin, rect.y - kRasterMargin,
+                      rect.width + 2 * kRasterMargin,
+                      rect.height + 2 * kRasterMargin);
+  m_scratch.create(area.size(), CV_8UC4);
+  m_scratch.setTo(cv::Scalar::all(0));
+  DrawItem(m_scratch, area, m_outer);
+  for (const CItem& hole : m_inner) DrawItem(m_scratch, area, hole);
+  for (const CItem& line : m_lines) DrawItem(m_scratch, area, line);
+  DrawItem(m_scratch, area, m_markers);
+  m_scratch(cv::Rect(kRasterMargin, kRasterMargin, rect.width, rect.height))
+      .copyTo(m_layer(rect));
+}
+
+void COverlay::DrawItem(cv::Mat& target, const cv::Rect& area,
+                        const CItem& item) {
+  if (item.points.empty() || (item.bounds & area).empty()) return;
+  const cv::Scalar color = ToScalar(item.color);
+  const cv::Point shift(area.x * (1 << kPointShift),
+                        area.y * (1 << kPointShift));
+
+  for (const CChunk& chunk : item.chunks) {
+    if ((chunk.bounds & area).empty()) continue;
+    m_polyline.clear();
+    for (int i = chunk.begin; i <= chunk.end; i++)
+      m_polyline.push_back(item.points[i] - shift);
+    // Маркеры: соединяющая линия проходит и между фрагментами
+    if (item.dots && item.connect && chunk.end + 1 < (int)item.points.size())
+      m_polyline.push_back(item.points[chunk.end + 1] - shift);
+    if (!item.dots || item.connect) {
+      const cv::Point* pts = m_polyline.data();
+      const int count = (int)m_polyline.size();
+      cv::polylines(target, &pts, &count, 1, false, color, item.thickness,
+                    cv::LINE_8, kPointShift);
+    }
+    if (!item.dots) continue;
+    const int r = item.radius << kPointShift;
+    for (int i = 0; i <= chunk.end - chunk.begin; i++) {
+      const cv::Point& p = m_polyline[i];
+      if (item.shape == EMarkerShape::Cross) {
+        cv::line(target, p - cv::Point(r, 0), p + cv::Point(r, 0), color, 1,
+                 cv::LINE_8, kPointShift);
+        cv::line(target, p - cv::Point(0, r), p + cv::Point(0, r), color, 1,
+                 cv::LINE_8, kPointShift);
+      } else {
+        cv::circle(target, p, r, color, cv::FILLED, cv::LINE_8, kPointShift);
+      }
+    }
+  }
+
+  // Маркер начала линии полосы
+  if (!item.dots && item.radius > 0)
+    cv::circle(target, item.points[0] - shift, item.radius << kPointShift,
+               color, cv::FILLED, cv::LINE_8, kPointShift);
+}
+
+void COverlay::UpdateLevels(const cv::Rect& rect) {
+  // Кусок уровня l пересчитывается из выровненного на 2 куска уровня l − 1
+  int x0 = rect.x, y0 = rect.y, x1 = rect.x + rect.width,
+      y1 = rect.y + rect.height;
+  for (int l = 1; l < (int)m_levels.size(); l++) {
+    x0 >>= 1;
+    y0 >>= 1;
+    x1 = (x1 + 1) >> 1;
+    y1 = (y1 + 1) >> 1;
+    const cv::Rect dst(x0, y0, x1 - x0, y1 - y0);
+    const cv::Rect src(2 * x0, 2 * y0, 2 * dst.width, 2 * dst.height);
+    cv::Mat out = m_levels[l](dst);
+    cv::resize(m_levels[l - 1](src), out, dst.size(), 0, 0, cv::INTER_AREA);
+  }
+}
+
+//=============================================================================
+// Наложение
+//=============================================================================
+void COverlay::Blend(const cv::Mat& layer, cv::Mat& target) {
+  CV_Assert(layer.type() == CV_8UC4 && layer.size() == target.size());
+  CV_Assert(target.type() == CV_8UC3 || target.type() == CV_8UC4);
+  const int cn = target.channels();
+  for (int y = 0; y < layer.rows; y++) {
+    const uchar* src = layer.ptr<uchar>(y);
+    uchar* dst = target.ptr<uchar>(y);
+    for (int x = 0; x < layer.cols; x++, src += 4, dst += cn) {
+      const int a = src[3];
+      if (a == 0) continue;
+      if (a == 255) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        continue;
+      }
+      const int k = 255 - a;
+      for (int c = 0; c < 3; c++)
+        dst[c] = (uchar)(src[c] + (dst[c] * k + 127) / 255);
+    }
+  }
+}
+
+cv::Mat COverlay::Compose(const cv::Mat& image) {
+  Update();
+  cv::Mat out;
+  if (image.channels() == 1)
+    cv::cvtColor(image, out, cv::COLOR_GRAY2BGR);
+  else if (image.channels() == 4)
+    cv::cvtColor(image, out, cv::COLOR_BGRA2BGR);
+  else
+    out = image.clone();
+  if (!IsEmpty() && out.size() == m_layer.size()) Blend(m_layer, out);
+  return out;
+}
+
+}  // namespace Interferometry
@@ -0,0 +1,467 @@
+#include "Viewport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <opencv2/imgproc.hpp>
+
+#include "Overlay.h"
+
+namespace Interferometry {
+
+namespace {
+
+// Уровней упрощения линий больше не нужно: 2^12 — весь кадр в пиксель
+constexpr int kMaxLod = 12;
+
+// Охват с нулевой шириной (вертикальная линия) тоже пересекается
+bool Overlaps(const cv::Rect2f& a, const cv::Rect2d& q) {
+  return a.x <= q.x + q.width && a.x + a.width >= q.x &&
+         a.y <= q.y + q.height && a.y + a.height >= q.y;
+}
+
+cv::Rect2f Bounds(const cv::Point2f* p, int n) {
+  float x0 = p[0].x, x1 = p[0].x, y0 = p[0].y, y1 = p[0].y;
+  for (int i = 1; i < n; i++) {
+    x0 = (std::min)(x0, p[i].x);
+    x1 = (std::max)(x1, p[i].x);
+    y0 = (std::min)(y0, p[i].y);
+    y1 = (std::max)(y1, p[i].y);
+  }
+  return cv::Rect2f(x0, y0, x1 - x0, y1 - y0);
+}
+
+// Дуглас-Пекер без рекурсии: отклонение от хорды не больше tolerance
+void Simplify(const std::vector<cv::Point2f>& in, double tolerance,
+              std::vector<cv::Point2f>& out) {
+  const int n = (int)in.size();
+  out.clear();
+  if (n <= 2) {
+    out = in;
+    return;
+  }
+  std::vector<char> keep(n, 0);
+  keep[0] = keep[n - 1] = 1;
+  std::vector<std::pair<int, int>> stack = {{0, n - 1}};
+  const double tol2 = tolerance * tolerance;
+  while (!stack.empty()) {
+    const int a = stack.back().first, b = stack.back().second;
+    stack.pop_back();
+    if (b - a < 2) continue;
+    const double dx = in[b].x - in[a].x, dy = in[b].y - in[a].y;
+    const double len2 = dx * dx + dy * dy;
+    double worst = -1.0;
+    int worstIdx = -1;
+    for (int i = a + 1; i < b; i++) {
+      double px = in[i].x - in[a].x, py = in[i].y - in[a].y;
+      double cross = px * dy - py * dx;
+      // Замкнутая хорда (a == b по месту) — расстояние до точки
+      double d2 = len2 > 0.0 ? cross * cross / len2 : px * px + py * py;
+      if (d2 > worst) {
+        worst = d2;
+        worstIdx = i;
+      }
+    }
+    if (worst > tol2) {
+      keep[worstIdx] = 1;
+      stack.push_back({a, worstIdx});
+      stack.push_back({worstIdx, b});
+    }
+  }
+  for (int i = 0; i < n; i++)
+    if (keep[i]) out.push_back(in[i]);
+}
+
+}  // namespace
+
+//=============================================================================
+// Данные
+//=============================================================================
+void CViewport::SetParams(const CViewportParams& p) {
+  const bool rebuild = p.tileSize != m_params.tileSize;
+  m_params = p;
+  m_params.tileSize = (std::max)(m_params.tileSize, 16);
+  m_params.chunkPoints = (std::max)(m_params.chunkPoints, 2);
+  m_params.maxDirtyRects = (std::max)(m_params.maxDirtyRects, 1);
+  if (rebuild && !m_pyramid.IsEmpty()) {
+    // Build() очищает уровни до чтения кадра — держим свою ссылку на данные
+    cv::Mat base = m_pyramid.Level(0);
+    m_pyramid.Build(base, m_params.tileSize);
+  }
+  for (CLine& line : m_lines) line.lods.clear();
+  Invalidate();
+}
+
+void CViewport::SetImage(const cv::Mat& image) {
+  m_pyramid.Build(image, m_params.tileSize);
+  Invalidate();
+}
+
+void CViewport::ClearImage() {
+  m_pyramid.Clear();
+  Invalidate();
+}
+
+void CViewport::AppendLine(const std::vector<CTracerPoint>& line,
+                           CColor color) {
+  CLine entry;
+  entry.color = color;
+  entry.points.reserve(line.size());
+  for (const CTracerPoint& p : line)
+    entry.points.emplace_back((float)p.PosX(), (float)p.PosY());
+  if (!entry.points.empty())
+    entry.bounds = Bounds(entry.points.data(), (int)entry.points.size());
+  m_lines.push_back(std::move(entry));
+}
+
+void CViewport::SetLines(const std::vector<std::vector<CTracerPoint>>& lines,
+                         const std::vector<CColor>& colors) {
+  m_lines.clear();
+  m_lines.reserve(lines.size());
+  for (size_t i = 0; i < lines.size(); i++)
+    AppendLine(lines[i],
+               i < colors.size() ? colors[i] : MakeColor(255, 255, 0));
+  Invalidate();
+}
+
+void CViewport::AddLine(const std::vector<CTracerPoint>& line, CColor color) {
+  AppendLine(line, color);
+  if (!m_lines.back().points.empty()) InvalidateImage(m_lines.back().bounds);
+}
+
+void CViewport::ClearLines() {
+  if (m_lines.empty()) return;
+  m_lines.clear();
+  Invalidate();
+}
+
+//=============================================================================
+// Окно и преобразование
+//=============================================================================
+void CViewport::Resize(int width, int height) {
+  width = (std::max)(width, 0);
+  height = (std::max)(height, 0);
+  if (width == m_buffer.cols && height == m_buffer.rows) return;
+
+  cv::Mat buffer(height, width, CV_8UC4, ToScalar(m_params.background));
+  const cv::Rect kept(0, 0, (std::min)(width, m_buffer.cols),
+                      (std::min)(height, m_buffer.rows));
+  if (kept.area() > 0) m_buffer(kept).copyTo(buffer(kept));
+  m_buffer = buffer;
+
+  const cv::Rect view(0, 0, width, height);
+  for (cv::Rect& r : m_dirty) r &= view;
+  m_dirty.erase(std::remove_if(m_dirty.begin(), m_dirty.end(),
+                               [](const cv::Rect& r) { return r.empty(); }),
+                m_dirty.end());
+  InvalidateView(cv::Rect(kept.width, 0, width - kept.width, height));
+  InvalidateView(cv::Rect(0, kept.height, kept.width, height - kept.height));
+}
+
+void CViewport::SetTransform(const CViewTransform& transform) {
+  m_transform = transform;
+  m_transform.zoom = (std::min)((std::max)(m_transform.zoom, m_params.minZoom),
+                                m_params.maxZoom);
+  Invalidate();
+}
+
+void CViewport::Pan(int dx, int dy) {
+  if (dx == 0 && dy == 0) return;
+  m_transform.originX -= dx / m_transform.zoom;
+  m_transform.originY -= dy / m_transform.zoom;
+
+  const int w = m_buffer.cols, h = m_buffer.rows;
+  if (std::abs(dx) >= w || std::abs(dy) >= h) {
+    Invalidate();
+    return;
+  }
+
+  // Прокрутка буфера; при dy > 0 строки копируются снизу вверх
+  const size_t rowBytes = (size_t)(w - std::abs(dx)) * 4;
+  const int dstX = (std::max)(dx, 0), srcX = (std::max)(-dx, 0);
+  auto moveRow = [&](int y) {
+    std::memmove(m_buffer.ptr<uchar>(y) + dstX * 4,
+                 m_buffer.ptr<uchar>(y - dy) + srcX * 4, rowBytes);
+  };
+  if (dy > 0) {
+    for (int y = h - 1; y >= dy; y--) moveRow(y);
+  } else {
+    for (int y = 0; y < h + dy; y++) moveRow(y);
+  }
+
+  // Ещё не перерисованное едет вместе с содержимым
+  const cv::Rect view(0, 0, w, h);
+  std::vector<cv::Rect> dirty;
+  dirty.swap(m_dirty);
+  for (const cv::Rect& r : dirty) InvalidateView(r + cv::Point(dx, dy));
+
+  if (dx > 0) InvalidateView(cv::Rect(0, 0, dx, h));
+  if (dx < 0) InvalidateView(cv::Rect(w + dx, 0, -dx, h));
+  if (dy > 0) InvalidateView(cv::Rect(0, 0, w, dy));
+  if (dy < 0) InvalidateView(cv::Rect(0, h + dy, w, -dy));
+}
+
+void CViewport::ZoomAt(double factor, double vx, double vy) {
+  double zoom = (std::min)(
+      (std::max)(m_transform.zoom * factor, m_params.minZoom),
+      m_params.maxZoom);
+  if (zoom == m_transform.zoom) return;
+  cv::Point2d anchor = m_transform.ViewToImage(vx, vy);
+  m_transform.zoom = zoom;
+  m_transform.originX = anchor.x - vx / zoom;
+  m_transform.originY = anchor.y - vy / zoom;
+  Invalidate();
+}
+
+void CViewport::FitToView() {
+  const int iw = m_pyramid.Width(), ih = m_pyramid.Height();
+  if (iw == 0 || ih == 0 || m_buffer.empty()) return;
+  CViewTransform t;
+  t.zoom = (std::min)((double)m_buffer.cols / iw, (double)m_buffer.rows / ih);
+  t.zoom = (std::min)((std::max)(t.zoom, m_params.minZoom), m_params.maxZoom);
+  t.originX = 0.5 * iw - 0.5 * m_buffer.cols / t.zoom;
+  t.originY = 0.5 * ih - 0.5 * m_buffer.rows / t.zoom;
+  SetTransform(t);
+}
+
+int CViewport::GetLodLevel() const {
+  if (m_transform.zoom >= 1.0) return 0;
+  return (std::min)((int)std::floor(std::log2(1.0 / m_transform.zoom)),
+                    kMaxLod);
+}
+
+void CViewport::SetOverlay(const COverlay* overlay) {
+  if (overlay == m_overlay) return;
+  m_overlay = overlay;
+  Invalidate();
+}
+
+//=============================================================================
+// Грязные области
+//=============================================================================
+void CViewport::Invalidate() {
+  m_dirty.clear();
+  if (!m_buffer.empty())
+    m_dirty.push_back(cv::Rect(0, 0, m_buffer.cols, m_buffer.rows));
+}
+
+void CViewport::InvalidateView(const cv::Rect& rect) {
+  cv::Rect r = rect & cv::Rect(0, 0, m_buffer.cols, m_buffer.rows);
+  if (r.empty()) return;
+  m_dirty.push_back(r);
+  if ((int)m_dirty.size() > m_params.maxDirtyRects) {
+    cv::Rect all = m_dirty[0];
+    for (const cv::Rect& d : m_dirty) all |= d;
+    m_dirty.assign(1, all);
+  }
+}
+
+void CViewport::InvalidateImage(const cv::Rect2d& rect) {
+  // Точки линий — центры пикселей: x кадра в непрерывных координатах x + 0.5
+  cv::Point2d p0 = m_transform.ImageToView(rect.x + 0.5, rect.y + 0.5);
+  cv::Point2d p1 = m_transform.ImageToView(rect.x + rect.width + 0.5,
+                                           rect.y + rect.height + 0.5);
+  const int margin = m_params.lineWidth + m_params.markerRadius + 2;
+  int x0 = (int)std::floor(p0.x) - margin, y0 = (int)std::floor(p0.y) - margin;
+  int x1 = (int)std::ceil(p1.x) + margin, y1 = (int)std::ceil(p1.y) + margin;
+  InvalidateView(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+}
+
+void CViewport::InvalidatePixels(const cv::Rect& pixels) {
+  // Пиксель кадра i занимает [i, i + 1) в непрерывных координатах; запас —
+  // на билинейную выборку при уменьшении
+  cv::Point2d p0 = m_transform.ImageToView(pixels.x, pixels.y);
+  cv::Point2d p1 = m_transform.ImageToView(pixels.x + pixels.width,
+                                           pixels.y + pixels.height);
+  int x0 = (int)std::floor(p0.x) - 1, y0 = (int)std::floor(p0.y) - 1;
+  int x1 = (int)std::ceil(p1.x) + 1, y1 = (int)std::ceil(p1.y) + 1;
+  InvalidateView(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+}
+
+cv::Rect2d CViewport::ViewRectToImage(const cv::Rect& rect) const {
+  cv::Point2d p0 = m_transform.ViewToImage(rect.x, rect.y);
+  cv::Point2d p1 = m_transform.ViewToImage(rect.x + rect.width,
+                                           rect.y + rect.height);
+  return cv::Rect2d(p0.x - 0.5, p0.y - 0.5, p1.x - p0.x, p1.y - p0.y);
+}
+
+//=============================================================================
+// Отрисовка
+//=============================================================================
+int CViewport::Render(std::vector<cv::Rect>* updated) {
+  INTERF_TIMED_SCOPE(m_stats, Render);
+  if (updated) updated->clear();
+  if (m_buffer.empty() || m_dirty.empty()) {
+    m_dirty.clear();
+    return 0;
+  }
+
+  // Грязные прямоугольники → по одному объединённому куску на плитку
+  const int ts = m_params.tileSize;
+  const int tilesX = (m_buffer.cols + ts - 1) / ts;
+  const int tilesY = (m_buffer.rows + ts - 1) / ts;
+  std::vector<cv::Rect> cells(tilesX * tilesY);
+  for (const cv::Rect& r : m_dirty)
+    for (int ty = r.y / ts; ty <= (r.y + r.height - 1) / ts; ty++)
+      for (int tx = r.x / ts; tx <= (r.x + r.width - 1) / ts; tx++) {
+        cv::Rect piece = r & cv::Rect(tx * ts, ty * ts, ts, ts);
+        cv::Rect& cell = cells[ty * tilesX + tx];
+        cell = cell.empty() ? piece : (cell | piece);
+      }
+  m_dirty.clear();
+
+  const int level = m_pyramid.LevelForZoom(m_transform.zoom);
+  int rendered = 0;
+  for (const cv::Rect& cell : cells) {
+    if (cell.empty()) continue;
+    RenderTile(cell, level);
+    if (updated) updated->push_back(cell);
+    rendered++;
+  }
+  INTERF_COUNT(m_stats, RenderTiles, rendered);
+  return rendered;
+}
+
+void CViewport::RenderTile(const cv::Rect& tile, int level) {
+  // Плитка рисуется с полями: отсечённые краем отрезки растеризуются так же,
+  // как в соседней плитке, без швов
+  const int margin = m_params.lineWidth + m_params.markerRadius + 2;
+  const cv::Rect area(tile.x - margin, tile.y - margin,
+                      tile.width + 2 * margin, tile.height + 2 * margin);
+  const cv::Scalar background = ToScalar(m_params.background);
+
+  if (m_pyramid.IsEmpty()) {
+    m_scratch.create(area.size(), CV_8UC4);
+    m_scratch.setTo(background);
+  } else {
+    const CViewTransform& t = m_transform;
+    const double scale = m_pyramid.Scale(level);
+    // Увеличение — видны пиксели кадра; уменьшение на уровне — не больше 2×
+    const int interp = t.zoom * scale >= 1.0 ? cv::INTER_NEAREST
+                                             : cv::INTER_LINEAR;
+    cv::warpAffine(m_pyramid.Level(level), m_scratchGray,
+                   LevelMap(area, scale), area.size(),
+                   interp | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT);
+    cv::cvtColor(m_scratchGray, m_scratch, cv::COLOR_GRAY2BGRA);
+
+    // Вне кадра — фон
+    cv::Point2d p0 = t.ImageToView(0.0, 0.0);
+    cv::Point2d p1 = t.ImageToView(m_pyramid.Width(), m_pyramid.Height());
+    const int ix0 = (int)std::ceil(p0.x - 0.5) - area.x;
+    const int iy0 = (int)std::ceil(p0.y - 0.5) - area.y;
+    const int ix1 = (int)std::ceil(p1.x - 0.5) - area.x;
+    const int iy1 = (int)std::ceil(p1.y - 0.5) - area.y;
+    const cv::Rect full(0, 0, area.width, area.height);
+    const cv::Rect inside =
+        full & cv::Rect(ix0, iy0, (std::max)(ix1 - ix0, 0),
+                        (std::max)(iy1 - iy0, 0));
+    if (inside.empty()) {
+      m_scratch.setTo(background);
+    } else {
+      m_scratch(cv::Rect(0, 0, area.width, inside.y)).setTo(background);
+      m_scratch(cv::Rect(0, inside.br().y, area.width,
+                         area.height - inside.br().y))
+          .setTo(background);
+      m_scratch(cv::Rect(0, inside.y, inside.x, inside.height))
+          .setTo(background);
+      m_scratch(cv::Rect(inside.br().x, inside.y, area.width - inside.br().x,
+                         inside.height))
+          .setTo(background);
+    }
+  }
+
+  DrawOverlay(area, level);
+  DrawLines(m_scratch, area, GetLodLevel());
+  m_scratch(cv::Rect(margin, margin, tile.width, tile.height))
+      .copyTo(m_buffer(tile));
+}
+
+cv::Matx23d CViewport::LevelMap(const cv::Rect& area, double scale) const {
+  // Пиксель поля (x, y) → индекс пикселя уровня:
+  // (origin + (area.x + x + 0.5) / zoom) / scale - 0.5
+  const CViewTransform& t = m_transform;
+  const double a = 1.0 / (t.zoom * scale);
+  return cv::Matx23d(
+      a, 0.0, (t.originX + (area.x + 0.5) / t.zoom) / scale - 0.5,
+      0.0, a, (t.originY + (area.y + 0.5) / t.zoom) / scale - 0.5);
+}
+
+void CViewport::DrawOverlay(const cv::Rect& area, int level) {
+  if (!m_overlay || m_overlay->IsEmpty()) return;
+  // Уровни слоя — те же 2^l, что у пирамиды кадра; вне слоя — прозрачно
+  level = (std::min)(level, m_overlay->NumLevels() - 1);
+  const double scale = (double)(1 << level);
+  const int interp = m_transform.zoom * scale >= 1.0 ? cv::INTER_NEAREST
+                                                      : cv::INTER_LINEAR;
+  cv::warpAffine(m_overlay->Level(level), m_scratchOverlay,
+                 LevelMap(area, scale), area.size(),
+                 interp | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT,
+                 cv::Scalar::all(0));
+  COverlay::Blend(m_scratchOverlay, m_scratch);
+}
+
+const CViewport::CLod& CViewport::GetLod(CLine& line, int level) {
+  if (line.lods.empty()) line.lods.resize(kMaxLod + 1);
+  CLod& lod = line.lods[level];
+  if (lod.built) return lod;
+
+  // Уровень 0 — без упрощения; уровень l — допуск lodTolerance · 2^l
+  // пикселей кадра, то есть не больше lodTolerance пикселей окна
+  if (level == 0)
+    lod.points = line.points;
+  else
+    Simplify(line.points, m_params.lodTolerance * (double)(1 << level),
+             lod.points);
+
+  const int n = (int)lod.points.size();
+  const int step = m_params.chunkPoints - 1;
+  for (int begin = 0; begin < n; begin += step) {
+    int end = (std::min)(begin + step, n - 1);
+    lod.chunks.push_back(
+        {begin, end, Bounds(lod.points.data() + begin, end - begin + 1)});
+    if (end == n - 1) break;
+  }
+  lod.built = true;
+  return lod;
+}
+
+void CViewport::DrawLines(cv::Mat& target, const cv::Rect& area, int level) {
+  if (m_lines.empty()) return;
+  const CViewTransform& t = m_transform;
+  const cv::Rect2d query = ViewRectToImage(area);
+  // Центр пикселя кадра x → индекс пикселя поля,
+  // с kPointShift дробными битами
+  const double ox = (0.5 - t.originX) * t.zoom - 0.5 - area.x;
+  const double oy = (0.5 - t.originY) * t.zoom - 0.5 - area.y;
+  auto toTarget = [&](const cv::Point2f& p) {
+    return cv::Point(
+        (int)std::lround((p.x * t.zoom + ox) * kPointShiftScale),
+        (int)std::lround((p.y * t.zoom + oy) * kPointShiftScale));
+  };
+
+  for (CLine& line : m_lines) {
+    if (line.points.empty() || !Overlaps(line.bounds, query)) continue;
+    const CLod& lod = GetLod(line, level);
+    const cv::Scalar color = ToScalar(line.color);
+    for (const CChunk& chunk : lod.chunks) {
+      if (!Overlaps(chunk.bounds, query)) continue;
+      m_polyline.clear();
+      for (int i = chunk.begin; i <= chunk.end; i++)
+        m_polyline.push_back(toTarget(lod.points[i]));
+      const cv::Point* pts = m_polyline.data();
+      const int count = (int)m_polyline.size();
+      cv::polylines(target, &pts, &count, 1, false, color,
+                    m_params.lineWidth, cv::LINE_8, kPointShift);
+    }
+    if (m_params.markerRadius > 0) {
+      const cv::Point2f& first = line.points[0];
+      cv::Rect2f dot(first.x, first.y, 0.0f, 0.0f);
+      if (Overlaps(dot, query))
+        cv::circle(target, toTarget(first),
+                   m_params.markerRadius << kPointShift, color, cv::FILLED,
+                   cv::LINE_8, kPointShift);
+    }
+  }
+}
+
+}  // namespace Interferometry
@@ -6,14 +6,20 @@
  * - MARKER.C: ell_bld() (строки 212-253), ell_small() (строки 257-297)
  * - STEP.C:   inside() (строки 648-657)
  * - WORK.C:   инициализация arr_coord_ell (строки 189-195)
+ *
+ * Отличия от оригинала: учитывается поворот эллипса (EllipseParams::angle),
+ * внешние эллипсы дают честное пересечение, а внутренние — объединение
+ * непересекающихся дырок (несколько заслонок на одной строке).
  */
 
 #include "pch.h"
 
 #include <EllipseBoundary.h>
+#include "Constants.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 namespace Interferometry
 {
@@ -32,6 +38,8 @@ namespace Interferometry
   CEllipseBoundary::CEllipseBoundary() : m_imageWidth(360), m_imageHeight(290)
   {
     m_boundaries.resize(m_imageHeight);
+    ClearExtraHoles();
+    RebuildInsideMask();
   }
 
   CEllipseBoundary::~CEllipseBoundary() {}
@@ -47,6 +55,7 @@ namespace Interferometry
     m_imageHeight = imageHeight;
     m_boundaries.clear();
     m_boundaries.resize(m_imageHeight);
+    ClearExtraHoles();
 
     // По умолчанию весь кадр доступен
     SetDefaultBoundaries();
@@ -58,6 +67,8 @@ namespace Interferometry
     {
       boundary = RowBoundary();
     }
+    ClearExtraHoles();
+    RebuildInsideMask();
   }
 
   /// @}
@@ -71,10 +82,13 @@ namespace Interferometry
     if (!ellipse.IsValid())
       return;
 
+    INTERF_TIMED_SCOPE(m_stats, Boundary);
     if (isOuter)
       ApplyOuterEllipse(ellipse);
     else
       ApplyInnerEllipse(ellipse);
+
+    RebuildInsideMask();
   }
 
   /**
@@ -106,15 +120,20 @@ namespace Interferometry
    * 5. **Обнуление** строк ниже нижнего края эллипса (y > cy+b).
    *    (MARKER.C:249-252)
    *
-   * @param ellipse Параметры эллипса (центр + полуоси).
+   * @par Отличия порта
+   *
+   * Шаг 4 — пересечение отрезков [0]..[3] и x1..x2: если они не
+   * пересекаются, строка обнуляется (в оригинале строка оставалась прежней,
+   * и два несовпадающих внешних эллипса давали не пересечение). Строки,
+   * которых эллипс не касается, обнуляются так же, как на шагах 3 и 5, —
+   * в оригинале последняя строка cy+b получала отрезок [cx, [3]].
+   * Диапазон строк учитывает поворот: полувысота повёрнутого эллипса —
+   * sqrt(a²·sin²θ + b²·cos²θ).
+   *
+   * @param ellipse Параметры эллипса (центр, полуоси, угол).
    */
   void CEllipseBoundary::ApplyOuterEllipse(const EllipseParams &ellipse)
   {
-    int x_center = ellipse.centerX;
-    int y_center = ellipse.centerY;
-    int a = ellipse.semiAxisA;
-    int b = ellipse.semiAxisB;
-
     // --- Шаг 1: Проверка первого вызова ---
     // Оригинал (MARKER.C:219-222):
     //   for(i=0; arr_coord_ell[i][0]==0 && i<290; i++);
@@ -138,56 +157,39 @@ namespace Interferometry
       }
     }
 
-    // --- Шаг 3: Обнуление строк выше эллипса ---
-    // Оригинал (MARKER.C:231-234):
-    //   for(i=0; i <= y_centr-b; i++) { [3]=0; [0]=0; }
-    int topEdge = (std::max)(0, y_center - b);
-    for (int i = 0; i <= topEdge && i < m_imageHeight; i++)
-    {
-      m_boundaries[i].leftOuter = 0;
-      m_boundaries[i].rightOuter = 0;
-    }
-
-    // --- Шаг 4: Вычисление границ для строк внутри эллипса ---
-    // Оригинал (MARKER.C:235-248):
-    //   if((edge = y_centr+b) > 290) edge = 290;
-    //   for(i=i; i < edge; i++) { ... }
-    int bottomEdge = y_center + b;
-    if (bottomEdge >= m_imageHeight)
-      bottomEdge = m_imageHeight - 1;
+    int topEdge, bottomEdge;
+    GetEllipseRows(ellipse, topEdge, bottomEdge);
 
-    for (int i = topEdge + 1; i <= bottomEdge; i++)
+    for (int i = 0; i < m_imageHeight; i++)
     {
-      float x1, x2;
-      CalculateEllipsePoints(ellipse, i, x1, x2);
+      RowBoundary &row = m_boundaries[i];
 
-      int ix1 = (int)x1;
-      int ix2 = (int)x2;
-
-      // Оригинал (MARKER.C:242):
-      //   if(arr_coord_ell[i][0] < x1 && arr_coord_ell[i][3] > x1)
-      //     arr_coord_ell[i][0] = x1;
-      if (m_boundaries[i].leftOuter < ix1 && m_boundaries[i].rightOuter > ix1)
+      // --- Шаги 3, 5: строки вне эллипса обнуляются ---
+      // Оригинал (MARKER.C:231-234, 249-252):
+      //   for(...) { [3]=0; [0]=0; }
+      float x1, x2;
+      if (i < topEdge || i > bottomEdge ||
+          !CalculateEllipsePoints(ellipse, i, x1, x2))
       {
-        m_boundaries[i].leftOuter = ix1;
+        row.leftOuter = 0;
+        row.rightOuter = 0;
+        continue;
       }
 
-      // Оригинал (MARKER.C:243):
-      //   if(arr_coord_ell[i][3] > x2 && x2 > arr_coord_ell[i][0])
-      //     arr_coord_ell[i][3] = x2;
-      if (m_boundaries[i].rightOuter > ix2 && ix2 > m_boundaries[i].leftOuter)
+      // --- Шаг 4: пересечение с уже заданной областью ---
+      // Оригинал (MARKER.C:242-243):
+      //   if([0] < x1 && [3] > x1) [0] = x1;
+      //   if([3] > x2 && x2 > [0]) [3] = x2;
+      int left = (std::max)(row.leftOuter, (int)x1);
+      int right = (std::min)(row.rightOuter, (int)x2);
+      if (!row.HasOuterBoundary() || left >= right)
       {
-        m_boundaries[i].rightOuter = ix2;
+        row.leftOuter = 0;
+        row.rightOuter = 0;
+        continue;
       }
-    }
-
-    // --- Шаг 5: Обнуление строк ниже эллипса ---
-    // Оригинал (MARKER.C:249-252):
-    //   for(i=i; i<290; i++) { [3]=0; [0]=0; }
-    for (int i = bottomEdge + 1; i < m_imageHeight; i++)
-    {
-      m_boundaries[i].leftOuter = 0;
-      m_boundaries[i].rightOuter = 0;
+      row.leftOuter = left;
+      row.rightOuter = right;
     }
   }
 
@@ -202,164 +204,144 @@ namespace Interferometry
    * где трассировка запрещена (например, отверстие в зеркале Кассегрена).
    * Точки ВНУТРИ дырки исключаются из рабочей области.
    *
-   * @par Алгоритм оригинала (построчный разбор)
+   * @par Алгоритм оригинала
    *
    * Оригинал ell_small() **объединяет** старый и новый внутренние эллипсы:
+   * строки старого эллипса вне нового сохраняются, а на общих строках
+   * дырка **расширяется** (MARKER.C:284-286):
+   * @code
+   *   // leftInner: берём МЕНЬШЕЕ (ближе к левому краю)
+   *   if(([1] > x1 || [1]==0) && x1 >= [0] && x1 < [3])
+   *     [1] = x1;
    *
-   * 1. (стр. 262-266) Стирание пикселей СТАРОГО внутреннего эллипса (визуализация).
-   *
-   * 2. (стр. 268-271) Прокрутка по строкам где [1]==0 и y <= cy-b.
-   *    Эти строки и так нулевые — по сути NOP, просто двигает счётчик i.
-   *
-   * 3. (стр. 272-276) Если СТАРЫЙ эллипс начинался ВЫШЕ нового —
-   *    его строки **сохраняются** (рисуются на экране, данные не трогаются).
-   *
-   * 4. (стр. 278-289) Основной цикл: для строк нового эллипса
-   *    **расширяется** мёртвая зона:
-   *    @code
-   *      // leftInner: берём МЕНЬШЕЕ (ближе к левому краю)
-   *      if(([1] > x1 || [1]==0) && x1 >= [0] && x1 < [3])
-   *        [1] = x1;
-   *
-   *      // rightInner: берём БОЛЬШЕЕ (ближе к правому краю)
-   *      if([2] < x2 && x2 <= [3])
-   *        [2] = x2;
-   *    @endcode
-   *
-   * 5. (стр. 290-294) Если СТАРЫЙ эллипс продолжается НИЖЕ нового —
-   *    его строки **сохраняются**.
-   *
-   * 6. (стр. 295-296) Строки после конца ОБОИХ эллипсов — обнуляются.
+   *   // rightInner: берём БОЛЬШЕЕ (ближе к правому краю)
+   *   if([2] < x2 && x2 <= [3])
+   *     [2] = x2;
+   * @endcode
    *
-   * @par Итого
+   * @par Несколько заслонок
    *
-   * Обнуление leftInner/rightInner происходит только для строк ВНЕ
-   * обоих эллипсов (и старого, и нового). Это даёт ОБЪЕДИНЕНИЕ.
+   * В оригинале на строке одна дырка, поэтому две разнесённые заслонки
+   * ("Число экранов на зрачке" > 1) сливались в одну вместе с рабочей
+   * областью между ними. Здесь дырки строки объединяются как множества:
+   * пересекающиеся или смежные сливаются (это совпадает с оригиналом),
+   * непересекающиеся остаются раздельными. Первая по x — в
+   * leftInner..rightInner, остальные — в дополнительных дырках строки.
+   * Дырка обрезается по внешней границе строки; строки без внешней
+   * границы не трогаются, как и в оригинале.
    *
-   * @param ellipse Параметры эллипса (центр + полуоси).
+   * @param ellipse Параметры эллипса (центр, полуоси, угол).
    */
   void CEllipseBoundary::ApplyInnerEllipse(const EllipseParams &ellipse)
   {
-    int x_centr = ellipse.centerX;
-    int y_centr = ellipse.centerY;
-    int a = ellipse.semiAxisA;
-    int b = ellipse.semiAxisB;
+    int newTop, newBottom;
+    GetEllipseRows(ellipse, newTop, newBottom);
 
-    int newTop = (std::max)(0, y_centr - b);
-    int newBottom = (std::min)(y_centr + b, m_imageHeight - 1);
+    // Дополнительные дырки пересобираются целиком: O(строк + дырок)
+    std::vector<int> index(m_imageHeight + 1);
+    std::vector<CRowSpan> spans;
+    spans.reserve(m_holeSpans.size());
+    std::vector<CRowSpan> holes;
 
-    // --- Найти диапазон СТАРОГО внутреннего эллипса ---
-    // Оригинал (MARKER.C:262):
-    //   for(i=0; arr_coord_ell[i][1]==0 && i<290; i++);
-    int oldTop = m_imageHeight; // "нет старого" по умолчанию
-    int oldBottom = -1;
     for (int i = 0; i < m_imageHeight; i++)
     {
-      if (m_boundaries[i].HasInnerBoundary())
-      {
-        if (oldTop == m_imageHeight)
-          oldTop = i;
-        oldBottom = i;
-      }
-    }
+      index[i] = (int)spans.size();
+      RowBoundary &row = m_boundaries[i];
 
-    // --- Вычислить объединённый диапазон ---
-    // Строки, покрытые хотя бы одним из двух эллипсов — сохраняются.
-    // Строки вне обоих — обнуляются.
-    int unionTop, unionBottom;
-    if (oldTop == m_imageHeight)
-    {
-      // Старого эллипса нет — работаем только с новым
-      unionTop = newTop;
-      unionBottom = newBottom;
-    }
-    else
-    {
-      unionTop = (std::min)(oldTop, newTop);
-      unionBottom = (std::max)(oldBottom, newBottom);
-    }
-
-    // --- Обнулить строки ВЫШЕ объединённого диапазона ---
-    for (int i = 0; i < unionTop && i < m_imageHeight; i++)
-    {
-      m_boundaries[i].leftInner = 0;
-      m_boundaries[i].rightInner = 0;
-    }
-
-    // --- Основной цикл: вычислить границы для строк НОВОГО эллипса ---
-    // Строки между старым и новым (вне нового но внутри старого) —
-    // старые значения сохранены, мы их не трогаем.
-    for (int i = newTop; i <= newBottom; i++)
-    {
       float x1, x2;
-      CalculateEllipsePoints(ellipse, i, x1, x2);
-
-      int ix1 = (int)x1;
-      int ix2 = (int)x2;
-
-      const RowBoundary &row = m_boundaries[i];
-
-      // Оригинал (MARKER.C:284-285):
-      //   if(([1] > x1 && x1 >= [0] && x1 < [3]) ||
-      //      ([1] == 0  && x1 >= [0] && x1 < [3]))
-      //     [1] = x1;
-      //
-      // Смысл: leftInner = x1 если:
-      //   - Новый x1 левее текущего [1] (расширяем дырку влево), ИЛИ
-      //   - [1]==0 (ещё нет внутреннего эллипса на этой строке)
-      //   И x1 лежит внутри внешнего эллипса ([0] <= x1 < [3])
-      if (ix1 >= row.leftOuter && ix1 < row.rightOuter)
+      CRowSpan hole = {0, 0};
+      bool hit = i >= newTop && i <= newBottom && row.HasOuterBoundary() &&
+                 CalculateEllipsePoints(ellipse, i, x1, x2);
+      if (hit)
       {
-        if (row.leftInner == 0 || ix1 < row.leftInner)
-        {
-          m_boundaries[i].leftInner = ix1;
-        }
+        hole.x0 = (std::max)((int)x1, row.leftOuter);
+        hole.x1 = (std::min)((int)x2, row.rightOuter);
+        hit = hole.x0 < hole.x1;
+      }
+      if (!hit)
+      {
+        const CRowSpan *extra = GetExtraHoles(i);
+        spans.insert(spans.end(), extra, extra + GetExtraHoleCount(i));
+        continue;
       }
 
-      // Оригинал (MARKER.C:286):
-      //   if([2] < x2 && x2 <= [3])
-      //     [2] = x2;
-      //
-      // Смысл: rightInner = x2 если новый x2 правее текущего [2]
-      //   (расширяем дырку вправо) И x2 внутри внешнего
-      if (ix2 <= row.rightOuter)
+      GetRowHoles(i, holes);
+      holes.push_back(hole);
+      std::sort(holes.begin(), holes.end(),
+                [](const CRowSpan &l, const CRowSpan &r)
+                { return l.x0 < r.x0; });
+      size_t n = 0;
+      for (size_t k = 1; k < holes.size(); k++)
       {
-        if (row.rightInner == 0 || ix2 > row.rightInner)
-        {
-          m_boundaries[i].rightInner = ix2;
-        }
+        if (holes[k].x0 <= holes[n].x1 + 1)
+          holes[n].x1 = (std::max)(holes[n].x1, holes[k].x1);
+        else
+          holes[++n] = holes[k];
       }
-    }
 
-    // --- Обнулить строки НИЖЕ объединённого диапазона ---
-    // Оригинал (MARKER.C:295-296):
-    //   for(i=i; i<290; i++) { [2]=0; [1]=0; }
-    for (int i = unionBottom + 1; i < m_imageHeight; i++)
-    {
-      m_boundaries[i].leftInner = 0;
-      m_boundaries[i].rightInner = 0;
+      row.leftInner = holes[0].x0;
+      row.rightInner = holes[0].x1;
+      spans.insert(spans.end(), holes.begin() + 1, holes.begin() + n + 1);
     }
+    index[m_imageHeight] = (int)spans.size();
+
+    m_holeIndex.swap(index);
+    m_holeSpans.swap(spans);
+  }
+
+  /**
+   * @brief Строки, которые может задеть эллипс: [top, bottom] в пределах кадра.
+   *
+   * Полувысота повёрнутого эллипса — sqrt(a²·sin²θ + b²·cos²θ); при
+   * angle = 0 это b, и диапазон совпадает с оригиналом (cy-b .. cy+b).
+   */
+  void CEllipseBoundary::GetEllipseRows(const EllipseParams &ellipse, int &top,
+                                        int &bottom) const
+  {
+    const double theta = ellipse.angle * (Physics::PI / 180.0);
+    const double c = std::cos(theta);
+    const double s = std::sin(theta);
+    const double a = ellipse.semiAxisA;
+    const double b = ellipse.semiAxisB;
+    const double halfHeight = std::sqrt(a * a * s * s + b * b * c * c);
+
+    top = (std::max)(0, (int)std::floor(ellipse.centerY - halfHeight));
+    bottom = (std::min)(m_imageHeight - 1,
+                        (int)std::ceil(ellipse.centerY + halfHeight));
   }
 
   /**
    * @brief Вычисление x-координат пересечения эллипса со строкой.
    *
-   * Формула из MARKER.C:239:
+   * Без поворота — формула из MARKER.C:239:
    * @code
    *   x = (int)(0.5 + (float)a * sqrt(1.0 - buf*buf / ((float)b*(float)b)));
    *   x1 = x_centr - x;
    *   x2 = x_centr + x;
    * @endcode
    *
+   * С поворотом на θ точка (cx + dx, cy + dy) лежит на эллипсе, если
+   * u²/a² + v²/b² = 1, где u = dx·cosθ + dy·sinθ, v = −dx·sinθ + dy·cosθ.
+   * Для строки dy известно, и это квадратное уравнение по dx:
+   * @code
+   *   A = cos²θ/a² + sin²θ/b²
+   *   B = 2·dy·sinθ·cosθ·(1/a² − 1/b²)
+   *   C = dy²·(sin²θ/a² + cos²θ/b²) − 1
+   *   dx = (−B ± sqrt(B² − 4AC)) / 2A
+   * @endcode
+   * Середина отрезка сдвинута на −B/2A, полуширина — sqrt(B² − 4AC)/2A;
+   * округление то же, что и без поворота (+0.5 к полуширине), поэтому при
+   * θ → 0 результат переходит в формулу оригинала без скачка.
+   *
    * @param[in]  ellipse Параметры эллипса.
    * @param[in]  row     Номер строки (y-координата).
    * @param[out] x1      Левый край эллипса на этой строке.
    * @param[out] x2      Правый край эллипса на этой строке.
+   * @return false, если строка не пересекает эллипс или он целиком вне кадра.
    *
-   * @note Если строка вне эллипса (|row - cy| >= b), x1 == x2 == cx.
    * @note Результат ограничен: x1 >= 1.0, x2 <= imageWidth - 2.
    */
-  void CEllipseBoundary::CalculateEllipsePoints(const EllipseParams &ellipse,
+  bool CEllipseBoundary::CalculateEllipsePoints(const EllipseParams &ellipse,
                                                 int row, float &x1,
                                                 float &x2) const
   {
@@ -368,29 +350,52 @@ namespace Interferometry
     int a = ellipse.semiAxisA;
     int b = ellipse.semiAxisB;
 
-    float buf = (float)(row - y_centr);
-    float bSquared = (float)b * (float)b;
+    x1 = (float)x_centr;
+    x2 = (float)x_centr;
 
-    float ratio = buf * buf / bSquared;
-    if (ratio >= 1.0f)
+    if (std::fmod(ellipse.angle, 180.0f) == 0.0f)
     {
-      // Строка за пределами эллипса
-      x1 = (float)x_centr;
-      x2 = (float)x_centr;
-      return;
-    }
+      float buf = (float)(row - y_centr);
+      float bSquared = (float)b * (float)b;
 
-    // +0.5f — округление к ближайшему, как в оригинале: (int)(0.5 + ...)
-    float x = 0.5f + (float)a * std::sqrt(1.0f - ratio);
+      float ratio = buf * buf / bSquared;
+      if (ratio >= 1.0f)
+        return false; // Строка за пределами эллипса
 
-    x1 = (float)x_centr - x;
-    x2 = (float)x_centr + x;
+      // +0.5f — округление к ближайшему, как в оригинале: (int)(0.5 + ...)
+      float x = 0.5f + (float)a * std::sqrt(1.0f - ratio);
+
+      x1 = (float)x_centr - x;
+      x2 = (float)x_centr + x;
+    }
+    else
+    {
+      const double theta = ellipse.angle * (Physics::PI / 180.0);
+      const double c = std::cos(theta);
+      const double s = std::sin(theta);
+      const double ia2 = 1.0 / ((double)a * a);
+      const double ib2 = 1.0 / ((double)b * b);
+      const double dy = row - y_centr;
+
+      const double A = c * c * ia2 + s * s * ib2;
+      const double B = 2.0 * dy * s * c * (ia2 - ib2);
+      const double C = dy * dy * (s * s * ia2 + c * c * ib2) - 1.0;
+      const double disc = B * B - 4.0 * A * C;
+      if (disc <= 0.0)
+        return false;
+
+      const double mid = x_centr - B / (2.0 * A);
+      const double x = 0.5 + std::sqrt(disc) / (2.0 * A);
+      x1 = (float)(mid - x);
+      x2 = (float)(mid + x);
+    }
 
     // Ограничение координат (MARKER.C:240-241)
     if (x1 < 1.0f)
       x1 = 1.0f;
     if (x2 >= (float)(m_imageWidth - 1))
       x2 = (float)(m_imageWidth - 2);
+    return x1 <= x2;
   }
 
   /// @name Доступ к границам
@@ -412,6 +417,81 @@ namespace Interferometry
     return m_boundaries[row];
   }
 
+  int CEllipseBoundary::GetExtraHoleCount(int row) const
+  {
+    if (m_holeSpans.empty() || row < 0 || row >= m_imageHeight)
+      return 0;
+    return m_holeIndex[row + 1] - m_holeIndex[row];
+  }
+
+  const CRowSpan *CEllipseBoundary::GetExtraHoles(int row) const
+  {
+    if (GetExtraHoleCount(row) == 0)
+      return nullptr;
+    return m_holeSpans.data() + m_holeIndex[row];
+  }
+
+  void CEllipseBoundary::GetRowHoles(int row,
+                                     std::vector<CRowSpan> &holes) const
+  {
+    holes.clear();
+    if (row < 0 || row >= m_imageHeight)
+      return;
+    const RowBoundary &b = m_boundaries[row];
+    if (b.HasInnerBoundary())
+      holes.push_back({b.leftInner, b.rightInner});
+    const CRowSpan *extra = GetExtraHoles(row);
+    holes.insert(holes.end(), extra, extra + GetExtraHoleCount(row));
+  }
+
+  std::vector<CRowHole> CEllipseBoundary::GetAllExtraHoles() const
+  {
+    std::vector<CRowHole> holes;
+    holes.reserve(m_holeSpans.size());
+    for (int i = 0; i < m_imageHeight && !m_holeSpans.empty(); i++)
+    {
+      for (int k = m_holeIndex[i]; k < m_holeIndex[i + 1]; k++)
+        holes.push_back({i, m_holeSpans[k].x0, m_holeSpans[k].x1});
+    }
+    return holes;
+  }
+
+  /**
+   * @details Порядок holes любой; строки вне кадра пропускаются. Первые
+   * дырки строк (RowBoundary) не меняются — их задают GetRowBoundary().
+   */
+  void CEllipseBoundary::SetAllExtraHoles(const std::vector<CRowHole> &holes)
+  {
+    std::vector<CRowHole> sorted;
+    sorted.reserve(holes.size());
+    for (const CRowHole &h : holes)
+    {
+      if (h.row >= 0 && h.row < m_imageHeight)
+        sorted.push_back(h);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const CRowHole &l, const CRowHole &r)
+              { return l.row != r.row ? l.row < r.row : l.x0 < r.x0; });
+
+    ClearExtraHoles();
+    m_holeSpans.reserve(sorted.size());
+    size_t k = 0;
+    for (int i = 0; i < m_imageHeight; i++)
+    {
+      m_holeIndex[i] = (int)m_holeSpans.size();
+      for (; k < sorted.size() && sorted[k].row == i; k++)
+        m_holeSpans.push_back({sorted[k].x0, sorted[k].x1});
+    }
+    m_holeIndex[m_imageHeight] = (int)m_holeSpans.size();
+    RebuildInsideMask();
+  }
+
+  void CEllipseBoundary::ClearExtraHoles()
+  {
+    m_holeIndex.assign(m_imageHeight + 1, 0);
+    m_holeSpans.clear();
+  }
+
   /// @}
 
   /// @name Проверка принадлежности точки
@@ -426,6 +506,7 @@ namespace Interferometry
    *   if(xt > [yt][1] && xt < [yt][2])              return(-1);  // внутри дырки
    *   return(0);                                                  // OK
    * @endcode
+   * и проверка дополнительных дырок строки, если они есть.
    */
   bool CEllipseBoundary::IsInside(int x, int y) const
   {
@@ -433,7 +514,15 @@ namespace Interferometry
       return false;
     if (x < 0 || x >= m_imageWidth)
       return false;
-    return m_boundaries[y].IsInside(x);
+    if (!m_boundaries[y].IsInside(x))
+      return false;
+    const CRowSpan *hole = GetExtraHoles(y);
+    for (int k = GetExtraHoleCount(y); k > 0; k--, hole++)
+    {
+      if (x >= hole->x0 && x <= hole->x1)
+        return false;
+    }
+    return true;
   }
 
   bool CEllipseBoundary::IsInsideOuter(int x, int y) const
@@ -447,7 +536,15 @@ namespace Interferometry
   {
     if (y < 0 || y >= m_imageHeight)
       return false;
-    return m_boundaries[y].IsInsideInner(x);
+    if (m_boundaries[y].IsInsideInner(x))
+      return true;
+    const CRowSpan *hole = GetExtraHoles(y);
+    for (int k = GetExtraHoleCount(y); k > 0; k--, hole++)
+    {
+      if (x >= hole->x0 && x <= hole->x1)
+        return true;
+    }
+    return false;
   }
 
   /// @}
@@ -462,6 +559,7 @@ namespace Interferometry
       b.leftOuter = 1;
       b.rightOuter = m_imageWidth - 2;
     }
+    RebuildInsideMask();
   }
 
   void CEllipseBoundary::ResetInnerBoundaries()
@@ -471,6 +569,8 @@ namespace Interferometry
       b.leftInner = 0;
       b.rightInner = 0;
     }
+    ClearExtraHoles();
+    RebuildInsideMask();
   }
 
   void CEllipseBoundary::ResetAllBoundaries()
@@ -497,6 +597,8 @@ namespace Interferometry
       m_boundaries[i].leftInner = 0;
       m_boundaries[i].rightInner = 0;
     }
+    ClearExtraHoles();
+    RebuildInsideMask();
   }
 
   /// @}
@@ -506,6 +608,76 @@ namespace Interferometry
     m_imageWidth = other.m_imageWidth;
     m_imageHeight = other.m_imageHeight;
     m_boundaries = other.m_boundaries;
+    m_holeIndex = other.m_holeIndex;
+    m_holeSpans = other.m_holeSpans;
+    m_insideMask = other.m_insideMask;
+    m_maskStride = other.m_maskStride;
+  }
+
+  /// @name Маска принадлежности
+  /// @{
+
+  /**
+   * @details
+   * Строит маску из RowBoundary за O(строк): каждая строка — один memset
+   * внешнего отрезка [leftOuter, rightOuter] и по одному memset на дырку
+   * ([leftInner, rightInner] и дополнительные). Результат совпадает с
+   * IsInside(x, y) для всех пикселей кадра.
+   *
+   * Размер буфера меняется только при смене размеров кадра, поэтому
+   * указатель GetInsideMask() остаётся валидным после SetEllipse().
+   */
+  void CEllipseBoundary::RebuildInsideMask()
+  {
+    m_maskStride = (m_imageWidth + 2 * MASK_PAD + MASK_ALIGN - 1) &
+                   ~(MASK_ALIGN - 1);
+    size_t total = (size_t)m_maskStride * (m_imageHeight + 2 * MASK_PAD);
+    if (m_insideMask.size() != total)
+      m_insideMask.assign(total, 0);
+    else
+      std::memset(m_insideMask.data(), 0, total);
+
+    uint8_t *origin = m_insideMask.data() + MASK_PAD * m_maskStride + MASK_PAD;
+    for (int y = 0; y < m_imageHeight; y++)
+    {
+      const RowBoundary &b = m_boundaries[y];
+      if (!b.HasOuterBoundary())
+        continue;
+
+      uint8_t *row = origin + (size_t)y * m_maskStride;
+      int x0 = (std::max)(b.leftOuter, 0);
+      int x1 = (std::min)(b.rightOuter, m_imageWidth - 1);
+      if (x0 > x1)
+        continue;
+      std::memset(row + x0, 0xFF, x1 - x0 + 1);
+
+      if (b.HasInnerBoundary())
+      {
+        int h0 = (std::max)(b.leftInner, x0);
+        int h1 = (std::min)(b.rightInner, x1);
+        if (h0 <= h1)
+          std::memset(row + h0, 0, h1 - h0 + 1);
+      }
+
+      const CRowSpan *hole = GetExtraHoles(y);
+      for (int k = GetExtraHoleCount(y); k > 0; k--, hole++)
+      {
+        int h0 = (std::max)(hole->x0, x0);
+        int h1 = (std::min)(hole->x1, x1);
+        if (h0 <= h1)
+          std::memset(row + h0, 0, h1 - h0 + 1);
+      }
+    }
+  }
+
+  /// @}
+
+  int64_t CEllipseBoundary::CountInside() const
+  {
+    int64_t count = 0;
+    ForEachSpan([&count](int, int x0, int x1)
+                { count += x1 - x0; });
+    return count;
   }
 
   bool CEllipseBoundary::Validate() const
@@ -532,6 +704,17 @@ namespace Interferometry
             return false;
         }
       }
+
+      // Дополнительные дырки: правее предыдущей, внутри внешней границы
+      int prev = b.HasInnerBoundary() ? b.rightInner : -1;
+      const CRowSpan *hole = GetExtraHoles(i);
+      for (int k = GetExtraHoleCount(i); k > 0; k--, hole++)
+      {
+        if (!b.HasInnerBoundary() || hole->x0 >= hole->x1 ||
+            hole->x0 <= prev || hole->x1 > b.rightOuter)
+          return false;
+        prev = hole->x1;
+      }
     }
     return true;
   }
@@ -0,0 +1,420 @@
+#include "FringeOrderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+
+#include "Constants.h"
+#include "EllipseBoundary.h"
+
+namespace Interferometry {
+
+namespace {
+
+// Больше профилей не строим — при шаге меньше пикселя голосов не прибавится
+constexpr double kMinScanSpacing = 0.5;
+// Меньше зазоров на профиле — порог зазора по медиане всех профилей
+constexpr int kMinScanGaps = 4;
+
+struct CCrossing {
+  float u;
+  int line;
+};
+
+// Голоса профилей за пару (a, b), a < b: orders[b] - orders[a] = +1, -1, 0
+struct CVotes {
+  int plus = 0;
+  int minus = 0;
+  int same = 0;
+};
+
+struct CEdge {
+  int a, b;
+  int delta;   // orders[b] - orders[a] по большинству голосов
+  int margin;  // перевес над вторым вариантом; 0 — ничья
+};
+
+uint64_t PairKey(int a, int b) { return ((uint64_t)a << 32) | (uint32_t)b; }
+
+int FindRoot(std::vector<int>& parent, int i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+// Направление полос: среднее по удвоенному углу, вес — длина отрезка
+double MeanFringeAngle(const std::vector<std::vector<CTracerPoint>>& lines) {
+  double c = 0.0, s = 0.0;
+  for (const auto& line : lines) {
+    for (size_t i = 1; i < line.size(); i++) {
+      double dx = line[i].PosX() - line[i - 1].PosX();
+      double dy = line[i].PosY() - line[i - 1].PosY();
+      double len = std::sqrt(dx * dx + dy * dy);
+      if (len <= 0.0) continue;
+      // len · (cos 2θ, sin 2θ)
+      c += (dx * dx - dy * dy) / len;
+      s += 2.0 * dx * dy / len;
+    }
+  }
+  return 0.5 * std::atan2(s, c);
+}
+
+}  // namespace
+
+//=============================================================================
+// CFringeOrderResult
+//=============================================================================
+int CFringeOrderResult::NumAssigned() const {
+  return (int)std::count_if(status.begin(), status.end(), [](EOrderStatus s) {
+    return s != EOrderStatus::Unassigned;
+  });
+}
+
+void CFringeOrderResult::Clear() {
+  orders.clear();
+  status.clear();
+  conflicts.clear();
+  scanAngle = 0.0;
+  numScans = numCrossings = numEdges = numComponents = 0;
+}
+
+//=============================================================================
+// Нумерация
+//=============================================================================
+bool CFringeOrderer::Assign(
+    const std::vector<std::vector<CTracerPoint>>& lines,
+    const CEllipseBoundary& boundary, CFringeOrderResult& result) {
+  INTERF_TIMED_SCOPE(m_stats, Order);
+  result.Clear();
+  m_lastError.clear();
+
+  const int numLines = (int)lines.size();
+  result.orders.assign(numLines, std::numeric_limits<double>::quiet_NaN());
+  result.status.assign(numLines, EOrderStatus::Unassigned);
+
+  // --- Система координат профилей: u вдоль профиля, v поперёк ---
+  const double angle = m_params.autoAngle
+                           ? MeanFringeAngle(lines) + 0.5 * Physics::PI
+                           : m_params.scanAngleDeg * Physics::PI / 180.0;
+  result.scanAngle = angle;
+  const double ca = std::cos(angle), sa = std::sin(angle);
+
+  double vMin = std::numeric_limits<double>::max();
+  double vMax = std::numeric_limits<double>::lowest();
+  for (const auto& line : lines)
+    for (const CTracerPoint& p : line) {
+      double v = -p.PosX() * sa + p.PosY() * ca;
+      vMin = (std::min)(vMin, v);
+      vMax = (std::max)(vMax, v);
+    }
+  if (vMin > vMax) {
+    m_lastError = "Нет линий с точками";
+    return false;
+  }
+  const double spacing = (std::max)(m_params.scanSpacing, kMinScanSpacing);
+  const int numScans = (int)((vMax - vMin) / spacing) + 1;
+  result.numScans = numScans;
+
+  // --- Пересечения отрезков с профилями v_k = vMin + (k + 0.5) · spacing ---
+  // Полуинтервал [min(v0, v1), max(v0, v1)): вершина на профиле не даёт
+  // двух пересечений
+  std::vector<CCrossing> raw;
+  std::vector<int> scanOf;
+  for (int li = 0; li < numLines; li++) {
+    const auto& line = lines[li];
+    for (size_t i = 1; i < line.size(); i++) {
+      double x0 = line[i - 1].PosX(), y0 = line[i - 1].PosY();
+      double x1 = line[i].PosX(), y1 = line[i].PosY();
+      double u0 = x0 * ca + y0 * sa, v0 = -x0 * sa + y0 * ca;
+      double u1 = x1 * ca + y1 * sa, v1 = -x1 * sa + y1 * ca;
+      if (v0 == v1) continue;
+      double lo = (std::min)(v0, v1), hi = (std::max)(v0, v1);
+      int k0 = (int)std::ceil((lo - vMin) / spacing - 0.5);
+      for (int k = (std::max)(k0, 0); k < numScans; k++) {
+        double vk = vMin + (k + 0.5) * spacing;
+        if (vk >= hi) break;
+        double t = (vk - v0) / (v1 - v0);
+        raw.push_back({(float)(u0 + t * (u1 - u0)), li});
+        scanOf.push_back(k);
+      }
+    }
+  }
+  result.numCrossings = (int)raw.size();
+
+  // Сортировка подсчётом по профилям, внутри профиля — по u
+  std::vector<int> scanStart(numScans + 1, 0);
+  for (int k : scanOf) scanStart[k + 1]++;
+  std::partial_sum(scanStart.begin(), scanStart.end(), scanStart.begin());
+  std::vector<CCrossing> crossings(raw.size());
+  {
+    std::vector<int> fill(scanStart.begin(), scanStart.end() - 1);
+    for (size_t i = 0; i < raw.size(); i++)
+      crossings[fill[scanOf[i]]++] = raw[i];
+  }
+  raw.clear();
+  raw.shrink_to_fit();
+
+  // --- Голоса соседних пересечений ---
+  // Пересечения ближе mergeDistance — одна полоса, пройденная несколькими
+  // линиями (повторная трассировка кольца, перекрытие фрагментов): такие
+  // группы голосуют за равный порядок, а соседство считается между группами
+  std::unordered_map<uint64_t, CVotes> votes;
+  auto vote = [&](int a, int b, int delta) {
+    if (a > b) {
+      std::swap(a, b);
+      delta = -delta;
+    }
+    CVotes& v = votes[PairKey(a, b)];
+    if (delta > 0)
+      v.plus++;
+    else if (delta < 0)
+      v.minus++;
+    else
+      v.same++;
+  };
+  auto insideAt = [&](double u, double v) {
+    int x = (int)std::lround(u * ca - v * sa);
+    int y = (int)std::lround(u * sa + v * ca);
+    return boundary.IsInside(x, y);
+  };
+  auto isNewGroup = [&](const CCrossing* scan, int i) {
+    return i == 0 || scan[i].u - scan[i - 1].u > m_params.mergeDistance;
+  };
+
+  // Первый проход: сортировка профилей и медиана зазоров по всем профилям —
+  // для коротких профилей у края зрачка своя медиана ненадёжна
+  std::vector<float> gaps;
+  for (int k = 0; k < numScans; k++) {
+    CCrossing* const scan = crossings.data() + scanStart[k];
+    const int count = scanStart[k + 1] - scanStart[k];
+    std::sort(scan, scan + count, [](const CCrossing& a, const CCrossing& b) {
+      return a.u < b.u;
+    });
+    for (int i = 1; i < count; i++)
+      if (isNewGroup(scan, i)) gaps.push_back(scan[i].u - scan[i - 1].u);
+  }
+  auto median = [](std::vector<float>& v) {
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return (double)v[v.size() / 2];
+  };
+  const double globalGap = gaps.empty() ? 0.0 : median(gaps);
+
+  std::vector<int> groupStart;
+  for (int k = 0; k < numScans; k++) {
+    CCrossing* const scan = crossings.data() + scanStart[k];
+    const int count = scanStart[k + 1] - scanStart[k];
+    groupStart.clear();
+    for (int i = 0; i < count; i++)
+      if (isNewGroup(scan, i)) groupStart.push_back(i);
+    const int numGroups = (int)groupStart.size();
+    groupStart.push_back(count);
+    if (numGroups < 2) continue;
+
+    // Шаг полос меняется по зрачку (дефокус) — своя медиана профиля, если
+    // зазоров достаточно
+    double refGap = globalGap;
+    if (numGroups > kMinScanGaps) {
+      gaps.clear();
+      for (int g = 1; g < numGroups; g++)
+        gaps.push_back(scan[groupStart[g]].u - scan[groupStart[g] - 1].u);
+      refGap = median(gaps);
+    }
+    const double maxGap = m_params.gapFactor * refGap;
+
+    const double vk = vMin + (k + 0.5) * spacing;
+    int sign = 1;
+    for (int g = 0; g < numGroups; g++) {
+      const int b0 = groupStart[g], b1 = groupStart[g + 1];
+      const int a0 = g > 0 ? groupStart[g - 1] : b0;
+      // Внутри группы — равный порядок; линия дважды — касание (экстремум
+      // фазы в самой группе, знак меняется после неё)
+      bool touch = false;
+      for (int i = b0; i < b1; i++)
+        for (int j = b0; j < i; j++) {
+          if (scan[i].line == scan[j].line)
+            touch = true;
+          else
+            vote(scan[j].line, scan[i].line, 0);
+        }
+
+      // Общая линия с предыдущей группой — между ними экстремум фазы.
+      // Знак меняется и через экранирование: кольцо вокруг него то же.
+      bool shared = false;
+      for (int i = b0; i < b1 && !shared; i++)
+        for (int j = a0; j < b0 && !shared; j++)
+          shared = scan[i].line == scan[j].line;
+
+      // Зазор или выход из рабочей области: между группами могла остаться
+      // нетрассированная полоса — соседство неизвестно, знак сохраняется
+      if (shared) {
+        sign = m_params.flipAtRepeat ? -sign : sign;
+      } else if (g > 0) {
+        const double u0 = scan[b0 - 1].u;
+        const double du = scan[b0].u - u0;
+        if (du <= maxGap && insideAt(u0 + 0.25 * du, vk) &&
+            insideAt(u0 + 0.5 * du, vk) && insideAt(u0 + 0.75 * du, vk)) {
+          for (int i = b0; i < b1; i++)
+            for (int j = a0; j < b0; j++)
+              vote(scan[j].line, scan[i].line, sign);
+        }
+      }
+      if (touch && m_params.flipAtRepeat) sign = -sign;
+    }
+  }
+
+  // Ребро — решение большинства, вес — перевес над вторым вариантом
+  std::vector<CEdge> edges;
+  edges.reserve(votes.size());
+  for (const auto& kv : votes) {
+    const CVotes& v = kv.second;
+    CEdge e;
+    e.a = (int)(kv.first >> 32);
+    e.b = (int)(uint32_t)kv.first;
+    int top = v.same, second = (std::max)(v.plus, v.minus);
+    e.delta = 0;
+    if (v.plus > top || v.minus > top) {
+      e.delta = v.plus > v.minus ? 1 : -1;
+      second = (std::max)(v.same, (std::min)(v.plus, v.minus));
+      top = (std::max)(v.plus, v.minus);
+    }
+    e.margin = top - second;
+    edges.push_back(e);
+  }
+  result.numEdges = (int)votes.size();
+  // Порядок обхода unordered_map не определён — результат не должен от него
+  // зависеть
+  std::sort(edges.begin(), edges.end(), [](const CEdge& e1, const CEdge& e2) {
+    if (e1.margin != e2.margin) return e1.margin > e2.margin;
+    return e1.a != e2.a ? e1.a < e2.a : e1.b < e2.b;
+  });
+
+  // --- Максимальный остовный лес (Крускал) ---
+  // Ничьи (margin == 0) в лес не идут, но проверяются как конфликт
+  std::vector<int> parent(numLines);
+  std::iota(parent.begin(), parent.end(), 0);
+  std::vector<std::vector<std::pair<int, int>>> tree(numLines);  // (сосед, Δ)
+  std::vector<char> inTree(edges.size(), 0);
+  for (size_t i = 0; i < edges.size(); i++) {
+    const CEdge& e = edges[i];
+    if (e.margin == 0) break;
+    int ra = FindRoot(parent, e.a), rb = FindRoot(parent, e.b);
+    if (ra == rb) continue;
+    parent[(std::max)(ra, rb)] = (std::min)(ra, rb);
+    tree[e.a].push_back({e.b, e.delta});
+    tree[e.b].push_back({e.a, -e.delta});
+    inTree[i] = 1;
+  }
+
+  // --- Относительные порядки обходом в ширину по компонентам ---
+  std::vector<int> relOrder(numLines, 0), component(numLines, -1);
+  std::vector<int64_t> componentPoints;
+  std::queue<int> bfs;
+  for (int root = 0; root < numLines; root++) {
+    if (component[root] >= 0 || lines[root].empty()) continue;
+    const int id = (int)componentPoints.size();
+    componentPoints.push_back(0);
+    component[root] = id;
+    bfs.push(root);
+    while (!bfs.empty()) {
+      int cur = bfs.front();
+      bfs.pop();
+      componentPoints[id] += (int64_t)lines[cur].size();
+      for (const auto& next : tree[cur]) {
+        if (component[next.first] >= 0) continue;
+        component[next.first] = id;
+        relOrder[next.first] = relOrder[cur] + next.second;
+        bfs.push(next.first);
+      }
+    }
+  }
+  result.numComponents = (int)componentPoints.size();
+
+  // Рёбра вне леса — проверка согласованности
+  for (size_t i = 0; i < edges.size(); i++) {
+    if (inTree[i]) continue;
+    const CEdge& e = edges[i];
+    if (component[e.a] != component[e.b]) {
+      // Ничья между компонентами — связь не установлена
+      result.conflicts.push_back({e.a, e.b, e.delta, 0, 0});
+      continue;
+    }
+    int actual = relOrder[e.b] - relOrder[e.a];
+    if (e.margin == 0 || actual != e.delta)
+      result.conflicts.push_back({e.a, e.b, e.delta, actual, e.margin});
+  }
+  std::sort(result.conflicts.begin(), result.conflicts.end(),
+            [](const COrderConflict& c1, const COrderConflict& c2) {
+              return c1.lineA != c2.lineA ? c1.lineA < c2.lineA
+                                          : c1.lineB < c2.lineB;
+            });
+  INTERF_COUNT(m_stats, OrderConflicts, result.conflicts.size());
+
+  // --- Основная компонента и привязка остальных ---
+  const int primary = (int)(std::max_element(componentPoints.begin(),
+                                             componentPoints.end()) -
+                            componentPoints.begin());
+  std::vector<double> meanU(numLines, 0.0);
+  for (int li = 0; li < numLines; li++) {
+    if (lines[li].empty()) continue;
+    double sum = 0.0;
+    for (const CTracerPoint& p : lines[li])
+      sum += p.PosX() * ca + p.PosY() * sa;
+    meanU[li] = sum / lines[li].size();
+  }
+
+  // Порядок ≈ α + β·ū по линиям основной компоненты
+  double su = 0.0, so = 0.0, suu = 0.0, suo = 0.0;
+  int n = 0;
+  for (int li = 0; li < numLines; li++) {
+    if (component[li] != primary) continue;
+    su += meanU[li];
+    so += relOrder[li];
+    suu += meanU[li] * meanU[li];
+    suo += meanU[li] * relOrder[li];
+    n++;
+  }
+  const double det = n * suu - su * su;
+  const bool canExtrapolate = n >= 2 && det > 1e-9 * (std::max)(1.0, n * suu);
+  const double beta = canExtrapolate ? (n * suo - su * so) / det : 0.0;
+  const double alpha = canExtrapolate ? (so - beta * su) / n : 0.0;
+
+  std::vector<double> offsetSum(componentPoints.size(), 0.0);
+  std::vector<int> offsetCount(componentPoints.size(), 0);
+  if (canExtrapolate) {
+    for (int li = 0; li < numLines; li++) {
+      int c = component[li];
+      if (c < 0 || c == primary) continue;
+      offsetSum[c] += alpha + beta * meanU[li] - relOrder[li];
+      offsetCount[c]++;
+    }
+  }
+
+  double minOrder = std::numeric_limits<double>::max();
+  for (int li = 0; li < numLines; li++) {
+    int c = component[li];
+    if (c < 0) continue;
+    if (c == primary) {
+      result.orders[li] = relOrder[li];
+      result.status[li] = EOrderStatus::Assigned;
+    } else if (offsetCount[c] > 0) {
+      double offset = std::round(offsetSum[c] / offsetCount[c]);
+      result.orders[li] = relOrder[li] + offset;
+      result.status[li] = EOrderStatus::Extrapolated;
+    } else {
+      continue;
+    }
+    minOrder = (std::min)(minOrder, result.orders[li]);
+  }
+  for (int li = 0; li < numLines; li++)
+    if (result.status[li] != EOrderStatus::Unassigned)
+      result.orders[li] -= minOrder;
+  return true;
+}
+
+}  // namespace Interferometry
@@ -1,8 +1,16 @@
 #include "FringeSkeletonizer.h"
 
 #include <algorithm>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
 
 #include "EllipseBoundary.h"
+#include "PupilSpans.h"
 
 namespace Interferometry {
 
@@ -24,6 +32,7 @@ bool CFringeSkeletonizer::Initialize(const cv::Mat& image,
 
   m_image = image;
   m_boundary = &boundary;
+  m_mask.release();
   return true;
 }
 
@@ -34,30 +43,59 @@ bool CFringeSkeletonizer::Initialize(const cv::Mat& image,
 //=============================================================================
 std::vector<std::vector<CTracerPoint>> CFringeSkeletonizer::Extract(
     const std::vector<CSeedPoint>& /*seeds*/) {
+  m_stats.Reset();
   if (m_image.empty()) {
     m_lastError = "Initialize() must be called before Extract()";
     return {};
   }
 
-  if (!BuildBinary()) return {};
+  {
+    INTERF_TIMED_SCOPE(m_stats, Binarize);
+    if (!BuildBinary()) return {};
+  }
 
-  Skeletonize(m_binary, m_skeleton);
+  {
+    INTERF_TIMED_SCOPE(m_stats, Thin);
+    Skeletonize(m_binary, m_skeleton);
+    // Защита: скелет тоже маскируем
+    if (m_boundary) ClearOutside(m_skeleton, *m_boundary);
+  }
+  INTERF_COUNT(m_stats, SkeletonPixels, cv::countNonZero(m_skeleton));
 
-  // Защита: скелет тоже маскируем
-  cv::bitwise_and(m_skeleton, m_mask, m_skeleton);
-  cv::imwrite("debug_skel_before_prune.png", m_skeleton);  // ← добавь
-  std::cout << "skelParams.pruneLength = " << m_params.pruneLength << std::endl;
-  // Обрезать короткие веточки перед обходом
-  PruneSkeleton(m_skeleton, m_params.pruneLength);
-  cv::imwrite("debug_skel_after_prune.png", m_skeleton);  // ← добавь
+  // Граф скелета; обрезка веточек — на графе, скелет перерисовывается
+  {
+    INTERF_TIMED_SCOPE(m_stats, GraphBuild);
+    m_graph.Build(m_skeleton);
+  }
+  INTERF_COUNT(m_stats, GraphNodes, m_graph.CountAliveNodes());
+  INTERF_COUNT(m_stats, GraphEdges, m_graph.CountAliveEdges());
+
+  {
+    INTERF_TIMED_SCOPE(m_stats, Prune);
+    int pruned = m_graph.Prune(m_params.pruneLength);
+    INTERF_COUNT(m_stats, PrunedEdges, pruned);
+    m_graph.Render(m_skeleton);
+    (void)pruned;
+  }
 
-  if (m_params.computeWidth)
-    cv::distanceTransform(m_binary, m_distMap, cv::DIST_L2, 3);
+  {
+    INTERF_TIMED_SCOPE(m_stats, Link);
+    int linked = m_graph.LinkEndpoints(m_params.linkDistance);
+    INTERF_COUNT(m_stats, LinkedGaps, linked);
+    (void)linked;
+  }
 
-  auto lines = ExtractPolylines();
-  LinkBrokenLines(lines);
-  if (m_params.smoothLines)
-    for (auto& line : lines) SmoothLine(line);
+  std::vector<std::vector<CTracerPoint>> lines;
+  {
+    INTERF_TIMED_SCOPE(m_stats, Polylines);
+    if (m_params.computeWidth)
+      cv::distanceTransform(m_binary, m_distMap, cv::DIST_L2, 3);
+    lines = ExtractPolylines();
+    if (m_params.smoothLines)
+      for (auto& line : lines) SmoothLine(line);
+  }
+
+  INTERF_COUNT_LINES(m_stats, lines);
 
   return lines;
 }
@@ -76,17 +114,10 @@ bool CFringeSkeletonizer::BuildBinary() {
     blurred = m_image.clone();
   }
 
-  // 2. Маска эллипса
-  m_mask = cv::Mat::zeros(m_image.size(), CV_8UC1);
-  if (m_boundary) {
-    for (int y = 0; y < m_image.rows; y++)
-      for (int x = 0; x < m_image.cols; x++)
-        if (m_boundary->IsInside(x, y)) m_mask.at<uchar>(y, x) = 255;
-  } else {
-    m_mask.setTo(255);
-  }
+  // Граница могла измениться с прошлого вызова — кэш маски устарел
+  m_mask.release();
 
-  // 3. Adaptive threshold
+  // 2. Adaptive threshold
   int blockSize = m_params.adaptiveBlockSize;
   if (blockSize % 2 == 0) blockSize++;
   if (blockSize < 3) blockSize = 3;
@@ -94,10 +125,10 @@ bool CFringeSkeletonizer::BuildBinary() {
   cv::adaptiveThreshold(blurred, m_binary, 255, cv::ADAPTIVE_THRESH_MEAN_C,
                         cv::THRESH_BINARY, blockSize, m_params.adaptiveC);
 
-  // 4. Применить маску
-  cv::bitwise_and(m_binary, m_mask, m_binary);
+  // 3. Применить маску — обнулить промежутки между отрезками зрачка
+  if (m_boundary) ClearOutside(m_binary, *m_boundary);
 
-  // 5. Морфологическая чистка
+  // 4. Морфологическая чистка
   int k = m_params.morphKernelSize;
   if (k >= 3 && k % 2 == 1) {
     cv::Mat kernel =
@@ -106,219 +137,269 @@ bool CFringeSkeletonizer::BuildBinary() {
     cv::morphologyEx(m_binary, m_binary, cv::MORPH_CLOSE, kernel);
   }
 
-  // 6. ПОВТОРНО применить маску — morphology может расширить пиксели
-  cv::bitwise_and(m_binary, m_mask, m_binary);
+  // 5. ПОВТОРНО применить маску — morphology может расширить пиксели
+  if (m_boundary) ClearOutside(m_binary, *m_boundary);
 
   return true;
 }
 
 //=============================================================================
-// Skeletonize — Zhang-Suen (если есть opencv_contrib, замени на ximgproc)
+// GetMask — отладочная маска зрачка, по запросу
 //=============================================================================
-void CFringeSkeletonizer::Skeletonize(const cv::Mat& binary,
-                                      cv::Mat& skeleton) const {
-  skeleton = binary.clone();
-  skeleton /= 255;
-
-  cv::Mat marker = cv::Mat::zeros(skeleton.size(), CV_8UC1);
-  bool changed = true;
+const cv::Mat& CFringeSkeletonizer::GetMask() const {
+  if (!m_mask.empty() || m_image.empty()) return m_mask;
 
-  auto P = [&](int y, int x, int dy, int dx) -> int {
-    int ny = y + dy, nx = x + dx;
-    if (ny < 0 || ny >= skeleton.rows || nx < 0 || nx >= skeleton.cols)
-      return 0;
-    return skeleton.at<uchar>(ny, nx);
-  };
-
-  while (changed) {
-    changed = false;
+  // Готовая маска CEllipseBoundary, копия общей части кадра
+  m_mask = cv::Mat::zeros(m_image.size(), CV_8UC1);
+  if (m_boundary) {
+    int w = (std::min)(m_image.cols, m_boundary->GetImageWidth());
+    int h = (std::min)(m_image.rows, m_boundary->GetImageHeight());
+    cv::Mat boundaryMask(h, w, CV_8UC1,
+                         const_cast<uint8_t*>(m_boundary->GetInsideMask()),
+                         m_boundary->GetInsideMaskStride());
+    boundaryMask.copyTo(m_mask(cv::Rect(0, 0, w, h)));
+  } else {
+    m_mask.setTo(255);
+  }
+  return m_mask;
+}
 
-    for (int sub = 0; sub < 2; sub++) {
-      marker.setTo(0);
-
-      for (int y = 1; y < skeleton.rows - 1; y++) {
-        for (int x = 1; x < skeleton.cols - 1; x++) {
-          if (skeleton.at<uchar>(y, x) == 0) continue;
-
-          int p2 = P(y, x, -1, 0);
-          int p3 = P(y, x, -1, +1);
-          int p4 = P(y, x, 0, +1);
-          int p5 = P(y, x, +1, +1);
-          int p6 = P(y, x, +1, 0);
-          int p7 = P(y, x, +1, -1);
-          int p8 = P(y, x, 0, -1);
-          int p9 = P(y, x, -1, -1);
-
-          int B = p2 + p3 + p4 + p5 + p6 + p7 + p8 + p9;
-          if (B < 2 || B > 6) continue;
-
-          int A = (p2 == 0 && p3 == 1) + (p3 == 0 && p4 == 1) +
-                  (p4 == 0 && p5 == 1) + (p5 == 0 && p6 == 1) +
-                  (p6 == 0 && p7 == 1) + (p7 == 0 && p8 == 1) +
-                  (p8 == 0 && p9 == 1) + (p9 == 0 && p2 == 1);
-          if (A != 1) continue;
-
-          if (sub == 0) {
-            if (p2 * p4 * p6 != 0) continue;
-            if (p4 * p6 * p8 != 0) continue;
-          } else {
-            if (p2 * p4 * p8 != 0) continue;
-            if (p2 * p6 * p8 != 0) continue;
-          }
-
-          marker.at<uchar>(y, x) = 1;
-        }
+//=============================================================================
+// Skeletonize — Zhang-Suen (если есть opencv_contrib, замени на ximgproc)
+//=============================================================================
+// Реализация по строкам: кадр копируется в выровненный буфер 0/1 с рамкой
+// в 1 пиксель, решение «удалить пиксель» — функция 8-битного кода соседей
+// (p2 — бит 0, …, p9 — бит 7) и номера подитерации.
+//
+// Скалярный путь берёт решение из таблицы на 256 кодов, SIMD-путь
+// (SSE2 / AVX2) вычисляет то же условие побайтно для 16/32 пикселей.
+//
+// Строка, на которой подитерация sub ничего не удалила, помечается
+// чистой для sub и пропускается, пока не изменится она сама или соседняя
+// строка. Подитерация по-прежнему «параллельная»: решения по старому
+// скелету, удаление — после прохода по всем строкам, поэтому результат
+// совпадает с классическим двойным циклом бит в бит.
+//=============================================================================
+namespace {
+
+// Таблица удаления: del[sub][code] == 1 — пиксель с кодом соседей code
+// удаляется на подитерации sub.
+struct ZhangSuenLut {
+  uint8_t del[2][256];
+
+  ZhangSuenLut() {
+    for (int code = 0; code < 256; code++) {
+      int p[8];  // p2 … p9 по часовой стрелке, начиная с верхнего
+      for (int k = 0; k < 8; k++) p[k] = (code >> k) & 1;
+
+      int B = 0, A = 0;
+      for (int k = 0; k < 8; k++) {
+        B += p[k];
+        A += (p[k] == 0 && p[(k + 1) % 8] == 1);
       }
 
-      for (int y = 0; y < skeleton.rows; y++)
-        for (int x = 0; x < skeleton.cols; x++)
-          if (marker.at<uchar>(y, x)) {
-            skeleton.at<uchar>(y, x) = 0;
-            changed = true;
-          }
+      const int p2 = p[0], p4 = p[2], p6 = p[4], p8 = p[6];
+      bool base = (B >= 2 && B <= 6 && A == 1);
+      del[0][code] = base && p2 * p4 * p6 == 0 && p4 * p6 * p8 == 0;
+      del[1][code] = base && p2 * p4 * p8 == 0 && p2 * p6 * p8 == 0;
     }
   }
+};
 
-  skeleton *= 255;
+const ZhangSuenLut& GetZhangSuenLut() {
+  static const ZhangSuenLut lut;
+  return lut;
 }
 
-//=============================================================================
-// CountNeighbors
-//=============================================================================
-int CFringeSkeletonizer::CountNeighbors(const cv::Mat& skel, int x,
-                                        int y) const {
-  int count = 0;
-  for (int dy = -1; dy <= 1; dy++)
-    for (int dx = -1; dx <= 1; dx++) {
-      if (dx == 0 && dy == 0) continue;
-      int nx = x + dx, ny = y + dy;
-      if (nx < 0 || nx >= skel.cols || ny < 0 || ny >= skel.rows) continue;
-      if (skel.at<uchar>(ny, nx) > 0) count++;
-    }
-  return count;
+// Скалярная разметка пикселей [x0, x1) строки row.
+// Возвращает true, если хоть один пиксель помечен.
+bool MarkRowScalar(const uint8_t* row, int stride, int x0, int x1, int sub,
+                   uint8_t* marker) {
+  const uint8_t* lut = GetZhangSuenLut().del[sub];
+  const uint8_t* up = row - stride;
+  const uint8_t* dn = row + stride;
+  uint8_t any = 0;
+
+  for (int x = x0; x < x1; x++) {
+    if (!row[x]) continue;
+    int code = up[x] | (up[x + 1] << 1) | (row[x + 1] << 2) |
+               (dn[x + 1] << 3) | (dn[x] << 4) | (dn[x - 1] << 5) |
+               (row[x - 1] << 6) | (up[x - 1] << 7);
+    marker[x] = lut[code];
+    any |= marker[x];
+  }
+  return any != 0;
 }
 
-//=============================================================================
-// TraceBranch
-//=============================================================================
-std::vector<CTracerPoint> CFringeSkeletonizer::TraceBranch(const cv::Mat& skel,
-                                                           cv::Mat& visited,
-                                                           int sx, int sy) {
-  std::vector<CTracerPoint> branch;
-  static const int dx8[8] = {0, 1, 0, -1, 1, 1, -1, -1};
-  static const int dy8[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
-
-  int x = sx, y = sy;
-  int prevDx = 0, prevDy = 0;  // предыдущее направление шага (0,0 = ещё нет)
-
-  while (true) {
-    visited.at<uchar>(y, x) = 1;
-
-    // Записать текущую точку
-    CTracerPoint pt;
-    pt.x = x;
-    pt.y = y;
-    pt.intensity = (float)m_image.at<uchar>(y, x);
-    pt.width = (m_params.computeWidth && !m_distMap.empty())
-                   ? 2.0f * m_distMap.at<float>(y, x)
-                   : 0.0f;
-    branch.push_back(pt);
-
-    // Собрать всех непосещённых соседей по скелету
-    struct Candidate {
-      int x, y, dx, dy;
-    };
-    Candidate candidates[8];
-    int numCandidates = 0;
-
-    for (int i = 0; i < 8; i++) {
-      int nx = x + dx8[i];
-      int ny = y + dy8[i];
-      if (nx < 0 || nx >= skel.cols || ny < 0 || ny >= skel.rows) continue;
-      if (skel.at<uchar>(ny, nx) == 0) continue;
-      if (visited.at<uchar>(ny, nx)) continue;
-
-      candidates[numCandidates++] = {nx, ny, dx8[i], dy8[i]};
-    }
+#if defined(__AVX2__)
+constexpr int ZS_LANES = 32;
+using ZsVec = __m256i;
+inline ZsVec ZsLoad(const uint8_t* p) {
+  return _mm256_loadu_si256((const __m256i*)p);
+}
+inline void ZsStore(uint8_t* p, ZsVec v) {
+  _mm256_storeu_si256((__m256i*)p, v);
+}
+inline ZsVec ZsAdd(ZsVec a, ZsVec b) { return _mm256_add_epi8(a, b); }
+inline ZsVec ZsAnd(ZsVec a, ZsVec b) { return _mm256_and_si256(a, b); }
+inline ZsVec ZsOr(ZsVec a, ZsVec b) { return _mm256_or_si256(a, b); }
+inline ZsVec ZsAndNot(ZsVec a, ZsVec b) { return _mm256_andnot_si256(a, b); }
+inline ZsVec ZsEq(ZsVec a, ZsVec b) { return _mm256_cmpeq_epi8(a, b); }
+inline ZsVec ZsGt(ZsVec a, ZsVec b) { return _mm256_cmpgt_epi8(a, b); }
+inline ZsVec ZsSet(int v) { return _mm256_set1_epi8((char)v); }
+inline bool ZsAny(ZsVec v) { return _mm256_movemask_epi8(v) != 0; }
+#define ZS_HAVE_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+constexpr int ZS_LANES = 16;
+using ZsVec = __m128i;
+inline ZsVec ZsLoad(const uint8_t* p) {
+  return _mm_loadu_si128((const __m128i*)p);
+}
+inline void ZsStore(uint8_t* p, ZsVec v) { _mm_storeu_si128((__m128i*)p, v); }
+inline ZsVec ZsAdd(ZsVec a, ZsVec b) { return _mm_add_epi8(a, b); }
+inline ZsVec ZsAnd(ZsVec a, ZsVec b) { return _mm_and_si128(a, b); }
+inline ZsVec ZsOr(ZsVec a, ZsVec b) { return _mm_or_si128(a, b); }
+inline ZsVec ZsAndNot(ZsVec a, ZsVec b) { return _mm_andnot_si128(a, b); }
+inline ZsVec ZsEq(ZsVec a, ZsVec b) { return _mm_cmpeq_epi8(a, b); }
+inline ZsVec ZsGt(ZsVec a, ZsVec b) { return _mm_cmpgt_epi8(a, b); }
+inline ZsVec ZsSet(int v) { return _mm_set1_epi8((char)v); }
+inline bool ZsAny(ZsVec v) { return _mm_movemask_epi8(v) != 0; }
+#define ZS_HAVE_SIMD 1
+#endif
+
+// Разметка строки: SIMD по блокам ZS_LANES, хвост — по таблице.
+// Условия те же, что в ZhangSuenLut, но вычисляются побайтно:
+//   B = Σp,  A = Σ(!p_k & p_{k+1}),
+//   sub 0: p4·p6·(p2|p8) == 0,  sub 1: p2·p8·(p4|p6) == 0.
+bool MarkRow(const uint8_t* row, int stride, int width, int sub,
+             uint8_t* marker) {
+  int x = 1;
+  const int xEnd = width - 1;  // крайние столбцы не удаляются
+  bool any = false;
+
+#ifdef ZS_HAVE_SIMD
+  const uint8_t* up = row - stride;
+  const uint8_t* dn = row + stride;
+  const ZsVec zero = ZsSet(0), one = ZsSet(1), bMin = ZsSet(1),
+              bMax = ZsSet(7);
+
+  for (; x + ZS_LANES <= xEnd; x += ZS_LANES) {
+    ZsVec c = ZsLoad(row + x);
+    if (!ZsAny(ZsGt(c, zero))) continue;
+
+    ZsVec p2 = ZsLoad(up + x), p3 = ZsLoad(up + x + 1);
+    ZsVec p4 = ZsLoad(row + x + 1), p5 = ZsLoad(dn + x + 1);
+    ZsVec p6 = ZsLoad(dn + x), p7 = ZsLoad(dn + x - 1);
+    ZsVec p8 = ZsLoad(row + x - 1), p9 = ZsLoad(up + x - 1);
+
+    ZsVec B = ZsAdd(ZsAdd(ZsAdd(p2, p3), ZsAdd(p4, p5)),
+                    ZsAdd(ZsAdd(p6, p7), ZsAdd(p8, p9)));
+    ZsVec A = ZsAdd(
+        ZsAdd(ZsAdd(ZsAndNot(p2, p3), ZsAndNot(p3, p4)),
+              ZsAdd(ZsAndNot(p4, p5), ZsAndNot(p5, p6))),
+        ZsAdd(ZsAdd(ZsAndNot(p6, p7), ZsAndNot(p7, p8)),
+              ZsAdd(ZsAndNot(p8, p9), ZsAndNot(p9, p2))));
+
+    ZsVec tri = (sub == 0) ? ZsAnd(ZsAnd(p4, p6), ZsOr(p2, p8))
+                           : ZsAnd(ZsAnd(p2, p8), ZsOr(p4, p6));
+
+    ZsVec del = ZsAnd(ZsAnd(ZsGt(c, zero), ZsGt(B, bMin)),
+                      ZsAnd(ZsGt(bMax, B), ZsEq(A, one)));
+    del = ZsAnd(del, ZsEq(tri, zero));
+
+    ZsStore(marker + x, ZsAnd(del, one));
+    any |= ZsAny(del);
+  }
+#endif
+
+  if (x < xEnd) any |= MarkRowScalar(row, stride, x, xEnd, sub, marker);
+  return any;
+}
+
+}  // namespace
+
+void CFringeSkeletonizer::Skeletonize(const cv::Mat& binary,
+                                      cv::Mat& skeleton) const {
+  const int w = binary.cols;
+  const int h = binary.rows;
+
+  // Буфер 0/1 с нулевой рамкой, строки выровнены на 32 байта.
+  // 0/1 — как у skeleton /= 255 в исходной версии (>= 128 → 1).
+  const int stride = (w + 2 + 31) & ~31;
+  std::vector<uint8_t> buf((size_t)stride * (h + 2), 0);
+  std::vector<uint8_t> marker((size_t)stride * (h + 2), 0);
+  uint8_t* img = buf.data() + stride + 1;
+  uint8_t* mark = marker.data() + stride + 1;
+
+  for (int y = 0; y < h; y++) {
+    const uint8_t* src = binary.ptr<uint8_t>(y);
+    uint8_t* dst = img + (size_t)y * stride;
+    for (int x = 0; x < w; x++) dst[x] = src[x] >= 128;
+  }
+
+  // clean[sub][y] — строка y на подитерации sub ничего не удаляет,
+  // и с тех пор не менялись ни она, ни соседи
+  std::vector<uint8_t> clean[2] = {std::vector<uint8_t>(h, 0),
+                                   std::vector<uint8_t>(h, 0)};
+  std::vector<int> markedRows;
+  markedRows.reserve(h);
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+
+    for (int sub = 0; sub < 2; sub++) {
+      markedRows.clear();
+
+      for (int y = 1; y < h - 1; y++) {
+        if (clean[sub][y]) continue;
+        if (MarkRow(img + (size_t)y * stride, stride, w, sub,
+                    mark + (size_t)y * stride))
+          markedRows.push_back(y);
+        else
+          clean[sub][y] = 1;
+      }
 
-    if (numCandidates == 0) break;  // тупик — конец линии
-
-    // Если выбор один — просто идём туда
-    // Если несколько — выбираем ближайшего по направлению к prevDx/prevDy
-    int bestIdx = 0;
-    if (numCandidates > 1 && (prevDx != 0 || prevDy != 0)) {
-      // Для каждого кандидата считаем dot-product с предыдущим направлением.
-      // Чем больше — тем ближе направления (cos угла больше).
-      float prevLen = std::sqrt((float)(prevDx * prevDx + prevDy * prevDy));
-      float bestScore = -1e9f;
-      for (int i = 0; i < numCandidates; i++) {
-        float cdLen = std::sqrt((float)(candidates[i].dx * candidates[i].dx +
-                                        candidates[i].dy * candidates[i].dy));
-        float dot =
-            (float)(prevDx * candidates[i].dx + prevDy * candidates[i].dy);
-        float score = dot / (prevLen * cdLen);  // cos угла
-        if (score > bestScore) {
-          bestScore = score;
-          bestIdx = i;
+      // Удаление после полного прохода — как отдельный цикл по marker
+      for (int y : markedRows) {
+        uint8_t* row = img + (size_t)y * stride;
+        uint8_t* m = mark + (size_t)y * stride;
+        for (int x = 0; x < w; x++) {
+          row[x] &= (uint8_t)(m[x] ^ 1);
+          m[x] = 0;
         }
+        for (int yy = y - 1; yy <= y + 1; yy++) {
+          clean[0][yy] = 0;
+          clean[1][yy] = 0;
+        }
+        changed = true;
       }
     }
-
-    // Переход на лучшего кандидата
-    prevDx = candidates[bestIdx].dx;
-    prevDy = candidates[bestIdx].dy;
-    x = candidates[bestIdx].x;
-    y = candidates[bestIdx].y;
   }
 
-  return branch;
+  skeleton.create(h, w, CV_8UC1);
+  for (int y = 0; y < h; y++) {
+    const uint8_t* src = img + (size_t)y * stride;
+    uint8_t* dst = skeleton.ptr<uint8_t>(y);
+    for (int x = 0; x < w; x++) dst[x] = (uint8_t)(src[x] * 255);
+  }
 }
 
 //=============================================================================
 // ExtractPolylines
 //=============================================================================
+// Полилинии — обход графа (концы, затем остальные рёбра); здесь только
+// интенсивность и ширина по исходному кадру и карте расстояний.
+//=============================================================================
 std::vector<std::vector<CTracerPoint>> CFringeSkeletonizer::ExtractPolylines() {
-  std::vector<std::vector<CTracerPoint>> lines;
-  cv::Mat visited = cv::Mat::zeros(m_skeleton.size(), CV_8UC1);
-
-  // Фаза 1: от endpoint'ов.
-  // Endpoint = пиксель скелета с ровно 1 соседом — это «свободный конец» линии.
-  // От него обход даёт самую полную линию (через все развилки).
-  for (int y = 0; y < m_skeleton.rows; y++) {
-    for (int x = 0; x < m_skeleton.cols; x++) {
-      if (m_skeleton.at<uchar>(y, x) == 0) continue;
-      if (visited.at<uchar>(y, x)) continue;
-      if (CountNeighbors(m_skeleton, x, y) != 1) continue;
-
-      auto branch = TraceBranch(m_skeleton, visited, x, y);
-      if ((int)branch.size() >= m_params.minLineLength)
-        lines.push_back(std::move(branch));
-      else {
-        std::cout << "[ExtractPolylines] rejecting branch size="
-                  << branch.size() << " (threshold=" << m_params.minLineLength
-                  << ")" << std::endl;
-      }
-    }
-  }
+  auto lines = m_graph.ExtractPolylines(m_params.minLineLength);
 
-  // Фаза 2: оставшиеся непосещённые пиксели.
-  // Сюда попадают замкнутые контуры (без endpoint'ов) и обрывки веточек,
-  // не доступных от endpoint'ов.
-  for (int y = 0; y < m_skeleton.rows; y++) {
-    for (int x = 0; x < m_skeleton.cols; x++) {
-      if (m_skeleton.at<uchar>(y, x) == 0) continue;
-      if (visited.at<uchar>(y, x)) continue;
-
-      auto branch = TraceBranch(m_skeleton, visited, x, y);
-      if ((int)branch.size() >= m_params.minLineLength)
-        lines.push_back(std::move(branch));
-      else {
-        std::cout << "[ExtractPolylines] rejecting branch size="
-                  << branch.size() << " (threshold=" << m_params.minLineLength
-                  << ")" << std::endl;
-      }
+  const bool withWidth = m_params.computeWidth && !m_distMap.empty();
+  for (auto& line : lines)
+    for (auto& pt : line) {
+      pt.intensity = (float)m_image.at<uchar>(pt.y, pt.x);
+      pt.width = withWidth ? 2.0f * m_distMap.at<float>(pt.y, pt.x) : 0.0f;
     }
-  }
 
   return lines;
 }
@@ -337,199 +418,9 @@ void CFringeSkeletonizer::SmoothLine(std::vector<CTracerPoint>& line) const {
       sx += line[i + j].x;
       sy += line[i + j].y;
     }
-    sm[i].x = (int)(sx / (2 * w + 1) + 0.5f);
-    sm[i].y = (int)(sy / (2 * w + 1) + 0.5f);
+    sm[i].SetPosition(sx / (2 * w + 1), sy / (2 * w + 1));
   }
   line = std::move(sm);
 }
 
-void CFringeSkeletonizer::PruneSkeleton(cv::Mat& skel,
-                                        int maxBranchLength) const {
-  if (maxBranchLength <= 0) return;
-
-  static const int dx8[8] = {0, 1, 0, -1, 1, 1, -1, -1};
-  static const int dy8[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
-
-  bool changed = true;
-  int iterations = 0;
-  const int maxIterations = 20;  // защита от вечного цикла
-
-  while (changed && iterations++ < maxIterations) {
-    changed = false;
-
-    // Найти все endpoint'ы текущего скелета
-    std::vector<std::pair<int, int>> endpoints;
-    for (int y = 0; y < skel.rows; y++)
-      for (int x = 0; x < skel.cols; x++) {
-        if (skel.at<uchar>(y, x) == 0) continue;
-        if (CountNeighbors(skel, x, y) == 1) endpoints.push_back({x, y});
-      }
-
-    // Для каждого endpoint обойти ветвь до развилки или предела
-    for (auto& ep : endpoints) {
-      int x = ep.first, y = ep.second;
-
-      // Проверяем что точка ещё существует (могла быть удалена в этом проходе)
-      if (skel.at<uchar>(y, x) == 0) continue;
-
-      std::vector<std::pair<int, int>> branch;
-      branch.push_back({x, y});
-
-      int curX = x, curY = y;
-      int prevX = -1, prevY = -1;
-
-      while ((int)branch.size() <= maxBranchLength) {
-        // Найти следующего соседа (не возвращаемся назад)
-        int nextX = -1, nextY = -1;
-        for (int i = 0; i < 8; i++) {
-          int nx = curX + dx8[i];
-          int ny = curY + dy8[i];
-          if (nx < 0 || nx >= skel.cols || ny < 0 || ny >= skel.rows) continue;
-          if (skel.at<uchar>(ny, nx) == 0) continue;
-          if (nx == prevX && ny == prevY) continue;
-
-          nextX = nx;
-          nextY = ny;
-          break;
-        }
-
-        if (nextX < 0) break;  // тупик
-
-        // Достигли развилки?
-        if (CountNeighbors(skel, nextX, nextY) >= 3)
-          break;  // ветвь закончилась — следующий пиксель уже развилка
-
-        prevX = curX;
-        prevY = curY;
-        curX = nextX;
-        curY = nextY;
-        branch.push_back({curX, curY});
-      }
-
-      // Если ветвь короткая — стереть её
-      if ((int)branch.size() < maxBranchLength) {
-        for (auto& p : branch) skel.at<uchar>(p.second, p.first) = 0;
-        changed = true;
-      }
-    }
-  }
-}
-
-void CFringeSkeletonizer::LinkBrokenLines(
-    std::vector<std::vector<CTracerPoint>>& lines) const {
-  std::cout << "[Link] called, linkDistance=" << m_params.linkDistance
-            << ", lines=" << lines.size() << std::endl;
-
-  if (m_params.linkDistance <= 0) {
-    std::cout << "[Link] skipped (distance <= 0)" << std::endl;
-    return;
-  }
-  const float maxDist = (float)m_params.linkDistance;
-  const float maxDist2 = maxDist * maxDist;
-
-  bool merged = true;
-  int pass = 0;
-  while (merged) {
-    merged = false;
-    pass++;
-    std::cout << "[Link] pass " << pass << std::endl;
-
-    for (size_t i = 0; i < lines.size() && !merged; i++) {
-      for (size_t j = i + 1; j < lines.size() && !merged; j++) {
-        if (lines[i].empty() || lines[j].empty()) continue;
-
-        const CTracerPoint& iFront = lines[i].front();
-        const CTracerPoint& iBack = lines[i].back();
-        const CTracerPoint& jFront = lines[j].front();
-        const CTracerPoint& jBack = lines[j].back();
-
-        struct LinkOption {
-          int distSq;
-          bool reverseI;
-          bool reverseJ;
-        };
-
-        auto sq = [](int dx, int dy) { return dx * dx + dy * dy; };
-
-        LinkOption opts[4] = {
-            {sq(iBack.x - jFront.x, iBack.y - jFront.y), false, false},
-            {sq(iBack.x - jBack.x, iBack.y - jBack.y), false, true},
-            {sq(iFront.x - jFront.x, iFront.y - jFront.y), true, false},
-            {sq(iFront.x - jBack.x, iFront.y - jBack.y), true, true}};
-
-        int bestIdx = 0;
-        for (int k = 1; k < 4; k++)
-          if (opts[k].distSq < opts[bestIdx].distSq) bestIdx = k;
-
-        int bestDist = (int)std::sqrt((float)opts[bestIdx].distSq);
-
-        // Лог только для близких пар (чтобы не засорять)
-        if (opts[bestIdx].distSq <= maxDist2 * 4) {
-          std::cout << "[Link] i=" << i << " j=" << j << " iFront=(" << iFront.x
-                    << "," << iFront.y << ")"
-                    << " iBack=(" << iBack.x << "," << iBack.y << ")"
-                    << " jFront=(" << jFront.x << "," << jFront.y << ")"
-                    << " jBack=(" << jBack.x << "," << jBack.y << ")"
-                    << " dist=" << bestDist << " maxDist=" << (int)maxDist
-                    << std::endl;
-        }
-
-        if (opts[bestIdx].distSq > maxDist2) continue;
-
-        std::vector<CTracerPoint> lineI = lines[i];
-        std::vector<CTracerPoint> lineJ = lines[j];
-        if (opts[bestIdx].reverseI) std::reverse(lineI.begin(), lineI.end());
-        if (opts[bestIdx].reverseJ) std::reverse(lineJ.begin(), lineJ.end());
-
-        if (lineI.size() < 3 || lineJ.size() < 3) {
-          std::cout << "[Link]   rejected: too short" << std::endl;
-          continue;
-        }
-
-        int iTailDx = lineI.back().x - lineI[lineI.size() - 3].x;
-        int iTailDy = lineI.back().y - lineI[lineI.size() - 3].y;
-        int jHeadDx = lineJ[2].x - lineJ.front().x;
-        int jHeadDy = lineJ[2].y - lineJ.front().y;
-
-        float iLen = std::sqrt((float)(iTailDx * iTailDx + iTailDy * iTailDy));
-        float jLen = std::sqrt((float)(jHeadDx * jHeadDx + jHeadDy * jHeadDy));
-        if (iLen < 0.5f || jLen < 0.5f) {
-          std::cout << "[Link]   rejected: zero direction" << std::endl;
-          continue;
-        }
-
-        float cosAngle =
-            (iTailDx * jHeadDx + iTailDy * jHeadDy) / (iLen * jLen);
-        std::cout << "[Link]   cosAngle=" << cosAngle << std::endl;
-
-        // Линии параллельны (или антипараллельны) — это хорошо
-        if (std::abs(cosAngle) < 0.5f) {
-          std::cout << "[Link]   rejected: not parallel" << std::endl;
-          continue;
-        }
-
-        // Если антипараллельны — развернём lineJ перед склейкой
-        if (cosAngle < 0) {
-          std::reverse(lineJ.begin(), lineJ.end());
-          std::cout << "[Link]   J reversed (was antiparallel)" << std::endl;
-        }
-
-        std::cout << "[Link]   *** MERGING " << i << " + " << j << " ***"
-                  << std::endl;
-
-        std::vector<CTracerPoint> combined;
-        combined.reserve(lineI.size() + lineJ.size());
-        combined.insert(combined.end(), lineI.begin(), lineI.end());
-        combined.insert(combined.end(), lineJ.begin(), lineJ.end());
-
-        lines[i] = std::move(combined);
-        lines.erase(lines.begin() + j);
-        merged = true;
-      }
-    }
-  }
-
-  std::cout << "[Link] done, lines now: " << lines.size() << std::endl;
-}
-
 }  // namespace Interferometry
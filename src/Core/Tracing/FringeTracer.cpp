@@ -19,8 +19,10 @@
 
 #include <..\..\external\opencv\opencv2\opencv.hpp>
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
 #include <cmath>
+#include <thread>
 
 #include "..\..\include\Core\Tracing\EllipseBoundary.h"
 #include "Types.h"
@@ -40,12 +42,7 @@ CFringeTracer::CFringeTracer()
       m_width(0),
       m_height(0),
       m_stride(0),
-      m_boundary(nullptr),
-      m_curWidth(0),
-      m_curAverage(0),
-      m_curDirection(0),
-      m_wideLine(0),
-      m_average(0) {}
+      m_boundary(nullptr) {}
 
 CFringeTracer::~CFringeTracer() {}
 
@@ -97,21 +94,78 @@ bool CFringeTracer::Initialize(const cv::Mat& image,
   m_boundary = &boundary;
   m_lastError.clear();
 
+  // Маска границ — только если она покрывает кадр целиком;
+  // иначе IsInside() идёт медленным путём через CEllipseBoundary.
+  SetInsideMask(boundary.GetInsideMask(), boundary.GetImageWidth(),
+                boundary.GetImageHeight(), boundary.GetInsideMaskStride());
+
+  if (m_params.useIntegralImage)
+    BuildIntegralImage();
+  else
+    m_integral.clear();
+
   return true;
 }
 
+/**
+ * @details
+ * Каждая стартовая точка трассируется со своим CTraceContext, поэтому
+ * линии независимы и раздаются потокам через общий атомарный счётчик.
+ * Результат складывается в слот по индексу seed и затем уплотняется
+ * в исходном порядке — выход совпадает с последовательным проходом
+ * точка в точку при любом числе потоков.
+ *
+ * Число потоков — CTracerParams::numThreads (0 = по числу ядер).
+ */
 std::vector<std::vector<CTracerPoint>> CFringeTracer::Extract(
     const std::vector<CSeedPoint>& seeds) {
   std::vector<std::vector<CTracerPoint>> result;
-  result.reserve(seeds.size());
-
-  for (const auto& seed : seeds) {
-    std::vector<CTracerPoint> line;
-    if (TraceLine(seed.x, seed.y, line) && line.size() >= 2) {
-      result.push_back(std::move(line));
+  m_stats.Reset();
+  if (!m_image) {
+    m_lastError = "Tracer not initialized. Call Initialize() first.";
+    return result;
+  }
+  m_lastError.clear();
+  INTERF_TIMED_SCOPE(m_stats, Trace);
+
+  const int numSeeds = (int)seeds.size();
+  std::vector<std::vector<CTracerPoint>> slots(numSeeds);
+
+  int numThreads = m_params.numThreads;
+  if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+  if (numThreads <= 0) numThreads = 1;
+  if (numThreads > numSeeds) numThreads = numSeeds;
+
+  std::atomic<int> next(0);
+  std::atomic<int64_t> totalSteps(0);
+  auto worker = [&]() {
+    CTraceContext ctx;
+    for (int i = next++; i < numSeeds; i = next++) {
+      std::vector<CTracerPoint> line;
+      if (TraceLine(ctx, seeds[i].x, seeds[i].y, line) && line.size() >= 2)
+        slots[i] = std::move(line);
     }
+    totalSteps += ctx.numSteps;
+  };
+
+  if (numThreads <= 1) {
+    worker();
+  } else {
+    std::vector<std::thread> pool;
+    pool.reserve(numThreads - 1);
+    for (int t = 1; t < numThreads; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& th : pool) th.join();
   }
 
+  result.reserve(numSeeds);
+  for (auto& line : slots)
+    if (!line.empty()) result.push_back(std::move(line));
+
+  INTERF_COUNT(m_stats, TraceSeeds, numSeeds);
+  INTERF_COUNT(m_stats, TraceSteps, totalSteps.load());
+  INTERF_COUNT_LINES(m_stats, result);
+
   return result;
 }
 
@@ -158,17 +212,69 @@ void CFringeTracer::SetImage(const uint8_t* imageData, int width, int height,
   m_width = width;
   m_height = height;
   m_stride = strideBytes;
+  m_mask = nullptr;  // маска от прежнего Initialize() к новому кадру не относится
+  m_maskStride = 0;
+  m_integral.clear();
 }
 
 void CFringeTracer::SetParams(const CTracerParams& params) {
   m_params = params;
 }
 
+/**
+ * @details
+ * Маска должна совпадать по размеру с изображением и иметь рамку
+ * в 1 пиксель (см. CEllipseBoundary::MASK_PAD) — AverageIntensity()
+ * читает соседей без проверок. При несовпадении размеров маска
+ * не используется.
+ */
+void CFringeTracer::SetInsideMask(const uint8_t* mask, int width, int height,
+                                  int strideBytes) {
+  if (mask && width == m_width && height == m_height) {
+    m_mask = mask;
+    m_maskStride = strideBytes;
+  } else {
+    m_mask = nullptr;
+    m_maskStride = 0;
+  }
+}
+
+/**
+ * @details
+ * Один проход по кадру: узел (x+1, y+1) хранит сумму яркостей и число
+ * пикселей рабочей области в прямоугольнике [0..x] × [0..y]. Пиксель
+ * входит, если IsInside() для него истинно — то есть учитывается та же
+ * маска, что и в поэлементном AverageIntensity().
+ *
+ * Память: 8 байт на пиксель. Строится один раз на Initialize(), поэтому
+ * после изменения границ трассировщик нужно переинициализировать.
+ */
+void CFringeTracer::BuildIntegralImage() {
+  m_integralStride = 2 * (m_width + 1);
+  m_integral.assign((size_t)m_integralStride * (m_height + 1), 0);
+
+  for (int y = 0; y < m_height; y++) {
+    const uint8_t* src = m_image + (size_t)y * m_stride;
+    const uint32_t* above = &m_integral[(size_t)y * m_integralStride];
+    uint32_t* cur = &m_integral[(size_t)(y + 1) * m_integralStride];
+
+    uint32_t rowSum = 0, rowCount = 0;
+    for (int x = 0; x < m_width; x++) {
+      uint32_t in = IsInside(x, y) ? 1u : 0u;
+      rowSum += src[x] * in;
+      rowCount += in;
+      cur[2 * (x + 1)] = above[2 * (x + 1)] + rowSum;
+      cur[2 * (x + 1) + 1] = above[2 * (x + 1) + 1] + rowCount;
+    }
+  }
+}
+
 /**
  * @details
  * Двухуровневая проверка:
  * 1. Координаты в пределах изображения (0 <= x < width, 0 <= y < height)
- * 2. Если m_boundary != nullptr — делегирует CEllipseBoundary::IsInside()
+ * 2. Если есть маска границ — один байт из неё; иначе, если
+ *    m_boundary != nullptr — делегирует CEllipseBoundary::IsInside()
  *
  * Порт inside() из STEP.C:648-657:
  * @code
@@ -179,11 +285,16 @@ void CFringeTracer::SetParams(const CTracerParams& params) {
  * @endcode
  */
 bool CFringeTracer::IsInside(int x, int y) const {
-  // Базовая проверка границ изображения
-  if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+  // Базовая проверка границ изображения (беззнаковое сравнение ловит и x < 0)
+  if ((unsigned)x >= (unsigned)m_width || (unsigned)y >= (unsigned)m_height) {
     return false;
   }
 
+  // Предвычисленная маска — без ветвлений по RowBoundary
+  if (m_mask != nullptr) {
+    return m_mask[y * m_maskStride + x] != 0;
+  }
+
   // Если границы установлены - проверить и их
   if (m_boundary != nullptr) {
     return m_boundary->IsInside(x, y);
@@ -193,6 +304,15 @@ bool CFringeTracer::IsInside(int x, int y) const {
   return true;
 }
 
+/** @details Трассировка с временным контекстом; ошибка — в GetLastError(). */
+bool CFringeTracer::TraceLine(int startX, int startY,
+                              std::vector<CTracerPoint>& outPoints) {
+  CTraceContext ctx;
+  bool ok = TraceLine(ctx, startX, startY, outPoints);
+  m_lastError = ctx.lastError;
+  return ok;
+}
+
 /**
  * @details
  * Порт follow_line() из STEP.C:87-161.
@@ -214,47 +334,55 @@ bool CFringeTracer::IsInside(int x, int y) const {
  * Реверс: берём последние точки прямого хода, экстраполируем
  * начальное направление, и трассируем обратно.
  * Результат: reverse(обратный) + прямой.
+ *
+ * @par Потокобезопасность
+ * Всё изменяемое состояние follow_line живёт в ctx, трассировщик
+ * только читается — метод можно вызывать из нескольких потоков
+ * одновременно, каждый со своим контекстом. Контекст сбрасывается
+ * на входе, его можно переиспользовать между линиями.
  */
-bool CFringeTracer::TraceLine(int startX, int startY,
-                              std::vector<CTracerPoint>& outPoints) {
+bool CFringeTracer::TraceLine(CTraceContext& ctx, int startX, int startY,
+                              std::vector<CTracerPoint>& outPoints) const {
   outPoints.clear();
-  m_tempLine.clear();
-  m_lastError.clear();
+  ctx.tempLine.clear();
+  ctx.lastError.clear();
 
   // Инициализация параметров (аналог начала follow_line в STEP.C)
-  m_curWidth = (float)m_width / 6.0f;
-  m_wideLine = (float)m_width / 5.0f;
-  m_curAverage = 0;
-  m_average = 0;
+  ctx.curWidth = (float)m_width / 6.0f;
+  ctx.wideLine = (float)m_width / 5.0f;
+  ctx.curAverage = 0;
+  ctx.average = 0;
 
   // Проверка начальной точки
   if (!IsInside(startX, startY)) {
-    m_lastError = "Начальная точка за пределом границ";
+    ctx.lastError = "Начальная точка за пределом границ";
     return false;
   }
 
   // Определение первых двух точек
   CTracerPoint point1, point2;
-  if (!FirstStep(startX, startY, point1, point2)) {
-    m_lastError = "Ошибка определения начального положения";
+  if (!FirstStep(ctx, startX, startY, point1, point2)) {
+    ctx.lastError = "Ошибка определения начального положения";
     return false;
   }
 
   // Начинаем с первой найденной точки
-  m_tempLine.clear();
-  m_tempLine.push_back(point1);
-  m_tempLine.push_back(point2);
+  ctx.tempLine.clear();
+  ctx.tempLine.push_back(point1);
+  ctx.tempLine.push_back(point2);
 
   // Трассировка в прямом направлении
   int stop = 0, i = 1;
   while (i < m_params.maxSteps) {
-    stop = Step(m_tempLine);
+    stop = Step(ctx, ctx.tempLine);
+    ctx.numSteps++;
     if (stop != 0) break;
     i++;
   }
 
   if (stop == -10) {
-    outPoints = m_tempLine;
+    outPoints = ctx.tempLine;
+    RefineSubpixel(outPoints);
     return outPoints.size() >= 2;
   }
 
@@ -269,42 +397,44 @@ bool CFringeTracer::TraceLine(int startX, int startY,
   //   line[1] = pt[1]  (вторая — средняя)
   //   line[2] = pt[0]  (первая — самая верхняя)
   // Step() увидит направление pt[1]→pt[0] = вверх, и пойдёт вверх.
-  if (m_params.bidirectional && m_tempLine.size() >= 3) {
-    std::vector<CTracerPoint> forwardLine = m_tempLine;
-    m_tempLine.clear();
+  if (m_params.bidirectional && ctx.tempLine.size() >= 3) {
+    std::vector<CTracerPoint> forwardLine = ctx.tempLine;
+    ctx.tempLine.clear();
 
     // Первые 3 точки прямого хода в обратном порядке
-    m_tempLine.push_back(forwardLine[2]);
-    m_tempLine.push_back(forwardLine[1]);
-    m_tempLine.push_back(forwardLine[0]);
+    ctx.tempLine.push_back(forwardLine[2]);
+    ctx.tempLine.push_back(forwardLine[1]);
+    ctx.tempLine.push_back(forwardLine[0]);
 
     // Сбросить ширину к значениям из начала прямого хода
-    m_curWidth = forwardLine[0].width;
-    if (m_curWidth < 5.0f) m_curWidth = forwardLine[1].width;
-    if (m_curWidth < 5.0f) m_curWidth = (float)m_width / 6.0f;
-    m_wideLine = m_curWidth;
-    m_average = 0;
+    ctx.curWidth = forwardLine[0].width;
+    if (ctx.curWidth < 5.0f) ctx.curWidth = forwardLine[1].width;
+    if (ctx.curWidth < 5.0f) ctx.curWidth = (float)m_width / 6.0f;
+    ctx.wideLine = ctx.curWidth;
+    ctx.average = 0;
 
     i = 2;
     while (i < m_params.maxSteps) {
-      stop = Step(m_tempLine);
+      stop = Step(ctx, ctx.tempLine);
+      ctx.numSteps++;
       if (stop != 0) break;
       i++;
     }
 
     std::vector<CTracerPoint> reversePart;
-    if (m_tempLine.size() > 3) {
-      reversePart.assign(m_tempLine.begin() + 3, m_tempLine.end());
+    if (ctx.tempLine.size() > 3) {
+      reversePart.assign(ctx.tempLine.begin() + 3, ctx.tempLine.end());
       std::reverse(reversePart.begin(), reversePart.end());
     }
 
-    m_tempLine = reversePart;
+    ctx.tempLine = reversePart;
     for (const auto& p : forwardLine) {
-      m_tempLine.push_back(p);
+      ctx.tempLine.push_back(p);
     }
   }
 
-  outPoints = m_tempLine;
+  outPoints = ctx.tempLine;
+  RefineSubpixel(outPoints);
   return outPoints.size() >= 2;
 }
 
@@ -337,18 +467,19 @@ bool CFringeTracer::TraceLine(int startX, int startY,
  * 5. CenterPerpendicular() — центрирование второй точки
  *    (STEP.C:224-229, вызов max_perp)
  */
-bool CFringeTracer::FirstStep(int x, int y, CTracerPoint& point1,
-                              CTracerPoint& point2) {
+bool CFringeTracer::FirstStep(CTraceContext& ctx, int x, int y,
+                              CTracerPoint& point1,
+                              CTracerPoint& point2) const {
   // Измеряем ширину в начальной точек
   int direction;
-  if (!MeasureWidth(x, y, m_curWidth, direction)) {
+  if (!MeasureWidth(ctx, x, y, ctx.curWidth, direction)) {
     return false;
   }
 
-  if (m_curWidth < 5) m_curWidth = 5;
+  if (ctx.curWidth < 5) ctx.curWidth = 5;
 
-  m_curDirection = direction;
-  m_curAverage = AverageIntensity(x, y);
+  ctx.curDirection = direction;
+  ctx.curAverage = AverageIntensity(x, y);
 
   // Определяем вектор направления для поиска первого максимума
   int dx, dy;
@@ -358,39 +489,39 @@ bool CFringeTracer::FirstStep(int x, int y, CTracerPoint& point1,
   // Радиус поиска = half-width (не полная ширина!) — чтобы не уйти на соседнюю
   // полосу
   int xx = x, yy = y;
-  if (!FindMaxAlong(xx, yy, dx, dy, m_curWidth)) {
+  if (!FindMaxAlong(xx, yy, dx, dy, ctx.curWidth)) {
     return false;
   }
 
   // Уточняем ширину в точке максимум
-  if (!MeasureWidth(xx, yy, m_curWidth, direction)) {
+  if (!MeasureWidth(ctx, xx, yy, ctx.curWidth, direction)) {
     return false;
   }
-  if (m_curWidth < 5) m_curWidth = 5;
+  if (ctx.curWidth < 5) ctx.curWidth = 5;
 
   // Первая точка
   point1.x = xx;
   point1.y = yy;
-  point1.width = m_curWidth;
+  point1.width = ctx.curWidth;
   point1.intensity = AverageIntensity(xx, yy);
 
   // Ищем вторую точку перпендикулярно направлению
   int perpDx, perpDy;
   switch (direction) {
     case DIR_VERTICAL:
-      perpDx = (int)(m_curWidth + 0.5f);
+      perpDx = (int)(ctx.curWidth + 0.5f);
       perpDy = 0;
       break;
     case DIR_DIAGONAL_45:
-      perpDx = (int)(0.707f * m_curWidth + 0.5f);
+      perpDx = (int)(0.707f * ctx.curWidth + 0.5f);
       perpDy = -perpDx;
       break;
     case DIR_HORIZONTAL:
       perpDx = 0;
-      perpDy = (int)(m_curWidth + 0.5f);
+      perpDy = (int)(ctx.curWidth + 0.5f);
       break;
     case DIR_DIAGONAL_135:
-      perpDx = (int)(0.707f * m_curWidth + 0.5f);
+      perpDx = (int)(0.707f * ctx.curWidth + 0.5f);
       perpDy = perpDx;
       break;
   }
@@ -402,13 +533,13 @@ bool CFringeTracer::FirstStep(int x, int y, CTracerPoint& point1,
     return false;
   }
 
-  if (!CenterPerpendicular(xx, yy, perpDx, perpDy)) {
+  if (!CenterPerpendicular(ctx, xx, yy, perpDx, perpDy)) {
     return false;
   }
 
   point2.x = xx;
   point2.y = yy;
-  point2.width = m_curWidth;
+  point2.width = ctx.curWidth;
   point2.intensity = AverageIntensity(xx, yy);
 
   return true;
@@ -442,14 +573,15 @@ static int sgn(int v) { return (v > 0) - (v < 0); }
  * 10. **Замыкание** (370-376): если расстояние до старта < wide_line
  *     — return -10
  */
-int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
+int CFringeTracer::Step(CTraceContext& ctx,
+                        std::vector<CTracerPoint>& line) const {
   //=== соответсвует step(num_line, num_point) ===
   const float coeff_wide = 1.5f;
 
   int num_point = (int)line.size() - 1;
   if (num_point < 1) return -100;  // нужно минимум 2 точки
 
-  if (m_curWidth < 2.0f) {
+  if (ctx.curWidth < 2.0f) {
     return -3;  // "cur_wide < 2"
   }
 
@@ -462,7 +594,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
     std::cout << "Step n=" << num_point << " cur=(" << x << "," << y << ")"
               << " prev=(" << prevX << "," << prevY << ")"
               << " dir=(" << (x - prevX) << "," << (y - prevY) << ")"
-              << " width=" << m_curWidth << std::endl;
+              << " width=" << ctx.curWidth << std::endl;
   });
 
   // Ранняя остановка: если интенсивность в текущей точке значительно
@@ -476,36 +608,36 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
 
   // Если текущая точка ниже порога "дна" — мы соскочили с полосы
   // (например, дошли до тёмной зоны у края эллипса). Стоп.
-  // Сравниваем со СТАРЫМ m_average (до перерасчёта в MeasureWidth) —
+  // Сравниваем со СТАРЫМ ctx.average (до перерасчёта в MeasureWidth) —
   // это «настоящий» порог полосы, а новый может быть искажён.
-  if (m_average > 0 && AverageIntensity(x, y) < m_average) {
+  if (ctx.average > 0 && AverageIntensity(x, y) < ctx.average) {
     return -5;
   }
 
   // wide(x,y) -> обновляет wide_line, average, direct
   int dir = 0;
   float measureWidth = 0.0f;
-  if (!MeasureWidth(x, y, measureWidth, dir)) return -3;
+  if (!MeasureWidth(ctx, x, y, measureWidth, dir)) return -3;
 
   // Сохраняем направление (direct) — оно нужно для CenterPerpendicular
-  m_curDirection = dir;
+  ctx.curDirection = dir;
 
-  m_wideLine = measureWidth;
-  if (m_wideLine < 5.0f) m_wideLine = 5.0f;
-  if (m_wideLine > 80.0f) m_wideLine = 80.0f;
+  ctx.wideLine = measureWidth;
+  if (ctx.wideLine < 5.0f) ctx.wideLine = 5.0f;
+  if (ctx.wideLine > 80.0f) ctx.wideLine = 80.0f;
 
   // Стабилизация изменения ширины (cur_wide и wide_line)
   // Ширина не может измениться более чем в coeff_wide раз за шаг
-  if (m_curWidth / m_wideLine > coeff_wide)
-    m_wideLine = m_curWidth / coeff_wide;
-  else if (m_wideLine / m_curWidth > coeff_wide)
-    m_wideLine = m_curWidth * coeff_wide;
+  if (ctx.curWidth / ctx.wideLine > coeff_wide)
+    ctx.wideLine = ctx.curWidth / coeff_wide;
+  else if (ctx.wideLine / ctx.curWidth > coeff_wide)
+    ctx.wideLine = ctx.curWidth * coeff_wide;
 
   // Дополнительное ограничение: ширина не может быть больше
   // удвоенной начальной ширины (предотвращает «взрыв» у края)
-  if (m_wideLine > 80.0f) m_wideLine = 80.0f;
+  if (ctx.wideLine > 80.0f) ctx.wideLine = 80.0f;
 
-  m_curWidth = m_wideLine;
+  ctx.curWidth = ctx.wideLine;
 
   // dx/dy по двум последним точкам (как в STEP.C)
   int dx = x - line[num_point - 1].x;
@@ -526,18 +658,18 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
   float fdy = (float)dy;
   float sqr_wide = std::sqrt(fdx * fdx + fdy * fdy);
 
-  if (m_wideLine <= 5.0f) {
-    fdx = fdx * m_wideLine / sqr_wide;
-    fdy = fdy * m_wideLine / sqr_wide;
-  } else if (m_wideLine <= 10.0f) {
-    fdx = 0.8f * fdx * m_wideLine / sqr_wide;
-    fdy = 0.8f * fdy * m_wideLine / sqr_wide;
-  } else if (m_wideLine <= 20.0f) {
-    fdx = 0.6f * fdx * m_wideLine / sqr_wide;
-    fdy = 0.6f * fdy * m_wideLine / sqr_wide;
+  if (ctx.wideLine <= 5.0f) {
+    fdx = fdx * ctx.wideLine / sqr_wide;
+    fdy = fdy * ctx.wideLine / sqr_wide;
+  } else if (ctx.wideLine <= 10.0f) {
+    fdx = 0.8f * fdx * ctx.wideLine / sqr_wide;
+    fdy = 0.8f * fdy * ctx.wideLine / sqr_wide;
+  } else if (ctx.wideLine <= 20.0f) {
+    fdx = 0.6f * fdx * ctx.wideLine / sqr_wide;
+    fdy = 0.6f * fdy * ctx.wideLine / sqr_wide;
   } else {
-    fdx = 0.4f * fdx * m_wideLine / sqr_wide;
-    fdy = 0.4f * fdy * m_wideLine / sqr_wide;
+    fdx = 0.4f * fdx * ctx.wideLine / sqr_wide;
+    fdy = 0.4f * fdy * ctx.wideLine / sqr_wide;
   }
 
   // округление как в STEP.C (ceil/floor с -0.5/+0.5)
@@ -556,7 +688,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
     LinStepToBoundary(x, y, predX, predY, boundX, boundY);
 
     CTracerPoint p(boundX, boundY);
-    p.width = m_curWidth;
+    p.width = ctx.curWidth;
     p.intensity = AverageIntensity(boundX, boundY);
     line.push_back(p);
     return -1;
@@ -569,9 +701,9 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
 
   int cx = predX;
   int cy = predY;
-  if (!CenterPerpendicular(cx, cy, ndx, ndy)) {
+  if (!CenterPerpendicular(ctx, cx, cy, ndx, ndy)) {
     CTracerPoint p(predX, predY);
-    p.width = m_curWidth;
+    p.width = ctx.curWidth;
     p.intensity = AverageIntensity(predX, predY);
     line.push_back(p);
     return -2;
@@ -582,7 +714,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
   // {
   //   float shiftDist = std::sqrt((float)(cx - predX) * (cx - predX) +
   //                               (float)(cy - predY) * (cy - predY));
-  //   if (shiftDist > m_wideLine * 0.5f)
+  //   if (shiftDist > ctx.wideLine * 0.5f)
   //   {
   //     cx = predX;
   //     cy = predY;
@@ -590,7 +722,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
   // }
 
   // блок "if(wide_line > 20) { ... }" (повторный max_perp) как в STEP.C
-  // if (m_wideLine > 20.0f)
+  // if (ctx.wideLine > 20.0f)
   // {
   //   int ddx2 = cx - predX;
   //   int ddy2 = cy - predY;
@@ -601,7 +733,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
   //   if (!CenterPerpendicular(cx2, cy2, ndx2, ndy2))
   //   {
   //     CTracerPoint p(cx, cy);
-  //     p.width = m_curWidth;
+  //     p.width = ctx.curWidth;
   //     p.intensity = AverageIntensity(cx, cy);
   //     line.push_back(p);
   //     return -2;
@@ -612,7 +744,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
 
   // записать новую точку (как curve_line[..][2*num_point+2] = x; ...)
   CTracerPoint np(cx, cy);
-  np.width = m_curWidth;
+  np.width = ctx.curWidth;
   np.intensity = AverageIntensity(cx, cy);
   line.push_back(np);
 
@@ -622,7 +754,7 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
         line.front();  // аналог curve_line[2], [3] — точка старта направления
     float dx0 = (float)(cx - ref.x);
     float dy0 = (float)(cy - ref.y);
-    if (std::sqrt(dx0 * dx0 + dy0 * dy0) < m_wideLine) {
+    if (std::sqrt(dx0 * dx0 + dy0 * dy0) < ctx.wideLine) {
       return -10;
     }
   }
@@ -651,22 +783,22 @@ int CFringeTracer::Step(std::vector<CTracerPoint>& line) {
  *     else:         k++; min_aver = ss // начали расти — зафиксировали дно
  * @endcode
  *
- * После 4 направлений m_average = последнее min_aver.
+ * После 4 направлений ctx.average = последнее min_aver.
  *
  * @par Фаза 2 — ширина (STEP.C:606-643)
  *
  * Для каждого направления: считаем пиксели от центра наружу,
- * пока AverageIntensity > m_average. Минимальная из 4 ширин —
+ * пока AverageIntensity > ctx.average. Минимальная из 4 ширин —
  * поперечное сечение полосы.
  *
  * @par Побочные эффекты
  *
- * - m_average  ← порог «дна» между полосами
- * - m_curAverage ← средняя яркость в точке (x, y)
- * - m_wideLine ← измеренная ширина
+ * - ctx.average  ← порог «дна» между полосами
+ * - ctx.curAverage ← средняя яркость в точке (x, y)
+ * - ctx.wideLine ← измеренная ширина
  */
-bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
-                                 int& outDirection) {
+bool CFringeTracer::MeasureWidth(CTraceContext& ctx, int x, int y,
+                                 float& outWidth, int& outDirection) const {
   const float coef_aver = 1.5f;
   const int d[4][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}};
 
@@ -678,8 +810,8 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
   // в итоге берётся значение от последнего направления {1,-1}.
   // Так работает оригинал.
   // ================================================================
-  float min_aver = m_average / coef_aver;
-  float max_wide = m_wideLine * 1.41f;
+  float min_aver = ctx.average / coef_aver;
+  float max_wide = ctx.wideLine * 1.41f;
   int step = 3;
 
   for (int i = 0; i < 4; i++) {
@@ -727,7 +859,7 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
       }
     }
 
-    m_average = min_aver;  // перезаписываем — как в оригинале
+    ctx.average = min_aver;  // перезаписываем — как в оригинале
   }
 
   // ================================================================
@@ -748,7 +880,7 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
 
     // Вперёд — точно как оригинал: ii < min_wide
     while (IsInside(x + ddx, y + ddy) &&
-           AverageIntensity(x + ddx, y + ddy) > m_average && ii < min_wide) {
+           AverageIntensity(x + ddx, y + ddy) > ctx.average && ii < min_wide) {
       ii += (j == 1 || j == 3) ? 1.42f : 1.0f;
       ddx += dx;
       ddy += dy;
@@ -758,7 +890,7 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
     ddx = dx;
     ddy = dy;
     while (IsInside(x - ddx, y - ddy) &&
-           AverageIntensity(x - ddx, y - ddy) > m_average &&
+           AverageIntensity(x - ddx, y - ddy) > ctx.average &&
            ii <= min_wide + 3)  // оригинал: ii <= min_wide+3 только назад
     {
       ii += (j == 1 || j == 3) ? 1.42f : 1.0f;
@@ -776,13 +908,13 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
 
   // ВРЕМЕННО: логируем реальное значение до зажима
   DBG(std::cout << "    MeasureWidth(" << x << "," << y << ")"
-                << " raw=" << min_wide << " average=" << m_average
+                << " raw=" << min_wide << " average=" << ctx.average
                 << " direction=" << outDirection << std::endl;);
 
   outWidth = min_wide;
   outDirection = bestDirection;
-  m_curAverage = AverageIntensity(x, y);
-  m_wideLine = min_wide;
+  ctx.curAverage = AverageIntensity(x, y);
+  ctx.wideLine = min_wide;
 
   return true;
 
@@ -818,7 +950,7 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
 
   //   float ss = s / (float)n;
   //   int r = 1, k = 0;
-  //   float maxWide = m_wideLine * 1.41f;
+  //   float maxWide = ctx.wideLine * 1.41f;
   //   int step = 3;
 
   //   while ((k < step && r < m_width / 6) || r < (int)maxWide)
@@ -852,7 +984,7 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
   //     }
   //   }
 
-  //   m_average = minAverage;
+  //   ctx.average = minAverage;
   // }
 
   // // Фаза 2: определение ширины — ищем минимальную ширину по 4 направлениям
@@ -911,8 +1043,8 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
 
   // outWidth = minWidth;
   // outDirection = bestDirection;
-  // m_curAverage = AverageIntensity(x, y);
-  // m_wideLine = minWidth;
+  // ctx.curAverage = AverageIntensity(x, y);
+  // ctx.wideLine = minWidth;
 
   // return true;
 }
@@ -932,7 +1064,7 @@ bool CFringeTracer::MeasureWidth(int x, int y, float& outWidth,
  * @endcode
  */
 bool CFringeTracer::FindMaxAlong(int& x, int& y, int dx, int dy,
-                                 float searchDist) {
+                                 float searchDist) const {
   // Ограничение: ищем только в пределах half-width от стартовой точки
   // Это предотвращает перескок на соседнюю полосу
   int halfSteps = (int)(searchDist / 2.0f + 0.5f);
@@ -1047,9 +1179,9 @@ void CFringeTracer::LinStepToBoundary(int x1, int y1, int x2, int y2, int& outX,
  *
  * @par Фаза 1 — «ловля» полосы (STEP.C:424-458)
  *
- * Если предсказанная точка (x+dx, y+dy) ниже порога m_average:
+ * Если предсказанная точка (x+dx, y+dy) ниже порога ctx.average:
  * - Сканируем перпендикулярно (±perpDx, ±perpDy) до wide_line/2
- * - Найдя точку >= m_average, пересчитываем направление
+ * - Найдя точку >= ctx.average, пересчитываем направление
  * - Повторяем (максимум 3 попытки — замена goto again)
  *
  * @par Фаза 2 — точное центрирование (STEP.C:462-494)
@@ -1061,13 +1193,14 @@ void CFringeTracer::LinStepToBoundary(int x1, int y1, int x2, int y2, int& outX,
  * @endcode
  *
  * Ключевое отличие от старой реализации: поиск **ограничен**
- * порогом m_average. Без этого ограничения трассировка
+ * порогом ctx.average. Без этого ограничения трассировка
  * дрейфует с полосы на соседнюю.
  */
-bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
+bool CFringeTracer::CenterPerpendicular(const CTraceContext& ctx, int& x,
+                                        int& y, int dx, int dy) const {
   DBG(std::cout << "    CP enter pred=(" << x << "," << y << ")"
                 << " dir=(" << dx << "," << dy << ")"
-                << " avg=" << m_average << " width=" << m_wideLine
+                << " avg=" << ctx.average << " width=" << ctx.wideLine
                 << std::endl;);
 
   // Нормализация направления движения до единичного вектора
@@ -1093,16 +1226,16 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
   // ВАЖНО: каждая кандидатная точка проверяется через IsInside —
   // нельзя «ловить» полосу за границей эллипса.
   int maxRetries = 3;
-  while (AverageIntensity(xx, yy) < m_average && maxRetries-- > 0) {
+  while (AverageIntensity(xx, yy) < ctx.average && maxRetries-- > 0) {
     bool found = false;
-    int halfWidth = (int)(m_wideLine / 3.0f);
+    int halfWidth = (int)(ctx.wideLine / 3.0f);
 
     for (int i = 1; i <= halfWidth; i++) {
       // Положительное перпендикулярное направление
       int testPlusX = xx + perpDx * i;
       int testPlusY = yy + perpDy * i;
       if (IsInside(testPlusX, testPlusY) &&
-          AverageIntensity(testPlusX, testPlusY) >= m_average) {
+          AverageIntensity(testPlusX, testPlusY) >= ctx.average) {
         xx = testPlusX;
         yy = testPlusY;
         // Пересчитать направление от исходной точки (как goto again)
@@ -1120,7 +1253,7 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
       int testMinusX = xx - perpDx * i;
       int testMinusY = yy - perpDy * i;
       if (IsInside(testMinusX, testMinusY) &&
-          AverageIntensity(testMinusX, testMinusY) >= m_average) {
+          AverageIntensity(testMinusX, testMinusY) >= ctx.average) {
         xx = testMinusX;
         yy = testMinusY;
         dx = xx - x;
@@ -1142,7 +1275,7 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
   float maxIntensity = AverageIntensity(xx, yy);
   int maxX = xx, maxY = yy;
 
-  int halfWidth = (int)(m_wideLine / 2.0f);
+  int halfWidth = (int)(ctx.wideLine / 2.0f);
 
   // Положительное направление — идём пока >= average
   for (int i = 1; i < halfWidth; i++) {
@@ -1153,7 +1286,7 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
       break;  // у границы — просто заканчиваем поиск, точка остаётся валидной
 
     float intensity = AverageIntensity(testX, testY);
-    if (intensity < m_average) break;
+    if (intensity < ctx.average) break;
 
     if (intensity > maxIntensity) {
       maxIntensity = intensity;
@@ -1170,7 +1303,7 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
     if (!IsInside(testX, testY)) break;
 
     float intensity = AverageIntensity(testX, testY);
-    if (intensity < m_average) break;
+    if (intensity < ctx.average) break;
 
     if (intensity > maxIntensity) {
       maxIntensity = intensity;
@@ -1186,6 +1319,95 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
 
   return true;
 }
+
+/**
+ * @details
+ * Целочисленный центр из CenterPerpendicular() — максимум яркости с шагом
+ * в пиксель; ошибка квантования до ±0.5 пикселя заставляет аппроксимацию
+ * брать лишние степени. Здесь центр уточняется вдоль нормали к линии
+ * (по соседним точкам), профиль — AverageIntensityAt():
+ *
+ * - Parabolic: отсчёты I(-h), I(0), I(+h), h ≈ ширина/4, вершина
+ *   @code
+ *     t = h * (I(-h) - I(+h)) / (2 * (I(-h) - 2*I(0) + I(+h)))
+ *   @endcode
+ *   Для косинусного профиля оценка несмещённая в первом порядке по t.
+ * - Centroid: центр тяжести I(t) - min I на t ∈ [-ширина/2, ширина/2].
+ *
+ * Точка остаётся целой, если окно выходит за границу области или (для
+ * параболы) центр не вершина профиля. Сдвиг t укорачивается вдоль нормали
+ * так, чтобы по каждой оси он не превышал 0.5: направление сохраняется,
+ * (x, y) не меняются — уточнение только в offsetX/offsetY.
+ */
+void CFringeTracer::RefineSubpixel(std::vector<CTracerPoint>& line) const {
+  if (m_params.subpixel == ESubpixelMode::None || line.size() < 2) return;
+
+  // Все четыре пикселя билинейного отсчёта внутри области
+  auto insideAt = [this](float sx, float sy) {
+    int x0 = (int)std::floor(sx), y0 = (int)std::floor(sy);
+    return IsInside(x0, y0) && IsInside(x0 + 1, y0) &&
+           IsInside(x0, y0 + 1) && IsInside(x0 + 1, y0 + 1);
+  };
+
+  const int n = (int)line.size();
+  for (int i = 0; i < n; i++) {
+    CTracerPoint& p = line[i];
+
+    // Нормаль к линии по соседним точкам (целые позиции не меняются)
+    const CTracerPoint& a = line[(std::max)(i - 1, 0)];
+    const CTracerPoint& b = line[(std::min)(i + 1, n - 1)];
+    float tx = (float)(b.x - a.x);
+    float ty = (float)(b.y - a.y);
+    float len = std::sqrt(tx * tx + ty * ty);
+    if (len < 1.0f) continue;
+    const float nx = -ty / len;
+    const float ny = tx / len;
+
+    float t = 0.0f;
+    if (m_params.subpixel == ESubpixelMode::Parabolic) {
+      float h = (std::max)(1.0f, std::floor(p.width / 4.0f + 0.5f));
+      float mx = p.x - h * nx, my = p.y - h * ny;
+      float px = p.x + h * nx, py = p.y + h * ny;
+      if (!insideAt(mx, my) || !insideAt(px, py)) continue;
+
+      float i0 = AverageIntensity(p.x, p.y);
+      float im = AverageIntensityAt(mx, my);
+      float ip = AverageIntensityAt(px, py);
+      float denom = im - 2.0f * i0 + ip;
+      if (denom >= 0.0f || i0 < im || i0 < ip) continue;
+      t = 0.5f * h * (im - ip) / denom;
+    } else {
+      int r = (std::max)(1, (int)(p.width / 2.0f));
+      float profile[2 * 80 + 1];  // ширина ограничена 80 в Step()
+      r = (std::min)(r, 80);
+      bool inside = true;
+      float minI = 255.0f;
+      for (int k = -r; k <= r && inside; k++) {
+        float sx = p.x + k * nx, sy = p.y + k * ny;
+        inside = insideAt(sx, sy);
+        profile[k + r] = inside ? AverageIntensityAt(sx, sy) : 0.0f;
+        minI = (std::min)(minI, profile[k + r]);
+      }
+      if (!inside) continue;
+
+      float sumW = 0.0f, sumT = 0.0f;
+      for (int k = -r; k <= r; k++) {
+        float w = profile[k + r] - minI;
+        sumW += w;
+        sumT += w * k;
+      }
+      if (sumW <= 0.0f) continue;
+      t = sumT / sumW;
+    }
+
+    // Сдвиг укорачивается вдоль нормали, а не обрезается по осям —
+    // иначе при большом t уточнённая точка уходит с нормали
+    float tMax = 0.5f / (std::max)(std::fabs(nx), std::fabs(ny));
+    t = (std::max)(-tMax, (std::min)(tMax, t));
+    p.offsetX = t * nx;
+    p.offsetY = t * ny;
+  }
+}
 /// @}
 
 //=========================================================================
@@ -1212,10 +1434,44 @@ bool CFringeTracer::CenterPerpendicular(int& x, int& y, int dx, int dy) {
  * На границе области возвращает среднее по доступным соседям
  * (от 1 до 9 пикселей). Это обеспечивает корректную работу
  * алгоритма вблизи границ эллипса.
+ *
+ * При наличии маски внутренние пиксели кадра считаются без ветвлений:
+ * байт маски 0xFF/0 даёт вес 1/0. Сумма целочисленная — результат
+ * совпадает с поэлементным float-сложением (сумма < 2^24).
  */
 float CFringeTracer::AverageIntensity(int x, int y) const {
   if (!IsInside(x, y)) return 0;
 
+  // O(1): окно 3×3, обрезанное кадром, из интегрального изображения.
+  // Центр внутри области, поэтому count >= 1, а сумма и число пикселей
+  // совпадают с поэлементным проходом ниже.
+  if (!m_integral.empty()) {
+    int x0 = (std::max)(x - 1, 0), x1 = (std::min)(x + 2, m_width);
+    int y0 = (std::max)(y - 1, 0), y1 = (std::min)(y + 2, m_height);
+    const uint32_t* top = &m_integral[(size_t)y0 * m_integralStride];
+    const uint32_t* bot = &m_integral[(size_t)y1 * m_integralStride];
+    uint32_t sum = bot[2 * x1] - bot[2 * x0] - top[2 * x1] + top[2 * x0];
+    uint32_t count = bot[2 * x1 + 1] - bot[2 * x0 + 1] - top[2 * x1 + 1] +
+                     top[2 * x0 + 1];
+    return (float)sum / (float)count;
+  }
+
+  if (m_mask && x > 0 && y > 0 && x < m_width - 1 && y < m_height - 1) {
+    const uint8_t* p = m_image + y * m_stride + x;
+    const uint8_t* m = m_mask + y * m_maskStride + x;
+    const int ps = m_stride, ms = m_maskStride;
+
+    int k0 = m[-ms - 1] >> 7, k1 = m[-ms] >> 7, k2 = m[-ms + 1] >> 7;
+    int k3 = m[-1] >> 7, k4 = m[1] >> 7;
+    int k5 = m[ms - 1] >> 7, k6 = m[ms] >> 7, k7 = m[ms + 1] >> 7;
+
+    int sum = p[0] + k0 * p[-ps - 1] + k1 * p[-ps] + k2 * p[-ps + 1] +
+              k3 * p[-1] + k4 * p[1] + k5 * p[ps - 1] + k6 * p[ps] +
+              k7 * p[ps + 1];
+    int count = 1 + k0 + k1 + k2 + k3 + k4 + k5 + k6 + k7;
+    return (float)sum / (float)count;
+  }
+
   // 8-связная окрестность
   static const int neighbors[8][2] = {{0, 1},  {0, -1}, {1, 0},  {1, 1},
                                       {1, -1}, {-1, 0}, {-1, 1}, {-1, -1}};
@@ -1235,6 +1491,20 @@ float CFringeTracer::AverageIntensity(int x, int y) const {
 
   return sum / (float)count;
 }
+
+/** @details Билинейная интерполяция AverageIntensity() четырёх соседей. */
+float CFringeTracer::AverageIntensityAt(float x, float y) const {
+  int x0 = (int)std::floor(x);
+  int y0 = (int)std::floor(y);
+  float ax = x - (float)x0;
+  float ay = y - (float)y0;
+
+  float top = (1.0f - ax) * AverageIntensity(x0, y0) +
+              ax * AverageIntensity(x0 + 1, y0);
+  float bottom = (1.0f - ax) * AverageIntensity(x0, y0 + 1) +
+                 ax * AverageIntensity(x0 + 1, y0 + 1);
+  return (1.0f - ay) * top + ay * bottom;
+}
 //=============================================================================
 // Преобразование направления в вектор
 //=============================================================================
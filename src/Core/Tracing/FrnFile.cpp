@@ -0,0 +1,505 @@
+/**
+ * @file FrnFile.cpp
+ * @brief Разбор и запись .frn: построчный автомат по секциям над буфером
+ *        блока, числа через std::from_chars / std::to_chars.
+ */
+#include "FrnFile.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace Interferometry {
+
+namespace {
+
+const size_t kChunkSize = 1 << 20;  // блок чтения и буфер записи
+
+bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+void Trim(const char*& begin, const char*& end) {
+  while (begin < end && IsSpace(*begin)) begin++;
+  while (end > begin && IsSpace(end[-1])) end--;
+}
+
+bool Equals(const char* begin, const char* end, const char* word) {
+  size_t n = std::strlen(word);
+  return (size_t)(end - begin) == n && std::memcmp(begin, word, n) == 0;
+}
+
+bool StartsWith(const char* begin, const char* end, const char* prefix) {
+  size_t n = std::strlen(prefix);
+  return (size_t)(end - begin) >= n && std::memcmp(begin, prefix, n) == 0;
+}
+
+// Число с позиции p (пробелы перед ним пропускаются); p — за числом
+bool ParseNumber(const char*& p, const char* end, double& value) {
+  while (p < end && IsSpace(*p)) p++;
+  if (p < end && *p == '+') p++;
+  auto r = std::from_chars(p, end, value);
+  if (r.ec != std::errc()) return false;
+  p = r.ptr;
+  return true;
+}
+
+/**
+ * @brief Числа строки до конца или до терминатора E.
+ * @return false — в строке не число и не E
+ */
+bool ParseNumbers(const char* p, const char* end, std::vector<double>& out) {
+  out.clear();
+  for (;;) {
+    while (p < end && IsSpace(*p)) p++;
+    if (p == end) return true;
+    if (*p == 'E' && (p + 1 == end || IsSpace(p[1]))) return true;
+    double v;
+    if (!ParseNumber(p, end, v)) return false;
+    out.push_back(v);
+  }
+}
+
+int RoundToInt(double v) { return (int)std::lround(v); }
+
+//=============================================================================
+// Буфер записи
+//=============================================================================
+
+class CFrnSink {
+ public:
+  explicit CFrnSink(std::ofstream* file) : m_file(file) {
+    m_buf.reserve(file ? kChunkSize + 256 : 0);
+  }
+
+  void Put(const char* s) { m_buf.append(s); }
+  void Put(const std::string& s) { m_buf.append(s); }
+  void Put(char c) { m_buf.push_back(c); }
+
+  void Put(double v, int precision) {
+    // Целые (пиксельные координаты) — без общего пути to_chars с точностью
+    if (v == std::trunc(v) && std::abs(v) < 1e9) {
+      Put((int)v);
+      m_buf.push_back('.');
+      m_buf.append((size_t)precision, '0');
+      return;
+    }
+    char tmp[64];
+    auto r = std::to_chars(tmp, tmp + sizeof(tmp), v,
+                           std::chars_format::fixed, precision);
+    m_buf.append(tmp, r.ptr);
+  }
+
+  void Put(int v) {
+    char tmp[16];
+    auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    m_buf.append(tmp, r.ptr);
+  }
+
+  // Конец строки; при заполнении буфер уходит в файл
+  void EndLine() {
+    m_buf.push_back('\n');
+    if (m_file && m_buf.size() >= kChunkSize) Flush();
+  }
+
+  void Flush() {
+    if (!m_file) return;
+    m_file->write(m_buf.data(), (std::streamsize)m_buf.size());
+    m_buf.clear();
+  }
+
+  std::string& Text() { return m_buf; }
+
+ private:
+  std::ofstream* m_file;
+  std::string m_buf;
+};
+
+void FormatFrn(const CFrnData& data, CFrnSink& out) {
+  out.Put("[GENERAL]");
+  out.EndLine();
+  if (data.general.empty()) {
+    out.Put("ScaleFactor=1.000");
+    out.EndLine();
+    out.Put("FiScan=0.00");
+    out.EndLine();
+  }
+  for (const auto& kv : data.general) {
+    out.Put(kv.first);
+    out.Put('=');
+    out.Put(kv.second);
+    out.EndLine();
+  }
+  out.EndLine();
+
+  out.Put("[ELLIPSES]");
+  out.EndLine();
+  for (const CFrnEllipse& e : data.ellipses) {
+    for (double v : {e.centerX, e.centerY, e.semiAxisA, e.semiAxisB}) {
+      out.Put(' ');
+      out.Put(v, 3);
+    }
+    out.Put(' ');
+    out.Put(e.angle, 2);
+    out.Put(' ');
+    out.Put(e.type);
+    out.Put(' ');
+    out.Put(e.flags);
+    out.Put(" E");
+    out.EndLine();
+  }
+  if (data.ellipses.empty()) {
+    out.Put("END");
+    out.EndLine();
+  }
+  out.EndLine();
+
+  out.Put("[BOUNDS]");
+  out.EndLine();
+  for (const auto& rec : data.bounds) {
+    for (double v : rec) {
+      out.Put(' ');
+      out.Put(v, 3);
+    }
+    out.Put(" E");
+    out.EndLine();
+  }
+  if (data.bounds.empty()) {
+    out.Put("END");
+    out.EndLine();
+  }
+  out.EndLine();
+
+  out.Put("[FRINGES]");
+  out.EndLine();
+  for (size_t i = 0; i < data.lines.size(); i++) {
+    double order = i < data.orders.size() ? data.orders[i] : (double)i;
+    double tenths = order * 10.0;
+    out.Put("NFringe=");
+    out.Put(order, tenths == std::round(tenths) ? 1 : 3);
+    out.EndLine();
+    for (const CTracerPoint& p : data.lines[i]) {
+      out.Put(' ');
+      out.Put(p.PosX(), 3);
+      out.Put(' ');
+      out.Put(p.PosY(), 3);
+      out.EndLine();
+    }
+    out.Put('E');
+    out.EndLine();
+  }
+  out.EndLine();
+
+  out.Put("[IMAGE]");
+  out.EndLine();
+  out.Put("Size=");
+  out.Put(data.imageWidth);
+  out.Put(' ');
+  out.Put(data.imageHeight);
+  out.EndLine();
+  out.Put("FileName=");
+  out.Put(data.imageFile);
+  out.EndLine();
+}
+
+}  // namespace
+
+//=============================================================================
+// CFrnEllipse, CFrnData
+//=============================================================================
+
+EllipseParams CFrnEllipse::ToParams() const {
+  return EllipseParams(RoundToInt(centerX), RoundToInt(centerY),
+                       RoundToInt(semiAxisA), RoundToInt(semiAxisB),
+                       (float)angle);
+}
+
+CFrnEllipse CFrnEllipse::FromParams(const EllipseParams& ellipse) {
+  CFrnEllipse e;
+  e.centerX = ellipse.centerX;
+  e.centerY = ellipse.centerY;
+  e.semiAxisA = ellipse.semiAxisA;
+  e.semiAxisB = ellipse.semiAxisB;
+  e.angle = ellipse.angle;
+  return e;
+}
+
+void CFrnData::Clear() {
+  general.clear();
+  ellipses.clear();
+  bounds.clear();
+  lines.clear();
+  orders.clear();
+  imageWidth = imageHeight = 0;
+  imageFile.clear();
+}
+
+std::string CFrnData::GetGeneral(const std::string& key) const {
+  for (const auto& kv : general)
+    if (kv.first == key) return kv.second;
+  return std::string();
+}
+
+void CFrnData::SetGeneral(const std::string& key, const std::string& value) {
+  for (auto& kv : general)
+    if (kv.first == key) {
+      kv.second = value;
+      return;
+    }
+  general.emplace_back(key, value);
+}
+
+bool CFrnData::GetOuterEllipse(EllipseParams& ellipse) const {
+  for (const CFrnEllipse& e : ellipses)
+    if (e.type == 1) {
+      ellipse = e.ToParams();
+      return true;
+    }
+  return false;
+}
+
+//=============================================================================
+// CFrnReader
+//=============================================================================
+
+bool CFrnReader::ReadFile(const std::filesystem::path& path, CFrnData& data) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    m_lastError = "не удалось открыть " + path.string();
+    return false;
+  }
+
+  Begin(data);
+  std::vector<char> chunk(kChunkSize);
+  while (in) {
+    in.read(chunk.data(), (std::streamsize)chunk.size());
+    size_t got = (size_t)in.gcount();
+    if (got == 0) break;
+    if (!Feed(chunk.data(), got)) return false;
+  }
+  if (in.bad()) {
+    m_lastError = "ошибка чтения " + path.string();
+    return false;
+  }
+  return Finish();
+}
+
+bool CFrnReader::Parse(const char* text, size_t size, CFrnData& data) {
+  Begin(data);
+  return Feed(text, size) && Finish();
+}
+
+void CFrnReader::Begin(CFrnData& data) {
+  m_data = &data;
+  m_data->Clear();
+  m_section = ESection::None;
+  m_inFringe = false;
+  m_pending.clear();
+  m_lineNumber = 0;
+  m_lastError.clear();
+}
+
+bool CFrnReader::Feed(const char* chunk, size_t size) {
+  if (!m_data) return Fail("Feed() без Begin()");
+
+  const char* p = chunk;
+  const char* end = chunk + size;
+
+  // Хвост прошлого куска дописывается до первого перевода строки
+  if (!m_pending.empty()) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    if (!nl) {
+      m_pending.append(p, end);
+      return true;
+    }
+    m_pending.append(p, nl);
+    p = nl + 1;
+    bool ok = ParseLine(m_pending.data(), m_pending.data() + m_pending.size());
+    m_pending.clear();
+    if (!ok) return false;
+  }
+
+  // Целые строки — прямо из буфера куска
+  while (p < end) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    if (!nl) {
+      m_pending.assign(p, end);
+      break;
+    }
+    if (!ParseLine(p, nl)) return false;
+    p = nl + 1;
+  }
+  return true;
+}
+
+bool CFrnReader::Finish() {
+  if (!m_data) return Fail("Finish() без Begin()");
+  if (!m_pending.empty()) {
+    bool ok = ParseLine(m_pending.data(), m_pending.data() + m_pending.size());
+    m_pending.clear();
+    if (!ok) return false;
+  }
+  m_data = nullptr;
+  return true;
+}
+
+bool CFrnReader::Fail(const std::string& message) {
+  m_lastError = m_lineNumber ? "строка " + std::to_string(m_lineNumber) +
+                                   ": " + message
+                             : message;
+  return false;
+}
+
+bool CFrnReader::ParseLine(const char* begin, const char* end) {
+  m_lineNumber++;
+  Trim(begin, end);
+  if (begin == end) return true;
+
+  // --- Заголовок секции ---
+  if (*begin == '[') {
+    m_inFringe = false;
+    if (Equals(begin, end, "[GENERAL]"))
+      m_section = ESection::General;
+    else if (Equals(begin, end, "[ELLIPSES]"))
+      m_section = ESection::Ellipses;
+    else if (Equals(begin, end, "[BOUNDS]"))
+      m_section = ESection::Bounds;
+    else if (Equals(begin, end, "[FRINGES]"))
+      m_section = ESection::Fringes;
+    else if (Equals(begin, end, "[IMAGE]") ||
+             Equals(begin, end, "[IMAGE_FILE]"))
+      m_section = ESection::Image;
+    else
+      m_section = ESection::Unknown;  // новые секции пропускаются
+    return true;
+  }
+
+  if (Equals(begin, end, "END")) {
+    m_inFringe = false;
+    return true;
+  }
+
+  switch (m_section) {
+    case ESection::General: {
+      const char* eq = (const char*)std::memchr(begin, '=', end - begin);
+      if (!eq) return Fail("ожидалось ключ=значение");
+      const char* kEnd = eq;
+      const char* v = eq + 1;
+      const char* vEnd = end;
+      Trim(begin, kEnd);
+      Trim(v, vEnd);
+      m_data->general.emplace_back(std::string(begin, kEnd),
+                                   std::string(v, vEnd));
+      return true;
+    }
+
+    case ESection::Ellipses: {
+      if (!ParseNumbers(begin, end, m_numbers) || m_numbers.size() < 4)
+        return Fail("неверная запись эллипса");
+      CFrnEllipse e;
+      e.centerX = m_numbers[0];
+      e.centerY = m_numbers[1];
+      e.semiAxisA = m_numbers[2];
+      e.semiAxisB = m_numbers[3];
+      if (m_numbers.size() > 4) e.angle = m_numbers[4];
+      if (m_numbers.size() > 5) e.type = RoundToInt(m_numbers[5]);
+      if (m_numbers.size() > 6) e.flags = RoundToInt(m_numbers[6]);
+      m_data->ellipses.push_back(e);
+      return true;
+    }
+
+    case ESection::Bounds:
+      if (!ParseNumbers(begin, end, m_numbers))
+        return Fail("неверная запись границ");
+      if (!m_numbers.empty()) m_data->bounds.push_back(m_numbers);
+      return true;
+
+    case ESection::Fringes:
+      return ParseFringeLine(begin, end);
+
+    case ESection::Image: {
+      const char* eq = (const char*)std::memchr(begin, '=', end - begin);
+      if (!eq) {  // имя файла без ключа (старые версии)
+        m_data->imageFile.assign(begin, end);
+        return true;
+      }
+      if (StartsWith(begin, end, "Size=")) {
+        double w, h;
+        const char* p = eq + 1;
+        if (!ParseNumber(p, end, w) || !ParseNumber(p, end, h))
+          return Fail("неверный Size=");
+        m_data->imageWidth = RoundToInt(w);
+        m_data->imageHeight = RoundToInt(h);
+      } else if (StartsWith(begin, end, "FileName=") ||
+                 StartsWith(begin, end, "Name=")) {
+        const char* v = eq + 1;
+        const char* vEnd = end;
+        Trim(v, vEnd);
+        m_data->imageFile.assign(v, vEnd);
+      }
+      return true;
+    }
+
+    case ESection::None:
+      return Fail("данные вне секции");
+
+    case ESection::Unknown:
+      return true;
+  }
+  return true;
+}
+
+bool CFrnReader::ParseFringeLine(const char* begin, const char* end) {
+  if (StartsWith(begin, end, "NFringe=")) {
+    const char* p = begin + 8;
+    double order;
+    if (!ParseNumber(p, end, order)) return Fail("неверный NFringe=");
+    m_data->orders.push_back(order);
+    m_data->lines.emplace_back();
+    m_inFringe = true;
+    return true;
+  }
+  if (Equals(begin, end, "E")) {
+    m_inFringe = false;
+    return true;
+  }
+  if (!m_inFringe) return Fail("точка вне блока NFringe=");
+
+  // Точка — самая частая строка, разбирается без промежуточного вектора
+  const char* p = begin;
+  double x, y;
+  if (!ParseNumber(p, end, x) || !ParseNumber(p, end, y))
+    return Fail("ожидалась пара координат");
+  m_data->lines.back().emplace_back();
+  m_data->lines.back().back().SetPosition(x, y);
+  return true;
+}
+
+//=============================================================================
+// CFrnWriter
+//=============================================================================
+
+bool CFrnWriter::WriteFile(const std::filesystem::path& path,
+                           const CFrnData& data) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) {
+    m_lastError = "не удалось создать " + path.string();
+    return false;
+  }
+  CFrnSink sink(&out);
+  FormatFrn(data, sink);
+  sink.Flush();
+  if (!out.good()) {
+    m_lastError = "ошибка записи " + path.string();
+    return false;
+  }
+  m_lastError.clear();
+  return true;
+}
+
+std::string CFrnWriter::Format(const CFrnData& data) {
+  CFrnSink sink(nullptr);
+  FormatFrn(data, sink);
+  return std::move(sink.Text());
+}
+
+}  // namespace Interferometry
@@ -2,13 +2,18 @@
  * @file ImageLoader.cpp
  * @brief Реализация загрузчика изображений.
  *
- * Поддержка стандартных форматов (через OpenCV) и raw-формата SCAN360.
+ * 8-битный BMP и raw-формат SCAN360 разбираются прямо из отображённого в
+ * память файла; прочие форматы — через cv::imdecode.
  */
 
 #include "pch.h"
 #include "ImageLoader.h"
 
-#include <fstream>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#include "MappedFile.h"
 
 namespace Interferometry
 {
@@ -18,99 +23,286 @@ namespace Interferometry
   static constexpr int SCAN360_HEIGHT = 290;
   static constexpr size_t SCAN360_RAW_SIZE = SCAN360_WIDTH * SCAN360_HEIGHT;
 
-  ImageLoader::ImageLoader() {}
-
-  ImageLoader::~ImageLoader() {}
+  /// BITMAPFILEHEADER и BITMAPINFOHEADER (более новые заголовки длиннее)
+  static constexpr size_t BMP_FILE_HEADER = 14;
+  static constexpr size_t BMP_INFO_HEADER = 40;
+  static constexpr uint32_t BMP_UNCOMPRESSED = 0;  // BI_RGB
 
-  //=============================================================================
-  // Автоопределение формата и загрузка
-  //=============================================================================
-
-  bool ImageLoader::Load(const std::string &filename)
+  namespace
   {
-    // Сначала пробуем как обычное изображение (BMP, PNG, TIFF...)
-    m_image = cv::imread(filename, cv::IMREAD_UNCHANGED);
 
-    if (!m_image.empty())
+    //=============================================================================
+    // Mat над отображением файла
+    //=============================================================================
+
+    /**
+     * Владеет отображением через UMatData::userdata и закрывает его вместе
+     * с последней копией cv::Mat. Новые буферы (create() у такого Mat)
+     * выделяет стандартный аллокатор.
+     */
+    class CMappedMatAllocator : public cv::MatAllocator
     {
-      if (m_image.channels() > 1)
+    public:
+      cv::UMatData *allocate(int dims, const int *sizes, int type, void *data,
+                             size_t *step, cv::AccessFlag flags,
+                             cv::UMatUsageFlags usageFlags) const override
       {
-        ConvertToGrayscale();
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data,
+                                                    step, flags, usageFlags);
       }
-      return true;
+
+      bool allocate(cv::UMatData *u, cv::AccessFlag accessFlags,
+                    cv::UMatUsageFlags usageFlags) const override
+      {
+        return cv::Mat::getStdAllocator()->allocate(u, accessFlags,
+                                                    usageFlags);
+      }
+
+      void deallocate(cv::UMatData *u) const override
+      {
+        if (!u)
+          return;
+        delete static_cast<CMappedFile *>(u->userdata);
+        delete u;
+      }
+    };
+
+    cv::Mat WrapMapped(std::unique_ptr<CMappedFile> file, size_t offset,
+                       int rows, int cols)
+    {
+      static CMappedMatAllocator allocator;
+
+      uchar *base = reinterpret_cast<uchar *>(file->Data());
+      cv::Mat image(rows, cols, CV_8UC1, base + offset);
+
+      cv::UMatData *u = new cv::UMatData(&allocator);
+      u->data = u->origdata = base;
+      u->size = file->Size();
+      u->userdata = file.release();
+      image.u = u;
+      image.allocator = &allocator;
+      image.addref();
+      return image;
+    }
+
+    //=============================================================================
+    // Сигнатуры и заголовок BMP
+    //=============================================================================
+
+    uint16_t ReadU16(const uchar *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+    uint32_t ReadU32(const uchar *p)
+    {
+      return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+             (uint32_t)p[3] << 24;
+    }
+
+    bool StartsWith(const uchar *data, size_t size, const char *magic,
+                    size_t length)
+    {
+      return size >= length && std::memcmp(data, magic, length) == 0;
     }
 
-    // OpenCV не смог — пробуем как raw SCAN360
-    if (IsRawFormat(filename))
+    bool IsBmp(const uchar *data, size_t size)
     {
-      return LoadRaw(filename);
+      return StartsWith(data, size, "BM", 2);
     }
 
-    return false;
+    /// Сигнатуры форматов, которые встречаются рядом с raw-кадрами
+    bool HasKnownSignature(const uchar *data, size_t size)
+    {
+      return IsBmp(data, size) ||
+             StartsWith(data, size, "\x89PNG", 4) ||
+             StartsWith(data, size, "\xFF\xD8\xFF", 3) ||
+             StartsWith(data, size, "II*\0", 4) ||
+             StartsWith(data, size, "MM\0*", 4);
+    }
+
+    /// Яркость как у cv::cvtColor(COLOR_BGR2GRAY) для 8U
+    uchar Gray(int b, int g, int r)
+    {
+      return (uchar)((b * 1868 + g * 9617 + r * 4899 + (1 << 13)) >> 14);
+    }
+
+  } // namespace
+
+  ImageLoader::ImageLoader() {}
+
+  ImageLoader::~ImageLoader() {}
+
+  //=============================================================================
+  // Автоопределение формата и загрузка
+  //=============================================================================
+
+  bool ImageLoader::Load(const std::string &filename)
+  {
+    return LoadFile(std::filesystem::path(filename));
   }
 
   bool ImageLoader::Load(const std::wstring &filename)
   {
-    std::string utf8;
-    utf8.reserve(filename.size());
-    for (wchar_t wc : filename)
+    return LoadFile(std::filesystem::path(filename));
+  }
+
+  bool ImageLoader::LoadFile(const std::filesystem::path &path)
+  {
+    INTERF_TIMED_SCOPE(m_stats, Load);
+    m_image.release();
+
+    // Единственное открытие: дальше все разборщики работают с отображением
+    auto file = std::make_unique<CMappedFile>();
+    if (!file->Open(path, EMapMode::CopyOnWrite) || file->Size() == 0)
+      return false;
+
+    const uchar *data = reinterpret_cast<const uchar *>(file->Data());
+    const size_t size = file->Size();
+
+    if (IsBmp(data, size))
+    {
+      if (LoadBmp(file))
+        return true;
+      // RLE, 1/4/16 бит, заголовок OS/2 — отдаём OpenCV
+    }
+    else if (!HasKnownSignature(data, size))
     {
-      if (wc < 0x80)
-        utf8.push_back((char)wc);
-      else
-        utf8.push_back('?');
+      // У raw SCAN360 сигнатуры нет — только ровно 360 × 290 байт
+      if (LoadRaw(file))
+        return true;
     }
-    return Load(utf8);
+
+    return LoadEncoded(*file);
   }
 
   //=============================================================================
-  // Загрузка raw-формата SCAN360
+  // BMP без сжатия: 8 бит с палитрой, 24 и 32 бита
   //=============================================================================
 
-  bool ImageLoader::LoadRaw(const std::string &filename, int width, int height)
+  bool ImageLoader::LoadBmp(std::unique_ptr<CMappedFile> &file)
   {
-    size_t expectedSize = (size_t)width * height;
+    const uchar *data = reinterpret_cast<const uchar *>(file->Data());
+    const size_t size = file->Size();
+    if (size < BMP_FILE_HEADER + BMP_INFO_HEADER)
+      return false;
+
+    const uint32_t pixelOffset = ReadU32(data + 10);
+    const uint32_t headerSize = ReadU32(data + 14);
+    const int32_t width = (int32_t)ReadU32(data + 18);
+    const int32_t height = (int32_t)ReadU32(data + 22);
+    const int bitCount = ReadU16(data + 28);
+    const uint32_t compression = ReadU32(data + 30);
+    uint32_t colorsUsed = ReadU32(data + 46);
+
+    if (headerSize < BMP_INFO_HEADER || compression != BMP_UNCOMPRESSED ||
+        (bitCount != 8 && bitCount != 24 && bitCount != 32))
+      return false;
+    if (width <= 0 || height == 0 || height == INT32_MIN)
+      return false;
 
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file.is_open())
+    // Положительная высота — строки в файле снизу вверх
+    const bool topDown = height < 0;
+    const int rows = topDown ? -height : height;
+    const size_t stride = (((size_t)width * bitCount + 31) / 32) * 4;
+    if ((uint64_t)width * rows > INT_MAX || pixelOffset > size ||
+        (size - pixelOffset) / stride < (size_t)rows)
       return false;
 
-    size_t fileSize = (size_t)file.tellg();
+    const uchar *pixels = data + pixelOffset;
+    auto fileRow = [&](int y)
+    { return pixels + (size_t)(topDown ? y : rows - 1 - y) * stride; };
 
-    if (fileSize != expectedSize)
+    if (bitCount == 8)
     {
-      if (fileSize == SCAN360_RAW_SIZE)
+      // Палитра сразу за заголовком; недостающие цвета — чёрные, как в OpenCV
+      const size_t paletteOffset = BMP_FILE_HEADER + headerSize;
+      const size_t paletteRoom =
+          pixelOffset > paletteOffset ? (pixelOffset - paletteOffset) / 4 : 0;
+      if (colorsUsed == 0 || colorsUsed > 256)
+        colorsUsed = 256;
+      if (colorsUsed > paletteRoom)
+        colorsUsed = (uint32_t)paletteRoom;
+
+      uchar lut[256];
+      bool identity = true;
+      for (int i = 0; i < 256; i++)
       {
-        width = SCAN360_WIDTH;
-        height = SCAN360_HEIGHT;
-        expectedSize = SCAN360_RAW_SIZE;
+        const uchar *c = data + paletteOffset + (size_t)i * 4;
+        lut[i] = i < (int)colorsUsed ? Gray(c[0], c[1], c[2]) : 0;
+        identity = identity && lut[i] == i;
       }
-      else
+
+      // Индекс = яркость, строки сверху вниз без выравнивания — кадр уже
+      // лежит в файле как CV_8UC1
+      if (m_zeroCopy && identity && topDown && stride == (size_t)width)
       {
-        return false;
+        m_image = WrapMapped(std::move(file), pixelOffset, rows, width);
+        return true;
       }
-    }
 
-    file.seekg(0, std::ios::beg);
-    m_image = cv::Mat(height, width, CV_8UC1);
-    file.read(reinterpret_cast<char *>(m_image.data), expectedSize);
+      m_image.create(rows, width, CV_8UC1);
+      for (int y = 0; y < rows; y++)
+      {
+        const uchar *src = fileRow(y);
+        uchar *dst = m_image.ptr<uchar>(y);
+        if (identity)
+        {
+          std::memcpy(dst, src, width);
+        }
+        else
+        {
+          for (int x = 0; x < width; x++)
+            dst[x] = lut[src[x]];
+        }
+      }
+      return true;
+    }
 
-    if (file.gcount() != (std::streamsize)expectedSize)
+    const int bytesPerPixel = bitCount / 8;
+    m_image.create(rows, width, CV_8UC1);
+    for (int y = 0; y < rows; y++)
     {
-      m_image = cv::Mat();
-      return false;
+      const uchar *src = fileRow(y);
+      uchar *dst = m_image.ptr<uchar>(y);
+      for (int x = 0; x < width; x++, src += bytesPerPixel)
+        dst[x] = Gray(src[0], src[1], src[2]);
     }
+    return true;
+  }
 
+  //=============================================================================
+  // Raw-формат SCAN360
+  //=============================================================================
+
+  bool ImageLoader::LoadRaw(std::unique_ptr<CMappedFile> &file)
+  {
+    if (file->Size() != SCAN360_RAW_SIZE)
+      return false;
+    if (m_zeroCopy)
+      m_image = WrapMapped(std::move(file), 0, SCAN360_HEIGHT, SCAN360_WIDTH);
+    else
+      m_image = cv::Mat(SCAN360_HEIGHT, SCAN360_WIDTH, CV_8UC1, file->Data())
+                    .clone();
     return true;
   }
 
-  bool ImageLoader::IsRawFormat(const std::string &filename)
+  //=============================================================================
+  // Остальные форматы (PNG, TIFF, JPEG...) — OpenCV из того же отображения
+  //=============================================================================
+
+  bool ImageLoader::LoadEncoded(const CMappedFile &file)
   {
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file.is_open())
+    if (file.Size() > (size_t)INT_MAX)
+      return false;
+
+    const cv::Mat buffer(1, (int)file.Size(), CV_8UC1, file.Data());
+    m_image = cv::imdecode(buffer, cv::IMREAD_UNCHANGED);
+    if (m_image.empty())
       return false;
-    size_t fileSize = (size_t)file.tellg();
-    return (fileSize == SCAN360_RAW_SIZE);
+
+    if (m_image.channels() > 1)
+    {
+      ConvertToGrayscale();
+    }
+    return true;
   }
 
   //=============================================================================
@@ -0,0 +1,114 @@
+#include "Instrumentation.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+namespace Interferometry {
+
+namespace {
+
+const char* const kStageNames[CInstrumentation::NUM_STAGES] = {
+    "load",  "boundary", "binarize",  "thin",  "graph_build",
+    "prune", "link",     "polylines", "trace", "approximate",
+    "order", "wavefront", "render", "overlay",
+    "pupil"};
+
+const char* const kCounterNames[CInstrumentation::NUM_COUNTERS] = {
+    "skeleton_pixels",  "graph_nodes",    "graph_edges", "pruned_edges",
+    "linked_gaps",      "lines",          "line_points", "trace_seeds",
+    "trace_steps",      "approx_fits",    "wavefront_points",
+    "order_conflicts",  "render_tiles",   "overlay_rects"};
+
+// Числа в экспорте — всегда с точкой, независимо от локали приложения
+std::ostringstream MakeStream() {
+  std::ostringstream out;
+  out.imbue(std::locale::classic());
+  out << std::fixed << std::setprecision(4);
+  return out;
+}
+
+bool WriteFile(const std::string& filename, const std::string& text) {
+  std::ofstream out(filename, std::ios::binary);
+  if (!out.is_open()) return false;
+  out << text;
+  return out.good();
+}
+
+}  // namespace
+
+//=============================================================================
+// Накопление
+//=============================================================================
+void CInstrumentation::Merge(const CInstrumentation& other) {
+  for (int i = 0; i < NUM_STAGES; i++) {
+    const CStageStats& o = other.m_stages[i];
+    if (o.calls == 0) continue;
+    CStageStats& s = m_stages[i];
+    s.minMs = (s.calls == 0) ? o.minMs : (std::min)(s.minMs, o.minMs);
+    s.maxMs = (s.calls == 0) ? o.maxMs : (std::max)(s.maxMs, o.maxMs);
+    s.calls += o.calls;
+    s.totalMs += o.totalMs;
+  }
+  for (int i = 0; i < NUM_COUNTERS; i++) m_counters[i] += other.m_counters[i];
+}
+
+const char* CInstrumentation::StageName(EStage stage) {
+  int i = (int)stage;
+  return (i >= 0 && i < NUM_STAGES) ? kStageNames[i] : "unknown";
+}
+
+const char* CInstrumentation::CounterName(ECounter counter) {
+  int i = (int)counter;
+  return (i >= 0 && i < NUM_COUNTERS) ? kCounterNames[i] : "unknown";
+}
+
+//=============================================================================
+// Экспорт
+//=============================================================================
+std::string CInstrumentation::ToJson() const {
+  std::ostringstream out = MakeStream();
+  out << "{\n  \"enabled\": " << (Enabled() ? "true" : "false") << ",\n";
+
+  out << "  \"stages\": {\n";
+  for (int i = 0; i < NUM_STAGES; i++) {
+    const CStageStats& s = m_stages[i];
+    out << "    \"" << kStageNames[i] << "\": {\"calls\": " << s.calls
+        << ", \"total_ms\": " << s.totalMs << ", \"min_ms\": " << s.minMs
+        << ", \"max_ms\": " << s.maxMs << "}"
+        << (i + 1 < NUM_STAGES ? ",\n" : "\n");
+  }
+  out << "  },\n";
+
+  out << "  \"counters\": {\n";
+  for (int i = 0; i < NUM_COUNTERS; i++)
+    out << "    \"" << kCounterNames[i] << "\": " << m_counters[i]
+        << (i + 1 < NUM_COUNTERS ? ",\n" : "\n");
+  out << "  }\n}\n";
+  return out.str();
+}
+
+std::string CInstrumentation::ToCsv() const {
+  std::ostringstream out = MakeStream();
+  out << "kind,name,calls,total_ms,min_ms,max_ms,value\n";
+  for (int i = 0; i < NUM_STAGES; i++) {
+    const CStageStats& s = m_stages[i];
+    out << "stage," << kStageNames[i] << "," << s.calls << "," << s.totalMs
+        << "," << s.minMs << "," << s.maxMs << ",\n";
+  }
+  for (int i = 0; i < NUM_COUNTERS; i++)
+    out << "counter," << kCounterNames[i] << ",,,,," << m_counters[i] << "\n";
+  return out.str();
+}
+
+bool CInstrumentation::SaveJson(const std::string& filename) const {
+  return WriteFile(filename, ToJson());
+}
+
+bool CInstrumentation::SaveCsv(const std::string& filename) const {
+  return WriteFile(filename, ToCsv());
+}
+
+}  // namespace Interferometry
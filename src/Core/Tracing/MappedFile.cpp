@@ -0,0 +1,88 @@
+/**
+ * @file MappedFile.cpp
+ * @brief CMappedFile для Windows (CreateFileMapping) и POSIX (mmap).
+ */
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Interferometry {
+
+bool CMappedFile::Open(const std::filesystem::path& path, EMapMode mode) {
+  Close();
+  const bool copyOnWrite = mode == EMapMode::CopyOnWrite;
+#ifdef _WIN32
+  // FILE_SHARE_DELETE: пока кадр над отображением жив, файл можно
+  // переименовать или удалить (перезапись отображённого файла Windows
+  // запрещает в любом случае)
+  m_file = CreateFileW(path.c_str(), GENERIC_READ,
+                       FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                       OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_file, &size)) {
+    Close();
+    return false;
+  }
+  m_size = (size_t)size.QuadPart;
+  if (m_size == 0) return true;
+  m_mapping = CreateFileMappingW(
+      m_file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0,
+      nullptr);
+  if (m_mapping)
+    m_data = (char*)MapViewOfFile(
+        m_mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+#else
+  m_fd = open(path.c_str(), O_RDONLY);
+  if (m_fd < 0) return false;
+  struct stat st;
+  if (fstat(m_fd, &st) != 0) {
+    Close();
+    return false;
+  }
+  m_size = (size_t)st.st_size;
+  if (m_size == 0) return true;
+  void* p = mmap(nullptr, m_size, PROT_READ | (copyOnWrite ? PROT_WRITE : 0),
+                 MAP_PRIVATE, m_fd, 0);
+  if (p != MAP_FAILED) {
+    madvise(p, m_size, MADV_SEQUENTIAL);
+    m_data = (char*)p;
+  }
+#endif
+  if (!m_data) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void CMappedFile::Close() {
+#ifdef _WIN32
+  if (m_data) UnmapViewOfFile(m_data);
+  if (m_mapping) CloseHandle(m_mapping);
+  if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+  m_mapping = nullptr;
+  m_file = INVALID_HANDLE_VALUE;
+#else
+  if (m_data) munmap(m_data, m_size);
+  if (m_fd >= 0) close(m_fd);
+  m_fd = -1;
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+bool CMappedFile::IsOpen() const {
+#ifdef _WIN32
+  return m_file != INVALID_HANDLE_VALUE;
+#else
+  return m_fd >= 0;
+#endif
+}
+
+}  // namespace Interferometry
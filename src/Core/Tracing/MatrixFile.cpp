@@ -0,0 +1,453 @@
+/**
+ * @file MatrixFile.cpp
+ * @brief Разбор .phs / .mtr: отображение файла в память, деление [MATRIX]
+ *        по записям, параллельный from_chars; запись и двоичный кэш.
+ */
+#include "MatrixFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <thread>
+
+#include "MappedFile.h"
+
+namespace Interferometry {
+
+namespace {
+
+const size_t kMinBytesPerThread = 256 * 1024;  // меньше — поток не окупается
+const int kPairsPerLine = 6;                  // пар «значение x» в строке
+const int kMaxGridSize = 16384;
+
+//=============================================================================
+// Разбор
+//=============================================================================
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void Trim(const char*& begin, const char*& end) {
+  while (begin < end && IsSpace(*begin)) begin++;
+  while (end > begin && IsSpace(end[-1])) end--;
+}
+
+template <typename T>
+bool ParseNumber(const char*& p, const char* end, T& value) {
+  if (p < end && *p == '+') p++;
+  auto r = std::from_chars(p, end, value);
+  if (r.ec != std::errc()) return false;
+  p = r.ptr;
+  return true;
+}
+
+// Терминатор записи — отдельное слово E
+bool IsTerminator(const char* p, const char* begin, const char* end) {
+  return *p == 'E' && (p == begin || IsSpace(p[-1])) &&
+         (p + 1 == end || IsSpace(p[1]));
+}
+
+/**
+ * @brief Записи [begin, end) в строки values.
+ * @return nullptr или место ошибки
+ */
+const char* ParseRows(const char* p, const char* end, cv::Mat& values) {
+  const int size = values.rows;
+  for (;;) {
+    while (p < end && IsSpace(*p)) p++;
+    if (p == end) return nullptr;
+
+    double y;
+    if (!ParseNumber(p, end, y)) return p;
+    int r = CMatrixData::Index(y, size);
+    float* row = (r >= 0 && r < size) ? values.ptr<float>(r) : nullptr;
+
+    for (;;) {
+      while (p < end && IsSpace(*p)) p++;
+      if (p == end) return p;  // запись без E
+      if (*p == 'E') {
+        p++;
+        break;
+      }
+      float v;
+      double x;
+      if (!ParseNumber(p, end, v)) return p;
+      while (p < end && IsSpace(*p)) p++;
+      if (!ParseNumber(p, end, x)) return p;
+      int c = CMatrixData::Index(x, size);
+      if (row && c >= 0 && c < size) row[c] = v;
+    }
+  }
+}
+
+// Ключ=значение строк текста вне [...]-заголовков
+void ParseHeader(const char* p, const char* end,
+                 std::vector<std::pair<std::string, std::string>>& header) {
+  while (p < end) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    const char* lineEnd = nl ? nl : end;
+    const char* b = p;
+    const char* e = lineEnd;
+    Trim(b, e);
+    const char* eq = (const char*)std::memchr(b, '=', e - b);
+    if (b < e && *b != '[' && eq) {
+      const char* kEnd = eq;
+      const char* v = eq + 1;
+      const char* vEnd = e;
+      Trim(b, kEnd);
+      Trim(v, vEnd);
+      header.emplace_back(std::string(b, kEnd), std::string(v, vEnd));
+    }
+    p = nl ? nl + 1 : end;
+  }
+}
+
+//=============================================================================
+// Двоичный кэш
+//=============================================================================
+
+struct CMatrixCacheHeader {
+  char magic[8];
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  int32_t rows;
+  int32_t cols;
+  uint64_t preambleSize;
+  uint64_t trailerSize;
+};
+
+const char kCacheMagic[8] = {'I', 'F', 'M', 'T', 'X', '0', '1', '\0'};
+
+bool SourceStamp(const std::filesystem::path& path, uint64_t& size,
+                 int64_t& time) {
+  std::error_code ec;
+  size = (uint64_t)std::filesystem::file_size(path, ec);
+  if (ec) return false;
+  auto t = std::filesystem::last_write_time(path, ec);
+  if (ec) return false;
+  time = (int64_t)t.time_since_epoch().count();
+  return true;
+}
+
+//=============================================================================
+// Запись
+//=============================================================================
+
+void AppendFixed4(std::string& out, double v) {
+  char tmp[64];
+  auto r =
+      std::to_chars(tmp, tmp + sizeof(tmp), v, std::chars_format::fixed, 4);
+  out.append(tmp, r.ptr);
+}
+
+}  // namespace
+
+//=============================================================================
+// CMatrixData
+//=============================================================================
+
+void CMatrixData::Clear() {
+  header.clear();
+  values.release();
+  preamble.clear();
+  trailer.clear();
+}
+
+std::string CMatrixData::GetHeader(const std::string& key) const {
+  for (const auto& kv : header)
+    if (kv.first == key) return kv.second;
+  return std::string();
+}
+
+double CMatrixData::Coordinate(int index, int size) {
+  return -1.0 + 2.0 * index / (size - 1);
+}
+
+int CMatrixData::Index(double coordinate, int size) {
+  return (int)std::lround((coordinate + 1.0) * (size - 1) * 0.5);
+}
+
+//=============================================================================
+// CMatrixReader
+//=============================================================================
+
+std::filesystem::path CMatrixReader::CachePath(
+    const std::filesystem::path& path) {
+  std::filesystem::path cache = path;
+  cache += ".mcache";
+  return cache;
+}
+
+bool CMatrixReader::ReadFile(const std::filesystem::path& path,
+                             CMatrixData& data) {
+  INTERF_TIMED_SCOPE(m_stats, Load);
+  m_fromCache = false;
+  if (m_params.useCache && ReadCache(path, data)) {
+    m_fromCache = true;
+    return true;
+  }
+
+  CMappedFile file;
+  if (!file.Open(path)) {
+    m_lastError = "не удалось открыть " + path.string();
+    return false;
+  }
+  if (!ParseText(file.Data(), file.Size(), data)) {
+    m_lastError = path.filename().string() + ": " + m_lastError;
+    return false;
+  }
+  if (m_params.useCache) WriteCache(path, data);
+  return true;
+}
+
+bool CMatrixReader::Parse(const char* text, size_t size, CMatrixData& data) {
+  INTERF_TIMED_SCOPE(m_stats, Load);
+  return ParseText(text, size, data);
+}
+
+bool CMatrixReader::ParseText(const char* text, size_t size,
+                              CMatrixData& data) {
+  data.Clear();
+  m_lastError.clear();
+  if (!text) text = "";
+  const char* end = text + size;
+
+  // --- Строка [MATRIX] ---
+  const char* matrixLine = nullptr;
+  const char* body = nullptr;
+  for (const char* p = text; p < end;) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    const char* lineEnd = nl ? nl : end;
+    const char* b = p;
+    const char* e = lineEnd;
+    Trim(b, e);
+    if (e - b == 8 && std::memcmp(b, "[MATRIX]", 8) == 0) {
+      matrixLine = p;
+      body = nl ? nl + 1 : end;
+      break;
+    }
+    p = nl ? nl + 1 : end;
+  }
+  if (!matrixLine) {
+    m_lastError = "нет секции [MATRIX]";
+    return false;
+  }
+  data.preamble.assign(text, matrixLine);
+  ParseHeader(text, matrixLine, data.header);
+
+  int gridSize = 0;
+  std::string sizeText = data.GetHeader("Size");
+  std::from_chars(sizeText.data(), sizeText.data() + sizeText.size(),
+                  gridSize);
+  if (gridSize < 2 || gridSize > kMaxGridSize) {
+    m_lastError = "неверный или отсутствующий Size= (" + sizeText + ")";
+    return false;
+  }
+
+  // --- Строка END (в теле матрицы слов на E, кроме терминатора, нет) ---
+  std::string_view all(text, size);
+  const char* bodyEnd = end;
+  const char* trailer = end;
+  size_t at = body - text;
+  if (all.compare(at, 3, "END") != 0) at = all.find("\nEND", at);
+  while (at != std::string_view::npos) {
+    if (text[at] == '\n') at++;
+    size_t after = at + 3;
+    if (after == size || text[after] == '\r' || text[after] == '\n') {
+      bodyEnd = text + at;
+      const char* nl =
+          (const char*)std::memchr(text + after, '\n', size - after);
+      trailer = nl ? nl + 1 : end;
+      break;
+    }
+    at = all.find("\nEND", after);
+  }
+  data.trailer.assign(trailer, end);
+
+  // --- Тело ---
+  data.values.create(gridSize, gridSize, CV_32F);
+  float* v = data.values.ptr<float>(0);
+  std::fill(v, v + (size_t)gridSize * gridSize,
+            std::numeric_limits<float>::quiet_NaN());
+
+  const char* errorAt = nullptr;
+  if (!ParseBody(body, bodyEnd, data.values, errorAt)) {
+    size_t line = 1 + std::count(text, errorAt, '\n');
+    m_lastError = "строка " + std::to_string(line) +
+                  ": неверная запись [MATRIX]";
+    return false;
+  }
+  return true;
+}
+
+bool CMatrixReader::ParseBody(const char* begin, const char* end,
+                              cv::Mat& values, const char*& errorAt) {
+  const size_t length = end - begin;
+  int numThreads = m_params.numThreads;
+  if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+  numThreads = (int)(std::max)(
+      (size_t)1, (std::min)((size_t)numThreads, length / kMinBytesPerThread));
+
+  // Границы кусков — сразу за терминатором записи
+  std::vector<const char*> splits(numThreads + 1, end);
+  splits[0] = begin;
+  for (int t = 1; t < numThreads; t++) {
+    const char* p = (std::max)(begin + length * t / numThreads, splits[t - 1]);
+    while (p < end && !IsTerminator(p, begin, end)) p++;
+    splits[t] = p < end ? p + 1 : end;
+  }
+
+  std::vector<const char*> errors(numThreads, nullptr);
+  auto worker = [&](int t) {
+    errors[t] = ParseRows(splits[t], splits[t + 1], values);
+  };
+  std::vector<std::thread> pool;
+  for (int t = 1; t < numThreads; t++) pool.emplace_back(worker, t);
+  worker(0);
+  for (auto& th : pool) th.join();
+
+  for (const char* e : errors)
+    if (e) {
+      errorAt = e;
+      return false;
+    }
+  return true;
+}
+
+bool CMatrixReader::ReadCache(const std::filesystem::path& path,
+                              CMatrixData& data) {
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  if (!SourceStamp(path, sourceSize, sourceTime)) return false;
+
+  CMappedFile file;
+  CMatrixCacheHeader h;
+  if (!file.Open(CachePath(path)) || file.Size() < sizeof(h)) return false;
+  std::memcpy(&h, file.Data(), sizeof(h));
+  if (std::memcmp(h.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+      h.sourceSize != sourceSize || h.sourceTime != sourceTime ||
+      h.rows < 2 || h.cols < 2 || h.rows > kMaxGridSize ||
+      h.cols > kMaxGridSize)
+    return false;
+  const uint64_t cells = (uint64_t)h.rows * h.cols;
+  if (file.Size() != sizeof(h) + h.preambleSize + h.trailerSize +
+                         cells * sizeof(float))
+    return false;
+
+  data.Clear();
+  const char* p = file.Data() + sizeof(h);
+  data.preamble.assign(p, h.preambleSize);
+  p += h.preambleSize;
+  data.trailer.assign(p, h.trailerSize);
+  p += h.trailerSize;
+  ParseHeader(data.preamble.data(),
+              data.preamble.data() + data.preamble.size(), data.header);
+  data.values.create(h.rows, h.cols, CV_32F);
+  std::memcpy(data.values.ptr<float>(0), p, cells * sizeof(float));
+  return true;
+}
+
+void CMatrixReader::WriteCache(const std::filesystem::path& path,
+                               const CMatrixData& data) {
+  // Кэш — ускорение, а не результат: ошибки записи не мешают загрузке
+  CMatrixCacheHeader h = {};
+  std::memcpy(h.magic, kCacheMagic, sizeof(kCacheMagic));
+  if (!SourceStamp(path, h.sourceSize, h.sourceTime)) return;
+  h.rows = data.values.rows;
+  h.cols = data.values.cols;
+  h.preambleSize = data.preamble.size();
+  h.trailerSize = data.trailer.size();
+
+  const std::filesystem::path cache = CachePath(path);
+  std::ofstream out(cache, std::ios::binary);
+  if (!out.is_open()) return;
+  out.write((const char*)&h, sizeof(h));
+  out.write(data.preamble.data(), (std::streamsize)data.preamble.size());
+  out.write(data.trailer.data(), (std::streamsize)data.trailer.size());
+  for (int r = 0; r < h.rows; r++)
+    out.write((const char*)data.values.ptr<float>(r),
+              (std::streamsize)h.cols * sizeof(float));
+  out.close();
+  if (!out) {
+    std::error_code ec;
+    std::filesystem::remove(cache, ec);
+  }
+}
+
+//=============================================================================
+// CMatrixWriter
+//=============================================================================
+
+std::string CMatrixWriter::Format(const CMatrixData& data) {
+  const int size = data.values.rows;
+  std::string out;
+  out.reserve(data.preamble.size() + data.trailer.size() +
+              (size_t)size * size * 16 + 64);
+
+  if (!data.preamble.empty()) {
+    out += data.preamble;
+  } else {
+    out += "[GENERAL]\n";
+    bool hasSize = false;
+    for (const auto& kv : data.header) {
+      out += kv.first + "=" + kv.second + "\n";
+      hasSize |= kv.first == "Size";
+    }
+    if (!hasSize) out += "Size=" + std::to_string(size) + "\n";
+    out += "\n";
+  }
+
+  out += "[MATRIX]\n";
+  for (int r = 0; r < size && data.values.type() == CV_32F; r++) {
+    const float* row = data.values.ptr<float>(r);
+    if (std::none_of(row, row + data.values.cols,
+                     [](float v) { return std::isfinite(v); }))
+      continue;
+
+    out += ' ';
+    AppendFixed4(out, CMatrixData::Coordinate(r, size));
+    int pairs = 0;
+    for (int c = 0; c < data.values.cols; c++) {
+      if (!std::isfinite(row[c])) continue;
+      out += (pairs && pairs % kPairsPerLine == 0) ? "\n        " : " ";
+      AppendFixed4(out, row[c]);
+      out += ' ';
+      AppendFixed4(out, CMatrixData::Coordinate(c, data.values.cols));
+      pairs++;
+    }
+    out += " E\n";
+  }
+  out += "END\n";
+  out += data.trailer;
+  return out;
+}
+
+bool CMatrixWriter::WriteFile(const std::filesystem::path& path,
+                              const CMatrixData& data) {
+  if (data.values.empty() || data.values.type() != CV_32F ||
+      data.values.rows != data.values.cols) {
+    m_lastError = "сетка должна быть квадратной CV_32F";
+    return false;
+  }
+  std::string text = Format(data);
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) {
+    m_lastError = "не удалось создать " + path.string();
+    return false;
+  }
+  out.write(text.data(), (std::streamsize)text.size());
+  if (!out.good()) {
+    m_lastError = "ошибка записи " + path.string();
+    return false;
+  }
+  m_lastError.clear();
+  return true;
+}
+
+}  // namespace Interferometry
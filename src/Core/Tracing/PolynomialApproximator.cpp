@@ -7,27 +7,231 @@
  * @par Структура оригинала → порт
  *
  * - APPROXIM.C:40-206  (approxim)  → Approximate(), PreparePoints(), ComputeApproximation()
- * - APPROXIM.C:209-218 (alfa)      → ComputeAlpha()
- * - APPROXIM.C:221-232 (beta)      → ComputeBeta()
- * - APPROXIM.C:234-245 (norma)     → ComputeNorm()
- * - work.c: poly()                  → EvalPolynomial()
+ * - APPROXIM.C:209-218 (alfa)      → AlphaBeta()
+ * - APPROXIM.C:221-232 (beta)      → AlphaBeta()
+ * - APPROXIM.C:234-245 (norma)     → NextColumn(), ShiftColumn()
+ * - work.c: poly()                  → не нужен, см. ниже
  *
  * Убрано: графика (pix, outtextxy), DOS-аллокация (farcalloc),
  * глобальные переменные, модификация curve_line на месте.
+ *
+ * Оригинал в alfa/beta/norma и в проекциях заново вычисляет Qk(xx[i])
+ * схемой Горнера по коэффициентам a[k] — O(d²·N) на полином степени d.
+ * Порт хранит значения Q_{k-1} и Q_k в точках как столбцы m_qPrev / m_qCur
+ * и получает Q_{k+1} той же трёхчленной рекуррентностью прямо по столбцам:
+ * каждая степень — O(N), скалярные произведения — SIMD (AVX2 / SSE2).
+ * Коэффициенты a[k] по-прежнему ведутся рекуррентностью (O(k) на степень)
+ * для пересчёта в обычный полином.
  */
 
 #include "pch.h"
 #include "PolynomialApproximator.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <thread>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
 
 #include "FringeTracer.h"
 
 namespace Interferometry
 {
 
+  namespace
+  {
+
+    //===========================================================================
+    // Ядра по столбцам значений (SIMD)
+    //===========================================================================
+
+#if defined(__AVX2__)
+    constexpr int PV_LANES = 4;
+    using PvVec = __m256d;
+    inline PvVec PvLoad(const double *p) { return _mm256_loadu_pd(p); }
+    inline void PvStore(double *p, PvVec v) { _mm256_storeu_pd(p, v); }
+    inline PvVec PvSet(double v) { return _mm256_set1_pd(v); }
+    inline PvVec PvAdd(PvVec a, PvVec b) { return _mm256_add_pd(a, b); }
+    inline PvVec PvSub(PvVec a, PvVec b) { return _mm256_sub_pd(a, b); }
+    inline PvVec PvMul(PvVec a, PvVec b) { return _mm256_mul_pd(a, b); }
+    inline double PvSum(PvVec v)
+    {
+      __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),
+                             _mm256_extractf128_pd(v, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    constexpr int PV_LANES = 2;
+    using PvVec = __m128d;
+    inline PvVec PvLoad(const double *p) { return _mm_loadu_pd(p); }
+    inline void PvStore(double *p, PvVec v) { _mm_storeu_pd(p, v); }
+    inline PvVec PvSet(double v) { return _mm_set1_pd(v); }
+    inline PvVec PvAdd(PvVec a, PvVec b) { return _mm_add_pd(a, b); }
+    inline PvVec PvSub(PvVec a, PvVec b) { return _mm_sub_pd(a, b); }
+    inline PvVec PvMul(PvVec a, PvVec b) { return _mm_mul_pd(a, b); }
+    inline double PvSum(PvVec v)
+    {
+      return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+#else
+    // Без SIMD: «вектор» из одного double, хвостовые циклы пустые
+    constexpr int PV_LANES = 1;
+    using PvVec = double;
+    inline PvVec PvLoad(const double *p) { return *p; }
+    inline void PvStore(double *p, PvVec v) { *p = v; }
+    inline PvVec PvSet(double v) { return v; }
+    inline PvVec PvAdd(PvVec a, PvVec b) { return a + b; }
+    inline PvVec PvSub(PvVec a, PvVec b) { return a - b; }
+    inline PvVec PvMul(PvVec a, PvVec b) { return a * b; }
+    inline double PvSum(PvVec v) { return v; }
+#endif
+
+    /// Σ a[i]
+    double SumColumn(const double *a, int n)
+    {
+      PvVec acc = PvSet(0.0);
+      int i = 0;
+      for (; i + PV_LANES <= n; i += PV_LANES)
+        acc = PvAdd(acc, PvLoad(a + i));
+      double s = PvSum(acc);
+      for (; i < n; i++)
+        s += a[i];
+      return s;
+    }
+
+    /// out[i] = x[i] + shift; возвращает Σ out[i]²
+    double ShiftColumn(const double *x, double shift, double *out, int n)
+    {
+      const PvVec vs = PvSet(shift);
+      PvVec acc = PvSet(0.0);
+      int i = 0;
+      for (; i + PV_LANES <= n; i += PV_LANES)
+      {
+        PvVec v = PvAdd(PvLoad(x + i), vs);
+        PvStore(out + i, v);
+        acc = PvAdd(acc, PvMul(v, v));
+      }
+      double s = PvSum(acc);
+      for (; i < n; i++)
+      {
+        out[i] = x[i] + shift;
+        s += out[i] * out[i];
+      }
+      return s;
+    }
+
+    /// alfa/beta за один проход: α = Σ x·q², β = Σ x·q·qPrev
+    void AlphaBeta(const double *x, const double *q, const double *qPrev,
+                   int n, double &alpha, double &beta)
+    {
+      PvVec accA = PvSet(0.0), accB = PvSet(0.0);
+      int i = 0;
+      for (; i + PV_LANES <= n; i += PV_LANES)
+      {
+        PvVec vq = PvLoad(q + i);
+        PvVec t = PvMul(PvLoad(x + i), vq);
+        accA = PvAdd(accA, PvMul(t, vq));
+        accB = PvAdd(accB, PvMul(t, PvLoad(qPrev + i)));
+      }
+      alpha = PvSum(accA);
+      beta = PvSum(accB);
+      for (; i < n; i++)
+      {
+        double t = x[i] * q[i];
+        alpha += t * q[i];
+        beta += t * qPrev[i];
+      }
+    }
+
+    /**
+     * Следующий столбец на место qPrev:
+     * qPrev[i] = (x[i] - α)·q[i] - β·qPrev[i]; возвращает Σ qPrev[i]²
+     */
+    double NextColumn(const double *x, const double *q, double *qPrev,
+                      double alpha, double beta, int n)
+    {
+      const PvVec va = PvSet(alpha), vb = PvSet(beta);
+      PvVec acc = PvSet(0.0);
+      int i = 0;
+      for (; i + PV_LANES <= n; i += PV_LANES)
+      {
+        PvVec v = PvSub(PvMul(PvSub(PvLoad(x + i), va), PvLoad(q + i)),
+                        PvMul(vb, PvLoad(qPrev + i)));
+        PvStore(qPrev + i, v);
+        acc = PvAdd(acc, PvMul(v, v));
+      }
+      double s = PvSum(acc);
+      for (; i < n; i++)
+      {
+        qPrev[i] = (x[i] - alpha) * q[i] - beta * qPrev[i];
+        s += qPrev[i] * qPrev[i];
+      }
+      return s;
+    }
+
+    /// Нормировка столбца: q[i] *= scale; возвращает проекцию Σ y[i]·q[i]
+    double ScaleDot(double *q, double scale, const double *y, int n)
+    {
+      const PvVec vs = PvSet(scale);
+      PvVec acc = PvSet(0.0);
+      int i = 0;
+      for (; i + PV_LANES <= n; i += PV_LANES)
+      {
+        PvVec v = PvMul(PvLoad(q + i), vs);
+        PvStore(q + i, v);
+        acc = PvAdd(acc, PvMul(v, PvLoad(y + i)));
+      }
+      double s = PvSum(acc);
+      for (; i < n; i++)
+      {
+        q[i] *= scale;
+        s += q[i] * y[i];
+      }
+      return s;
+    }
+
+    /// r[i] -= b·q[i]; возвращает Σ r[i]² (невязка после очередной степени)
+    double SubtractScaled(double *r, const double *q, double b, int n)
+    {
+      const PvVec vb = PvSet(b);
+      PvVec acc = PvSet(0.0);
+      int i = 0;
+      for (; i + PV_LANES <= n; i += PV_LANES)
+      {
+        PvVec v = PvSub(PvLoad(r + i), PvMul(vb, PvLoad(q + i)));
+        PvStore(r + i, v);
+        acc = PvAdd(acc, PvMul(v, v));
+      }
+      double s = PvSum(acc);
+      for (; i < n; i++)
+      {
+        r[i] -= b * q[i];
+        s += r[i] * r[i];
+      }
+      return s;
+    }
+
+    DegreeSelection FixedDegree(int degree)
+    {
+      DegreeSelection selection;
+      selection.criterion = EDegreeCriterion::Fixed;
+      selection.degree = degree;
+      return selection;
+    }
+
+    int ClampDegree(int degree)
+    {
+      return (std::max)(1, (std::min)(degree, CPolynomialApproximator::MAX_DEGREE));
+    }
+
+  } // namespace
+
   //=============================================================================
   // ApproximationResult
   //=============================================================================
@@ -57,11 +261,12 @@ namespace Interferometry
   //=============================================================================
 
   CPolynomialApproximator::CPolynomialApproximator()
-      : m_numPoints(0), m_degree(0)
+      : m_trackResiduals(false), m_numPoints(0), m_degree(0)
   {
     std::memset(m_orthoCoeffs, 0, sizeof(m_orthoCoeffs));
     std::memset(m_projections, 0, sizeof(m_projections));
     std::memset(m_coefficients, 0, sizeof(m_coefficients));
+    std::memset(m_rss, 0, sizeof(m_rss));
   }
 
   CPolynomialApproximator::~CPolynomialApproximator() {}
@@ -77,40 +282,91 @@ namespace Interferometry
    */
   ApproximationResult CPolynomialApproximator::Approximate(
       const std::vector<CTracerPoint> &points, int degree)
+  {
+    return Approximate(points, FixedDegree(degree));
+  }
+
+  ApproximationResult CPolynomialApproximator::Approximate(
+      const std::vector<CTracerPoint> &points, const DegreeSelection &selection,
+      std::vector<DegreeResidual> *residuals)
   {
     ApproximationResult result;
+    LineFitInfo info;
+    double coeffs[MAX_DEGREE];
+
+    if (residuals)
+      residuals->clear();
+    if (!FitLine(points.data(), (int)points.size(), selection, coeffs, info,
+                 residuals))
+      return result;
+
+    result.degree = info.degree;
+    result.coefficients.assign(coeffs, coeffs + info.degree);
+    result.xMin = info.xMin;
+    result.xMax = info.xMax;
+    result.valid = true;
+    return result;
+  }
+
+  /**
+   * @details
+   * Общий путь Approximate() и ApproximateBatch(): выбор оси, Форсайт,
+   * выбор степени, копирование info.degree коэффициентов в coeffsOut.
+   * Память выделяется только при росте рабочих столбцов — на потоке пакета
+   * это один буфер на все линии.
+   *
+   * При переборе Форсайт строится сразу до верхней границы, невязки всех
+   * степеней берутся из m_rss, а в обычный полином пересчитываются только
+   * первые info.degree проекций.
+   */
+  bool CPolynomialApproximator::FitLine(const CTracerPoint *points,
+                                        int numPoints,
+                                        const DegreeSelection &selection,
+                                        double *coeffsOut, LineFitInfo &info,
+                                        std::vector<DegreeResidual> *residuals)
+  {
+    INTERF_TIMED_SCOPE(m_stats, Approximate);
+    info = LineFitInfo();
     m_lastError.clear();
 
-    if (points.size() < 3)
+    if (numPoints < 3)
     {
       m_lastError = "Недостаточно точек для аппроксимации (нужно >= 3)";
-      return result;
+      return false;
     }
 
-    if (degree < 1)
-      degree = 1;
-    if (degree > MAX_DEGREE)
-      degree = MAX_DEGREE;
-    m_degree = degree;
+    m_degree = ClampDegree(selection.degree);
 
-    if (!PreparePoints(points))
+    if (!PreparePoints(points, numPoints))
     {
-      return result;
+      return false;
     }
 
+    const bool select = selection.criterion != EDegreeCriterion::Fixed;
+    m_trackResiduals = select || residuals != nullptr;
     if (!ComputeApproximation())
     {
-      return result;
+      return false;
     }
 
-    // Заполнить результат
-    result.degree = m_degree;
-    result.coefficients.assign(m_coefficients, m_coefficients + m_degree);
-    result.xMin = m_xx.front();
-    result.xMax = m_xx.back();
-    result.valid = true;
+    if (residuals)
+    {
+      for (int p = 1; p <= m_degree; p++)
+        residuals->push_back(MakeResidual(p));
+    }
+    if (select)
+    {
+      m_degree = SelectDegree(selection);
+      ConvertToMonomial();
+    }
 
-    return result;
+    std::copy(m_coefficients, m_coefficients + m_degree, coeffsOut);
+    info.degree = m_degree;
+    info.xMin = m_xx[0];
+    info.xMax = m_xx[m_numPoints - 1];
+    info.valid = true;
+    INTERF_COUNT(m_stats, ApproxFits, 1);
+    return true;
   }
 
   /**
@@ -121,6 +377,7 @@ namespace Interferometry
   ApproximationResult CPolynomialApproximator::Approximate(
       const double *xx, const double *yy, int numPoints, int degree)
   {
+    INTERF_TIMED_SCOPE(m_stats, Approximate);
     ApproximationResult result;
     m_lastError.clear();
 
@@ -139,6 +396,7 @@ namespace Interferometry
     m_yy.assign(yy, yy + numPoints);
     m_numPoints = numPoints;
     m_degree = degree;
+    m_trackResiduals = false;
 
     // Ограничение степени по количеству точек (APPROXIM.C:95)
     if (m_numPoints < m_degree + 2)
@@ -161,10 +419,154 @@ namespace Interferometry
     result.xMin = m_xx.front();
     result.xMax = m_xx.back();
     result.valid = true;
+    INTERF_COUNT(m_stats, ApproxFits, 1);
 
     return result;
   }
 
+  //=============================================================================
+  // Пакетная аппроксимация
+  //=============================================================================
+
+  /**
+   * @details
+   * Линии раздаются потокам через атомарный счётчик (как линии в
+   * CFringeTracer::Extract). Поток 0 — сам объект, остальные — временные
+   * аппроксиматоры со своими m_xx / m_yy; каждый пишет только в свою строку
+   * out.coefficients и свой out.lines[i], поэтому синхронизация не нужна.
+   * Замеры рабочих потоков после join() складываются в m_stats.
+   */
+  bool CPolynomialApproximator::ApproximateBatch(const CTracerPoint *points,
+                                                 const int *offsets,
+                                                 int numLines, int degree,
+                                                 BatchApproximationResult &out,
+                                                 int numThreads)
+  {
+    return ApproximateBatch(points, offsets, numLines, FixedDegree(degree),
+                            out, numThreads);
+  }
+
+  bool CPolynomialApproximator::ApproximateBatch(
+      const CTracerPoint *points, const int *offsets, int numLines,
+      const DegreeSelection &selection, BatchApproximationResult &out,
+      int numThreads)
+  {
+    m_lastError.clear();
+    const int degree = ClampDegree(selection.degree);
+
+    out.stride = degree;
+    out.lines.assign(numLines, LineFitInfo());
+    out.coefficients.assign((size_t)numLines * degree, 0.0);
+    if (numLines <= 0)
+      return true;
+    if (!points || !offsets)
+    {
+      m_lastError = "Пустой пакет: points или offsets == nullptr";
+      return false;
+    }
+
+    if (numThreads <= 0)
+      numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0)
+      numThreads = 1;
+    if (numThreads > numLines)
+      numThreads = numLines;
+
+    std::atomic<int> next(0);
+    auto worker = [&](CPolynomialApproximator &approx)
+    {
+      for (int i = next++; i < numLines; i = next++)
+      {
+        approx.FitLine(points + offsets[i], offsets[i + 1] - offsets[i],
+                       selection, out.coefficients.data() + (size_t)i * degree,
+                       out.lines[i]);
+      }
+    };
+
+    if (numThreads == 1)
+    {
+      worker(*this);
+    }
+    else
+    {
+      std::vector<CPolynomialApproximator> helpers(numThreads - 1);
+      std::vector<std::thread> pool;
+      pool.reserve(numThreads - 1);
+      for (auto &h : helpers)
+        pool.emplace_back(worker, std::ref(h));
+      worker(*this);
+      for (auto &th : pool)
+        th.join();
+      for (const auto &h : helpers)
+        m_stats.Merge(h.GetStats());
+    }
+
+    // Текст ошибки отдельной линии не сохраняется — только valid
+    m_lastError.clear();
+    return true;
+  }
+
+  bool CPolynomialApproximator::ApproximateBatch(
+      const std::vector<std::vector<CTracerPoint>> &lines, int degree,
+      BatchApproximationResult &out, int numThreads)
+  {
+    return ApproximateBatch(lines, FixedDegree(degree), out, numThreads);
+  }
+
+  bool CPolynomialApproximator::ApproximateBatch(
+      const std::vector<std::vector<CTracerPoint>> &lines,
+      const DegreeSelection &selection, BatchApproximationResult &out,
+      int numThreads)
+  {
+    // Упаковка в CSR: одна копия точек на весь пакет
+    std::vector<int> offsets(lines.size() + 1, 0);
+    for (size_t i = 0; i < lines.size(); i++)
+      offsets[i + 1] = offsets[i] + (int)lines[i].size();
+
+    std::vector<CTracerPoint> points;
+    points.reserve(offsets.back());
+    for (const auto &line : lines)
+      points.insert(points.end(), line.begin(), line.end());
+
+    return ApproximateBatch(points.data(), offsets.data(), (int)lines.size(),
+                            selection, out, numThreads);
+  }
+
+  //=============================================================================
+  // BatchApproximationResult
+  //=============================================================================
+
+  double BatchApproximationResult::Evaluate(int line, double x) const
+  {
+    const LineFitInfo &info = lines[line];
+    if (!info.valid || info.degree <= 0)
+      return 0.0;
+
+    const double *c = Coefficients(line);
+    double result = c[info.degree - 1];
+    for (int i = info.degree - 2; i >= 0; i--)
+    {
+      result = result * x + c[i];
+    }
+    return result;
+  }
+
+  ApproximationResult BatchApproximationResult::ToResult(int line) const
+  {
+    ApproximationResult result;
+    const LineFitInfo &info = lines[line];
+    if (!info.valid)
+      return result;
+
+    result.valid = true;
+    result.degree = info.degree;
+    result.coefficients.assign(Coefficients(line),
+                               Coefficients(line) + info.degree);
+    result.xMin = info.xMin;
+    result.xMax = info.xMax;
+    return result;
+  }
+
   //=============================================================================
   // Подготовка точек
   //=============================================================================
@@ -194,10 +596,9 @@ namespace Interferometry
    * Если полоса горизонтальна (x монотонен) — m_xx = point.x, m_yy = point.y.
    * Если вертикальна (y монотонен) — m_xx = point.y, m_yy = point.x.
    */
-  bool CPolynomialApproximator::PreparePoints(
-      const std::vector<CTracerPoint> &points)
+  bool CPolynomialApproximator::PreparePoints(const CTracerPoint *points,
+                                              int n)
   {
-    int n = (int)points.size();
 
     // Определить, по какой оси полоса более монотонна
     // (как в оригинале: сравнение y[0] с y[1] и y[2])
@@ -227,8 +628,8 @@ namespace Interferometry
         // Прямой порядок (APPROXIM.C:72-76)
         for (int i = 0; i < n; i++)
         {
-          m_xx[i] = (double)points[i].y;
-          m_yy[i] = (double)points[i].x;
+          m_xx[i] = points[i].PosY();
+          m_yy[i] = points[i].PosX();
         }
       }
       else if (dy01 < 0 || dy02 < 0)
@@ -236,8 +637,8 @@ namespace Interferometry
         // Реверс (APPROXIM.C:77-88)
         for (int i = 0; i < n; i++)
         {
-          m_xx[i] = (double)points[n - 1 - i].y;
-          m_yy[i] = (double)points[n - 1 - i].x;
+          m_xx[i] = points[n - 1 - i].PosY();
+          m_yy[i] = points[n - 1 - i].PosX();
         }
       }
       else
@@ -253,16 +654,16 @@ namespace Interferometry
       {
         for (int i = 0; i < n; i++)
         {
-          m_xx[i] = (double)points[i].x;
-          m_yy[i] = (double)points[i].y;
+          m_xx[i] = points[i].PosX();
+          m_yy[i] = points[i].PosY();
         }
       }
       else if (dx01 < 0 || dx02 < 0)
       {
         for (int i = 0; i < n; i++)
         {
-          m_xx[i] = (double)points[n - 1 - i].x;
-          m_yy[i] = (double)points[n - 1 - i].y;
+          m_xx[i] = points[n - 1 - i].PosX();
+          m_yy[i] = points[n - 1 - i].PosY();
         }
       }
       else
@@ -312,10 +713,9 @@ namespace Interferometry
    * @par Шаг 4 — Рекуррентное построение Q2…Q_{step_pol-1} (APPROXIM.C:166-176)
    * @code
    *   for k=2..step_pol-1:
-   *     α = ComputeAlpha(k-1)
-   *     β = ComputeBeta(k-2, k-1)
+   *     α = Σ x·Q_{k-1}²,  β = Σ x·Q_{k-2}·Q_{k-1}    // alfa(), beta()
    *     a[k][j] = a[k-1][j-1] - α*a[k-1][j] - β*a[k-2][j]
-   *     нормировка на ||Qk||
+   *     нормировка на ||Qk||                        // norma()
    * @endcode
    *
    * @par Шаг 5 — Проекции y на базис (APPROXIM.C:179-183)
@@ -327,6 +727,15 @@ namespace Interferometry
    * @code
    *   c[i] = Σ b[j] * a[j][i]   для j=i..step_pol-1
    * @endcode
+   *
+   * Шаги 4 и 5 идут по столбцам значений: Qk(xx[i]) не вычисляется по a[k],
+   * а получается из двух предыдущих столбцов той же рекуррентностью
+   *   Qk(x) = ((x - α)·Q_{k-1}(x) - β·Q_{k-2}(x)) / ||·||,
+   * так что α, β, норма и b[k] — скалярные произведения столбцов.
+   *
+   * При m_trackResiduals из столбца невязки r = y вычитается b[k]·Qk после
+   * каждой степени: m_rss[k+1] = Σ r². Это точнее, чем Σy² - Σb², где
+   * малая невязка теряется на фоне Σy².
    */
   bool CPolynomialApproximator::ComputeApproximation()
   {
@@ -334,6 +743,7 @@ namespace Interferometry
     std::memset(m_orthoCoeffs, 0, sizeof(m_orthoCoeffs));
     std::memset(m_projections, 0, sizeof(m_projections));
     std::memset(m_coefficients, 0, sizeof(m_coefficients));
+    std::memset(m_rss, 0, sizeof(m_rss));
 
     if (m_numPoints < 2)
     {
@@ -341,21 +751,36 @@ namespace Interferometry
       return false;
     }
 
+    const int n = m_numPoints;
+    const double *xx = m_xx.data();
+    const double *yy = m_yy.data();
+    m_qPrev.resize(n);
+    m_qCur.resize(n);
+    double *qPrev = m_qPrev.data();
+    double *qCur = m_qCur.data();
+
     // --- Шаг 2: Q0(x) = 1/sqrt(N) ---
     // APPROXIM.C:134
-    m_orthoCoeffs[0][0] = 1.0 / std::sqrt((double)m_numPoints);
+    const double q0 = 1.0 / std::sqrt((double)n);
+    m_orthoCoeffs[0][0] = q0;
+    std::fill(qPrev, qPrev + n, q0);
+    m_projections[0] = q0 * SumColumn(yy, n);
 
-    // --- Шаг 3: Q1(x) = (x - mean(x)) / ||Q1|| ---
-    // APPROXIM.C:140-147
-    double sumX = 0.0;
-    for (int i = 0; i < m_numPoints; i++)
+    double *resid = nullptr;
+    if (m_trackResiduals)
     {
-      sumX += m_xx[i];
+      m_resid.assign(yy, yy + n);
+      resid = m_resid.data();
+      m_rss[1] = SubtractScaled(resid, qPrev, m_projections[0], n);
     }
-    m_orthoCoeffs[1][0] = -sumX / (double)m_numPoints;
+
+    // --- Шаг 3: Q1(x) = (x - mean(x)) / ||Q1|| ---
+    // APPROXIM.C:140-147
+    double meanX = SumColumn(xx, n) / (double)n;
+    m_orthoCoeffs[1][0] = -meanX;
     m_orthoCoeffs[1][1] = 1.0;
 
-    double norm1 = ComputeNorm(1);
+    double norm1 = ShiftColumn(xx, -meanX, qCur, n);
     if (norm1 <= 0.0)
     {
       m_lastError = "Норма Q1 == 0 (все точки совпадают по x?)";
@@ -364,13 +789,20 @@ namespace Interferometry
     double lambda = std::sqrt(norm1);
     m_orthoCoeffs[1][0] /= lambda;
     m_orthoCoeffs[1][1] /= lambda;
+    double b1 = ScaleDot(qCur, 1.0 / lambda, yy, n);
+    if (m_degree > 1)
+    {
+      m_projections[1] = b1;
+      if (resid)
+        m_rss[2] = SubtractScaled(resid, qCur, b1, n);
+    }
 
-    // --- Шаг 4: рекуррентное построение Q2…Q_{degree-1} ---
-    // APPROXIM.C:166-176
+    // --- Шаги 4-5: Q2…Q_{degree-1} и проекции <y, Qk> ---
+    // APPROXIM.C:166-183
     for (int k = 2; k < m_degree; k++)
     {
-      double alf = ComputeAlpha(k - 1);
-      double bet = ComputeBeta(k - 2, k - 1);
+      double alf, bet;
+      AlphaBeta(xx, qCur, qPrev, n, alf, bet);
 
       for (int j = 0; j <= k; j++)
       {
@@ -381,7 +813,8 @@ namespace Interferometry
         m_orthoCoeffs[k][k - j] = prev1 - alf * prev1_same - bet * prev2_same;
       }
 
-      double normK = ComputeNorm(k);
+      // Столбец Qk пишется на место Q_{k-2}
+      double normK = NextColumn(xx, qCur, qPrev, alf, bet, n);
       if (normK <= 0.0)
       {
         m_lastError = "Норма Q" + std::to_string(k) + " == 0";
@@ -392,127 +825,111 @@ namespace Interferometry
       {
         m_orthoCoeffs[k][j] /= lambda;
       }
-    }
-
-    // --- Шаг 5: проекции <y, Qk> ---
-    // APPROXIM.C:179-183
-    for (int k = 0; k < m_degree; k++)
-    {
-      m_projections[k] = 0.0;
-      for (int i = 0; i < m_numPoints; i++)
-      {
-        m_projections[k] +=
-            m_yy[i] * EvalPolynomial(m_xx[i], k, m_orthoCoeffs[k]);
-      }
+      m_projections[k] = ScaleDot(qPrev, 1.0 / lambda, yy, n);
+      if (resid)
+        m_rss[k + 1] = SubtractScaled(resid, qPrev, m_projections[k], n);
+      std::swap(qPrev, qCur);
     }
 
     // --- Шаг 6: пересчёт в обычные коэффициенты ---
-    // APPROXIM.C:184-191
-    //   approx_lines[line][i] = Σ b[j] * a[j][i]  для j=i..step_pol-1
-    for (int i = 0; i < m_degree; i++)
-    {
-      m_coefficients[i] = 0.0;
-      for (int j = i; j < m_degree; j++)
-      {
-        m_coefficients[i] += m_projections[j] * m_orthoCoeffs[j][i];
-      }
-    }
-
+    ConvertToMonomial();
     return true;
   }
 
-  //=============================================================================
-  // Вычисление полинома
-  //=============================================================================
-
   /**
    * @details
-   * Порт poly() из work.c (не показан в исходниках, восстановлен по вызовам).
+   * APPROXIM.C:184-191:
+   *   approx_lines[line][i] = Σ b[j] * a[j][i]  для j=i..step_pol-1
    *
-   * Вычисляет: c[0] + c[1]*x + c[2]*x² + … + c[degree]*x^degree
-   * по схеме Горнера: result = ((c[n]*x + c[n-1])*x + c[n-2])*x + …
+   * Берёт первые m_degree проекций, поэтому после уменьшения m_degree
+   * даёт полином меньшей степени без пересчёта базиса.
    */
-  double CPolynomialApproximator::EvalPolynomial(double x, int degree,
-                                                 const double *coeffs) const
+  void CPolynomialApproximator::ConvertToMonomial()
   {
-    if (degree < 0)
-      return 0.0;
-
-    double result = coeffs[degree];
-    for (int i = degree - 1; i >= 0; i--)
+    std::memset(m_coefficients, 0, sizeof(m_coefficients));
+    for (int i = 0; i < m_degree; i++)
     {
-      result = result * x + coeffs[i];
+      m_coefficients[i] = 0.0;
+      for (int j = i; j < m_degree; j++)
+      {
+        m_coefficients[i] += m_projections[j] * m_orthoCoeffs[j][i];
+      }
     }
-    return result;
   }
 
   //=============================================================================
-  // Коэффициенты рекуррентного соотношения
+  // Выбор степени
   //=============================================================================
 
-  /**
-   * @details
-   * Порт alfa() из APPROXIM.C:209-218:
-   * @code
-   *   for(i=0; i<num_point; i++) {
-   *     p = poly(xx[i], rang, a[rang]);
-   *     s += xx[i] * p * p;
-   *   }
-   * @endcode
-   */
-  double CPolynomialApproximator::ComputeAlpha(int k) const
+  DegreeResidual CPolynomialApproximator::MakeResidual(int degree) const
   {
-    double s = 0.0;
-    for (int i = 0; i < m_numPoints; i++)
-    {
-      double p = EvalPolynomial(m_xx[i], k, m_orthoCoeffs[k]);
-      s += m_xx[i] * p * p;
-    }
-    return s;
+    const double n = (double)m_numPoints;
+    DegreeResidual r;
+    r.degree = degree;
+    r.rss = (std::max)(m_rss[degree], 0.0);
+    r.rms = std::sqrt(r.rss / n);
+    r.disp = (m_numPoints > degree) ? std::sqrt(r.rss / (n - degree)) : 0.0;
+
+    // Точная подгонка (rss == 0) не должна давать -inf
+    double logMse = std::log((std::max)(r.rss / n, 1e-300));
+    r.aic = n * logMse + 2.0 * degree;
+    r.bic = n * logMse + degree * std::log(n);
+    return r;
   }
 
   /**
    * @details
-   * Порт beta() из APPROXIM.C:221-232:
-   * @code
-   *   for(i=0; i<num_point; i++) {
-   *     p1 = poly(xx[i], rang1, a[rang1]);
-   *     p2 = poly(xx[i], rang2, a[rang2]);
-   *     s += xx[i] * p1 * p2;
-   *   }
-   * @endcode
+   * AIC и BIC — минимум по степеням 1..m_degree (при равенстве — меньшая).
+   * Plateau — наименьшая степень, которая не больше чем на
+   * plateauTolerance хуже лучшей RMS из перебранных.
    */
-  double CPolynomialApproximator::ComputeBeta(int k1, int k2) const
+  int CPolynomialApproximator::SelectDegree(
+      const DegreeSelection &selection) const
   {
-    double s = 0.0;
-    for (int i = 0; i < m_numPoints; i++)
+    int best = 1;
+    switch (selection.criterion)
+    {
+    case EDegreeCriterion::Fixed:
+      return m_degree;
+
+    case EDegreeCriterion::AIC:
+    case EDegreeCriterion::BIC:
     {
-      double p1 = EvalPolynomial(m_xx[i], k1, m_orthoCoeffs[k1]);
-      double p2 = EvalPolynomial(m_xx[i], k2, m_orthoCoeffs[k2]);
-      s += m_xx[i] * p1 * p2;
+      const bool aic = selection.criterion == EDegreeCriterion::AIC;
+      double bestValue = 0.0;
+      for (int p = 1; p <= m_degree; p++)
+      {
+        DegreeResidual r = MakeResidual(p);
+        double value = aic ? r.aic : r.bic;
+        if (p == 1 || value < bestValue)
+        {
+          bestValue = value;
+          best = p;
+        }
+      }
+      break;
     }
-    return s;
-  }
 
-  /**
-   * @details
-   * Порт norma() из APPROXIM.C:234-245:
-   * @code
-   *   for(i=0; i<num_point; i++) {
-   *     p = poly(xx[i], rang, a[rang]);
-   *     s += p * p;
-   *   }
-   * @endcode
-   */
-  double CPolynomialApproximator::ComputeNorm(int k) const
-  {
-    double s = 0.0;
-    for (int i = 0; i < m_numPoints; i++)
+    case EDegreeCriterion::Plateau:
     {
-      double p = EvalPolynomial(m_xx[i], k, m_orthoCoeffs[k]);
-      s += p * p;
+      double minRss = m_rss[1];
+      for (int p = 2; p <= m_degree; p++)
+        minRss = (std::min)(minRss, m_rss[p]);
+      double limit = std::sqrt((std::max)(minRss, 0.0)) *
+                     (1.0 + (std::max)(selection.plateauTolerance, 0.0));
+      best = m_degree;
+      for (int p = 1; p <= m_degree; p++)
+      {
+        if (std::sqrt((std::max)(m_rss[p], 0.0)) <= limit)
+        {
+          best = p;
+          break;
+        }
+      }
+      break;
+    }
     }
-    return s;
+    return best;
   }
 
 } // namespace Interferometry
@@ -0,0 +1,571 @@
+/**
+ * @file ProjectFile.cpp
+ * @brief Секции .ifp: кодирование в буфер, CRC32, оглавление при Open()
+ *        и декодирование по требованию.
+ */
+#include "ProjectFile.h"
+
+#include <cstring>
+
+namespace Interferometry {
+
+namespace {
+
+const char kMagic[8] = {'I', 'F', 'P', 'R', 'O', 'J', '\0', '\0'};
+const size_t kFileHeaderSize = 16;
+const size_t kSectionHeaderSize = 24;
+
+const char kTags[(int)EProjectSection::Count][5] = {"INFO", "PIXL", "ELLP",
+                                                     "BNDS", "LINE", "APRX"};
+
+// Версии секций (растут независимо от версии формата).
+// BNDS 2: дополнительные дырки строк (несколько заслонок)
+// LINE 2: субпиксельный центр точки (offsetX, offsetY)
+const uint32_t kSectionVersions[(int)EProjectSection::Count] = {1, 1, 1,
+                                                                2, 2, 1};
+
+// Флаги ELLP
+const uint32_t kFlagOuter = 1u << 0;
+const uint32_t kFlagInner = 1u << 1;
+
+int SectionFromTag(const char* tag) {
+  for (int i = 0; i < (int)EProjectSection::Count; i++)
+    if (std::memcmp(tag, kTags[i], 4) == 0) return i;
+  return -1;
+}
+
+uint32_t Crc32(const char* data, size_t size) {
+  static uint32_t table[256];
+  static const bool init = [] {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    return true;
+  }();
+  (void)init;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++)
+    crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+//=============================================================================
+// Буферы секций (порядок байт — платформы, на которых собирается ядро:
+// x86 / x64, little-endian)
+//=============================================================================
+
+class CByteWriter {
+ public:
+  template <typename T>
+  void Put(const T& v) {
+    m_buf.append((const char*)&v, sizeof(T));
+  }
+  void PutBytes(const void* p, size_t n) { m_buf.append((const char*)p, n); }
+  void PutString(const std::string& s) {
+    Put((uint32_t)s.size());
+    m_buf.append(s);
+  }
+  std::string& Buffer() { return m_buf; }
+
+ private:
+  std::string m_buf;
+};
+
+class CByteReader {
+ public:
+  explicit CByteReader(const std::vector<char>& data)
+      : m_p(data.data()), m_end(data.data() + data.size()) {}
+
+  template <typename T>
+  bool Get(T& v) {
+    return GetBytes(&v, sizeof(T));
+  }
+  bool GetBytes(void* out, size_t n) {
+    if ((size_t)(m_end - m_p) < n) return false;
+    std::memcpy(out, m_p, n);
+    m_p += n;
+    return true;
+  }
+  bool GetString(std::string& s) {
+    uint32_t n;
+    if (!Get(n) || Remaining() < n) return false;
+    s.assign(m_p, n);
+    m_p += n;
+    return true;
+  }
+  size_t Remaining() const { return (size_t)(m_end - m_p); }
+
+ private:
+  const char* m_p;
+  const char* m_end;
+};
+
+struct CEllipseRecord {
+  int32_t centerX, centerY, semiAxisA, semiAxisB;
+  float angle;
+};
+
+struct CPointRecordV1 {
+  int32_t x, y;
+  float width, intensity;
+};
+
+struct CPointRecord {
+  int32_t x, y;
+  float offsetX, offsetY;
+  float width, intensity;
+};
+
+struct CFitRecord {
+  int32_t valid, degree;
+  double xMin, xMax;
+};
+
+CEllipseRecord ToRecord(const EllipseParams& e) {
+  return {e.centerX, e.centerY, e.semiAxisA, e.semiAxisB, e.angle};
+}
+
+EllipseParams FromRecord(const CEllipseRecord& r) {
+  return EllipseParams(r.centerX, r.centerY, r.semiAxisA, r.semiAxisB,
+                       r.angle);
+}
+
+//=============================================================================
+// Кодирование секций
+//=============================================================================
+
+void EncodeInfo(const CProjectData& d, CByteWriter& w) {
+  w.PutString(d.imagePath);
+  w.Put((int32_t)d.imageWidth);
+  w.Put((int32_t)d.imageHeight);
+}
+
+void EncodeImage(const CProjectData& d, CByteWriter& w) {
+  const cv::Mat& m = d.pixels;
+  w.Put((int32_t)m.rows);
+  w.Put((int32_t)m.cols);
+  w.Put((int32_t)m.type());
+  const size_t rowBytes = (size_t)m.cols * m.elemSize();
+  for (int r = 0; r < m.rows; r++) w.PutBytes(m.ptr(r), rowBytes);
+}
+
+void EncodeEllipses(const CProjectData& d, CByteWriter& w) {
+  w.Put((uint32_t)((d.hasOuter ? kFlagOuter : 0) |
+                   (d.hasInner ? kFlagInner : 0)));
+  w.Put(ToRecord(d.outerEllipse));
+  w.Put(ToRecord(d.innerEllipse));
+}
+
+void EncodeBoundaries(const CProjectData& d, CByteWriter& w) {
+  w.Put((uint32_t)d.boundaries.size());
+  for (const RowBoundary& b : d.boundaries) {
+    int32_t v[4] = {b.leftOuter, b.leftInner, b.rightInner, b.rightOuter};
+    w.PutBytes(v, sizeof(v));
+  }
+  w.Put((uint32_t)d.extraHoles.size());
+  for (const CRowHole& h : d.extraHoles) {
+    int32_t v[3] = {h.row, h.x0, h.x1};
+    w.PutBytes(v, sizeof(v));
+  }
+}
+
+// Счётчики точек всех линий, затем порядки, затем точки подряд
+void EncodeLines(const CProjectData& d, CByteWriter& w) {
+  const bool hasOrders = d.orders.size() == d.lines.size();
+  w.Put((uint32_t)d.lines.size());
+  w.Put((uint32_t)(hasOrders ? 1 : 0));
+  for (const auto& line : d.lines) w.Put((uint32_t)line.size());
+  if (hasOrders) w.PutBytes(d.orders.data(), d.orders.size() * sizeof(double));
+  for (const auto& line : d.lines)
+    for (const CTracerPoint& p : line)
+      w.Put(CPointRecord{p.x, p.y, p.offsetX, p.offsetY, p.width,
+                         p.intensity});
+}
+
+void EncodeApproximation(const CProjectData& d, CByteWriter& w) {
+  const BatchApproximationResult& a = d.approximation;
+  w.Put((int32_t)a.stride);
+  w.Put((uint32_t)a.lines.size());
+  for (const LineFitInfo& f : a.lines)
+    w.Put(CFitRecord{f.valid ? 1 : 0, f.degree, f.xMin, f.xMax});
+  w.PutBytes(a.coefficients.data(), a.coefficients.size() * sizeof(double));
+}
+
+//=============================================================================
+// Декодирование секций
+//=============================================================================
+
+bool DecodeInfo(CByteReader& r, CProjectData& d) {
+  int32_t w, h;
+  if (!r.GetString(d.imagePath) || !r.Get(w) || !r.Get(h)) return false;
+  d.imageWidth = w;
+  d.imageHeight = h;
+  return true;
+}
+
+bool DecodeImage(CByteReader& r, CProjectData& d) {
+  int32_t rows, cols, type;
+  if (!r.Get(rows) || !r.Get(cols) || !r.Get(type)) return false;
+  if (rows < 0 || cols < 0 || type < 0 || type >= CV_DEPTH_MAX * CV_CN_MAX)
+    return false;
+  const size_t rowBytes = (size_t)cols * CV_ELEM_SIZE(type);
+  if (r.Remaining() != rowBytes * rows) return false;
+  d.pixels.create(rows, cols, type);
+  for (int y = 0; y < rows; y++) r.GetBytes(d.pixels.ptr(y), rowBytes);
+  return true;
+}
+
+bool DecodeEllipses(CByteReader& r, CProjectData& d) {
+  uint32_t flags;
+  CEllipseRecord outer, inner;
+  if (!r.Get(flags) || !r.Get(outer) || !r.Get(inner)) return false;
+  d.hasOuter = (flags & kFlagOuter) != 0;
+  d.hasInner = (flags & kFlagInner) != 0;
+  d.outerEllipse = FromRecord(outer);
+  d.innerEllipse = FromRecord(inner);
+  return true;
+}
+
+bool DecodeBoundaries(CByteReader& r, uint32_t version, CProjectData& d) {
+  uint32_t n;
+  if (!r.Get(n)) return false;
+  const size_t table = (size_t)n * 4 * sizeof(int32_t);
+  if (version >= 2 ? r.Remaining() < table : r.Remaining() != table)
+    return false;
+  d.boundaries.resize(n);
+  for (RowBoundary& b : d.boundaries) {
+    int32_t v[4];
+    r.GetBytes(v, sizeof(v));
+    b.leftOuter = v[0];
+    b.leftInner = v[1];
+    b.rightInner = v[2];
+    b.rightOuter = v[3];
+  }
+
+  d.extraHoles.clear();
+  if (version < 2) return true;
+  uint32_t numHoles;
+  if (!r.Get(numHoles) ||
+      r.Remaining() != (size_t)numHoles * 3 * sizeof(int32_t))
+    return false;
+  d.extraHoles.resize(numHoles);
+  for (CRowHole& h : d.extraHoles) {
+    int32_t v[3];
+    r.GetBytes(v, sizeof(v));
+    h.row = v[0];
+    h.x0 = v[1];
+    h.x1 = v[2];
+  }
+  return true;
+}
+
+bool DecodeLines(CByteReader& r, uint32_t version, CProjectData& d) {
+  uint32_t numLines, hasOrders;
+  if (!r.Get(numLines) || !r.Get(hasOrders) ||
+      r.Remaining() < (size_t)numLines * sizeof(uint32_t))
+    return false;
+  std::vector<uint32_t> counts(numLines);
+  r.GetBytes(counts.data(), counts.size() * sizeof(uint32_t));
+
+  uint64_t total = 0;
+  for (uint32_t c : counts) total += c;
+  const uint64_t expected = (hasOrders ? numLines * sizeof(double) : 0) +
+                            total * (version >= 2 ? sizeof(CPointRecord)
+                                                  : sizeof(CPointRecordV1));
+  if (r.Remaining() != expected) return false;
+
+  d.orders.assign(hasOrders ? numLines : 0, 0.0);
+  r.GetBytes(d.orders.data(), d.orders.size() * sizeof(double));
+  d.lines.assign(numLines, {});
+  for (uint32_t i = 0; i < numLines; i++) {
+    std::vector<CTracerPoint>& line = d.lines[i];
+    line.resize(counts[i]);
+    for (CTracerPoint& p : line) {
+      if (version >= 2) {
+        CPointRecord rec;
+        r.Get(rec);
+        p.x = rec.x;
+        p.y = rec.y;
+        p.offsetX = rec.offsetX;
+        p.offsetY = rec.offsetY;
+        p.width = rec.width;
+        p.intensity = rec.intensity;
+      } else {
+        CPointRecordV1 rec;
+        r.Get(rec);
+        p.x = rec.x;
+        p.y = rec.y;
+        p.width = rec.width;
+        p.intensity = rec.intensity;
+      }
+    }
+  }
+  return true;
+}
+
+bool DecodeApproximation(CByteReader& r, CProjectData& d) {
+  int32_t stride;
+  uint32_t n;
+  if (!r.Get(stride) || !r.Get(n) || stride < 0 ||
+      r.Remaining() != (size_t)n * (sizeof(CFitRecord) +
+                                    (size_t)stride * sizeof(double)))
+    return false;
+  BatchApproximationResult& a = d.approximation;
+  a.stride = stride;
+  a.lines.resize(n);
+  for (LineFitInfo& f : a.lines) {
+    CFitRecord rec;
+    r.Get(rec);
+    f.valid = rec.valid != 0;
+    f.degree = rec.degree;
+    f.xMin = rec.xMin;
+    f.xMax = rec.xMax;
+  }
+  a.coefficients.resize((size_t)n * stride);
+  r.GetBytes(a.coefficients.data(), a.coefficients.size() * sizeof(double));
+  return true;
+}
+
+}  // namespace
+
+//=============================================================================
+// CProjectData
+//=============================================================================
+
+void CProjectData::Clear() {
+  imagePath.clear();
+  imageWidth = imageHeight = 0;
+  pixels.release();
+  hasOuter = hasInner = false;
+  outerEllipse = innerEllipse = EllipseParams();
+  boundaries.clear();
+  extraHoles.clear();
+  lines.clear();
+  orders.clear();
+  approximation = BatchApproximationResult();
+}
+
+void CProjectData::SetBoundary(const CEllipseBoundary& boundary) {
+  imageWidth = boundary.GetImageWidth();
+  imageHeight = boundary.GetImageHeight();
+  boundaries = boundary.GetAllBoundaries();
+  extraHoles = boundary.GetAllExtraHoles();
+}
+
+bool CProjectData::RestoreBoundary(CEllipseBoundary& boundary) const {
+  if (imageWidth <= 0 || imageHeight <= 0 ||
+      boundaries.size() != (size_t)imageHeight)
+    return false;
+  boundary.Initialize(imageWidth, imageHeight);
+  for (int y = 0; y < imageHeight; y++)
+    boundary.GetRowBoundary(y) = boundaries[y];
+  boundary.SetAllExtraHoles(extraHoles);
+  return true;
+}
+
+//=============================================================================
+// CProjectWriter
+//=============================================================================
+
+bool CProjectWriter::WriteFile(const std::filesystem::path& path,
+                               const CProjectData& data) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out.is_open()) {
+    m_lastError = "не удалось создать " + path.string();
+    return false;
+  }
+
+  const uint32_t version = CProjectReader::FORMAT_VERSION;
+  const uint32_t reserved = 0;
+  out.write(kMagic, sizeof(kMagic));
+  out.write((const char*)&version, sizeof(version));
+  out.write((const char*)&reserved, sizeof(reserved));
+
+  auto writeSection = [&](EProjectSection section,
+                          void (*encode)(const CProjectData&, CByteWriter&)) {
+    CByteWriter w;
+    encode(data, w);
+    const std::string& payload = w.Buffer();
+    const uint64_t size = payload.size();
+    const uint32_t crc = Crc32(payload.data(), payload.size());
+    out.write(kTags[(int)section], 4);
+    const uint32_t sectionVersion = kSectionVersions[(int)section];
+    out.write((const char*)&sectionVersion, sizeof(sectionVersion));
+    out.write((const char*)&size, sizeof(size));
+    out.write((const char*)&crc, sizeof(crc));
+    out.write((const char*)&reserved, sizeof(reserved));
+    out.write(payload.data(), (std::streamsize)payload.size());
+  };
+
+  // Маленькие секции — первыми: Open() быстрее доходит до конца оглавления
+  writeSection(EProjectSection::Info, EncodeInfo);
+  writeSection(EProjectSection::Ellipses, EncodeEllipses);
+  writeSection(EProjectSection::Boundaries, EncodeBoundaries);
+  writeSection(EProjectSection::Lines, EncodeLines);
+  if (!data.approximation.lines.empty())
+    writeSection(EProjectSection::Approximation, EncodeApproximation);
+  if (!data.pixels.empty()) writeSection(EProjectSection::Image, EncodeImage);
+
+  if (!out.good()) {
+    m_lastError = "ошибка записи " + path.string();
+    return false;
+  }
+  m_lastError.clear();
+  return true;
+}
+
+//=============================================================================
+// CProjectReader
+//=============================================================================
+
+bool CProjectReader::Open(const std::filesystem::path& path) {
+  Close();
+  m_path = path;
+  std::error_code ec;
+  const uint64_t fileSize = std::filesystem::file_size(path, ec);
+  m_file.open(path, std::ios::binary);
+  if (ec || !m_file.is_open()) {
+    m_lastError = "не удалось открыть " + path.string();
+    Close();
+    return false;
+  }
+
+  char header[kFileHeaderSize];
+  if (!m_file.read(header, sizeof(header)) ||
+      std::memcmp(header, kMagic, sizeof(kMagic)) != 0) {
+    m_lastError = path.string() + ": не файл проекта";
+    Close();
+    return false;
+  }
+  std::memcpy(&m_version, header + 8, sizeof(m_version));
+  if (m_version > FORMAT_VERSION) {
+    m_lastError = path.string() + ": версия формата " +
+                  std::to_string(m_version) + " новее поддерживаемой";
+    Close();
+    return false;
+  }
+
+  // Оглавление: заголовки секций, данные пропускаются
+  uint64_t pos = kFileHeaderSize;
+  while (pos + kSectionHeaderSize <= fileSize) {
+    char sh[kSectionHeaderSize];
+    m_file.seekg((std::streamoff)pos);
+    if (!m_file.read(sh, sizeof(sh))) break;
+    CSectionEntry e;
+    e.present = true;
+    std::memcpy(&e.version, sh + 4, sizeof(e.version));
+    std::memcpy(&e.size, sh + 8, sizeof(e.size));
+    std::memcpy(&e.crc, sh + 16, sizeof(e.crc));
+    e.offset = pos + kSectionHeaderSize;
+    if (e.size > fileSize - e.offset) {
+      m_lastError = path.string() + ": секция " + std::string(sh, 4) +
+                    " обрезана";
+      Close();
+      return false;
+    }
+    int s = SectionFromTag(sh);
+    if (s >= 0 && !m_sections[s].present) m_sections[s] = e;
+    pos = e.offset + e.size;
+  }
+  m_file.clear();
+  m_lastError.clear();
+  return true;
+}
+
+void CProjectReader::Close() {
+  if (m_file.is_open()) m_file.close();
+  m_file.clear();
+  m_version = 0;
+  for (CSectionEntry& e : m_sections) e = CSectionEntry();
+}
+
+bool CProjectReader::HasSection(EProjectSection section) const {
+  return m_sections[(int)section].present;
+}
+
+uint64_t CProjectReader::GetSectionSize(EProjectSection section) const {
+  return m_sections[(int)section].size;
+}
+
+bool CProjectReader::ReadPayload(EProjectSection section,
+                                 std::vector<char>& payload) {
+  const CSectionEntry& e = m_sections[(int)section];
+  const std::string tag = kTags[(int)section];
+  if (!m_file.is_open()) {
+    m_lastError = "проект не открыт";
+    return false;
+  }
+  if (!e.present) {
+    m_lastError = "нет секции " + tag;
+    return false;
+  }
+  if (e.version > kSectionVersions[(int)section]) {
+    m_lastError = "секция " + tag + " версии " + std::to_string(e.version) +
+                  " новее поддерживаемой";
+    return false;
+  }
+  payload.resize((size_t)e.size);
+  m_file.clear();
+  m_file.seekg((std::streamoff)e.offset);
+  if (!m_file.read(payload.data(), (std::streamsize)payload.size())) {
+    m_lastError = "ошибка чтения секции " + tag;
+    return false;
+  }
+  if (Crc32(payload.data(), payload.size()) != e.crc) {
+    m_lastError = "секция " + tag + " повреждена (CRC)";
+    return false;
+  }
+  return true;
+}
+
+bool CProjectReader::Load(EProjectSection section, CProjectData& data) {
+  std::vector<char> payload;
+  if (!ReadPayload(section, payload)) return false;
+
+  CByteReader r(payload);
+  bool ok = false;
+  switch (section) {
+    case EProjectSection::Info:
+      ok = DecodeInfo(r, data);
+      break;
+    case EProjectSection::Image:
+      ok = DecodeImage(r, data);
+      break;
+    case EProjectSection::Ellipses:
+      ok = DecodeEllipses(r, data);
+      break;
+    case EProjectSection::Boundaries:
+      ok = DecodeBoundaries(r, m_sections[(int)section].version, data);
+      break;
+    case EProjectSection::Lines:
+      ok = DecodeLines(r, m_sections[(int)section].version, data);
+      break;
+    case EProjectSection::Approximation:
+      ok = DecodeApproximation(r, data);
+      break;
+    case EProjectSection::Count:
+      break;
+  }
+  if (!ok) {
+    m_lastError = "неверные данные секции " +
+                  std::string(kTags[(int)section]);
+    return false;
+  }
+  return true;
+}
+
+bool CProjectReader::LoadAll(CProjectData& data, bool withImage) {
+  data.Clear();
+  for (int s = 0; s < (int)EProjectSection::Count; s++) {
+    EProjectSection section = (EProjectSection)s;
+    if (!HasSection(section)) continue;
+    if (section == EProjectSection::Image && !withImage) continue;
+    if (!Load(section, data)) return false;
+  }
+  return true;
+}
+
+}  // namespace Interferometry
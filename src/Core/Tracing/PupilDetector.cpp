@@ -0,0 +1,570 @@
+#include "PupilDetector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <opencv2/imgproc.hpp>
+#include <random>
+
+#include "Constants.h"
+
+namespace Interferometry {
+
+namespace {
+
+// Шаг вдоль луча, пикселей уменьшенного кадра
+constexpr double kRayStep = 0.5;
+// cv::fitEllipse требует не меньше 5 точек
+constexpr int kMinFitPoints = 5;
+// Экранирование почти круглое: вытянутый «эллипс» — тёмная полоса
+constexpr double kMinInnerAxisRatio = 0.5;
+// Автопорог — доля пути от фона к зрачку: ниже минимумов сглаженных тёмных
+// полос, но выше шума фона. Смещение края от низкого порога снимают
+// RefineProfileEdge и RefineImageEdge
+constexpr double kAutoThresholdLevel = 0.1;
+// Уточнение по исходному кадру: скользящее среднее отсчётов и превышение
+// фона в СКО этого среднего
+constexpr int kEdgeAverage = 5;
+constexpr double kEdgeSigmas = 4.0;
+constexpr int kMinBackgroundSamples = 8;
+// Экранирование затенено, как фон вне зрачка: уровень внутри выше фона не
+// больше чем на эту долю пути до порога. Тёмная центральная полоса колец
+// светлее фона и экранированием не считается
+constexpr double kScreenLevel = 0.25;
+constexpr int kHistBins = 256;
+
+struct CEllipseFit {
+  cv::RotatedRect ellipse;
+  int inliers = 0;
+  double rms = 0.0;
+};
+
+bool IsSane(const cv::RotatedRect& e, double maxSize) {
+  return std::isfinite(e.center.x) && std::isfinite(e.center.y) &&
+         std::isfinite(e.angle) && e.size.width > 0.0f &&
+         e.size.height > 0.0f && e.size.width < maxSize &&
+         e.size.height < maxSize;
+}
+
+// Расстояние от точки до эллипса вдоль луча из его центра
+double RadialResidual(const cv::RotatedRect& e, const cv::Point2f& p) {
+  const double a = 0.5 * e.size.width;
+  const double b = 0.5 * e.size.height;
+  const double t = e.angle * Physics::PI / 180.0;
+  const double ct = std::cos(t), st = std::sin(t);
+  const double dx = p.x - e.center.x, dy = p.y - e.center.y;
+  const double u = dx * ct + dy * st;
+  const double v = -dx * st + dy * ct;
+  const double k = std::sqrt(u * u / (a * a) + v * v / (b * b));
+  if (k <= 0.0) return (std::min)(a, b);
+  return std::fabs(1.0 - 1.0 / k) * std::sqrt(dx * dx + dy * dy);
+}
+
+// Точка внутри эллипса
+bool IsInsideFit(const cv::RotatedRect& e, const cv::Point2f& p) {
+  const double a = 0.5 * e.size.width;
+  const double b = 0.5 * e.size.height;
+  const double t = e.angle * Physics::PI / 180.0;
+  const double dx = p.x - e.center.x, dy = p.y - e.center.y;
+  const double u = dx * std::cos(t) + dy * std::sin(t);
+  const double v = -dx * std::sin(t) + dy * std::cos(t);
+  return u * u / (a * a) + v * v / (b * b) < 1.0;
+}
+
+int CountInliers(const cv::RotatedRect& e,
+                 const std::vector<cv::Point2f>& points, double tolerance,
+                 double* sumSq) {
+  int n = 0;
+  double s = 0.0;
+  for (const cv::Point2f& p : points) {
+    const double r = RadialResidual(e, p);
+    if (r <= tolerance) {
+      n++;
+      s += r * r;
+    }
+  }
+  if (sumSq) *sumSq = s;
+  return n;
+}
+
+// RANSAC по 5 точкам, затем fitEllipse по всем inlier'ам лучшей гипотезы
+bool FitEllipseRansac(const std::vector<cv::Point2f>& points,
+                      const CPupilDetectorParams& params, double tolerance,
+                      double maxSize, int minInliers, CEllipseFit& fit) {
+  const int n = (int)points.size();
+  if (n < kMinFitPoints) return false;
+
+  std::mt19937 rng(params.seed);
+  std::vector<int> index(n);
+  std::iota(index.begin(), index.end(), 0);
+  std::vector<cv::Point2f> sample(kMinFitPoints);
+
+  const int iterations =
+      n == kMinFitPoints ? 1 : (std::max)(1, params.ransacIterations);
+  cv::RotatedRect best;
+  int bestInliers = 0;
+  double bestCost = std::numeric_limits<double>::max();
+  for (int it = 0; it < iterations; it++) {
+    // Частичная перестановка Фишера — Йетса: 5 разных точек
+    for (int k = 0; k < kMinFitPoints; k++) {
+      const int j = k + (int)(rng() % (uint32_t)(n - k));
+      std::swap(index[k], index[j]);
+      sample[k] = points[index[k]];
+    }
+    const cv::RotatedRect e = cv::fitEllipse(sample);
+    if (!IsSane(e, maxSize)) continue;
+    double cost = 0.0;
+    const int inliers = CountInliers(e, points, tolerance, &cost);
+    if (inliers > bestInliers ||
+        (inliers == bestInliers && cost < bestCost)) {
+      best = e;
+      bestInliers = inliers;
+      bestCost = cost;
+    }
+  }
+  if (bestInliers < (std::max)(minInliers, kMinFitPoints)) return false;
+
+  std::vector<cv::Point2f> inlierPoints;
+  inlierPoints.reserve(bestInliers);
+  for (const cv::Point2f& p : points)
+    if (RadialResidual(best, p) <= tolerance) inlierPoints.push_back(p);
+  cv::RotatedRect refined = cv::fitEllipse(inlierPoints);
+  if (!IsSane(refined, maxSize)) refined = best;
+
+  double sumSq = 0.0;
+  int inliers = CountInliers(refined, points, tolerance, &sumSq);
+  if (inliers < bestInliers) {
+    // Уточнение ухудшило согласие — остаётся гипотеза RANSAC
+    refined = best;
+    inliers = CountInliers(best, points, tolerance, &sumSq);
+  }
+  fit.ellipse = refined;
+  fit.inliers = inliers;
+  fit.rms = inliers > 0 ? std::sqrt(sumSq / inliers) : 0.0;
+  return true;
+}
+
+// Уровни фона и зрачка: средние тёмного и светлого классов разбиения Оцу
+// значений CV_32F из диапазона [lo, hi]
+void OtsuLevels(const cv::Mat& mean, double lo, double hi, double& dark,
+                double& bright) {
+  std::vector<int64_t> hist(kHistBins, 0);
+  const double scale = (kHistBins - 1) / (hi - lo);
+  for (int y = 0; y < mean.rows; y++) {
+    const float* p = mean.ptr<float>(y);
+    for (int x = 0; x < mean.cols; x++) hist[(int)((p[x] - lo) * scale)]++;
+  }
+  const double total = (double)mean.total();
+  double sumAll = 0.0;
+  for (int i = 0; i < kHistBins; i++) sumAll += (double)i * hist[i];
+
+  double w0 = 0.0, sum0 = 0.0, bestVar = -1.0;
+  double m0Best = 0.0, m1Best = kHistBins - 1;
+  for (int t = 0; t < kHistBins - 1; t++) {
+    w0 += (double)hist[t];
+    sum0 += (double)t * hist[t];
+    const double w1 = total - w0;
+    if (w0 <= 0.0 || w1 <= 0.0) continue;
+    const double m0 = sum0 / w0;
+    const double m1 = (sumAll - sum0) / w1;
+    const double var = w0 * w1 * (m0 - m1) * (m0 - m1);
+    if (var > bestVar) {
+      bestVar = var;
+      m0Best = m0;
+      m1Best = m1;
+    }
+  }
+  // Средние корзин → уровни яркости (центр корзины)
+  dark = lo + (m0Best + 0.5) / scale;
+  bright = lo + (m1Best + 0.5) / scale;
+}
+
+double Median(std::vector<double>& v) {
+  std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+  return v[v.size() / 2];
+}
+
+double MeanOf(const std::vector<float>& v, int k0, int k1) {
+  double s = 0.0;
+  for (int k = k0; k < k1; k++) s += v[k];
+  return s / (k1 - k0);
+}
+
+float SampleBilinear(const cv::Mat& m, double x, double y) {
+  const int x0 = (std::min)((int)x, m.cols - 2);
+  const int y0 = (std::min)((int)y, m.rows - 2);
+  const float fx = (float)(x - x0), fy = (float)(y - y0);
+  const float* r0 = m.ptr<float>(y0) + x0;
+  const float* r1 = m.ptr<float>(y0 + 1) + x0;
+  const float top = r0[0] + (r0[1] - r0[0]) * fx;
+  const float bottom = r1[0] + (r1[1] - r1[0]) * fx;
+  return top + (bottom - top) * fy;
+}
+
+/**
+ * Положение перехода между отсчётами i - 1 и i профиля, в отсчётах:
+ * пересечение с серединой между средними уровнями по обе стороны перехода,
+ * ближайшее к i. Уровни — средние по окнам [i - 2w, i - w) и [i + w, i + 2w):
+ * вне сглаженного склона, остаток полос усредняется. Без такого
+ * пересечения — по порогу.
+ */
+double RefineProfileEdge(const std::vector<float>& v, int i, double threshold,
+                  int window) {
+  const int n = (int)v.size();
+  auto mean = [&](int k0, int k1, double fallback) {
+    k0 = (std::max)(k0, 0);
+    k1 = (std::min)(k1, n);
+    if (k0 >= k1) return fallback;
+    double s = 0.0;
+    for (int k = k0; k < k1; k++) s += v[k];
+    return s / (k1 - k0);
+  };
+  const double before = mean(i - 2 * window, i - window, v[i - 1]);
+  const double after = mean(i + window, i + 2 * window, v[i]);
+  const double mid = 0.5 * (before + after);
+
+  int bestK = -1;
+  for (int k = (std::max)(1, i - window); k < (std::min)(n, i + window); k++) {
+    const double d0 = v[k - 1] - mid, d1 = v[k] - mid;
+    if (d0 == d1 || d0 * d1 > 0.0) continue;
+    if (bestK < 0 || std::abs(k - i) < std::abs(bestK - i)) bestK = k;
+  }
+  double level = mid;
+  if (bestK < 0) {
+    bestK = i;
+    level = threshold;
+  }
+  const double d0 = v[bestK - 1] - level, d1 = v[bestK] - level;
+  const double t = d0 == d1 ? 0.5 : d0 / (d0 - d1);
+  return bestK - 1 + (std::min)((std::max)(t, 0.0), 1.0);
+}
+
+template <typename T>
+double PixelAt(const cv::Mat& image, double x, double y) {
+  const int x0 = (std::min)((int)x, image.cols - 2);
+  const int y0 = (std::min)((int)y, image.rows - 2);
+  const double fx = x - x0, fy = y - y0;
+  const T* r0 = image.ptr<T>(y0) + x0;
+  const T* r1 = image.ptr<T>(y0 + 1) + x0;
+  const double top = r0[0] + ((double)r0[1] - r0[0]) * fx;
+  const double bottom = r1[0] + ((double)r1[1] - r1[0]) * fx;
+  return top + (bottom - top) * fy;
+}
+
+double SampleImage(const cv::Mat& image, double x, double y) {
+  switch (image.depth()) {
+    case CV_8U: return PixelAt<uint8_t>(image, x, y);
+    case CV_8S: return PixelAt<int8_t>(image, x, y);
+    case CV_16U: return PixelAt<uint16_t>(image, x, y);
+    case CV_16S: return PixelAt<int16_t>(image, x, y);
+    case CV_32S: return PixelAt<int32_t>(image, x, y);
+    case CV_32F: return PixelAt<float>(image, x, y);
+    default: return PixelAt<double>(image, x, y);
+  }
+}
+
+/**
+ * Уточнение края по исходному кадру. Сглаженный профиль смещает край на
+ * долю окна в зависимости от фазы полос у края; в исходном кадре край —
+ * там, где яркость впервые отрывается от фона.
+ *
+ * От грубого края edge в сторону тени (единичный вектор dark) на
+ * [window, 2·window] берутся фон и его СКО; затем от window к -window
+ * с шагом в пиксель ищется, где скользящее среднее kEdgeAverage отсчётов
+ * превышает фон на kEdgeSigmas СКО (не меньше minStep).
+ * @param darkLength  сколько тени за краем (для экранирования — до начала
+ *                    лучей), пикселей кадра
+ * @return false — отрезка фона нет в кадре или отрыв не найден
+ */
+bool RefineImageEdge(const cv::Mat& image, cv::Point2f& edge, double darkX,
+                     double darkY, double darkLength, double window,
+                     double minStep) {
+  auto at = [&](double t, double& v) {
+    const double x = edge.x + darkX * t, y = edge.y + darkY * t;
+    if (x < 0.0 || y < 0.0 || x > image.cols - 1 || y > image.rows - 1)
+      return false;
+    v = SampleImage(image, x, y);
+    return true;
+  };
+
+  double sum = 0.0, sum2 = 0.0, v = 0.0;
+  int n = 0;
+  const double tMax = (std::min)(2.0 * window, darkLength);
+  for (double t = window; t <= tMax && at(t, v); t += 1.0) {
+    sum += v;
+    sum2 += v * v;
+    n++;
+  }
+  if (n < kMinBackgroundSamples) return false;
+  const double background = sum / n;
+  const double sd =
+      std::sqrt((std::max)(sum2 / n - background * background, 0.0));
+  const double level =
+      background +
+      (std::max)(kEdgeSigmas * sd / std::sqrt((double)kEdgeAverage), minStep);
+
+  // Отсчёты k: t = window - k. Среднее по [k - A + 1, k] первым отрывается
+  // от фона, когда в зрачок попадает новый отсчёт k — его положение и
+  // есть край
+  double ring[kEdgeAverage] = {};
+  double run = 0.0, prevMean = 0.0;
+  const int steps = (int)(2.0 * window);
+  for (int k = 0; k <= steps; k++) {
+    if (!at(window - k, v)) return false;
+    run += v - ring[k % kEdgeAverage];
+    ring[k % kEdgeAverage] = v;
+    if (k < kEdgeAverage - 1) continue;
+    const double mean = run / kEdgeAverage;
+    if (mean > level) {
+      if (k == kEdgeAverage - 1) return false;  // светло с самого начала
+      const double frac = (level - prevMean) / (mean - prevMean);
+      const double t = window - (k - 1) - frac;
+      edge.x += (float)(darkX * t);
+      edge.y += (float)(darkY * t);
+      return true;
+    }
+    prevMean = mean;
+  }
+  return false;
+}
+
+}  // namespace
+
+//=============================================================================
+// CPupilDetection
+//=============================================================================
+void CPupilDetection::Clear() {
+  hasOuter = hasInner = false;
+  outer = inner = EllipseParams();
+  threshold = 0.0;
+  origin = cv::Point2f();
+  outerPoints.clear();
+  innerPoints.clear();
+  outerInliers = innerInliers = 0;
+  outerRms = innerRms = 0.0;
+}
+
+//=============================================================================
+// Определение зрачка
+//=============================================================================
+bool CPupilDetector::Detect(const cv::Mat& image, CPupilDetection& result) {
+  INTERF_TIMED_SCOPE(m_stats, Pupil);
+  result.Clear();
+  m_lastError.clear();
+
+  if (image.empty() || image.channels() != 1) {
+    m_lastError = "Нужен непустой одноканальный кадр";
+    return false;
+  }
+  if (image.depth() == CV_16F) {
+    m_lastError = "Глубина кадра CV_16F не поддерживается";
+    return false;
+  }
+  if (image.cols < 8 || image.rows < 8) {
+    m_lastError = "Кадр слишком мал";
+    return false;
+  }
+
+  // --- Уменьшенный кадр: f — пикселей кадра на пиксель уменьшенного ---
+  const int longSide = (std::max)(image.cols, image.rows);
+  const int workSize = (std::max)(m_params.maxWorkSize, 16);
+  const double scale = (std::min)(1.0, (double)workSize / longSide);
+  const int sw = (std::max)(8, (int)std::lround(image.cols * scale));
+  const int sh = (std::max)(8, (int)std::lround(image.rows * scale));
+  if (sw == image.cols && sh == image.rows)
+    image.convertTo(m_small, CV_32F);
+  else if (image.depth() == CV_8S || image.depth() == CV_32S) {
+    // INTER_AREA не поддерживает 8S и 32S — уменьшаем копию во float
+    cv::Mat converted;
+    image.convertTo(converted, CV_32F);
+    cv::resize(converted, m_small, cv::Size(sw, sh), 0, 0, cv::INTER_AREA);
+  } else {
+    cv::resize(image, m_small, cv::Size(sw, sh), 0, 0, cv::INTER_AREA);
+    if (m_small.depth() != CV_32F) m_small.convertTo(m_small, CV_32F);
+  }
+  const double fx = (double)image.cols / sw;
+  const double fy = (double)image.rows / sh;
+  const double f = (std::max)(fx, fy);
+
+  // --- Среднее по окну ±R через интегральное изображение ---
+  const int R = (std::max)(1, (int)std::lround(m_params.smoothRadius / f));
+  cv::integral(m_small, m_sum, CV_64F);
+  m_mean.create(sh, sw, CV_32F);
+  for (int y = 0; y < sh; y++) {
+    const int y0 = (std::max)(y - R, 0), y1 = (std::min)(y + R + 1, sh);
+    const double* s0 = m_sum.ptr<double>(y0);
+    const double* s1 = m_sum.ptr<double>(y1);
+    float* out = m_mean.ptr<float>(y);
+    for (int x = 0; x < sw; x++) {
+      const int x0 = (std::max)(x - R, 0), x1 = (std::min)(x + R + 1, sw);
+      const double s = s1[x1] - s0[x1] - s1[x0] + s0[x0];
+      out[x] = (float)(s / ((x1 - x0) * (y1 - y0)));
+    }
+  }
+
+  // --- Порог ---
+  double lo = 0.0, hi = 0.0;
+  cv::minMaxLoc(m_mean, &lo, &hi);
+  if (hi - lo < 1e-6 * (std::max)(1.0, std::fabs(hi))) {
+    m_lastError = "Кадр однородный — зрачок не выделяется";
+    return false;
+  }
+  double threshold = m_params.threshold * hi;
+  if (m_params.threshold <= 0.0) {
+    double dark = 0.0, bright = 0.0;
+    OtsuLevels(m_mean, lo, hi, dark, bright);
+    threshold = dark + kAutoThresholdLevel * (bright - dark);
+  }
+  result.threshold = threshold;
+
+  // --- Начало лучей: центр масс светлой области ---
+  double sx = 0.0, sy = 0.0;
+  int64_t count = 0;
+  for (int y = 0; y < sh; y++) {
+    const float* p = m_mean.ptr<float>(y);
+    for (int x = 0; x < sw; x++)
+      if (p[x] > threshold) {
+        sx += x;
+        sy += y;
+        count++;
+      }
+  }
+  if (count == 0) {
+    m_lastError = "Нет пикселей выше порога";
+    return false;
+  }
+  const double ox = sx / count, oy = sy / count;
+  result.origin = cv::Point2f((float)((ox + 0.5) * fx - 0.5),
+                              (float)((oy + 0.5) * fy - 0.5));
+
+  // --- Лучи ---
+  const int numRays = (std::max)(m_params.numRays, kMinFitPoints);
+  const int window = (int)std::ceil(2.0 * R / kRayStep);
+  const bool originDark = SampleBilinear(m_mean, ox, oy) <= threshold;
+  const bool findInner = m_params.detectInner && originDark;
+  // Склон сглаженного края в пикселях кадра — с запасом на полпикселя
+  // уменьшенного кадра
+  const double edgeWindow = 2.0 * (R + 1) * f;
+  const double minStep = 0.1 * (std::max)(threshold - lo, 0.0);
+  std::vector<float> profile;
+  // Уровни сглаженного кадра: за внешним краем и внутри экранирования —
+  // вне сглаженного склона
+  std::vector<double> shadowLevels, screenLevels;
+  result.outerPoints.reserve(numRays);
+  for (int i = 0; i < numRays; i++) {
+    const double angle = i * Physics::TWO_PI / numRays;
+    const double dx = std::cos(angle), dy = std::sin(angle);
+    // Направление луча в пикселях кадра и его длина на единицу r
+    const double unitLength = std::hypot(dx * fx, dy * fy);
+    const double ux = dx * fx / unitLength, uy = dy * fy / unitLength;
+    auto toImage = [&](double r) {
+      return cv::Point2f((float)((ox + dx * r + 0.5) * fx - 0.5),
+                         (float)((oy + dy * r + 0.5) * fy - 0.5));
+    };
+
+    profile.clear();
+    for (double r = 0.0;; r += kRayStep) {
+      const double x = ox + dx * r, y = oy + dy * r;
+      if (x < 0.0 || y < 0.0 || x > sw - 1 || y > sh - 1) break;
+      profile.push_back(SampleBilinear(m_mean, x, y));
+    }
+    const int n = (int)profile.size();
+
+    // Внутренний край — первый подъём, внешний — последний спуск после него
+    int rise = profile.empty() || profile[0] > threshold ? 0 : -1;
+    int fall = -1;
+    for (int k = 1; k < n; k++) {
+      const bool above = profile[k] > threshold;
+      const bool wasAbove = profile[k - 1] > threshold;
+      if (above && !wasAbove && rise < 0) rise = k;
+      if (!above && wasAbove && rise >= 0) fall = k;
+    }
+    if (rise < 0) continue;  // луч целиком в тени
+    if (findInner && rise > 0) {
+      const double r =
+          RefineProfileEdge(profile, rise, threshold, window) * kRayStep;
+      cv::Point2f edge = toImage(r);
+      RefineImageEdge(image, edge, -ux, -uy, r * unitLength, edgeWindow,
+                      minStep);
+      result.innerPoints.push_back(edge);
+      screenLevels.push_back(MeanOf(profile, 0, (std::max)(1, rise - window)));
+    }
+    // Светлый до края кадра — зрачок обрезан кадром, края нет
+    if (fall > 0) {
+      const double r =
+          RefineProfileEdge(profile, fall, threshold, window) * kRayStep;
+      cv::Point2f edge = toImage(r);
+      RefineImageEdge(image, edge, ux, uy, edgeWindow * 2.0, edgeWindow,
+                      minStep);
+      result.outerPoints.push_back(edge);
+      if (fall + window < n)
+        shadowLevels.push_back(MeanOf(profile, fall + window, n));
+    }
+  }
+
+  // --- Эллипсы ---
+  const double tolerance = (std::max)(m_params.ransacTolerance, f);
+  const double maxSize = 4.0 * longSide;
+  const int minEdgePoints = (std::max)(kMinFitPoints, numRays / 4);
+  auto minInliers = [&](size_t points) {
+    return (int)std::ceil(m_params.minInlierFraction * points);
+  };
+
+  CEllipseFit outer;
+  if ((int)result.outerPoints.size() < minEdgePoints) {
+    m_lastError = "Край зрачка найден на " +
+                  std::to_string(result.outerPoints.size()) + " лучах из " +
+                  std::to_string(numRays);
+    return false;
+  }
+  if (!FitEllipseRansac(result.outerPoints, m_params, tolerance, maxSize,
+                        minInliers(result.outerPoints.size()), outer)) {
+    m_lastError = "Точки края не ложатся на эллипс";
+    return false;
+  }
+  const int outerA =
+      (int)std::floor(0.5 * outer.ellipse.size.width - m_params.margin);
+  const int outerB =
+      (int)std::floor(0.5 * outer.ellipse.size.height - m_params.margin);
+  if (outerA <= 0 || outerB <= 0) {
+    m_lastError = "Зрачок меньше отступа margin";
+    return false;
+  }
+  result.hasOuter = true;
+  result.outer = EllipseParams((int)std::lround(outer.ellipse.center.x),
+                               (int)std::lround(outer.ellipse.center.y),
+                               outerA, outerB, outer.ellipse.angle);
+  result.outerInliers = outer.inliers;
+  result.outerRms = outer.rms;
+
+  // Экранирование: затенено как фон, почти круглое, в зрачке и меньше его
+  if (screenLevels.empty()) return true;
+  const double shadow = shadowLevels.empty() ? lo : Median(shadowLevels);
+  if (Median(screenLevels) - shadow > kScreenLevel * (threshold - shadow))
+    return true;
+  CEllipseFit inner;
+  if ((int)result.innerPoints.size() >= minEdgePoints &&
+      FitEllipseRansac(result.innerPoints, m_params, tolerance, maxSize,
+                       minInliers(result.innerPoints.size()), inner)) {
+    const double ia = 0.5 * inner.ellipse.size.width;
+    const double ib = 0.5 * inner.ellipse.size.height;
+    const double oMin = 0.5 * (std::min)(outer.ellipse.size.width,
+                                         outer.ellipse.size.height);
+    if ((std::min)(ia, ib) >= kMinInnerAxisRatio * (std::max)(ia, ib) &&
+        (std::max)(ia, ib) + m_params.margin < oMin &&
+        IsInsideFit(outer.ellipse, inner.ellipse.center)) {
+      result.hasInner = true;
+      result.inner = EllipseParams(
+          (int)std::lround(inner.ellipse.center.x),
+          (int)std::lround(inner.ellipse.center.y),
+          (int)std::ceil(ia + m_params.margin),
+          (int)std::ceil(ib + m_params.margin), inner.ellipse.angle);
+      result.innerInliers = inner.inliers;
+      result.innerRms = inner.rms;
+    }
+  }
+  return true;
+}
+
+}  // namespace Interferometry
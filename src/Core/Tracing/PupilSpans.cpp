@@ -0,0 +1,174 @@
+#include "PupilSpans.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace Interferometry {
+
+namespace {
+
+// Отрезки зрачка в пределах кадра
+template <typename Fn>
+void ForEachImageSpan(const cv::Mat& image, const CEllipseBoundary& boundary,
+                      Fn&& fn) {
+  boundary.ForEachSpan(0, image.rows, [&](int y, int x0, int x1) {
+    x1 = (std::min)(x1, image.cols);
+    if (x0 < x1) fn(y, x0, x1);
+  });
+}
+
+// Суммы по кускам отрезка не длиннее kChunk в узких типах Sum / Sum2 —
+// внутренний цикл векторизуется, переполнения нет:
+// 8U: 255² · 16384 < 2^32; 16U: 65535 · 16384 < 2^32, квадраты — в 64 бит
+template <typename T, typename Sum, typename Sum2, int kChunk>
+CMaskedStats StatsImpl(const cv::Mat& image,
+                       const CEllipseBoundary& boundary) {
+  using Total = typename std::conditional<std::is_integral<Sum>::value,
+                                          uint64_t, double>::type;
+  Total sum = 0, sum2 = 0;
+  T lo = (std::numeric_limits<T>::max)();
+  T hi = std::numeric_limits<T>::lowest();
+  int64_t count = 0;
+
+  ForEachImageSpan(image, boundary, [&](int y, int x0, int x1) {
+    const T* p = image.ptr<T>(y);
+    count += x1 - x0;
+    for (int c0 = x0; c0 < x1; c0 += kChunk) {
+      const int c1 = (std::min)(c0 + kChunk, x1);
+      Sum s = 0;
+      Sum2 s2 = 0;
+      T l = p[c0], h = p[c0];
+      for (int x = c0; x < c1; x++) {
+        const T v = p[x];
+        s += (Sum)v;
+        s2 += (Sum2)v * (Sum2)v;
+        l = (std::min)(l, v);
+        h = (std::max)(h, v);
+      }
+      sum += (Total)s;
+      sum2 += (Total)s2;
+      lo = (std::min)(lo, l);
+      hi = (std::max)(hi, h);
+    }
+  });
+
+  CMaskedStats stats;
+  if (count == 0) return stats;
+  stats.count = count;
+  stats.mean = (double)sum / (double)count;
+  const double var = (double)sum2 / (double)count - stats.mean * stats.mean;
+  stats.stdDev = std::sqrt((std::max)(var, 0.0));
+  stats.minValue = (double)lo;
+  stats.maxValue = (double)hi;
+  return stats;
+}
+
+}  // namespace
+
+//=============================================================================
+// Статистика
+//=============================================================================
+CMaskedStats MaskedStats(const cv::Mat& image,
+                         const CEllipseBoundary& boundary) {
+  if (image.channels() != 1) return CMaskedStats();
+  switch (image.depth()) {
+    case CV_8U:
+      return StatsImpl<uint8_t, uint32_t, uint32_t, 16384>(image, boundary);
+    case CV_16U:
+      return StatsImpl<uint16_t, uint32_t, uint64_t, 16384>(image, boundary);
+    case CV_32F:
+      return StatsImpl<float, double, double, (1 << 30)>(image, boundary);
+    case CV_64F:
+      return StatsImpl<double, double, double, (1 << 30)>(image, boundary);
+    default:
+      return CMaskedStats();
+  }
+}
+
+void MaskedHistogram(const cv::Mat& image, const CEllipseBoundary& boundary,
+                     int64_t hist[256]) {
+  std::fill(hist, hist + 256, 0);
+  if (image.type() != CV_8UC1) return;
+
+  // Четыре таблицы по очереди: соседние одинаковые пиксели не ждут
+  // запись предыдущего инкремента
+  std::vector<int64_t> part(4 * 256, 0);
+  ForEachImageSpan(image, boundary, [&](int y, int x0, int x1) {
+    const uint8_t* p = image.ptr<uint8_t>(y);
+    int x = x0;
+    for (; x + 4 <= x1; x += 4) {
+      part[p[x]]++;
+      part[256 + p[x + 1]]++;
+      part[512 + p[x + 2]]++;
+      part[768 + p[x + 3]]++;
+    }
+    for (; x < x1; x++) part[p[x]]++;
+  });
+  for (int v = 0; v < 256; v++)
+    hist[v] = part[v] + part[256 + v] + part[512 + v] + part[768 + v];
+}
+
+//=============================================================================
+// Копирование и маскирование
+//=============================================================================
+void MaskedCopy(const cv::Mat& src, cv::Mat& dst,
+                const CEllipseBoundary& boundary) {
+  if (dst.size() != src.size() || dst.type() != src.type())
+    dst = cv::Mat::zeros(src.size(), src.type());
+  const size_t elem = src.elemSize();
+  ForEachImageSpan(src, boundary, [&](int y, int x0, int x1) {
+    std::memcpy(dst.ptr(y) + x0 * elem, src.ptr(y) + x0 * elem,
+                (x1 - x0) * elem);
+  });
+}
+
+void ClearOutside(cv::Mat& image, const CEllipseBoundary& boundary) {
+  if (image.empty()) return;
+  const size_t elem = image.elemSize();
+
+  // (row, col) — первый пиксель, который ещё не обработан
+  int row = 0, col = 0;
+  auto clearTo = [&](int y, int x) {
+    for (; row < y; row++, col = 0)
+      std::memset(image.ptr(row) + col * elem, 0, (image.cols - col) * elem);
+    if (row < image.rows && x > col)
+      std::memset(image.ptr(row) + col * elem, 0, (x - col) * elem);
+  };
+  ForEachImageSpan(image, boundary, [&](int y, int x0, int x1) {
+    clearTo(y, x0);
+    col = x1;
+  });
+  clearTo(image.rows, 0);
+}
+
+int64_t MaskedThreshold(const cv::Mat& src, cv::Mat& dst, int thresh,
+                        const CEllipseBoundary& boundary) {
+  if (src.type() != CV_8UC1) {
+    dst.release();
+    return 0;
+  }
+  dst.create(src.size(), CV_8UC1);
+
+  // thresh < 0 — весь зрачок, thresh >= 255 — ни одного пикселя
+  const int t = (std::min)((std::max)(thresh, -1), 255);
+  int64_t count = 0;
+  ForEachImageSpan(src, boundary, [&](int y, int x0, int x1) {
+    const uint8_t* p = src.ptr<uint8_t>(y);
+    uint8_t* q = dst.ptr<uint8_t>(y);
+    uint32_t n = 0;
+    for (int x = x0; x < x1; x++) {
+      const uint8_t v = p[x] > t ? 255 : 0;
+      q[x] = v;
+      n += v & 1;
+    }
+    count += n;
+  });
+  ClearOutside(dst, boundary);
+  return count;
+}
+
+}  // namespace Interferometry
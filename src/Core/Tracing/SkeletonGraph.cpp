@@ -0,0 +1,704 @@
+#include "SkeletonGraph.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+
+namespace Interferometry {
+
+namespace {
+
+// Соседи: N, E, S, W, NE, SE, SW, NW (порядок прежнего обхода скелета)
+const int kDx8[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+const int kDy8[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
+
+// Система непересекающихся множеств со сжатием путей
+int FindRoot(std::vector<int>& parent, int i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+void Unite(std::vector<int>& parent, int a, int b) {
+  a = FindRoot(parent, a);
+  b = FindRoot(parent, b);
+  if (a == b) return;
+  if (a < b)
+    parent[b] = a;
+  else
+    parent[a] = b;
+}
+
+int DistSq(const cv::Point& a, const cv::Point& b) {
+  int dx = a.x - b.x, dy = a.y - b.y;
+  return dx * dx + dy * dy;
+}
+
+}  // namespace
+
+//=============================================================================
+// Build
+//=============================================================================
+// Проход 1 (растровый): степень каждого пикселя в буфере с рамкой.
+//   степень 2  — пиксель ребра (кроме угла треугольника, см. ниже);
+//   степень 0/1 — отдельный узел (одиночный пиксель / конец);
+//   степень 3+ — пиксель развилки, сливается с уже пройденными соседями
+//                (W, NW, N, NE) — однопроходная разметка связности.
+// Дальше работа идёт только со списками узловых и рёберных пикселей.
+//=============================================================================
+void CSkeletonGraph::Build(const cv::Mat& skeleton) {
+  Clear();
+  if (skeleton.empty()) return;
+
+  m_width = skeleton.cols;
+  m_height = skeleton.rows;
+
+  const int w = m_width, h = m_height;
+  const int stride = w + 2;
+  int off8[8];
+  for (int k = 0; k < 8; k++) off8[k] = kDy8[k] * stride + kDx8[k];
+
+  auto toPoint = [stride](int i) {
+    return cv::Point(i % stride - 1, i / stride - 1);
+  };
+  auto toIndex = [stride](const cv::Point& p) {
+    return (p.y + 1) * stride + (p.x + 1);
+  };
+
+  std::vector<uint8_t> on((size_t)stride * (h + 2), 0);
+  for (int y = 0; y < h; y++) {
+    const uint8_t* src = skeleton.ptr<uint8_t>(y);
+    uint8_t* dst = on.data() + (size_t)(y + 1) * stride + 1;
+    for (int x = 0; x < w; x++) dst[x] = src[x] > 0;
+  }
+
+  // label: >= 0 — узел пикселя, -1 — пиксель ребра или фон
+  std::vector<int> label(on.size(), -1);
+  std::vector<uint8_t> junction(on.size(), 0);
+  std::vector<int> nodePixels;  // узловые пиксели в растровом порядке
+  std::vector<int> pathPixels;  // пиксели степени 2
+  std::vector<int> parent;      // разметка узлов до слияния развилок
+
+  for (int y = 0; y < h; y++) {
+    int i = (y + 1) * stride + 1;
+    for (int x = 0; x < w; x++, i++) {
+      if (!on[i]) continue;
+
+      int d = 0, nb[2] = {0, 0};
+      for (int k = 0; k < 8; k++)
+        if (on[i + off8[k]]) {
+          if (d < 2) nb[d] = i + off8[k];
+          d++;
+        }
+
+      // Угол треугольника (оба соседа смежны между собой) — не звено
+      // цепочки, а утолщение развилки или ступеньки: относим к развилке
+      bool corner = false;
+      if (d == 2) {
+        int ddx = std::abs(nb[0] % stride - nb[1] % stride);
+        int ddy = std::abs(nb[0] / stride - nb[1] / stride);
+        corner = ddx <= 1 && ddy <= 1;
+      }
+
+      if (d == 2 && !corner) {
+        pathPixels.push_back(i);
+        continue;
+      }
+
+      int id = (int)parent.size();
+      parent.push_back(id);
+      label[i] = id;
+      nodePixels.push_back(i);
+
+      if (d < 3 && !corner) continue;
+      junction[i] = 1;
+
+      // Уже пройденные соседи: W, NW, N, NE
+      const int causal[4] = {-1, -stride - 1, -stride, -stride + 1};
+      for (int c : causal)
+        if (junction[i + c]) Unite(parent, id, label[i + c]);
+    }
+  }
+
+  // Корни разметки -> номера узлов в порядке первого пикселя
+  std::vector<int> nodeOf(parent.size(), -1);
+  for (int i : nodePixels) {
+    int root = FindRoot(parent, label[i]);
+    if (nodeOf[root] < 0) {
+      nodeOf[root] = (int)m_nodes.size();
+      CSkeletonNode node;
+      cv::Point p = toPoint(i);
+      node.x = p.x;
+      node.y = p.y;
+      m_nodes.push_back(node);
+    }
+    label[i] = nodeOf[root];
+    m_nodes[label[i]].numPixels++;
+  }
+
+  // Пиксели узлов — участками подряд в хранилище
+  int offset = 0;
+  for (auto& node : m_nodes) {
+    node.firstPixel = offset;
+    offset += node.numPixels;
+    node.numPixels = 0;
+  }
+  m_points.resize(offset);
+  for (int i : nodePixels) {
+    CSkeletonNode& node = m_nodes[label[i]];
+    m_points[node.firstPixel + node.numPixels++] = toPoint(i);
+  }
+
+  // Рёбра: от каждого узлового пикселя по соседям степени 2
+  std::vector<uint8_t> visited(on.size(), 0);
+  std::vector<cv::Point> pts;
+  const int numNodes = (int)m_nodes.size();
+
+  for (int n = 0; n < numNodes; n++) {
+    for (int pi = 0; pi < m_nodes[n].numPixels; pi++) {
+      const int p = toIndex(m_points[m_nodes[n].firstPixel + pi]);
+
+      for (int k = 0; k < 8; k++) {
+        const int q = p + off8[k];
+        if (!on[q]) continue;
+
+        // Соседний узел — ребро без точек (один раз на пару узлов)
+        if (label[q] >= 0) {
+          int m = label[q];
+          if (m <= n) continue;
+          bool exists = false;
+          for (int e : m_nodes[n].edges)
+            if (m_edges[e].Other(n) == m && m_edges[e].numPoints == 0)
+              exists = true;
+          if (!exists) AddEdge(n, m, {});
+          continue;
+        }
+
+        if (visited[q]) continue;
+
+        // Обход цепочки степени 2 до следующего узла
+        pts.clear();
+        int prev = p, cur = q, to = n;
+        while (true) {
+          visited[cur] = 1;
+          pts.push_back(toPoint(cur));
+
+          int next = -1;
+          for (int kk = 0; kk < 8; kk++) {
+            int r = cur + off8[kk];
+            if (on[r] && r != prev) {
+              next = r;
+              break;
+            }
+          }
+          if (next < 0 || (label[next] < 0 && visited[next])) break;
+          if (label[next] >= 0) {
+            to = label[next];
+            break;
+          }
+          prev = cur;
+          cur = next;
+        }
+
+        // Петля в 1–2 пикселя вокруг развилки — утолщение, не ребро
+        // (пиксели остаются вне графа)
+        if (to == n && pts.size() <= 2) continue;
+        AddEdge(n, to, pts);
+      }
+    }
+  }
+
+  // Оставшиеся пиксели степени 2 — замкнутые контуры без узлов
+  for (int start : pathPixels) {
+    if (visited[start]) continue;
+
+    pts.clear();
+    int cur = start;
+    while (cur >= 0) {
+      visited[cur] = 1;
+      pts.push_back(toPoint(cur));
+      int next = -1;
+      for (int k = 0; k < 8; k++) {
+        int r = cur + off8[k];
+        if (on[r] && !visited[r]) {
+          next = r;
+          break;
+        }
+      }
+      cur = next;
+    }
+    AddEdge(-1, -1, pts);
+  }
+
+  // Развилки с двумя рёбрами (ступеньки диагоналей) — часть ребра
+  for (int n = 0; n < numNodes; n++)
+    if (m_nodes[n].alive && m_nodes[n].Degree() == 2) Dissolve(n);
+}
+
+void CSkeletonGraph::Clear() {
+  m_width = m_height = 0;
+  m_nodes.clear();
+  m_edges.clear();
+  m_points.clear();
+}
+
+int CSkeletonGraph::CountAliveNodes() const {
+  int count = 0;
+  for (const auto& n : m_nodes) count += n.alive;
+  return count;
+}
+
+int CSkeletonGraph::CountAliveEdges() const {
+  int count = 0;
+  for (const auto& e : m_edges) count += e.alive;
+  return count;
+}
+
+//=============================================================================
+// Рёбра и узлы
+//=============================================================================
+int CSkeletonGraph::AddEdge(int from, int to,
+                            const std::vector<cv::Point>& points, bool gap) {
+  CSkeletonEdge edge;
+  edge.from = from;
+  edge.to = to;
+  edge.firstPoint = (int)m_points.size();
+  edge.numPoints = (int)points.size();
+  edge.gap = gap;
+  m_points.insert(m_points.end(), points.begin(), points.end());
+
+  int id = (int)m_edges.size();
+  m_edges.push_back(edge);
+  if (from >= 0) m_nodes[from].edges.push_back(id);
+  if (to >= 0) m_nodes[to].edges.push_back(id);
+  return id;
+}
+
+void CSkeletonGraph::DetachEdge(int node, int edge) {
+  if (node < 0) return;
+  auto& edges = m_nodes[node].edges;
+  auto it = std::find(edges.begin(), edges.end(), edge);
+  if (it != edges.end()) edges.erase(it);
+}
+
+void CSkeletonGraph::KillEdge(int edge) {
+  CSkeletonEdge& e = m_edges[edge];
+  if (!e.alive) return;
+  e.alive = false;
+  DetachEdge(e.from, edge);
+  DetachEdge(e.to, edge);  // для петли снимает второе вхождение
+}
+
+void CSkeletonGraph::AppendEdgeFrom(int edge, int node,
+                                    std::vector<cv::Point>& out) const {
+  const CSkeletonEdge& e = m_edges[edge];
+  const cv::Point* p = EdgePoints(edge);
+  if (node < 0 || e.from == node)
+    out.insert(out.end(), p, p + e.numPoints);
+  else
+    for (int i = e.numPoints - 1; i >= 0; i--) out.push_back(p[i]);
+}
+
+void CSkeletonGraph::AppendNodePixels(int node, const cv::Point* from,
+                                      const cv::Point* to,
+                                      std::vector<cv::Point>& out) const {
+  const CSkeletonNode& n = m_nodes[node];
+  const cv::Point* px = NodePixels(node);
+  const int k = n.numPixels;
+  if (k == 1) {
+    out.push_back(px[0]);
+    return;
+  }
+
+  // Одиночное пятно без рёбер — все пиксели
+  if (!from && !to) {
+    out.insert(out.end(), px, px + k);
+    return;
+  }
+
+  auto nearest = [&](const cv::Point& p) {
+    int best = 0;
+    for (int i = 1; i < k; i++)
+      if (DistSq(px[i], p) < DistSq(px[best], p)) best = i;
+    return best;
+  };
+
+  // Начало или конец линии — один пиксель, ближайший к соседней точке
+  if (!from || !to) {
+    out.push_back(px[nearest(from ? *from : *to)]);
+    return;
+  }
+
+  // Проход через развилку (или ступеньку толщиной 2) — кратчайший
+  // 8-связный путь по её пикселям от входа к выходу
+  const int entry = nearest(*from);
+  const int exit = nearest(*to);
+
+  std::vector<int> prev(k, -1);
+  std::vector<int> bfs(1, entry);
+  prev[entry] = entry;
+  for (size_t head = 0; head < bfs.size() && prev[exit] < 0; head++) {
+    const cv::Point& c = px[bfs[head]];
+    for (int i = 0; i < k; i++)
+      if (prev[i] < 0 && std::abs(px[i].x - c.x) <= 1 &&
+          std::abs(px[i].y - c.y) <= 1) {
+        prev[i] = bfs[head];
+        bfs.push_back(i);
+      }
+  }
+
+  std::vector<int> path;
+  for (int i = exit; prev[i] >= 0; i = prev[i]) {
+    path.push_back(i);
+    if (i == entry) break;
+  }
+  for (auto it = path.rbegin(); it != path.rend(); ++it) out.push_back(px[*it]);
+}
+
+void CSkeletonGraph::Dissolve(int node) {
+  CSkeletonNode& n = m_nodes[node];
+  if (!n.alive || n.Degree() != 2) return;
+
+  const int e1 = n.edges[0], e2 = n.edges[1];
+  if (m_edges[e1].gap || m_edges[e2].gap) return;
+
+  std::vector<cv::Point> pts;
+
+  if (e1 == e2) {
+    // Петля через узел — замкнутый контур
+    AppendEdgeFrom(e1, node, pts);
+    const cv::Point* from = pts.empty() ? nullptr : &pts.back();
+    const cv::Point* to = pts.empty() ? nullptr : &pts.front();
+    std::vector<cv::Point> nodePts;
+    AppendNodePixels(node, from, to, nodePts);
+    pts.insert(pts.end(), nodePts.begin(), nodePts.end());
+    KillEdge(e1);
+    n.alive = false;
+    AddEdge(-1, -1, pts);
+    return;
+  }
+
+  const int a = m_edges[e1].Other(node);
+  const int b = m_edges[e2].Other(node);
+
+  // e1 развёрнуто к узлу, затем пиксели узла, затем e2 от узла
+  AppendEdgeFrom(e1, node, pts);
+  std::reverse(pts.begin(), pts.end());
+  std::vector<cv::Point> tail;
+  AppendEdgeFrom(e2, node, tail);
+
+  cv::Point aPos(m_nodes[a].x, m_nodes[a].y);
+  cv::Point bPos(m_nodes[b].x, m_nodes[b].y);
+  AppendNodePixels(node, pts.empty() ? &aPos : &pts.back(),
+                   tail.empty() ? &bPos : &tail.front(), pts);
+  pts.insert(pts.end(), tail.begin(), tail.end());
+
+  KillEdge(e1);
+  KillEdge(e2);
+  n.alive = false;
+  AddEdge(a, b, pts);
+}
+
+bool CSkeletonGraph::InwardPoint(int node, int steps, cv::Point& pt) const {
+  const CSkeletonNode& n = m_nodes[node];
+  if (n.Degree() != 1 || steps <= 0) return false;
+
+  const int e = n.edges[0];
+  std::vector<cv::Point> seq;
+  AppendEdgeFrom(e, node, seq);
+  int other = m_edges[e].Other(node);
+  if ((int)seq.size() < steps && other >= 0)
+    seq.push_back(cv::Point(m_nodes[other].x, m_nodes[other].y));
+  if ((int)seq.size() < steps) return false;
+
+  pt = seq[steps - 1];
+  return true;
+}
+
+//=============================================================================
+// Prune
+//=============================================================================
+int CSkeletonGraph::Prune(int maxBranchLength) {
+  if (maxBranchLength <= 0) return 0;
+
+  std::vector<int> queue;
+  for (int n = 0; n < (int)m_nodes.size(); n++)
+    if (m_nodes[n].alive && m_nodes[n].Degree() == 1) queue.push_back(n);
+
+  int removed = 0;
+  for (size_t head = 0; head < queue.size(); head++) {
+    const int n = queue[head];
+    if (!m_nodes[n].alive || m_nodes[n].Degree() != 1) continue;
+
+    const int e = m_nodes[n].edges[0];
+    if (m_edges[e].gap) continue;
+    const int m = m_edges[e].Other(n);
+
+    // Отрезок «конец — конец» стирается целиком, иначе — до развилки
+    const bool segment = m_nodes[m].Degree() == 1;
+    int length = m_nodes[n].numPixels + m_edges[e].numPoints;
+    if (segment) length += m_nodes[m].numPixels;
+    if (length >= maxBranchLength) continue;
+
+    KillEdge(e);
+    m_nodes[n].alive = false;
+    removed++;
+
+    if (segment) {
+      m_nodes[m].alive = false;
+      continue;
+    }
+
+    switch (m_nodes[m].Degree()) {
+      case 0:
+        m_nodes[m].alive = false;  // остаток развилки без веток
+        break;
+      case 1:
+        queue.push_back(m);  // развилка стала концом
+        break;
+      case 2:
+        Dissolve(m);
+        break;
+      default:
+        break;
+    }
+  }
+  return removed;
+}
+
+//=============================================================================
+// LinkEndpoints
+//=============================================================================
+// Концы раскладываются по сетке с ячейкой maxDistance (все пары ближе
+// maxDistance — в соседних ячейках 3x3). Пары разных компонент идут в
+// очередь по квадрату расстояния (при равенстве — по номерам узлов).
+// Склейка не сдвигает концы, поэтому пары считаются один раз; при
+// извлечении проверяется, что оба конца ещё свободны и компоненты разные.
+//=============================================================================
+int CSkeletonGraph::LinkEndpoints(int maxDistance) {
+  if (maxDistance <= 0) return 0;
+
+  const int numNodes = (int)m_nodes.size();
+  const int maxDist2 = maxDistance * maxDistance;
+
+  // Компоненты связности по живым рёбрам
+  std::vector<int> comp(numNodes);
+  std::iota(comp.begin(), comp.end(), 0);
+  for (const auto& e : m_edges)
+    if (e.alive && e.from >= 0 && e.to >= 0) Unite(comp, e.from, e.to);
+
+  std::vector<int> endpoints;
+  int minX = INT_MAX, minY = INT_MAX, maxX = INT_MIN, maxY = INT_MIN;
+  for (int n = 0; n < numNodes; n++) {
+    const CSkeletonNode& node = m_nodes[n];
+    if (!node.alive || node.Degree() != 1) continue;
+    endpoints.push_back(n);
+    minX = (std::min)(minX, node.x);
+    minY = (std::min)(minY, node.y);
+    maxX = (std::max)(maxX, node.x);
+    maxY = (std::max)(maxY, node.y);
+  }
+  if (endpoints.size() < 2) return 0;
+
+  const int cols = (maxX - minX) / maxDistance + 1;
+  const int rows = (maxY - minY) / maxDistance + 1;
+  std::vector<std::vector<int>> grid((size_t)cols * rows);
+  auto cellX = [&](int x) { return (x - minX) / maxDistance; };
+  auto cellY = [&](int y) { return (y - minY) / maxDistance; };
+  for (int n : endpoints)
+    grid[(size_t)cellY(m_nodes[n].y) * cols + cellX(m_nodes[n].x)].push_back(n);
+
+  struct Candidate {
+    int distSq;
+    int a, b;
+    bool operator>(const Candidate& o) const {
+      if (distSq != o.distSq) return distSq > o.distSq;
+      if (a != o.a) return a > o.a;
+      return b > o.b;
+    }
+  };
+  std::priority_queue<Candidate, std::vector<Candidate>,
+                      std::greater<Candidate>>
+      queue;
+
+  for (int a : endpoints) {
+    const cv::Point pa(m_nodes[a].x, m_nodes[a].y);
+    const int cx = cellX(pa.x), cy = cellY(pa.y);
+    for (int y = (std::max)(cy - 1, 0); y <= (std::min)(cy + 1, rows - 1); y++)
+      for (int x = (std::max)(cx - 1, 0); x <= (std::min)(cx + 1, cols - 1);
+           x++)
+        for (int b : grid[(size_t)y * cols + x]) {
+          if (b <= a || FindRoot(comp, a) == FindRoot(comp, b)) continue;
+          int d2 = DistSq(pa, cv::Point(m_nodes[b].x, m_nodes[b].y));
+          if (d2 <= maxDist2) queue.push({d2, a, b});
+        }
+  }
+
+  int linked = 0;
+  while (!queue.empty()) {
+    Candidate c = queue.top();
+    queue.pop();
+
+    if (m_nodes[c.a].Degree() != 1 || m_nodes[c.b].Degree() != 1) continue;
+    if (FindRoot(comp, c.a) == FindRoot(comp, c.b)) continue;
+
+    // Направление линии у конца a (наружу) и от конца b (внутрь)
+    cv::Point inA, inB;
+    if (!InwardPoint(c.a, 2, inA) || !InwardPoint(c.b, 2, inB)) continue;
+
+    const cv::Point pa(m_nodes[c.a].x, m_nodes[c.a].y);
+    const cv::Point pb(m_nodes[c.b].x, m_nodes[c.b].y);
+    const cv::Point tail = pa - inA;
+    const cv::Point head = inB - pb;
+
+    float tLen = std::sqrt((float)tail.dot(tail));
+    float hLen = std::sqrt((float)head.dot(head));
+    if (tLen < 0.5f || hLen < 0.5f) continue;
+
+    float cosAngle = (float)tail.dot(head) / (tLen * hLen);
+    if (cosAngle < 0.5f) continue;
+
+    AddEdge(c.a, c.b, {}, true);
+    Unite(comp, c.a, c.b);
+    linked++;
+  }
+  return linked;
+}
+
+//=============================================================================
+// ExtractPolylines
+//=============================================================================
+std::vector<std::vector<CTracerPoint>> CSkeletonGraph::ExtractPolylines(
+    int minLength) const {
+  std::vector<std::vector<CTracerPoint>> lines;
+  std::vector<uint8_t> edgeUsed(m_edges.size(), 0);
+  std::vector<uint8_t> nodeUsed(m_nodes.size(), 0);
+  std::vector<cv::Point> pts;
+
+  auto emit = [&]() {
+    if ((int)pts.size() < minLength) return;
+    std::vector<CTracerPoint> line;
+    line.reserve(pts.size());
+    for (const cv::Point& p : pts) line.push_back(CTracerPoint(p.x, p.y));
+    lines.push_back(std::move(line));
+  };
+
+  // Первая точка ребра ce при выходе из узла node
+  auto firstPoint = [&](int ce, int node) {
+    const CSkeletonEdge& c = m_edges[ce];
+    if (c.numPoints > 0)
+      return (c.from == node) ? EdgePoints(ce)[0]
+                              : EdgePoints(ce)[c.numPoints - 1];
+    int o = c.Other(node);
+    return cv::Point(m_nodes[o].x, m_nodes[o].y);
+  };
+
+  // Обход от узла cur по ребру e; на развилках — самое прямое продолжение
+  auto walk = [&](int cur, int e) {
+    pts.clear();
+    if (cur >= 0) {
+      cv::Point target = firstPoint(e, cur);
+      AppendNodePixels(cur, nullptr, &target, pts);
+      nodeUsed[cur] = 1;
+    }
+
+    while (true) {
+      edgeUsed[e] = 1;
+      AppendEdgeFrom(e, cur, pts);
+
+      const int next = m_edges[e].Other(cur);
+      if (next < 0) break;
+
+      cv::Point dir(0, 0);
+      if (pts.size() >= 2) dir = pts.back() - pts[pts.size() - 2];
+      const float dirLen = std::sqrt((float)dir.dot(dir));
+
+      int best = -1;
+      float bestScore = -1e9f;
+      cv::Point bestTarget;
+      for (int ce : m_nodes[next].edges) {
+        if (edgeUsed[ce]) continue;
+        const cv::Point target = firstPoint(ce, next);
+        if (best < 0) {
+          best = ce;
+          bestTarget = target;
+        }
+        if (dirLen == 0.0f || pts.empty()) break;
+
+        cv::Point step = target - pts.back();
+        float stepLen = std::sqrt((float)step.dot(step));
+        if (stepLen == 0.0f) continue;
+
+        float score = (float)dir.dot(step) / (dirLen * stepLen);
+        if (score > bestScore) {
+          bestScore = score;
+          best = ce;
+          bestTarget = target;
+        }
+      }
+
+      // Путь через узел; конец линии на уже пройденном узле не дублируется
+      if (!nodeUsed[next] || best >= 0) {
+        cv::Point last = pts.empty() ? bestTarget : pts.back();
+        AppendNodePixels(next, &last, best >= 0 ? &bestTarget : nullptr, pts);
+        nodeUsed[next] = 1;
+      }
+
+      if (best < 0) break;
+      cur = next;
+      e = best;
+    }
+    emit();
+  };
+
+  // Фаза 1: от концов — самые полные линии
+  for (int n = 0; n < (int)m_nodes.size(); n++) {
+    const CSkeletonNode& node = m_nodes[n];
+    if (node.alive && node.Degree() == 1 && !edgeUsed[node.edges[0]])
+      walk(n, node.edges[0]);
+  }
+
+  // Фаза 2: оставшиеся рёбра — контуры и участки между развилками
+  for (int e = 0; e < (int)m_edges.size(); e++)
+    if (m_edges[e].alive && !edgeUsed[e]) walk(m_edges[e].from, e);
+
+  // Фаза 3: одиночные узлы без рёбер
+  for (int n = 0; n < (int)m_nodes.size(); n++) {
+    if (!m_nodes[n].alive || m_nodes[n].Degree() != 0 || nodeUsed[n]) continue;
+    pts.clear();
+    AppendNodePixels(n, nullptr, nullptr, pts);
+    emit();
+  }
+
+  return lines;
+}
+
+//=============================================================================
+// Render
+//=============================================================================
+void CSkeletonGraph::Render(cv::Mat& skeleton) const {
+  skeleton.create(m_height, m_width, CV_8UC1);
+  skeleton.setTo(0);
+
+  for (int n = 0; n < (int)m_nodes.size(); n++) {
+    if (!m_nodes[n].alive) continue;
+    const cv::Point* px = NodePixels(n);
+    for (int i = 0; i < m_nodes[n].numPixels; i++)
+      skeleton.at<uchar>(px[i].y, px[i].x) = 255;
+  }
+
+  for (int e = 0; e < (int)m_edges.size(); e++) {
+    if (!m_edges[e].alive) continue;
+    const cv::Point* p = EdgePoints(e);
+    for (int i = 0; i < m_edges[e].numPoints; i++)
+      skeleton.at<uchar>(p[i].y, p[i].x) = 255;
+  }
+}
+
+}  // namespace Interferometry
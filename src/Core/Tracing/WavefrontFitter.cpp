@@ -0,0 +1,494 @@
+#include "WavefrontFitter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "Constants.h"
+#include "EllipseBoundary.h"
+
+namespace Interferometry {
+
+//=============================================================================
+// WavefrontStats (объявлены в Types.h)
+//=============================================================================
+double WavefrontStats::PV_nm() const { return PV * Physics::WAVELENGTH_HeNe; }
+double WavefrontStats::RMS_nm() const { return RMS * Physics::WAVELENGTH_HeNe; }
+
+namespace {
+
+// Строк базиса в блоке накопления AᵀA
+constexpr int kBlockRows = 64;
+// Меньше точек на поток не делим — накладные расходы больше выигрыша
+constexpr int kMinPointsPerThread = 4096;
+
+// R_n^m(ρ) = Σ_s (-1)^s (n-s)! / (s! ((n+m)/2-s)! ((n-m)/2-s)!) ρ^(n-2s)
+struct CRadialTerm {
+  double coeff;
+  int power;
+};
+
+double Factorial(int k) {
+  double f = 1.0;
+  for (int i = 2; i <= k; i++) f *= i;
+  return f;
+}
+
+std::vector<CRadialTerm> RadialPolynomial(int n, int m) {
+  std::vector<CRadialTerm> terms;
+  for (int s = 0; s <= (n - m) / 2; s++) {
+    double c = Factorial(n - s) /
+               (Factorial(s) * Factorial((n + m) / 2 - s) *
+                Factorial((n - m) / 2 - s));
+    terms.push_back({(s % 2) ? -c : c, n - 2 * s});
+  }
+  return terms;
+}
+
+/**
+ * Базис из numTerms членов: строка A для точки (u, v) за O(T + nMax).
+ * Степени ρ и cos/sin(mθ) считаются один раз на точку рекуррентно,
+ * член — сумма готовых степеней с табличными коэффициентами.
+ */
+class CZernikeBasis {
+ public:
+  explicit CZernikeBasis(int numTerms) {
+    m_terms.resize(numTerms);
+    for (int j = 0; j < numTerms; j++) {
+      Term& t = m_terms[j];
+      CWavefrontFitter::FringeIndex(j + 1, t.n, t.m, t.sinTerm);
+      t.first = (int)m_radial.size();
+      for (const CRadialTerm& r : RadialPolynomial(t.n, t.m))
+        m_radial.push_back(r);
+      t.count = (int)m_radial.size() - t.first;
+      m_maxN = (std::max)(m_maxN, t.n);
+      m_maxM = (std::max)(m_maxM, t.m);
+    }
+    m_pow.resize(m_maxN + 1);
+    m_cos.resize(m_maxM + 1);
+    m_sin.resize(m_maxM + 1);
+  }
+
+  int NumTerms() const { return (int)m_terms.size(); }
+
+  /// row[j] = Z_{j+1}(u, v); row заполняется с шагом stride
+  void Row(double u, double v, double* row, int stride = 1) {
+    double rho = std::sqrt(u * u + v * v);
+    m_pow[0] = 1.0;
+    for (int k = 1; k <= m_maxN; k++) m_pow[k] = m_pow[k - 1] * rho;
+
+    // cos(mθ), sin(mθ) без atan2: поворот на θ m раз
+    double c1 = rho > 0.0 ? u / rho : 1.0;
+    double s1 = rho > 0.0 ? v / rho : 0.0;
+    m_cos[0] = 1.0;
+    m_sin[0] = 0.0;
+    for (int k = 1; k <= m_maxM; k++) {
+      m_cos[k] = m_cos[k - 1] * c1 - m_sin[k - 1] * s1;
+      m_sin[k] = m_sin[k - 1] * c1 + m_cos[k - 1] * s1;
+    }
+
+    for (size_t j = 0; j < m_terms.size(); j++) {
+      const Term& t = m_terms[j];
+      double r = 0.0;
+      for (int i = t.first; i < t.first + t.count; i++)
+        r += m_radial[i].coeff * m_pow[m_radial[i].power];
+      row[j * stride] = r * (t.sinTerm ? m_sin[t.m] : m_cos[t.m]);
+    }
+  }
+
+ private:
+  struct Term {
+    int n = 0, m = 0;
+    bool sinTerm = false;
+    int first = 0, count = 0;  // диапазон в m_radial
+  };
+
+  std::vector<Term> m_terms;
+  std::vector<CRadialTerm> m_radial;
+  int m_maxN = 0;
+  int m_maxM = 0;
+
+  // рабочие массивы Row()
+  std::vector<double> m_pow, m_cos, m_sin;
+};
+
+// Точки МНК в нормированных координатах
+struct CFitPoints {
+  std::vector<double> u, v, w;
+  int Size() const { return (int)w.size(); }
+};
+
+/**
+ * Верхний треугольник AᵀA и Aᵀw по точкам [begin, end).
+ * Блок строк хранится по столбцам (член × строка), поэтому произведения
+ * столбцов — непрерывные циклы, которые компилятор векторизует.
+ */
+void AccumulateNormal(const CFitPoints& pts, int begin, int end,
+                      int numTerms, std::vector<double>& ata,
+                      std::vector<double>& atw) {
+  CZernikeBasis basis(numTerms);
+  std::vector<double> block((size_t)numTerms * kBlockRows);
+  ata.assign((size_t)numTerms * numTerms, 0.0);
+  atw.assign(numTerms, 0.0);
+
+  for (int b = begin; b < end; b += kBlockRows) {
+    int rows = (std::min)(kBlockRows, end - b);
+    for (int r = 0; r < rows; r++)
+      basis.Row(pts.u[b + r], pts.v[b + r], block.data() + r, kBlockRows);
+
+    const double* w = pts.w.data() + b;
+    for (int i = 0; i < numTerms; i++) {
+      const double* ci = block.data() + (size_t)i * kBlockRows;
+      double* ataRow = ata.data() + (size_t)i * numTerms;
+      for (int j = i; j < numTerms; j++) {
+        const double* cj = block.data() + (size_t)j * kBlockRows;
+        double s = 0.0;
+        for (int r = 0; r < rows; r++) s += ci[r] * cj[r];
+        ataRow[j] += s;
+      }
+      double s = 0.0;
+      for (int r = 0; r < rows; r++) s += ci[r] * w[r];
+      atw[i] += s;
+    }
+  }
+}
+
+/**
+ * Холецкий для симметричной T×T (верхний треугольник a, по строкам):
+ * a = UᵀU на месте, затем Uᵀy = b, Uz = y. false — матрица не
+ * положительно определена (диагональ ≤ eps·max диагонали).
+ */
+bool CholeskySolve(std::vector<double>& a, std::vector<double>& b, int t) {
+  double maxDiag = 0.0;
+  for (int i = 0; i < t; i++)
+    maxDiag = (std::max)(maxDiag, a[(size_t)i * t + i]);
+  const double eps = 1e-13 * maxDiag;
+
+  for (int i = 0; i < t; i++) {
+    double* ri = a.data() + (size_t)i * t;
+    double d = ri[i];
+    for (int k = 0; k < i; k++)
+      d -= a[(size_t)k * t + i] * a[(size_t)k * t + i];
+    if (!(d > eps)) return false;
+    ri[i] = std::sqrt(d);
+    for (int j = i + 1; j < t; j++) {
+      double s = ri[j];
+      for (int k = 0; k < i; k++)
+        s -= a[(size_t)k * t + i] * a[(size_t)k * t + j];
+      ri[j] = s / ri[i];
+    }
+  }
+  for (int i = 0; i < t; i++) {  // Uᵀy = b
+    double s = b[i];
+    for (int k = 0; k < i; k++) s -= a[(size_t)k * t + i] * b[k];
+    b[i] = s / a[(size_t)i * t + i];
+  }
+  for (int i = t - 1; i >= 0; i--) {  // Uz = y
+    double s = b[i];
+    for (int k = i + 1; k < t; k++) s -= a[(size_t)i * t + k] * b[k];
+    b[i] = s / a[(size_t)i * t + i];
+  }
+  return true;
+}
+
+/**
+ * МНК через QR Хаусхолдера: a — матрица n×t по столбцам, w — правая
+ * часть (обе портятся). Отражения применяются к столбцам справа и к w,
+ * затем обратный ход по R. false — ранг меньше t.
+ */
+bool HouseholderSolve(std::vector<double>& a, std::vector<double>& w, int n,
+                      int t, std::vector<double>& z) {
+  std::vector<double> diag(t);
+  double maxDiag = 0.0;
+  for (int k = 0; k < t; k++) {
+    double* ck = a.data() + (size_t)k * n;
+    double norm = 0.0;
+    for (int i = k; i < n; i++) norm += ck[i] * ck[i];
+    norm = std::sqrt(norm);
+    if (norm == 0.0) return false;
+
+    // v = x + sign(x0)·||x||·e0, хранится на месте столбца
+    double alpha = ck[k] > 0 ? -norm : norm;
+    ck[k] -= alpha;
+    double vv = 0.0;
+    for (int i = k; i < n; i++) vv += ck[i] * ck[i];
+
+    for (int j = k + 1; j < t; j++) {
+      double* cj = a.data() + (size_t)j * n;
+      double s = 0.0;
+      for (int i = k; i < n; i++) s += ck[i] * cj[i];
+      s = 2.0 * s / vv;
+      for (int i = k; i < n; i++) cj[i] -= s * ck[i];
+    }
+    double s = 0.0;
+    for (int i = k; i < n; i++) s += ck[i] * w[i];
+    s = 2.0 * s / vv;
+    for (int i = k; i < n; i++) w[i] -= s * ck[i];
+
+    diag[k] = alpha;
+    maxDiag = (std::max)(maxDiag, std::fabs(alpha));
+  }
+
+  z.assign(t, 0.0);
+  for (int k = t - 1; k >= 0; k--) {
+    if (std::fabs(diag[k]) <= 1e-12 * maxDiag) return false;
+    double s = w[k];
+    for (int j = k + 1; j < t; j++) s -= a[(size_t)j * n + k] * z[j];
+    z[k] = s / diag[k];
+  }
+  return true;
+}
+
+/// Матрица базиса n×t по столбцам для HouseholderSolve
+void BuildDesignMatrix(const CFitPoints& pts, int numTerms,
+                       std::vector<double>& a) {
+  const int n = pts.Size();
+  a.resize((size_t)n * numTerms);
+  CZernikeBasis basis(numTerms);
+  for (int i = 0; i < n; i++) basis.Row(pts.u[i], pts.v[i], a.data() + i, n);
+}
+
+}  // namespace
+
+//=============================================================================
+// Базис
+//=============================================================================
+
+// Порядок Fringe: группа k = (n + m) / 2 занимает номера k²+1 .. (k+1)²,
+// внутри группы m = k, k-1, …, 0, для m > 0 сначала cos, затем sin.
+// Z1 поршень, Z2/Z3 наклоны, Z4 дефокус, Z5/Z6 астигматизм, Z7/Z8 кома,
+// Z9 сферическая; первые 36 членов совпадают со стандартной таблицей.
+void CWavefrontFitter::FringeIndex(int j, int& n, int& m, bool& sinTerm) {
+  int k = (int)std::ceil(std::sqrt((double)j)) - 1;
+  while (k > 0 && k * k >= j) k--;  // защита от погрешности sqrt
+  while ((k + 1) * (k + 1) < j) k++;
+  int offset = j - k * k - 1;
+  m = k - offset / 2;
+  sinTerm = (m > 0) && (offset % 2 == 1);
+  n = 2 * k - m;
+}
+
+double CWavefrontFitter::Zernike(int j, double u, double v) {
+  int n, m;
+  bool sinTerm;
+  FringeIndex(j, n, m, sinTerm);
+
+  double rho = std::sqrt(u * u + v * v);
+  double r = 0.0;
+  for (const CRadialTerm& t : RadialPolynomial(n, m))
+    r += t.coeff * std::pow(rho, t.power);
+  if (m == 0) return r;
+  double theta = std::atan2(v, u);
+  return r * (sinTerm ? std::sin(m * theta) : std::cos(m * theta));
+}
+
+// Центр и полуоси — по моментам внешней области: для заполненного эллипса
+// с полуосями a, b дисперсия x равна a²/4, y — b²/4. В отличие от габаритов
+// одиночная «выбитая» строка границ почти не сдвигает результат.
+CPupilGeometry CWavefrontFitter::PupilFromBoundary(
+    const CEllipseBoundary& boundary) {
+  CPupilGeometry pupil;
+  const std::vector<RowBoundary>& rows = boundary.GetAllBoundaries();
+  auto sumSquares = [](double k) { return k * (k + 1) * (2 * k + 1) / 6.0; };
+
+  double count = 0.0, sx = 0.0, sxx = 0.0, sy = 0.0, syy = 0.0;
+  for (int y = 0; y < (int)rows.size(); y++) {
+    const RowBoundary& r = rows[y];
+    if (!r.HasOuterBoundary() || r.rightOuter < r.leftOuter) continue;
+    double c = r.rightOuter - r.leftOuter + 1;
+    count += c;
+    sx += 0.5 * c * (r.leftOuter + r.rightOuter);
+    sxx += sumSquares(r.rightOuter) - sumSquares(r.leftOuter - 1);
+    sy += c * y;
+    syy += c * (double)y * y;
+  }
+  if (count < 4) return pupil;
+
+  pupil.centerX = sx / count;
+  pupil.centerY = sy / count;
+  double varX = sxx / count - pupil.centerX * pupil.centerX;
+  double varY = syy / count - pupil.centerY * pupil.centerY;
+  pupil.radiusX = varX > 0 ? 2.0 * std::sqrt(varX) : 0.0;
+  pupil.radiusY = varY > 0 ? 2.0 * std::sqrt(varY) : 0.0;
+  return pupil;
+}
+
+//=============================================================================
+// CWavefrontResult
+//=============================================================================
+bool CWavefrontResult::MeetsStrehl() const {
+  return valid && strehl >= Quality::MIN_STREHL;
+}
+
+double CWavefrontResult::Evaluate(double u, double v) const {
+  double w = 0.0;
+  for (size_t j = 0; j < zernike.size(); j++)
+    w += zernike[j] * CWavefrontFitter::Zernike((int)j + 1, u, v);
+  return w;
+}
+
+//=============================================================================
+// Аппроксимация
+//=============================================================================
+bool CWavefrontFitter::Fit(const std::vector<std::vector<CTracerPoint>>& lines,
+                           const std::vector<double>& orders,
+                           const CEllipseBoundary& boundary,
+                           CWavefrontResult& result) {
+  INTERF_TIMED_SCOPE(m_stats, Wavefront);
+  result = CWavefrontResult();
+  m_lastError.clear();
+
+  const int numTerms = m_params.numTerms;
+  if (numTerms < 1) {
+    m_lastError = "Число членов Цернике < 1";
+    return false;
+  }
+  if (orders.size() != lines.size()) {
+    m_lastError = "Число порядков не совпадает с числом линий";
+    return false;
+  }
+
+  CPupilGeometry pupil = PupilFromBoundary(boundary);
+  if (!pupil.IsValid()) {
+    m_lastError = "Внешняя граница зрачка не установлена";
+    return false;
+  }
+  result.pupil = pupil;
+
+  // --- Точки полос в нормированных координатах ---
+  CFitPoints pts;
+  size_t total = 0;
+  for (const auto& line : lines) total += line.size();
+  pts.u.reserve(total);
+  pts.v.reserve(total);
+  pts.w.reserve(total);
+
+  for (size_t i = 0; i < lines.size(); i++) {
+    if (std::isnan(orders[i])) continue;
+    double w = orders[i] * m_params.wavesPerFringe;
+    for (const CTracerPoint& p : lines[i]) {
+      if (!boundary.IsInside(p.x, p.y)) continue;
+      double u = (p.PosX() - pupil.centerX) / pupil.radiusX;
+      double v = (p.PosY() - pupil.centerY) / pupil.radiusY;
+      if (u * u + v * v > 1.0) continue;
+      pts.u.push_back(u);
+      pts.v.push_back(v);
+      pts.w.push_back(w);
+    }
+  }
+  const int n = pts.Size();
+  INTERF_COUNT(m_stats, WavefrontPoints, n);
+  if (n < numTerms) {
+    m_lastError = "Точек в зрачке (" + std::to_string(n) +
+                  ") меньше числа членов (" + std::to_string(numTerms) + ")";
+    return false;
+  }
+
+  // --- МНК ---
+  std::vector<double> z;
+  bool solved = false;
+  if (m_params.solver == EZernikeSolver::NormalEquations) {
+    int numThreads = m_params.numThreads;
+    if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+    numThreads = (std::max)(1, (std::min)(numThreads, n / kMinPointsPerThread));
+
+    // Каждый поток — свой диапазон точек и своя AᵀA; сумма после join()
+    std::vector<std::vector<double>> ata(numThreads), atw(numThreads);
+    auto worker = [&](int t) {
+      int begin = (int)((int64_t)n * t / numThreads);
+      int end = (int)((int64_t)n * (t + 1) / numThreads);
+      AccumulateNormal(pts, begin, end, numTerms, ata[t], atw[t]);
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < numThreads; t++) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& th : pool) th.join();
+
+    for (int t = 1; t < numThreads; t++) {
+      for (size_t i = 0; i < ata[0].size(); i++) ata[0][i] += ata[t][i];
+      for (int i = 0; i < numTerms; i++) atw[0][i] += atw[t][i];
+    }
+    z = atw[0];
+    solved = CholeskySolve(ata[0], z, numTerms);
+  }
+  if (!solved) {
+    // QR по запросу или при плохой обусловленности AᵀA
+    std::vector<double> a, w = pts.w;
+    BuildDesignMatrix(pts, numTerms, a);
+    if (!HouseholderSolve(a, w, n, numTerms, z)) {
+      m_lastError = "МНК: вырожденная система (точки не покрывают зрачок?)";
+      return false;
+    }
+  }
+  result.zernike = z;
+  result.numPoints = n;
+
+  // --- Невязка в точках полос ---
+  CZernikeBasis basis(numTerms);
+  std::vector<double> row(numTerms);
+  double ss = 0.0;
+  for (int i = 0; i < n; i++) {
+    basis.Row(pts.u[i], pts.v[i], row.data());
+    double e = pts.w[i];
+    for (int j = 0; j < numTerms; j++) e -= result.zernike[j] * row[j];
+    ss += e * e;
+  }
+  result.fitRms = std::sqrt(ss / n);
+
+  // --- Характеристики по сетке внутри зрачка ---
+  std::vector<double> coeffs = result.zernike;
+  coeffs[0] = 0.0;  // поршень
+  if (m_params.removeTilt)
+    for (int j = 1; j <= 2 && j < numTerms; j++) coeffs[j] = 0.0;
+  if (m_params.removeDefocus && numTerms > 3) coeffs[3] = 0.0;
+
+  double diameter = 2.0 * (std::max)(pupil.radiusX, pupil.radiusY);
+  int step = (std::max)(1, (int)std::lround(
+                               diameter / (std::max)(1, m_params.statsGrid)));
+  int y0 = (int)std::ceil(pupil.centerY - pupil.radiusY);
+  int y1 = (int)std::floor(pupil.centerY + pupil.radiusY);
+  int x0 = (int)std::ceil(pupil.centerX - pupil.radiusX);
+  int x1 = (int)std::floor(pupil.centerX + pupil.radiusX);
+
+  int64_t count = 0;
+  double sum = 0.0, sum2 = 0.0;
+  double wMin = 0.0, wMax = 0.0;
+  // Узлы сетки (x0 + i·step, y0 + j·step) — только на отрезках зрачка
+  boundary.ForEachSpan(y0, y1 + 1, [&](int y, int spanX0, int spanX1) {
+    if ((y - y0) % step != 0) return;
+    const int first = (std::max)(spanX0, x0);
+    const int last = (std::min)(spanX1 - 1, x1);
+    for (int x = x0 + (first - x0 + step - 1) / step * step; x <= last;
+         x += step) {
+      double u = (x - pupil.centerX) / pupil.radiusX;
+      double v = (y - pupil.centerY) / pupil.radiusY;
+      if (u * u + v * v > 1.0) continue;
+      basis.Row(u, v, row.data());
+      double w = 0.0;
+      for (int j = 0; j < numTerms; j++) w += coeffs[j] * row[j];
+      if (count == 0 || w < wMin) wMin = w;
+      if (count == 0 || w > wMax) wMax = w;
+      sum += w;
+      sum2 += w * w;
+      count++;
+    }
+  });
+  if (count == 0) {
+    m_lastError = "Нет отсчётов сетки внутри зрачка";
+    return false;
+  }
+
+  WavefrontStats& st = result.stats;
+  st.PV = wMax - wMin;
+  st.mean = sum / count;
+  st.RMS = std::sqrt(sum2 / count);
+  st.stddev = std::sqrt((std::max)(sum2 / count - st.mean * st.mean, 0.0));
+
+  double phase = Physics::TWO_PI * st.stddev;
+  result.strehl = std::exp(-phase * phase);
+  result.valid = true;
+  return true;
+}
+
+}  // namespace Interferometry
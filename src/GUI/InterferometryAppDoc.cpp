@@ -28,7 +28,10 @@ END_MESSAGE_MAP()
 
 // CInterferometryAppDoc construction/destruction
 
-CInterferometryAppDoc::CInterferometryAppDoc() noexcept {}
+CInterferometryAppDoc::CInterferometryAppDoc() noexcept {
+  // Кадр документа живёт до закрытия — исходный файл держать открытым нельзя
+  m_imageLoader.SetZeroCopy(false);
+}
 
 CInterferometryAppDoc::~CInterferometryAppDoc() {}
 
@@ -14,6 +14,8 @@
 #include "InterferometryAppDoc.h"
 #include "InterferometryAppView.h"
 #include "MainFrm.h"
+
+#include <cmath>
 #ifdef _DEBUG
 #define new DEBUG_NEW
 #endif
@@ -45,6 +47,11 @@ ON_COMMAND(ID_PROCESS_CLEAR, &CInterferometryAppView::OnProcessClear)
 ON_WM_LBUTTONDOWN()
 ON_WM_KEYDOWN()
 ON_WM_MOUSEMOVE()
+ON_WM_MOUSEWHEEL()
+ON_WM_MBUTTONDOWN()
+ON_WM_MBUTTONUP()
+ON_WM_SIZE()
+ON_WM_ERASEBKGND()
 
 END_MESSAGE_MAP()
 
@@ -54,12 +61,11 @@ CInterferometryAppView::CInterferometryAppView() noexcept
     : m_currentMode(Interferometry::EditMode::MODE_NONE),
       m_imageOffsetX(10),
       m_imageOffsetY(60),
-      m_cacheBitmap(NULL) {}
+      m_viewportImage(nullptr),
+      m_viewportLines(0),
+      m_panning(false) {}
 
-CInterferometryAppView::~CInterferometryAppView()
-{
-  InvalidateChachedBitmap();
-}
+CInterferometryAppView::~CInterferometryAppView() {}
 
 BOOL CInterferometryAppView::PreCreateWindow(CREATESTRUCT &cs)
 {
@@ -74,32 +80,135 @@ BOOL CInterferometryAppView::PreCreateWindow(CREATESTRUCT &cs)
 // ===============================
 CPoint CInterferometryAppView::WindowToImage(CPoint windowPt) const
 {
-  return CPoint(windowPt.x - m_imageOffsetX, windowPt.y - m_imageOffsetY);
+  // Центр пикселя окна -> точка кадра -> пиксель кадра
+  cv::Point2d p = m_viewport.GetTransform().ViewToImage(
+      windowPt.x - m_imageOffsetX + 0.5, windowPt.y - m_imageOffsetY + 0.5);
+  return CPoint((int)std::floor(p.x), (int)std::floor(p.y));
+}
+
+CRect CInterferometryAppView::GetViewportRect() const
+{
+  return CRect(m_imageOffsetX, m_imageOffsetY,
+               m_imageOffsetX + m_viewport.Width(),
+               m_imageOffsetY + m_viewport.Height());
 }
 
 // ========================
-// Кэширование HBITMAP
+// Синхронизация окна просмотра с документом
 // ========================
-void CInterferometryAppView::InvalidateCachedBitmap()
+void CInterferometryAppView::SyncViewport()
 {
-  if (m_chachedBitmap)
+  CInterferometryAppDoc *pDoc = GetDocument();
+  if (!pDoc)
+    return;
+
+  // Новый кадр: пирамида строится один раз, масштаб — весь кадр в окне
+  const cv::Mat &image = pDoc->GetImageLoader().GetImage();
+  const uchar *data = pDoc->HasImage() ? image.data : nullptr;
+  if (data != m_viewportImage)
   {
-    ::DeleteObject(m_chacheBitmap);
-    m_chacheBitmap = NULL;
+    if (data)
+    {
+      m_overlay.Reset(image.cols, image.rows);
+      m_viewport.SetImage(image);
+      m_viewport.SetOverlay(&m_overlay);
+      m_viewport.FitToView();
+    }
+    else
+    {
+      m_viewport.SetOverlay(nullptr);
+      m_overlay.Reset(0, 0);
+      m_viewport.ClearImage();
+    }
+    m_viewportImage = data;
   }
-}
 
-void CInterferometryAppView::EnsureCachedBitmap()
-{
-  if (m_cachedBitmap)
+  // Линии: новые дописываются (грязной становится только их область),
+  // при уменьшении числа — передаются заново
+  const auto &lines = pDoc->GetFringeLines();
+  if (lines.size() < m_viewportLines)
+  {
+    std::vector<std::vector<Interferometry::CTracerPoint>> points;
+    std::vector<Interferometry::CColor> colors;
+    points.reserve(lines.size());
+    colors.reserve(lines.size());
+    for (const auto &line : lines)
+    {
+      points.push_back(line.points);
+      colors.push_back((Interferometry::CColor)line.color);
+    }
+    m_viewport.SetLines(points, colors);
+  }
+  else
+  {
+    for (size_t i = m_viewportLines; i < lines.size(); i++)
+      m_viewport.AddLine(lines[i].points,
+                         (Interferometry::CColor)lines[i].color);
+  }
+  m_viewportLines = lines.size();
+
+  // Разметка: слой меняется только там, где изменились границы или точки
+  if (!data)
     return;
+  m_overlay.SetBoundary(pDoc->GetBoundary());
 
-  CInterferometryAppDoc *pDoc = GetDocument();
-  if (!pDoc || !pDoc->HasImage())
+  const std::vector<CPoint> *input = nullptr;
+  Interferometry::CColor inputColor = 0;
+  if (m_currentMode == Interferometry::EditMode::MODE_SET_OUTER_BOUNDARY)
+  {
+    input = &pDoc->GetOuterEllipsePoints();
+    inputColor = Interferometry::MakeColor(255, 0, 0); // Красный
+  }
+  else if (m_currentMode == Interferometry::EditMode::MODE_SET_INNER_BOUNDARY)
+  {
+    input = &pDoc->GetInnerEllipsePoints();
+    inputColor = Interferometry::MakeColor(0, 0, 255); // Синий
+  }
+  if (input)
+  {
+    std::vector<cv::Point2f> points;
+    for (const CPoint &pt : *input)
+      points.emplace_back((float)pt.x, (float)pt.y);
+    m_overlay.SetMarkers(points, inputColor, Interferometry::EMarkerShape::Dot,
+                         true);
+  }
+  else
+  {
+    m_overlay.ClearMarkers();
+  }
+
+  std::vector<cv::Rect> changed;
+  m_overlay.Update(&changed);
+  for (const cv::Rect &rect : changed)
+    m_viewport.InvalidatePixels(rect);
+}
+
+// ========================
+// Вывод буфера окна просмотра
+// ========================
+void CInterferometryAppView::BlitViewport(CDC *pDC, const CRect &rect)
+{
+  CRect area;
+  if (!area.IntersectRect(rect, GetViewportRect()))
     return;
 
-  const Interferometry::ImageLoader &loader = pDoc->GetImageLoader();
-  m_cachedBitmap = loader.CreateHBITMAP();
+  const cv::Mat &buffer = m_viewport.GetBuffer();
+  int x = area.left - m_imageOffsetX;
+  int y = area.top - m_imageOffsetY;
+
+  // DIB сверху вниз из строк [y, y + height) буфера: строки BGRA
+  // выровнены на DWORD, шаг буфера равен ширине DIB
+  BITMAPINFO bmi = {};
+  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+  bmi.bmiHeader.biWidth = buffer.cols;
+  bmi.bmiHeader.biHeight = -area.Height();
+  bmi.bmiHeader.biPlanes = 1;
+  bmi.bmiHeader.biBitCount = 32;
+  bmi.bmiHeader.biCompression = BI_RGB;
+
+  ::SetDIBitsToDevice(pDC->GetSafeHdc(), area.left, area.top, area.Width(),
+                      area.Height(), x, 0, 0, area.Height(), buffer.ptr(y),
+                      &bmi, DIB_RGB_COLORS);
 }
 
 // CInterferometryAppView drawing
@@ -127,64 +236,26 @@ void CInterferometryAppView::OnDraw(CDC *pDC)
         width, height, (LPCTSTR)GetModeText());
     CRect textRect = rect;
     textRect.bottom = m_imageOffsetY - 5;
+    // Фон вокруг области кадра (OnEraseBkgnd его не стирает)
+    int savedDC = pDC->SaveDC();
+    pDC->ExcludeClipRect(GetViewportRect());
+    pDC->FillSolidRect(&rect, ::GetSysColor(COLOR_WINDOW));
+    pDC->RestoreDC(savedDC);
     pDC->DrawText(info, &textRect, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
 
-    // Рисуем изображение с кэшированием
-    EnsureCachedBitmap();
-    if (m_cachedBitmap)
-    {
-      CDC dcMem;
-      dcMem.CreateCompatibleDC(pDC);
-      HBITMAP holdBitmap = (HBITMAP)dcMem.SelectObject(m_cachedBitmap);
-
-      pDC->BitBlt(m_imageOffsetX, m_imageOffsetY, width, height, &dcMem, 0, 0,
-                  SRCCOPY);
-
-      dcMem.SelectObject(holdBitmap);
-      // НЕ удаляем m_cachedBitmap — он кэширован!
-    }
-
-    // === Все дальнейшие координаты в пространстве изображения ===
-    // Сдвигаем начало координат DC на offset изображения
-    pDC->SetViewportOrg(m_imageOffsetX, m_imageOffsetY);
-
-    // === 2. Рисуем точки границ ===
-    // ИСПРАВЛЕНО: первое условие теперь MODE_SET_OUTER_BOUNDARY (был баг — оба
-    // были INNER)
-    if (m_currentMode == Interferometry::EditMode::MODE_SET_OUTER_BOUNDARY)
-    {
-      DrawBoundaryPoints(pDC, pDoc->GetOuterEllipsePoints(),
-                         RGB(255, 0, 0)); // Красный
-    }
-    else if (m_currentMode ==
-             Interferometry::EditMode::MODE_SET_INNER_BOUNDARY)
-    {
-      DrawBoundaryPoints(pDC, pDoc->GetInnerEllipsePoints(),
-                         RGB(0, 0, 255)); // Синий
-    }
-
-    // === 3. Рисуем эллипсы границ ===
-    if (pDoc->HasOuterBoundary())
-    {
-      DrawEllipseBoundary(pDC, true);
-    }
-    if (pDoc->HasInnerBoundary())
-    {
-      DrawEllipseBoundary(pDC, false);
-    }
-
-    // === 4. Рисуем трассированные линии ===
-    const auto &lines = pDoc->GetFringeLines();
-    for (const auto &line : lines)
-    {
-      DrawFringeLine(pDC, line);
-    }
+    // === Кадр, границы, точки ввода и линии ===
+    // Слой разметки и буфер окна обновляются только в грязных областях;
+    // в окно выводится только область отсечения WM_PAINT
+    SyncViewport();
+    m_viewport.Render();
 
-    // Восстановить начало координат
-    pDC->SetViewportOrg(0, 0);
+    CRect clipRect;
+    pDC->GetClipBox(&clipRect);
+    BlitViewport(pDC, clipRect);
   }
   else
   {
+    pDC->FillSolidRect(&rect, ::GetSysColor(COLOR_WINDOW));
     // ===== НЕТ ИЗОБРАЖЕНИЯ - показываем инструкцию =====
     CString msg =
         _T("Interferometry Application\n\n")
@@ -269,9 +340,6 @@ void CInterferometryAppView::OnFileOpen()
     CString filePath = dlg.GetPathName();
     std::wstring wFilePath(filePath);
 
-    // Сбросить кэш при загрузке нового изображения
-    InvalidateCachedBitmap();
-
     if (pDoc->LoadImage(wFilePath))
     {
       // Сбросить режим
@@ -457,6 +525,23 @@ void CInterferometryAppView::OnLButtonDown(UINT nFlags, CPoint point)
 
 void CInterferometryAppView::OnMouseMove(UINT nFlags, CPoint point)
 {
+  if (m_panning)
+  {
+    int dx = point.x - m_panLast.x;
+    int dy = point.y - m_panLast.y;
+    m_panLast = point;
+    if (dx != 0 || dy != 0)
+    {
+      // Буфер и окно прокручиваются, перерисовывается только открывшаяся
+      // полоса
+      m_viewport.Pan(dx, dy);
+      CRect viewRect = GetViewportRect();
+      ScrollWindowEx(dx, dy, &viewRect, &viewRect, NULL, NULL,
+                     SW_INVALIDATE);
+      UpdateWindow();
+    }
+  }
+
   CInterferometryAppDoc *pDoc = GetDocument();
   if (pDoc && pDoc->HasImage())
   {
@@ -548,138 +633,90 @@ void CInterferometryAppView::OnKeyDown(UINT nChar, UINT nRepCnt, UINT nFlags)
     UpdateStatusBar();
     Invalidate();
   }
-
-  CView::OnKeyDown(nChar, nRepCnt, nFlags);
-}
-
-// === Вспомогательные методы
-void CInterferometryAppView::DrawBoundaryPoints(CDC *pDC,
-                                                const std::vector<CPoint> &points,
-                                                COLORREF color)
-{
-  if (points.empty())
-    return;
-
-  // Создать перо и кисть
-  CPen pen(PS_SOLID, 2, color);
-  CBrush brush(color);
-  CPen *poldPen = pDC->SelectObject(&pen);
-  CBrush *poldBrush = pDC->SelectObject(&brush);
-
-  // Нарисовать кружки
-  for (const auto &pt : points)
-  {
-    pDC->Ellipse(pt.x - 4, pt.y - 4, pt.x + 4, pt.y + 4);
-  }
-
-  // Нарисовать линию между точками
-  if (points.size() > 1)
+  // HOME - весь кадр в окне
+  else if (nChar == VK_HOME)
   {
-    CPen dashedPen(PS_DOT, 1, color);
-    pDC->SelectObject(&dashedPen);
-
-    pDC->MoveTo(points[0]);
-    for (size_t i = 1; i < points.size(); i++)
-    {
-      pDC->LineTo(points[i]);
-    }
+    m_viewport.FitToView();
+    Invalidate(FALSE);
   }
 
-  pDC->SelectObject(poldPen);
-  pDC->SelectObject(poldBrush);
+  CView::OnKeyDown(nChar, nRepCnt, nFlags);
 }
 
-void CInterferometryAppView::DrawEllipseBoundary(CDC *pDC, bool isOuter)
+BOOL CInterferometryAppView::OnMouseWheel(UINT nFlags, short zDelta, CPoint pt)
 {
   CInterferometryAppDoc *pDoc = GetDocument();
-  if (!pDoc)
-    return;
-
-  const Interferometry::CEllipseBoundary &boundary = pDoc->GetBoundary();
-  const auto &rows = boundary.GetAllBoundaries();
-
-  if (rows.empty())
-    return;
-
-  // Выбрать цвет
-  COLORREF color = isOuter ? RGB(255, 255, 255) : RGB(0, 255, 255); // Белый / Cyan
-  CPen pen(PS_SOLID, 1, color);
-  CPen *poldPen = pDC->SelectObject(&pen);
+  if (!pDoc || !pDoc->HasImage())
+    return CView::OnMouseWheel(nFlags, zDelta, pt);
+
+  // pt — в координатах экрана; шаг колеса — масштаб × 1.25
+  ScreenToClient(&pt);
+  double factor = std::pow(1.25, (double)zDelta / WHEEL_DELTA);
+  m_viewport.ZoomAt(factor, pt.x - m_imageOffsetX, pt.y - m_imageOffsetY);
+  Invalidate(FALSE);
+  return TRUE;
+}
 
-  int height = (int)rows.size();
+void CInterferometryAppView::OnMButtonDown(UINT nFlags, CPoint point)
+{
+  m_panning = true;
+  m_panLast = point;
+  SetCapture();
+  CView::OnMButtonDown(nFlags, point);
+}
 
-  int firstY = -1;
-  for (int y = 0; y < height; y++)
+void CInterferometryAppView::OnMButtonUp(UINT nFlags, CPoint point)
+{
+  if (m_panning)
   {
-    bool hasBoundary = isOuter ? rows[y].HasOuterBoundary() : rows[y].HasInnerBoundary();
-    if (hasBoundary)
-    {
-      int leftX = isOuter ? rows[y].LeftOuter : rows[y].leftInner;
-      int rightX = isOuter ? rows[y].rightOuter : rows[y].rightInner;
-      if (leftX > 0 || rightX > 0)
-      {
-        if (firstY < 0)
-        {
-          firstY = y;
-          pDC->MoveTo(leftX, y);
-        }
-        // Левая дуга
-        pDC->LineTo(leftX, y);
-      }
-    }
+    m_panning = false;
+    ReleaseCapture();
   }
+  CView::OnMButtonUp(nFlags, point);
+}
 
-  // Правая дуга
-  firstY = -1;
-  for (int y = 0; y < height; y++)
-  {
-    bool hasBoundary =
-        isOuter ? rows[y].HasOuterBoundary() : rows[y].HasInnerBoundary();
-    if (hasBoundary)
-    {
-      int rightX = isOuter ? rows[y].rightOuter : rows[y].rightInner;
-      if (rightX > 0)
-      {
-        if (firstY < 0)
-        {
-          firstY = y;
-          pDC->MoveTo(rightX, y);
-        }
-        pDC->LineTo(rightX, y);
-      }
-    }
-  }
+void CInterferometryAppView::OnSize(UINT nType, int cx, int cy)
+{
+  CView::OnSize(nType, cx, cy);
+  m_viewport.Resize(max(cx - 2 * m_imageOffsetX, 0),
+                    max(cy - m_imageOffsetY - m_imageOffsetX, 0));
+}
 
-  pDC->SelectObject(poldPen);
+BOOL CInterferometryAppView::OnEraseBkgnd(CDC * /*pDC*/)
+{
+  // Фон закрашивает OnDraw — без мерцания при прокрутке
+  return TRUE;
 }
 
-void CInterferometryAppView::DrawFringeLine(CDC *pDC,
-   const Interferometry::FringeLine &line)
+void CInterferometryAppView::OnUpdate(CView * /*pSender*/, LPARAM /*lHint*/,
+                                      CObject * /*pHint*/)
 {
-  if (line.IsEmpty())
+  // Изменился документ: новые линии, границы и кадр помечают грязными свои
+  // области, в окне перерисовываются только они и строка информации
+  SyncViewport();
+  CInterferometryAppDoc *pDoc = GetDocument();
+  if (!pDoc || !pDoc->HasImage())
+  {
+    Invalidate(FALSE);
     return;
+  }
 
-  CPen pen(PS_SOLID, 2, line.color);
-  CPen *pOldPen = pDC->SelectObject(&pen);
-
-  const auto &points = line.points;
-  pDC->MoveTo(points[0].x, points[0].y);
-
-  for (size_t i = 1; i < points.size(); i++)
+  std::vector<cv::Rect> updated;
+  m_viewport.Render(&updated);
+  for (const cv::Rect &rect : updated)
   {
-    pDC->LineTo(points[i].x, points[i].y);
+    CRect area(rect.x, rect.y, rect.x + rect.width, rect.y + rect.height);
+    area.OffsetRect(m_imageOffsetX, m_imageOffsetY);
+    InvalidateRect(&area, FALSE);
   }
 
-  // Нарисовать начальную точку маркером
-  CBrush brush(line.color);
-  CBrush *pOldBrush = pDC->SelectObject(&brush);
-  pDC->Ellipse(points[0].x - 3, points[0].y - 3, points[0].x + 3,
-               points[0].y + 3);
-
-  pDC->SelectObject(pOldBrush);
-  pDC->SelectObject(pOldPen);
+  CRect header;
+  GetClientRect(&header);
+  header.bottom = m_imageOffsetY;
+  InvalidateRect(&header, FALSE);
 }
 
+// === Вспомогательные методы
 void CInterferometryAppView::UpdateStatusBar()
 {
   CMainFrame *pMainFrame = (CMainFrame *)AfxGetMainWnd();
@@ -24,6 +24,8 @@
  * @code
  *   pipeline_test.exe bat2v31.bmp
  *   pipeline_test.exe bat2v31.bmp 185 180    # стартовая точка (x, y)
+ *   pipeline_test.exe bat2v31.bmp 185 180 8  # фиксированная степень
+ *                                            # (без неё — выбор по BIC)
  * @endcode
  */
 
@@ -49,7 +51,9 @@
 #include "FringeSkeletonizer.h"
 #include "FringeTracer.h"
 #include "ImageLoader.h"
+#include "Overlay.h"
 #include "PolynomialApproximator.h"
+#include "PupilDetector.h"
 
 using namespace Interferometry;
 
@@ -152,8 +156,9 @@ static bool SavePointsCSV(const std::string& filename,
 
   out << "line_id,point_idx,x,y,width,intensity" << std::endl;
   for (int i = 0; i < (int)points.size(); i++) {
-    out << lineId << "," << i << "," << points[i].x << "," << points[i].y << ","
-        << std::fixed << std::setprecision(2) << points[i].width << ","
+    out << lineId << "," << i << "," << std::fixed << std::setprecision(2)
+        << points[i].PosX() << "," << points[i].PosY() << ","
+        << points[i].width << ","
         << points[i].intensity << std::endl;
   }
 
@@ -197,61 +202,62 @@ static bool SaveApproxCSV(const std::string& filename,
 }
 
 /**
- * @brief Сохранение изображения с эллипсом границы и линиями трассировки.
+ * @brief Таблица невязок по степеням в виде *APPOLN* отчёта SCAN.
+ * @param chosen Выбранное число коэффициентов (помечается «<»).
+ */
+static void PrintResidualTable(const std::vector<DegreeResidual>& table,
+                               int chosen) {
+  std::cout << "    *APPOLN*  NP       RMSA       DISP        BIC" << std::endl;
+  for (const DegreeResidual& r : table) {
+    std::cout << "          " << std::setw(4) << r.degree - 1 << std::fixed
+              << std::setprecision(4) << std::setw(11) << r.rms
+              << std::setw(11) << r.disp << std::setprecision(1)
+              << std::setw(11) << r.bic << (r.degree == chosen ? "  <" : "")
+              << std::endl;
+  }
+}
+
+/**
+ * @brief Сохранение изображения с границей и линиями трассировки.
+ *
+ * Разметка — COverlay, как в окне приложения и в BatchProcess: контур
+ * границы по строкам маски, крест в центре эллипса, линии с маркером начала.
  */
 static bool SaveDebugImage(
     const std::string& filename, const cv::Mat& image,
     const std::vector<std::vector<CTracerPoint>>& allPoints,
-    const EllipseParams& ellipse = EllipseParams()) {
-  cv::Mat color;
-  cv::cvtColor(image, color, cv::COLOR_GRAY2BGR);
-
-  // Эллипс границы (зелёный)
-  if (ellipse.IsValid()) {
-    cv::ellipse(color, cv::Point(ellipse.centerX, ellipse.centerY),
-                cv::Size(ellipse.semiAxisA, ellipse.semiAxisB), 0, 0, 360,
-                cv::Scalar(0, 255, 0), 1);
-    // Крестик в центре
-    cv::line(color, cv::Point(ellipse.centerX - 5, ellipse.centerY),
-             cv::Point(ellipse.centerX + 5, ellipse.centerY),
-             cv::Scalar(0, 0, 255), 1);
-    cv::line(color, cv::Point(ellipse.centerX, ellipse.centerY - 5),
-             cv::Point(ellipse.centerX, ellipse.centerY + 5),
-             cv::Scalar(0, 0, 255), 1);
-  }
+    const CEllipseBoundary& boundary,
+    const EllipseParams& ellipse = EllipseParams(), int boundaryWidth = 1) {
+  COverlayParams params;
+  params.lineWidth = 3;
+  params.boundaryWidth = boundaryWidth;
+  params.markerRadius = 4;
+  params.outerColor = MakeColor(0, 255, 0);  // зелёный
+  COverlay overlay;
+  overlay.SetParams(params);
+  overlay.Reset(image.cols, image.rows);
+  overlay.SetBoundary(boundary);
 
   // Цвета для разных линий
-  const cv::Scalar colors[] = {
-      cv::Scalar(0, 255, 255),    // жёлтый
-      cv::Scalar(0, 255, 0),      // зелёный
-      cv::Scalar(255, 100, 100),  // голубой
-      cv::Scalar(0, 165, 255),    // оранжевый
-      cv::Scalar(255, 0, 255),    // пурпурный
-      cv::Scalar(0, 200, 200),    // тёмно-жёлтый
+  const CColor colors[] = {
+      MakeColor(255, 255, 0),    // жёлтый
+      MakeColor(0, 255, 0),      // зелёный
+      MakeColor(100, 100, 255),  // голубой
+      MakeColor(255, 165, 0),    // оранжевый
+      MakeColor(255, 0, 255),    // пурпурный
+      MakeColor(200, 200, 0),    // тёмно-жёлтый
   };
   int numColors = sizeof(colors) / sizeof(colors[0]);
+  for (int lineIdx = 0; lineIdx < (int)allPoints.size(); lineIdx++)
+    overlay.AddLine(allPoints[lineIdx], colors[lineIdx % numColors]);
 
-  for (int lineIdx = 0; lineIdx < (int)allPoints.size(); lineIdx++) {
-    const auto& pts = allPoints[lineIdx];
-    cv::Scalar col = colors[lineIdx % numColors];
-
-    for (int i = 0; i < (int)pts.size(); i++) {
-      cv::circle(color, cv::Point(pts[i].x, pts[i].y), 1, col, -1);
-
-      if (i > 0) {
-        cv::line(color, cv::Point(pts[i - 1].x, pts[i - 1].y),
-                 cv::Point(pts[i].x, pts[i].y), col, 3);
-      }
-    }
+  // Крестик в центре
+  if (ellipse.IsValid())
+    overlay.SetMarkers({cv::Point2f((float)ellipse.centerX,
+                                    (float)ellipse.centerY)},
+                       MakeColor(255, 0, 0), EMarkerShape::Cross);
 
-    // Маркер старта
-    if (!pts.empty()) {
-      cv::circle(color, cv::Point(pts[0].x, pts[0].y), 4, cv::Scalar(0, 0, 255),
-                 1);
-    }
-  }
-
-  return cv::imwrite(filename, color);
+  return cv::imwrite(filename, overlay.Compose(image));
 }
 
 //=============================================================================
@@ -297,20 +303,14 @@ static std::vector<std::pair<int, int>> FindStartPoints(
     std::cout << x << ":" << (int)profile[x] << std::endl;
   }
   std::cout << std::endl;
-  // Границы рабочей области
+  // Границы рабочей области — первый и последний отрезок строки cy
   int xLeft = 0, xRight = width - 1;
-  for (int x = 0; x < width; x++) {
-    if (boundary.IsInside(x, cy)) {
-      xLeft = x;
-      break;
-    }
-  }
-  for (int x = width - 1; x >= 0; x--) {
-    if (boundary.IsInside(x, cy)) {
-      xRight = x;
-      break;
-    }
-  }
+  bool hasSpan = false;
+  boundary.ForEachSpan(cy, cy + 1, [&](int, int x0, int x1) {
+    if (!hasSpan) xLeft = x0;
+    xRight = (std::min)(x1, width) - 1;
+    hasSpan = true;
+  });
 
   int safeLeft = xLeft + 3;
   int safeRight = xRight - 3;
@@ -406,8 +406,10 @@ static std::vector<std::pair<int, int>> FindStartPoints(
   std::cout << "  DEBUG safeLeft=" << safeLeft << " safeRight=" << safeRight
             << std::endl;
   int insideCount = 0;
-  for (int x = safeLeft; x <= safeRight; x++)
-    if (boundary.IsInside(x, cy)) insideCount++;
+  boundary.ForEachSpan(cy, cy + 1, [&](int, int x0, int x1) {
+    insideCount += (std::max)(0, (std::min)(x1 - 1, safeRight) -
+                                     (std::max)(x0, safeLeft) + 1);
+  });
   std::cout << "  DEBUG insideCount=" << insideCount
             << " allPeaks=" << allPeaks.size() << std::endl;
 
@@ -442,9 +444,9 @@ int main(int argc, char* argv[]) {
   std::cout << "\n[1] Загрузка: " << imagePath << std::endl;
 
   int startX = -1, startY = -1;  // -1 = автоматический поиск
-  int polyDegree = 8;
+  int polyDegree = 0;  // 0 — выбор степени по BIC
   int maxLines = 20;
-  // Хардкод эллипса (0 = автоопределение)
+  // Эллипс для ручного ввода, если автоопределение не справилось
   int ellipseCX = 420, ellipseCY = 360, ellipseA = 310, ellipseB = 320;
 
   // if (argc >= 2) imagePath = argv[1];
@@ -480,83 +482,27 @@ int main(int argc, char* argv[]) {
   CEllipseBoundary boundary;
   boundary.Initialize(loader.GetWidth(), loader.GetHeight());
 
-  // Автоопределение эллипса: находим границу интерферограммы по порогу яркости.
-  //
-  // Проблема: простое сканирование по одному лучу натыкается на тёмные полосы
-  // интерференции и принимает их за край. Решение: усреднять яркость по
-  // широкой полосе (±20 пикселей), чтобы полосы сгладились.
-  int imgW = loader.GetWidth();
-  int imgH = loader.GetHeight();
-  int cx = imgW / 2;
-  int cy = imgH / 2;
-
-  // Порог = 10% от максимальной яркости
-  double minVal, maxVal;
-  loader.GetMinMax(minVal, maxVal);
-  int threshold = (int)(maxVal * 0.10);
-
-  // Вспомогательная лямбда: средняя яркость в прямоугольнике
-  auto avgBrightness = [&](int x, int y) -> float {
-    const int R = 15;
-    float sum = 0;
-    int cnt = 0;
-    for (int dy = -R; dy <= R; dy++) {
-      for (int dx = -R; dx <= R; dx++) {
-        int px = x + dx, py = y + dy;
-        if (px >= 0 && px < imgW && py >= 0 && py < imgH) {
-          sum += loader.GetPixel(px, py);
-          cnt++;
-        }
-      }
-    }
-    return (cnt > 0) ? sum / cnt : 0;
-  };
-
-  // Сканируем лучи из центра по 36 направлениям (каждые 10 градусов)
-  const int NUM_RAYS = 36;
-  std::vector<cv::Point2f> edgePoints;
-
-  for (int i = 0; i < NUM_RAYS; i++) {
-    double angle = i * 2.0 * CV_PI / NUM_RAYS;
-    double dx = cos(angle);
-    double dy = sin(angle);
-
-    // Идём от центра наружу
-    int maxR = (int)(sqrt((double)(imgW * imgW + imgH * imgH)) / 2.0);
-    for (int r = 10; r < maxR; r++) {
-      int x = cx + (int)(dx * r);
-      int y = cy + (int)(dy * r);
-
-      if (x < 0 || x >= imgW || y < 0 || y >= imgH) break;
-
-      if (avgBrightness(x, y) <= threshold) {
-        // Нашли край — берём точку чуть раньше
-        int ex = cx + (int)(dx * (r - 2));
-        int ey = cy + (int)(dy * (r - 2));
-        edgePoints.push_back(cv::Point2f((float)ex, (float)ey));
-        break;
-      }
-    }
-  }
-
-  std::cout << "  Найдено точек края: " << edgePoints.size() << std::endl;
-
+  // Автоопределение зрачка: внешний эллипс и центральное экранирование
+  // (см. PupilDetector.h). Ручной ввод — только если зрачок не найден
+  CPupilDetector detector;
+  CPupilDetection pupil;
   EllipseParams outerEllipse;
-  // Фитируем эллипс по найденным точкам (нужно минимум 5)
-  if (edgePoints.size() >= 5) {
-    cv::RotatedRect fittedEllipse = cv::fitEllipse(edgePoints);
-
-    outerEllipse = EllipseParams(
-        (int)fittedEllipse.center.x, (int)fittedEllipse.center.y,
-        (int)(fittedEllipse.size.width / 2.0f) - 2,  // полуось A, -2 запас
-        (int)(fittedEllipse.size.height / 2.0f) - 2,
-        (float)(fittedEllipse.angle)  // угол наклона!
-    );
-
+  if (detector.Detect(loader.GetImage(), pupil)) {
+    std::cout << "  Точек края: " << pupil.outerPoints.size()
+              << ", согласованных: " << pupil.outerInliers
+              << ", СКО " << std::fixed << std::setprecision(2)
+              << pupil.outerRms << " пикс." << std::endl;
+    outerEllipse = pupil.outer;
     boundary.SetEllipse(outerEllipse, true);
+    if (pupil.hasInner) {
+      std::cout << "  Экранирование: центр (" << pupil.inner.centerX << ", "
+                << pupil.inner.centerY << "), полуоси " << pupil.inner.semiAxisA
+                << " x " << pupil.inner.semiAxisB << std::endl;
+      boundary.SetEllipse(pupil.inner, false);
+    }
   } else {
-    std::cout << "\nВведите параметры эллипса (0 = автоопределение):"
-              << std::endl;
+    std::cout << "  Зрачок не найден: " << detector.GetLastError() << std::endl;
+    std::cout << "\nВведите параметры эллипса:" << std::endl;
     std::cout << "  centerX centerY semiA semiB: ";
     std::cin >> ellipseCX >> ellipseCY >> ellipseA >> ellipseB;
     outerEllipse = EllipseParams(ellipseCX, ellipseCY, ellipseA, ellipseB);
@@ -566,22 +512,9 @@ int main(int argc, char* argv[]) {
   bool valid = boundary.Validate();
   std::cout << "  Валидация: " << (valid ? "OK" : "ОШИБКА") << std::endl;
 
-  // Сохранить debug-картинку с эллипсом
-  {
-    cv::Mat img;
-    cv::cvtColor(loader.GetImage(), img, cv::COLOR_GRAY2BGR);
-    cv::ellipse(
-        img,
-        cv::Point(outerEllipse.centerX, outerEllipse.centerY),  // ← исправлено
-        cv::Size(outerEllipse.semiAxisA, outerEllipse.semiAxisB),
-        outerEllipse.angle, 0, 360, cv::Scalar(0, 255, 0), 2);
-    cv::line(img, cv::Point(outerEllipse.centerX - 5, outerEllipse.centerY),
-             cv::Point(outerEllipse.centerX + 5, outerEllipse.centerY),
-             cv::Scalar(0, 0, 255), 2);
-    cv::line(img, cv::Point(outerEllipse.centerX, outerEllipse.centerY - 5),
-             cv::Point(outerEllipse.centerX, outerEllipse.centerY + 5),
-             cv::Scalar(0, 0, 255), 2);
-    cv::imwrite(outputDir + "debug_boundary.png", img);
+  // Сохранить debug-картинку с границей (без линий, контур толще)
+  if (SaveDebugImage(outputDir + "debug_boundary.png", loader.GetImage(), {},
+                     boundary, outerEllipse, 2)) {
     std::cout << "  Граница → debug_boundary.png" << std::endl;
   }
 
@@ -686,16 +619,26 @@ int main(int argc, char* argv[]) {
   // ===================================================================
   // Этап 4: Аппроксимация
   // ===================================================================
-  std::cout << "\n[4] Аппроксимация (степень " << polyDegree << ")"
-            << std::endl;
+  DegreeSelection degreeSelection;
+  if (polyDegree > 0) {
+    degreeSelection.criterion = EDegreeCriterion::Fixed;
+    degreeSelection.degree = polyDegree;
+    std::cout << "\n[4] Аппроксимация (степень " << polyDegree << ")"
+              << std::endl;
+  } else {
+    std::cout << "\n[4] Аппроксимация (выбор степени по BIC, до "
+              << degreeSelection.degree << ")" << std::endl;
+  }
 
   CPolynomialApproximator approximator;
+  std::vector<DegreeResidual> residuals;
 
   for (int i = 0; i < (int)allLines.size(); i++) {
     std::cout << "\n  --- Линия " << i << " (" << allLines[i].size()
               << " точек) ---" << std::endl;
 
-    auto result = approximator.Approximate(allLines[i], polyDegree);
+    auto result =
+        approximator.Approximate(allLines[i], degreeSelection, &residuals);
 
     if (!result.valid) {
       std::cout << "    ОШИБКА: " << approximator.GetLastError() << std::endl;
@@ -703,6 +646,7 @@ int main(int argc, char* argv[]) {
     }
 
     std::cout << "    Степень: " << result.degree << std::endl;
+    PrintResidualTable(residuals, result.degree);
     std::cout << "    Диапазон x: [" << result.xMin << " .. " << result.xMax
               << "]" << std::endl;
     std::cout << "    Коэффициенты:" << std::endl;
@@ -732,7 +676,8 @@ int main(int argc, char* argv[]) {
   std::string debugPath = outputDir + "debug_traced.png";
   std::cout << "\n[5] Debug-изображение → " << debugPath << std::endl;
 
-  if (SaveDebugImage(debugPath, loader.GetImage(), allLines, outerEllipse)) {
+  if (SaveDebugImage(debugPath, loader.GetImage(), allLines, boundary,
+                     outerEllipse)) {
     std::cout << "  OK" << std::endl;
   } else {
     std::cout << "  Ошибка сохранения" << std::endl;
@@ -0,0 +1,1087 @@
+/**
+ * @file BatchProcess.cpp
+ * @brief Пакетная обработка интерферограмм из командной строки.
+ *
+ * Каталог (или маска файлов) обрабатывается параллельно по ядрам:
+ * загрузка → граница (PupilDetector.h: зрачок и экранирование) →
+ * трассировка полос → аппроксимация → нумерация полос (FringeOrderer.h) →
+ * [волновой фронт] → запись результатов. Для каждого кадра создаётся
+ * подкаталог с lines.csv, approx.csv и orders.csv (с -w — и wavefront.csv,
+ * с -s — project.ifp, который открывается без повторной трассировки).
+ * Архивы .frn сохраняют свои порядки. Для всего прогона — summary.csv
+ * с временем каждого этапа, instrumentation.json/.csv — суммарные
+ * замеры ядра (Instrumentation.h) по всем кадрам. В конце печатается
+ * пропускная способность (кадров/с) и суммарное/среднее время по этапам.
+ *
+ * Один кадр обрабатывается одним потоком; при -j > 1 внутренняя
+ * параллельность CFringeTracer и ApproximateBatch отключается
+ * (numThreads = 1), чтобы не умножать число потоков.
+ *
+ * @par Использование
+ * @code
+ *   BatchProcess frames/                           # все изображения каталога
+ *   BatchProcess "frames/shift1_*.bmp" -a scan     # маска, SCAN-трассировщик
+ *   BatchProcess frames/ -p batch.ini -o out -j 8 -d 6
+ *   BatchProcess frames/ -d 12 -c bic              # степень до 12 по BIC
+ *   BatchProcess archive/ -d 12                    # пересчёт архива .frn
+ *   BatchProcess frames/ -w                        # + Цернике по нумерации
+ * @endcode
+ *
+ * @par Файл параметров (INI)
+ * @code
+ *   [run]
+ *   algorithm = skeleton      ; skeleton | scan
+ *   degree = 8                ; степень аппроксимации (или верхняя граница)
+ *   criterion = fixed         ; fixed | aic | bic | plateau — выбор степени
+ *   maxLines = 20             ; стартовых точек для scan
+ *   boundaryThreshold = 0     ; = [pupil] threshold (прежнее имя)
+ *   saveImages = 0            ; debug_traced.png для каждого кадра
+ *   saveProjects = 0          ; project.ifp (ProjectFile.h) для каждого кадра
+ *   wavefront = 0             ; wavefront.csv — Цернике по всему зрачку
+ *   terms = 36                ; членов Цернике
+ *
+ *   [tracer]                  ; поля CTracerParams
+ *   maxSteps = 200
+ *   bidirectional = 1
+ *   subpixel = parabolic      ; none | parabolic | centroid
+ *
+ *   [skeleton]                ; поля CSkeletonizerParams
+ *   minLineLength = 30
+ *   pruneLength = 40
+ *
+ *   [order]                   ; поля CFringeOrderParams
+ *   scanSpacing = 4
+ *   gapFactor = 1.8
+ *   scanAngle = auto          ; auto | угол профилей в градусах
+ *
+ *   [pupil]                   ; поля CPupilDetectorParams
+ *   rays = 72
+ *   threshold = 0             ; доля от максимума яркости; 0 — автопорог
+ *   smoothRadius = 12
+ *   margin = 2
+ *   inner = 1                 ; искать центральное экранирование
+ * @endcode
+ * Ключи командной строки перекрывают значения из файла.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <locale>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EllipseBoundary.h"
+#include "FringeOrderer.h"
+#include "FringeSkeletonizer.h"
+#include "FringeTracer.h"
+#include "FrnFile.h"
+#include "ImageLoader.h"
+#include "Overlay.h"
+#include "PolynomialApproximator.h"
+#include "ProjectFile.h"
+#include "PupilDetector.h"
+#include "WavefrontFitter.h"
+
+using namespace Interferometry;
+namespace fs = std::filesystem;
+
+namespace {
+
+//=============================================================================
+// Конфигурация прогона
+//=============================================================================
+
+struct BatchConfig {
+  std::string input;
+  std::string outDir = "batch_output";
+  std::string algorithm = "skeleton";  // skeleton | scan
+  int degree = 8;
+  EDegreeCriterion criterion = EDegreeCriterion::Fixed;
+  int jobs = 0;       // 0 — по числу ядер
+  int maxLines = 20;  // стартовых точек для scan
+  bool saveImages = false;
+  bool saveProjects = false;
+  bool wavefront = false;  // Цернике по пронумерованным полосам
+  int numTerms = 36;
+
+  CTracerParams tracer;
+  CSkeletonizerParams skeleton;
+  CFringeOrderParams order;
+  CPupilDetectorParams pupil;
+};
+
+std::string Trim(const std::string& s) {
+  size_t b = 0, e = s.size();
+  while (b < e && std::isspace((unsigned char)s[b])) b++;
+  while (e > b && std::isspace((unsigned char)s[e - 1])) e--;
+  return s.substr(b, e - b);
+}
+
+std::string ToLower(std::string s) {
+  for (char& c : s) c = (char)std::tolower((unsigned char)c);
+  return s;
+}
+
+// Разбор числа без учёта системной локали (десятичная точка всегда '.')
+template <typename T>
+bool ParseValue(const std::string& text, T& out) {
+  std::istringstream in(text);
+  in.imbue(std::locale::classic());
+  T v{};
+  in >> v;
+  if (in.fail()) return false;
+  in >> std::ws;
+  if (!in.eof()) return false;
+  out = v;
+  return true;
+}
+
+bool ParseValue(const std::string& text, bool& out) {
+  std::string t = ToLower(text);
+  if (t == "1" || t == "true" || t == "yes" || t == "on") {
+    out = true;
+    return true;
+  }
+  if (t == "0" || t == "false" || t == "no" || t == "off") {
+    out = false;
+    return true;
+  }
+  return false;
+}
+
+bool ParseValue(const std::string& text, EDegreeCriterion& out) {
+  std::string t = ToLower(text);
+  if (t == "fixed")
+    out = EDegreeCriterion::Fixed;
+  else if (t == "aic")
+    out = EDegreeCriterion::AIC;
+  else if (t == "bic")
+    out = EDegreeCriterion::BIC;
+  else if (t == "plateau")
+    out = EDegreeCriterion::Plateau;
+  else
+    return false;
+  return true;
+}
+
+bool ParseValue(const std::string& text, ESubpixelMode& out) {
+  std::string t = ToLower(text);
+  if (t == "none")
+    out = ESubpixelMode::None;
+  else if (t == "parabolic")
+    out = ESubpixelMode::Parabolic;
+  else if (t == "centroid")
+    out = ESubpixelMode::Centroid;
+  else
+    return false;
+  return true;
+}
+
+/**
+ * @brief Применить пару ключ=значение из секции section.
+ * @return false — неизвестный ключ или неверное значение.
+ */
+bool ApplyParam(BatchConfig& cfg, const std::string& section,
+                const std::string& key, const std::string& value) {
+  CTracerParams& t = cfg.tracer;
+  CSkeletonizerParams& s = cfg.skeleton;
+  CFringeOrderParams& o = cfg.order;
+  CPupilDetectorParams& p = cfg.pupil;
+
+  if (section == "run") {
+    if (key == "algorithm") {
+      cfg.algorithm = ToLower(value);
+      return cfg.algorithm == "skeleton" || cfg.algorithm == "scan";
+    }
+    if (key == "degree") return ParseValue(value, cfg.degree);
+    if (key == "criterion") return ParseValue(value, cfg.criterion);
+    if (key == "jobs") return ParseValue(value, cfg.jobs);
+    if (key == "maxlines") return ParseValue(value, cfg.maxLines);
+    if (key == "boundarythreshold") return ParseValue(value, p.threshold);
+    if (key == "saveimages") return ParseValue(value, cfg.saveImages);
+    if (key == "saveprojects") return ParseValue(value, cfg.saveProjects);
+    if (key == "wavefront") return ParseValue(value, cfg.wavefront);
+    if (key == "terms") return ParseValue(value, cfg.numTerms);
+    if (key == "outdir") {
+      cfg.outDir = value;
+      return true;
+    }
+  } else if (section == "tracer") {
+    if (key == "initialwidth") return ParseValue(value, t.initialWidth);
+    if (key == "maxwidthchange") return ParseValue(value, t.maxWidthChange);
+    if (key == "intensitythreshold")
+      return ParseValue(value, t.intensityThreshold);
+    if (key == "maxsteps") return ParseValue(value, t.maxSteps);
+    if (key == "bidirectional") return ParseValue(value, t.bidirectional);
+    if (key == "curvaturecoeff") return ParseValue(value, t.curvatureCoeff);
+    if (key == "numthreads") return ParseValue(value, t.numThreads);
+    if (key == "useintegralimage")
+      return ParseValue(value, t.useIntegralImage);
+    if (key == "subpixel") return ParseValue(value, t.subpixel);
+  } else if (section == "skeleton") {
+    if (key == "gaussiankernel") return ParseValue(value, s.gaussianKernel);
+    if (key == "adaptiveblocksize")
+      return ParseValue(value, s.adaptiveBlockSize);
+    if (key == "adaptivec") return ParseValue(value, s.adaptiveC);
+    if (key == "morphkernelsize") return ParseValue(value, s.morphKernelSize);
+    if (key == "minlinelength") return ParseValue(value, s.minLineLength);
+    if (key == "computewidth") return ParseValue(value, s.computeWidth);
+    if (key == "smoothlines") return ParseValue(value, s.smoothLines);
+    if (key == "smoothwindow") return ParseValue(value, s.smoothWindow);
+    if (key == "prunelength") return ParseValue(value, s.pruneLength);
+    if (key == "linkdistance") return ParseValue(value, s.linkDistance);
+  } else if (section == "order") {
+    if (key == "scanspacing") return ParseValue(value, o.scanSpacing);
+    if (key == "gapfactor") return ParseValue(value, o.gapFactor);
+    if (key == "mergedistance") return ParseValue(value, o.mergeDistance);
+    if (key == "flipatrepeat") return ParseValue(value, o.flipAtRepeat);
+    if (key == "scanangle") {
+      o.autoAngle = ToLower(value) == "auto";
+      return o.autoAngle || ParseValue(value, o.scanAngleDeg);
+    }
+  } else if (section == "pupil") {
+    if (key == "rays") return ParseValue(value, p.numRays);
+    if (key == "worksize") return ParseValue(value, p.maxWorkSize);
+    if (key == "smoothradius") return ParseValue(value, p.smoothRadius);
+    if (key == "threshold") return ParseValue(value, p.threshold);
+    if (key == "margin") return ParseValue(value, p.margin);
+    if (key == "inner") return ParseValue(value, p.detectInner);
+    if (key == "ransaciterations") return ParseValue(value, p.ransacIterations);
+    if (key == "ransactolerance") return ParseValue(value, p.ransacTolerance);
+  }
+  return false;
+}
+
+/**
+ * @brief Чтение INI-файла параметров: [секция], ключ = значение,
+ *        комментарии с '#' или ';'. Ключи без учёта регистра.
+ */
+bool LoadParamFile(const std::string& path, BatchConfig& cfg,
+                   std::string& error) {
+  std::ifstream in(path);
+  if (!in.is_open()) {
+    error = "не удалось открыть " + path;
+    return false;
+  }
+
+  std::string section = "run";
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(in, line)) {
+    lineNo++;
+    size_t comment = line.find_first_of("#;");
+    if (comment != std::string::npos) line.erase(comment);
+    line = Trim(line);
+    if (line.empty()) continue;
+
+    if (line.front() == '[') {
+      if (line.back() != ']') {
+        error = path + ":" + std::to_string(lineNo) + ": неверная секция";
+        return false;
+      }
+      section = ToLower(Trim(line.substr(1, line.size() - 2)));
+      continue;
+    }
+
+    size_t eq = line.find('=');
+    if (eq == std::string::npos) {
+      error = path + ":" + std::to_string(lineNo) + ": ожидается ключ = значение";
+      return false;
+    }
+    std::string key = ToLower(Trim(line.substr(0, eq)));
+    std::string value = Trim(line.substr(eq + 1));
+    if (!ApplyParam(cfg, section, key, value)) {
+      error = path + ":" + std::to_string(lineNo) + ": [" + section + "] " +
+              key + " = " + value + " — неизвестный ключ или значение";
+      return false;
+    }
+  }
+  return true;
+}
+
+//=============================================================================
+// Список входных файлов
+//=============================================================================
+
+// Размер raw-кадра SCAN360 (360 x 290, 8 бит) — такие файлы без расширения
+const uintmax_t kScan360RawSize = 360u * 290u;
+
+bool IsFringeFile(const fs::path& path) {
+  return ToLower(path.extension().string()) == ".frn";
+}
+
+bool IsImageFile(const fs::path& path) {
+  std::string ext = ToLower(path.extension().string());
+  if (ext == ".bmp" || ext == ".png" || ext == ".jpg" || ext == ".jpeg" ||
+      ext == ".tif" || ext == ".tiff" || ext == ".frn")
+    return true;
+
+  std::error_code ec;
+  return ext.empty() && fs::file_size(path, ec) == kScan360RawSize && !ec;
+}
+
+// Маска имени файла: '*' — любая подстрока, '?' — один символ
+bool WildcardMatch(const std::string& pattern, const std::string& name) {
+  size_t p = 0, n = 0, star = std::string::npos, mark = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() &&
+        (pattern[p] == '?' ||
+         std::tolower((unsigned char)pattern[p]) ==
+             std::tolower((unsigned char)name[n]))) {
+      p++;
+      n++;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      mark = n;
+    } else if (star != std::string::npos) {
+      p = star + 1;
+      n = ++mark;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') p++;
+  return p == pattern.size();
+}
+
+/**
+ * @brief Файлы для обработки: один файл, все изображения каталога
+ *        или файлы каталога по маске имени (без рекурсии).
+ */
+bool CollectInputs(const std::string& input, std::vector<fs::path>& files,
+                   std::string& error) {
+  std::error_code ec;
+  fs::path in(input);
+
+  if (fs::is_regular_file(in, ec)) {
+    files.push_back(in);
+    return true;
+  }
+
+  fs::path dir = in;
+  std::string pattern;
+  if (!fs::is_directory(in, ec)) {
+    pattern = in.filename().string();
+    if (pattern.find_first_of("*?") == std::string::npos) {
+      error = "нет такого файла или каталога: " + input;
+      return false;
+    }
+    dir = in.has_parent_path() ? in.parent_path() : fs::path(".");
+  }
+
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (!it->is_regular_file(ec)) continue;
+    const fs::path& p = it->path();
+    if (!pattern.empty() && !WildcardMatch(pattern, p.filename().string()))
+      continue;
+    if (IsImageFile(p)) files.push_back(p);
+  }
+  if (ec) {
+    error = "ошибка чтения каталога " + dir.string() + ": " + ec.message();
+    return false;
+  }
+
+  std::sort(files.begin(), files.end());
+  return true;
+}
+
+//=============================================================================
+// Стартовые точки (как в PipelineTest, без отладочного вывода)
+//=============================================================================
+
+/**
+ * @brief Стартовые точки для SCAN-трассировщика: пики (и центры плато)
+ *        профиля центральной строки, самые контрастные — первыми.
+ */
+std::vector<CSeedPoint> FindStartPoints(const cv::Mat& image,
+                                        const CEllipseBoundary& boundary,
+                                        int maxPoints) {
+  const int cy = image.rows / 2;
+  const int width = image.cols;
+  const int minPeakDist = 5;
+
+  // Профиль яркости (усреднение 5 строк)
+  std::vector<float> profile(width, 0.0f);
+  for (int x = 0; x < width; x++) {
+    float sum = 0;
+    int cnt = 0;
+    for (int dy = -2; dy <= 2; dy++) {
+      int yy = cy + dy;
+      if (yy >= 0 && yy < image.rows) {
+        sum += image.at<uchar>(yy, x);
+        cnt++;
+      }
+    }
+    profile[x] = (cnt > 0) ? sum / cnt : 0;
+  }
+
+  // Первый и последний отрезок зрачка на строке cy
+  int xLeft = width, xRight = -1;
+  boundary.ForEachSpan(cy, cy + 1, [&](int, int x0, int x1) {
+    xLeft = (std::min)(xLeft, x0);
+    xRight = (std::min)(x1, width) - 1;
+  });
+
+  struct Peak {
+    int x;
+    float contrast;
+  };
+  std::vector<Peak> peaks;
+
+  for (int x = xLeft + 3; x <= xRight - 3; x++) {
+    if (!boundary.IsInside(x, cy)) continue;
+    float val = profile[x];
+
+    float leftMin = val, rightMin = val;
+    for (int d = 1; d <= 8; d++) {
+      if (x - d >= 0) leftMin = (std::min)(leftMin, profile[x - d]);
+      if (x + d < width) rightMin = (std::min)(rightMin, profile[x + d]);
+    }
+    float contrast = val - (std::min)(leftMin, rightMin);
+    if (contrast < 15) continue;
+
+    bool atTop = true;
+    for (int d = 1; d <= 3 && atTop; d++) {
+      if (x - d >= 0 && profile[x - d] > val + 1) atTop = false;
+      if (x + d < width && profile[x + d] > val + 1) atTop = false;
+    }
+    if (!atTop) continue;
+
+    int pStart = x, pEnd = x;
+    while (pStart > 0 && profile[pStart - 1] >= val - 1) pStart--;
+    while (pEnd < width - 1 && profile[pEnd + 1] >= val - 1) pEnd++;
+    int center = (pStart + pEnd) / 2;
+
+    if (!peaks.empty() && center - peaks.back().x < minPeakDist) {
+      if (contrast > peaks.back().contrast) peaks.back() = {center, contrast};
+      continue;
+    }
+    peaks.push_back({center, contrast});
+    x = pEnd;
+  }
+
+  std::sort(peaks.begin(), peaks.end(),
+            [](const Peak& a, const Peak& b) { return a.contrast > b.contrast; });
+
+  std::vector<int> xs;
+  for (const auto& peak : peaks) {
+    bool tooClose = false;
+    for (int x : xs)
+      if (std::abs(peak.x - x) < minPeakDist) tooClose = true;
+    if (tooClose) continue;
+    xs.push_back(peak.x);
+    if ((int)xs.size() >= maxPoints) break;
+  }
+  std::sort(xs.begin(), xs.end());
+
+  std::vector<CSeedPoint> seeds;
+  for (int x : xs) seeds.push_back(CSeedPoint(x, cy));
+  return seeds;
+}
+
+//=============================================================================
+// Обработка одного кадра
+//=============================================================================
+
+enum Stage { STAGE_LOAD, STAGE_BOUNDARY, STAGE_EXTRACT, STAGE_APPROX,
+             STAGE_ORDER, STAGE_WAVEFRONT, STAGE_WRITE, NUM_STAGES };
+
+const char* const kStageNames[NUM_STAGES] = {
+    "load", "boundary", "extract", "approx", "order", "wavefront", "write"};
+
+struct ImageResult {
+  std::string file;
+  bool ok = false;
+  std::string error;
+  int width = 0;
+  int height = 0;
+  int numLines = 0;
+  int numPoints = 0;
+  int numApprox = 0;  // успешно аппроксимированных линий
+  int numOrdered = 0;    // линий с порядком
+  int numConflicts = 0;  // пар линий с противоречивыми порядками
+  double wavefrontRms = std::nan("");  // RMS фронта, волн; NaN — не считался
+  double stageMs[NUM_STAGES] = {};
+  double totalMs = 0.0;
+  CInstrumentation coreStats;  // замеры этапов ядра по этому кадру
+};
+
+class StageTimer {
+ public:
+  explicit StageTimer(double& out)
+      : m_out(out), m_start(std::chrono::steady_clock::now()) {}
+  ~StageTimer() {
+    m_out += std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - m_start)
+                 .count();
+  }
+
+ private:
+  double& m_out;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+bool WriteLinesCSV(const fs::path& path,
+                   const std::vector<std::vector<CTracerPoint>>& lines) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out.imbue(std::locale::classic());
+  out << "line_id,point_idx,x,y,width,intensity\n";
+  out << std::fixed << std::setprecision(2);
+  for (size_t i = 0; i < lines.size(); i++)
+    for (size_t j = 0; j < lines[i].size(); j++) {
+      const CTracerPoint& p = lines[i][j];
+      out << i << "," << j << "," << p.PosX() << "," << p.PosY() << ","
+          << p.width << "," << p.intensity << "\n";
+    }
+  return out.good();
+}
+
+bool WriteApproxCSV(const fs::path& path,
+                    const BatchApproximationResult& results) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out.imbue(std::locale::classic());
+  out << "line_id,valid,degree,x_min,x_max,coefficients\n";
+  for (int i = 0; i < results.NumLines(); i++) {
+    const LineFitInfo& r = results.lines[i];
+    const double* c = results.Coefficients(i);
+    out << i << "," << (r.valid ? 1 : 0) << "," << r.degree << ","
+        << std::fixed << std::setprecision(2) << r.xMin << "," << r.xMax
+        << "," << std::scientific << std::setprecision(10);
+    for (int k = 0; k < r.degree; k++) out << (k ? " " : "") << c[k];
+    out << "\n";
+  }
+  return out.good();
+}
+
+const char* OrderStatusName(EOrderStatus status) {
+  switch (status) {
+    case EOrderStatus::Assigned: return "assigned";
+    case EOrderStatus::Extrapolated: return "extrapolated";
+    default: return "unassigned";
+  }
+}
+
+// Порядки линий; status пуст — порядки из архива .frn
+bool WriteOrdersCSV(const fs::path& path, const std::vector<double>& orders,
+                    const std::vector<EOrderStatus>& status) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out.imbue(std::locale::classic());
+  out << "line_id,order,status\n";
+  for (size_t i = 0; i < orders.size(); i++) {
+    out << i << ",";
+    if (!std::isnan(orders[i])) out << orders[i];
+    out << "," << (status.empty() ? "archive" : OrderStatusName(status[i]))
+        << "\n";
+  }
+  return out.good();
+}
+
+bool WriteWavefrontCSV(const fs::path& path, const CWavefrontResult& wf) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out.imbue(std::locale::classic());
+  out << std::fixed << std::setprecision(6);
+  out << "# points=" << wf.numPoints << " fit_rms=" << wf.fitRms
+      << " pv=" << wf.stats.PV << " rms=" << wf.stats.RMS
+      << " strehl=" << wf.strehl << "\n";
+  out << "term,coefficient\n";
+  for (size_t j = 0; j < wf.zernike.size(); j++)
+    out << "Z" << j + 1 << "," << wf.zernike[j] << "\n";
+  return out.good();
+}
+
+// Разметка — та же COverlay, что и в окне: контур границы по строкам маски,
+// центр эллипса, линии тонкие красные без маркера начала
+bool SaveTracedImage(const fs::path& path, const cv::Mat& image,
+                     const CEllipseBoundary& boundary,
+                     const EllipseParams& ellipse,
+                     const std::vector<std::vector<CTracerPoint>>& lines) {
+  COverlayParams params;
+  params.lineWidth = 1;
+  params.markerRadius = 0;
+  params.outerColor = MakeColor(0, 255, 0);
+  COverlay overlay;
+  overlay.SetParams(params);
+  overlay.Reset(image.cols, image.rows);
+  overlay.SetBoundary(boundary);
+  for (const auto& line : lines) overlay.AddLine(line, MakeColor(255, 0, 0));
+  if (ellipse.IsValid())
+    overlay.SetMarkers({cv::Point2f((float)ellipse.centerX,
+                                    (float)ellipse.centerY)},
+                       MakeColor(255, 0, 0), EMarkerShape::Cross);
+  return cv::imwrite(path.string(), overlay.Compose(image));
+}
+
+// Кадр: загрузка, граница (внешний эллипс и экранирование, если найдено)
+// и трассировка полос
+bool TraceImage(const fs::path& path, const BatchConfig& cfg, int innerThreads,
+                ImageResult& res, cv::Mat& image, EllipseParams& ellipse,
+                EllipseParams& inner, CEllipseBoundary& boundary,
+                std::vector<std::vector<CTracerPoint>>& lines) {
+  // --- Загрузка ---
+  ImageLoader loader;
+  {
+    StageTimer timer(res.stageMs[STAGE_LOAD]);
+    if (!loader.Load(path.string())) {
+      res.error = "не удалось загрузить";
+      return false;
+    }
+    if (!loader.IsGrayscale()) loader.ConvertToGrayscale();
+  }
+  res.coreStats.Merge(loader.GetStats());
+  image = loader.GetImage();
+  res.width = image.cols;
+  res.height = image.rows;
+
+  // --- Граница ---
+  {
+    StageTimer timer(res.stageMs[STAGE_BOUNDARY]);
+    CPupilDetector detector(cfg.pupil);
+    CPupilDetection pupil;
+    const bool found = detector.Detect(image, pupil);
+    res.coreStats.Merge(detector.GetStats());
+    if (!found) {
+      res.error = "граница: " + detector.GetLastError();
+      return false;
+    }
+    ellipse = pupil.outer;
+    if (pupil.hasInner) inner = pupil.inner;
+    boundary.Initialize(image.cols, image.rows);
+    boundary.SetEllipse(ellipse, true);
+    if (pupil.hasInner) boundary.SetEllipse(inner, false);
+    res.coreStats.Merge(boundary.GetStats());
+    if (!boundary.Validate()) {
+      res.error = "неверная граница";
+      return false;
+    }
+  }
+
+  // --- Трассировка ---
+  {
+    StageTimer timer(res.stageMs[STAGE_EXTRACT]);
+    std::unique_ptr<IFringeExtractor> extractor;
+    std::vector<CSeedPoint> seeds;
+    if (cfg.algorithm == "scan") {
+      auto t = std::make_unique<CFringeTracer>();
+      CTracerParams params = cfg.tracer;
+      if (innerThreads > 0) params.numThreads = innerThreads;
+      t->SetParams(params);
+      extractor = std::move(t);
+      seeds = FindStartPoints(image, boundary, cfg.maxLines);
+    } else {
+      auto s = std::make_unique<CFringeSkeletonizer>();
+      s->SetParams(cfg.skeleton);
+      extractor = std::move(s);
+    }
+
+    if (!extractor->Initialize(image, boundary)) {
+      res.error = "Initialize: " + extractor->GetLastError();
+      return false;
+    }
+    lines = extractor->Extract(seeds);
+    res.coreStats.Merge(extractor->GetStats());
+  }
+  return true;
+}
+
+// Архивный .frn: линии и порядки из файла, граница — по эллипсу архива
+bool ReadFringeFile(const fs::path& path, ImageResult& res,
+                    EllipseParams& ellipse, CEllipseBoundary& boundary,
+                    std::vector<std::vector<CTracerPoint>>& lines,
+                    std::vector<double>& orders) {
+  StageTimer timer(res.stageMs[STAGE_LOAD]);
+  CFrnData frn;
+  CFrnReader reader;
+  if (!reader.ReadFile(path, frn)) {
+    res.error = reader.GetLastError();
+    return false;
+  }
+  res.width = frn.imageWidth;
+  res.height = frn.imageHeight;
+  if (frn.GetOuterEllipse(ellipse) && res.width > 0 && res.height > 0) {
+    boundary.Initialize(res.width, res.height);
+    boundary.SetEllipse(ellipse, true);
+  }
+  lines = std::move(frn.lines);
+  orders = std::move(frn.orders);
+  return true;
+}
+
+// Проект кадра: ссылка на исходный файл, граница, линии, аппроксимация
+bool WriteProject(const fs::path& path, const fs::path& source,
+                  const ImageResult& res, const EllipseParams& ellipse,
+                  const EllipseParams& inner,
+                  const CEllipseBoundary& boundary,
+                  std::vector<std::vector<CTracerPoint>>& lines,
+                  BatchApproximationResult& approx,
+                  const std::vector<double>& orders) {
+  std::error_code ec;
+  fs::path absolute = fs::absolute(source, ec);
+  CProjectData project;
+  project.imagePath = (ec ? source : absolute).u8string();
+  project.SetBoundary(boundary);
+  project.imageWidth = res.width;
+  project.imageHeight = res.height;
+  project.hasOuter = ellipse.IsValid();
+  project.outerEllipse = ellipse;
+  project.hasInner = inner.IsValid();
+  project.innerEllipse = inner;
+  project.orders = orders;
+  // Буферы переносятся в проект и обратно, без копий
+  project.lines.swap(lines);
+  std::swap(project.approximation, approx);
+  CProjectWriter writer;
+  bool ok = writer.WriteFile(path, project);
+  project.lines.swap(lines);
+  std::swap(project.approximation, approx);
+  return ok;
+}
+
+ImageResult ProcessImage(const fs::path& path, const BatchConfig& cfg,
+                         int innerThreads) {
+  ImageResult res;
+  res.file = path.string();
+  auto t0 = std::chrono::steady_clock::now();
+
+  cv::Mat image;
+  EllipseParams ellipse;
+  EllipseParams inner;  // экранирование; у архива .frn — нет
+  CEllipseBoundary boundary;
+  std::vector<std::vector<CTracerPoint>> lines;
+  CFringeOrderResult order;
+  const bool archive = IsFringeFile(path);
+  if (archive) {
+    if (!ReadFringeFile(path, res, ellipse, boundary, lines, order.orders))
+      return res;
+  } else if (!TraceImage(path, cfg, innerThreads, res, image, ellipse,
+                         inner, boundary, lines)) {
+    return res;
+  }
+
+  res.numLines = (int)lines.size();
+  for (const auto& l : lines) res.numPoints += (int)l.size();
+
+  // --- Аппроксимация ---
+  BatchApproximationResult approx;
+  {
+    StageTimer timer(res.stageMs[STAGE_APPROX]);
+    CPolynomialApproximator approximator;
+    DegreeSelection selection;
+    selection.criterion = cfg.criterion;
+    selection.degree = cfg.degree;
+    approximator.ApproximateBatch(lines, selection, approx, innerThreads);
+    for (const LineFitInfo& fit : approx.lines)
+      if (fit.valid) res.numApprox++;
+    res.coreStats.Merge(approximator.GetStats());
+  }
+
+  // --- Нумерация полос (у архива — своя) ---
+  if (!archive) {
+    StageTimer timer(res.stageMs[STAGE_ORDER]);
+    CFringeOrderer orderer;
+    orderer.SetParams(cfg.order);
+    orderer.Assign(lines, boundary, order);
+    res.numConflicts = (int)order.conflicts.size();
+    res.coreStats.Merge(orderer.GetStats());
+  }
+  for (double o : order.orders)
+    if (!std::isnan(o)) res.numOrdered++;
+
+  // --- Волновой фронт ---
+  CWavefrontResult wavefront;
+  if (cfg.wavefront) {
+    StageTimer timer(res.stageMs[STAGE_WAVEFRONT]);
+    CWavefrontFitter fitter;
+    CWavefrontParams params;
+    params.numTerms = cfg.numTerms;
+    if (innerThreads > 0) params.numThreads = innerThreads;
+    fitter.SetParams(params);
+    if (fitter.Fit(lines, order.orders, boundary, wavefront))
+      res.wavefrontRms = wavefront.stats.RMS;
+    res.coreStats.Merge(fitter.GetStats());
+  }
+
+  // --- Запись ---
+  {
+    StageTimer timer(res.stageMs[STAGE_WRITE]);
+    fs::path dir = fs::path(cfg.outDir) / path.filename();
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec || !WriteLinesCSV(dir / "lines.csv", lines) ||
+        !WriteApproxCSV(dir / "approx.csv", approx) ||
+        !WriteOrdersCSV(dir / "orders.csv", order.orders, order.status) ||
+        (wavefront.valid &&
+         !WriteWavefrontCSV(dir / "wavefront.csv", wavefront))) {
+      res.error = "ошибка записи в " + dir.string();
+      return res;
+    }
+    if (cfg.saveImages && !image.empty())
+      SaveTracedImage(dir / "debug_traced.png", image, boundary, ellipse,
+                      lines);
+    if (cfg.saveProjects &&
+        !WriteProject(dir / "project.ifp", path, res, ellipse, inner,
+                      boundary, lines, approx, order.orders)) {
+      res.error = "ошибка записи проекта в " + dir.string();
+      return res;
+    }
+  }
+
+  res.totalMs = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count();
+  res.ok = true;
+  return res;
+}
+
+//=============================================================================
+// Итоги
+//=============================================================================
+
+// Значение CSV в кавычках, если в нём есть разделитель или кавычка
+std::string CsvField(const std::string& s) {
+  if (s.find_first_of(",\"\n") == std::string::npos) return s;
+  std::string q = "\"";
+  for (char c : s) q += (c == '"') ? std::string("\"\"") : std::string(1, c);
+  return q + "\"";
+}
+
+bool WriteSummaryCSV(const fs::path& path,
+                     const std::vector<ImageResult>& results) {
+  std::ofstream out(path);
+  if (!out.is_open()) return false;
+  out.imbue(std::locale::classic());
+  out << "file,status,width,height,lines,points,approx_ok,ordered,conflicts,"
+         "wf_rms";
+  for (const char* name : kStageNames) out << "," << name << "_ms";
+  out << ",total_ms,error\n";
+
+  out << std::fixed << std::setprecision(3);
+  for (const ImageResult& r : results) {
+    out << CsvField(r.file) << "," << (r.ok ? "ok" : "fail") << "," << r.width
+        << "," << r.height << "," << r.numLines << "," << r.numPoints << ","
+        << r.numApprox << "," << r.numOrdered << "," << r.numConflicts << ",";
+    if (!std::isnan(r.wavefrontRms)) out << r.wavefrontRms;
+    for (double ms : r.stageMs) out << "," << ms;
+    out << "," << r.totalMs << "," << CsvField(r.error) << "\n";
+  }
+  return out.good();
+}
+
+void PrintUsage() {
+  std::cout
+      << "Использование: BatchProcess <каталог|маска|файл> [ключи]\n"
+         "  -a, --algorithm skeleton|scan  алгоритм (по умолчанию skeleton)\n"
+         "  -p, --params FILE              INI-файл параметров\n"
+         "  -o, --out DIR                  каталог результатов "
+         "(batch_output)\n"
+         "  -j, --jobs N                   потоков (0 — по числу ядер)\n"
+         "  -d, --degree N                 степень аппроксимации (8)\n"
+         "  -c, --criterion fixed|aic|bic|plateau\n"
+         "                                 выбор степени до N (fixed)\n"
+         "  -i, --images                   сохранять debug_traced.png\n"
+         "  -s, --projects                 сохранять project.ifp\n"
+         "  -w, --wavefront                Цернике по нумерации полос "
+         "(wavefront.csv)\n";
+}
+
+}  // namespace
+
+//=============================================================================
+// Main
+//=============================================================================
+
+int main(int argc, char* argv[]) {
+  BatchConfig cfg;
+  cfg.skeleton.minLineLength = 30;  // как в PipelineTest
+  cfg.tracer.maxSteps = 200;
+  cfg.tracer.maxWidthChange = 1.5f;
+
+  // Сначала файл параметров, чтобы ключи командной строки его перекрывали
+  for (int i = 1; i + 1 < argc; i++) {
+    std::string a = argv[i];
+    if (a == "-p" || a == "--params") {
+      std::string error;
+      if (!LoadParamFile(argv[i + 1], cfg, error)) {
+        std::cerr << "Ошибка параметров: " << error << std::endl;
+        return 2;
+      }
+    }
+  }
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    bool ok = true;
+    if (a == "-h" || a == "--help") {
+      PrintUsage();
+      return 0;
+    } else if (a == "-i" || a == "--images") {
+      cfg.saveImages = true;
+    } else if (a == "-s" || a == "--projects") {
+      cfg.saveProjects = true;
+    } else if (a == "-w" || a == "--wavefront") {
+      cfg.wavefront = true;
+    } else if ((a == "-p" || a == "--params") && hasValue) {
+      i++;
+    } else if ((a == "-a" || a == "--algorithm") && hasValue) {
+      ok = ApplyParam(cfg, "run", "algorithm", argv[++i]);
+    } else if ((a == "-o" || a == "--out") && hasValue) {
+      cfg.outDir = argv[++i];
+    } else if ((a == "-j" || a == "--jobs") && hasValue) {
+      ok = ParseValue(argv[++i], cfg.jobs);
+    } else if ((a == "-d" || a == "--degree") && hasValue) {
+      ok = ParseValue(argv[++i], cfg.degree);
+    } else if ((a == "-c" || a == "--criterion") && hasValue) {
+      ok = ParseValue(argv[++i], cfg.criterion);
+    } else if (a[0] != '-' && cfg.input.empty()) {
+      cfg.input = a;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      std::cerr << "Неверный аргумент: " << a << std::endl;
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (cfg.input.empty()) {
+    PrintUsage();
+    return 2;
+  }
+
+  std::vector<fs::path> files;
+  std::string error;
+  if (!CollectInputs(cfg.input, files, error)) {
+    std::cerr << "Ошибка: " << error << std::endl;
+    return 2;
+  }
+  if (files.empty()) {
+    std::cerr << "Нет изображений: " << cfg.input << std::endl;
+    return 2;
+  }
+
+  std::error_code ec;
+  fs::create_directories(cfg.outDir, ec);
+  if (ec) {
+    std::cerr << "Не удалось создать " << cfg.outDir << ": " << ec.message()
+              << std::endl;
+    return 2;
+  }
+
+  int jobs = cfg.jobs > 0 ? cfg.jobs : (int)std::thread::hardware_concurrency();
+  jobs = (std::max)(1, (std::min)(jobs, (int)files.size()));
+  // Параллельность по кадрам — внутри кадра трассировка в один поток
+  int innerThreads = (jobs > 1) ? 1 : 0;
+
+  std::cout << "Кадров: " << files.size() << ", алгоритм: " << cfg.algorithm
+            << ", потоков: " << jobs << ", результаты: " << cfg.outDir
+            << std::endl;
+
+  std::vector<ImageResult> results(files.size());
+  std::atomic<size_t> next{0};
+  std::atomic<int> done{0};
+  std::mutex printMutex;
+
+  auto worker = [&]() {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      try {
+        results[i] = ProcessImage(files[i], cfg, innerThreads);
+      } catch (const std::exception& e) {
+        results[i].file = files[i].string();
+        results[i].error = e.what();
+      }
+
+      const ImageResult& r = results[i];
+      std::lock_guard<std::mutex> lock(printMutex);
+      std::cout << "  [" << ++done << "/" << files.size() << "] "
+                << files[i].filename().string() << ": ";
+      if (r.ok) {
+        std::cout << r.numLines << " линий, ";
+        if (r.numConflicts > 0)
+          std::cout << r.numConflicts << " конфликтов нумерации, ";
+        std::cout << std::fixed << std::setprecision(1) << r.totalMs << " мс"
+                  << std::endl;
+      }
+      else
+        std::cout << "ОШИБКА — " << r.error << std::endl;
+    }
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (int t = 1; t < jobs; t++) pool.emplace_back(worker);
+  worker();
+  for (auto& th : pool) th.join();
+  double wallMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+
+  fs::path summaryPath = fs::path(cfg.outDir) / "summary.csv";
+  if (!WriteSummaryCSV(summaryPath, results))
+    std::cerr << "Не удалось записать " << summaryPath.string() << std::endl;
+
+  // Замеры ядра по всем кадрам — для отслеживания регрессий
+  CInstrumentation coreTotal;
+  for (const ImageResult& r : results) coreTotal.Merge(r.coreStats);
+  fs::path statsPath = fs::path(cfg.outDir) / "instrumentation";
+  coreTotal.SaveJson(statsPath.string() + ".json");
+  coreTotal.SaveCsv(statsPath.string() + ".csv");
+
+  // --- Итог: пропускная способность и время по этапам ---
+  int numOk = 0;
+  double stageTotal[NUM_STAGES] = {};
+  for (const ImageResult& r : results) {
+    if (!r.ok) continue;
+    numOk++;
+    for (int s = 0; s < NUM_STAGES; s++) stageTotal[s] += r.stageMs[s];
+  }
+  int numFailed = (int)files.size() - numOk;
+
+  std::cout << "\n=== Итог ===" << std::endl;
+  std::cout << "  Успешно: " << numOk << ", ошибок: " << numFailed
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(1)
+            << "  Время: " << wallMs << " мс, "
+            << std::setprecision(2)
+            << (wallMs > 0 ? 1000.0 * files.size() / wallMs : 0.0)
+            << " кадров/с" << std::endl;
+  std::cout << "  Этап          всего, мс   на кадр, мс" << std::endl;
+  for (int s = 0; s < NUM_STAGES; s++)
+    std::cout << "  " << std::left << std::setw(10) << kStageNames[s]
+              << std::right << std::setprecision(1) << std::setw(14)
+              << stageTotal[s] << std::setprecision(2) << std::setw(14)
+              << (numOk > 0 ? stageTotal[s] / numOk : 0.0) << std::endl;
+  if (CInstrumentation::Enabled()) {
+    std::cout << "  Этапы ядра    вызовов     всего, мс" << std::endl;
+    for (int s = 0; s < CInstrumentation::NUM_STAGES; s++) {
+      const CStageStats& st = coreTotal.GetStage((EStage)s);
+      if (st.calls == 0) continue;
+      std::cout << "  " << std::left << std::setw(12)
+                << CInstrumentation::StageName((EStage)s) << std::right
+                << std::setw(9) << st.calls << std::setprecision(1)
+                << std::setw(14) << st.totalMs << std::endl;
+    }
+  }
+  std::cout << "  Сводка → " << summaryPath.string() << std::endl;
+  std::cout << "  Замеры ядра → " << statsPath.string() << ".json/.csv"
+            << std::endl;
+
+  return numFailed > 0 ? 1 : 0;
+}